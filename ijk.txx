@@ -268,6 +268,46 @@ namespace IJK {
     ETYPE * End() { return(this->element+length); };
   };
 
+  /// \brief Array stored in the class if its length is
+  ///   at most LOCAL_LENGTH.
+  /// - Memory is allocated only for longer arrays, so short arrays,
+  ///   e.g., coordinates of a point, do not allocate memory.
+  template <typename ETYPE, int LOCAL_LENGTH> class LOCAL_ARRAY {
+  protected:
+    ETYPE local_element[LOCAL_LENGTH];
+    ETYPE * element;
+
+    // Copying would share element.  Not implemented.
+    LOCAL_ARRAY(const LOCAL_ARRAY &);
+    const LOCAL_ARRAY & operator = (const LOCAL_ARRAY &);
+
+  public:
+    template <typename LTYPE>
+    LOCAL_ARRAY(const LTYPE array_length) // constructor
+    {
+      if (array_length <= LTYPE(LOCAL_LENGTH)) { element = local_element; }
+      else { element = new ETYPE[array_length]; }
+    }
+    template <typename LTYPE>
+    LOCAL_ARRAY(const LTYPE array_length, const ETYPE init_value)
+      // constructor
+    {
+      if (array_length <= LTYPE(LOCAL_LENGTH)) { element = local_element; }
+      else { element = new ETYPE[array_length]; }
+      for (LTYPE i = 0; i < array_length; i++) { element[i] = init_value; }
+    }
+    ~LOCAL_ARRAY()
+    { if (element != local_element) { delete [] element; } }
+
+    // get functions
+    ETYPE * Ptr() { return(element); };
+    const ETYPE * PtrConst() const { return(element); }
+    template <typename ITYPE>
+    ETYPE & operator [] (const ITYPE i) { return(*(element+i)); }
+    template <typename ITYPE>
+    ETYPE operator [] (const ITYPE i) const { return(*(element+i)); }
+  };
+
 
   // ********************************************************
   // TEMPLATE CLASS SET_VALUE
@@ -695,13 +735,33 @@ namespace IJK {
   protected:
     std::vector<std::string> msg;   // error messages
 
+    /// Procedure name of a procedure message preceding msg[0].
+    /// - The procedure message is stored in msg only when
+    ///   another message is added, so errors which are constructed
+    ///   but never used do not allocate memory.
+    /// - NULL if there is no such procedure message.
+    const char * pending_procname;
+
+    /// Store procedure message of pending_procname in msg.
+    void StorePendingProcMessage()
+    {
+      if (pending_procname != NULL) {
+        const char * procname = pending_procname;
+        pending_procname = NULL;
+        msg.push_back(ProcMessage(procname));
+      }
+    }
+
   public:
-    ERROR(){};
-    ERROR(const char * error_msg) { AddMessage(error_msg); };
-    ERROR(const std::string & error_msg) { AddMessage(error_msg); };
+    ERROR() { pending_procname = NULL; };
+    ERROR(const char * error_msg) 
+    { pending_procname = NULL; AddMessage(error_msg); };
+    ERROR(const std::string & error_msg) 
+    { pending_procname = NULL; AddMessage(error_msg); };
 
     ERROR(const ERROR & error)                      // copy constructor
     {
+      pending_procname = NULL;
       for (int i = 0; i < error.NumMessages(); i++)
         { msg.push_back(error.Message(i)); };
     };
@@ -709,6 +769,7 @@ namespace IJK {
     const ERROR & operator = (const ERROR & right)  // copy assignment
     {
       if (&right != this) {
+        StorePendingProcMessage();
         for (int i = 0; i < right.NumMessages(); i++)
           { msg.push_back(right.Message(i)); };
       }
@@ -719,24 +780,31 @@ namespace IJK {
     // get functions
     std::string Message(const int i) const
     {
+      if (pending_procname != NULL) {
+        if (i == 0) { return(ProcMessage(pending_procname)); }
+        if (i > 0 && i < NumMessages()) { return(msg[i-1]); }
+        return("");
+      }
+
       if (i >= 0 && i < NumMessages()) { return(msg[i]); }
       else { return(""); }
     }
-    int NumMessages() const { return(msg.size()); };
+    int NumMessages() const 
+    { return(msg.size() + ((pending_procname == NULL) ? 0 : 1)); };
 
     // get procedure error messages
-    std::string ProcMessage(const std::string & procedure_name)
+    std::string ProcMessage(const std::string & procedure_name) const
     {
       std::string error_msg = 
         "Error detected in procedure: " +  procedure_name + ".";
       return(error_msg);
     }
-    std::string ProcMessage(const char * procedure_name)
+    std::string ProcMessage(const char * procedure_name) const
     { return(ProcMessage(std::string(procedure_name))); }
 
     // set functions
     void AddMessage(const std::string & error_msg) ///< Add error message.
-    { msg.push_back(error_msg); };
+    { StorePendingProcMessage(); msg.push_back(error_msg); };
     void AddMessage(const char * error_msg)     
     { AddMessage(std::string(error_msg)); };
 
@@ -805,8 +873,21 @@ namespace IJK {
     { AddMessage(ProcMessage(procname)); };
     void AddProcMessage(const std::string & procname)
     { AddMessage(ProcMessage(procname)); };
+
+    /// Add procedure message without allocating memory.
+    /// - The message is constructed when another message is added.
+    /// @pre No messages have been added.
+    /// @pre procname is not freed before the error is destroyed,
+    ///   e.g., procname is a string literal.
+    void AddPendingProcMessage(const char * procname)
+    {
+      if (NumMessages() == 0) { pending_procname = procname; }
+      else { AddProcMessage(procname); }
+    }
+
     void SetMessage(const int i, const std::string & error_msg)
     {
+      StorePendingProcMessage();
       if (i >= 0 && i < NumMessages())
         msg[i] = error_msg;
     };
@@ -816,7 +897,7 @@ namespace IJK {
     { SetMessage(i, ProcMessage(procname)); };
     void SetProcMessage(const int i, const std::string & procname)
     { SetMessage(i, ProcMessage(procname)); };
-    void ClearAll() { msg.clear(); };
+    void ClearAll() { msg.clear(); pending_procname = NULL; };
 
     ERROR & operator ()(const std::string & msg1)
     {
@@ -843,27 +924,24 @@ namespace IJK {
 
   /// \brief Procedure error class.
   /// Includes procedure name as first error message.
+  /// - Procedure name must be a string literal or must otherwise
+  ///   outlive the error.  Constructing the error does not allocate 
+  ///   memory until a message is added.
   class PROCEDURE_ERROR:public ERROR {
 
-  protected:
-    std::string procedure_name;
-
   public:
     PROCEDURE_ERROR(const char * procedure_name)
     {
-      this->procedure_name = procedure_name;
-      AddProcMessage(procedure_name);
+      AddPendingProcMessage(procedure_name);
     };
     PROCEDURE_ERROR(const char * procedure_name, const char * error_msg)
     {
-      this->procedure_name = procedure_name;
-      AddProcMessage(procedure_name);
+      AddPendingProcMessage(procedure_name);
       AddMessage(error_msg);
     };
     PROCEDURE_ERROR(const std::string & procedure_name, 
                     const std::string & error_msg)
     {
-      this->procedure_name = procedure_name;
       AddProcMessage(procedure_name);
       AddMessage(error_msg);
     };
@@ -191,6 +191,7 @@ namespace IJKDUAL {
     VERTEX_INDEX NumIsoVert() const
     { return(vertex_coord.size()/dimension); }
 
+    /// Clear all lists.
     void Clear();
 
     /// Return false and set error message in error if isopoly_info.size() 
@@ -671,7 +672,10 @@ namespace IJKDUAL {
   void DUAL_ISOSURFACE_BASE<ISOPOLY_INFO_TYPE>::Clear()
   {
     isopoly_vert.clear();
+    isopoly_info.clear();
     vertex_coord.clear();
+    tri_vert.clear();
+    cube_containing_isopoly.clear();
     first_isov_dual_to_iso_poly = 0;
   }
 
@@ -2643,8 +2643,6 @@ namespace IJKDUALTABLE {
   void ISODUAL_TABLE_BASE<DTYPE,NTYPE,TI_TYPE,ENTRY_TYPE>::
   Init(const DTYPE2 dimension)
   {
-    const char * procname = "ISODUAL_TABLE_BASE::Init";
-
     max_num_vertices = 20;
     // Note: Even tables for polytopes of this size are probably impossible 
     //   to compute/store
@@ -1333,7 +1333,6 @@ namespace IJK {
     typedef typename GRID_TYPE::VERTEX_INDEX_TYPE VTYPE;
     typedef typename std::vector<GRID_CUBE_TYPE>::size_type SIZE_TYPE;
     typedef typename ISODUAL_TABLE::TABLE_INDEX TABLE_INDEX;
-    typedef typename ISODUAL_TABLE::FACET_BITS_TYPE FACET_BITS_TYPE;
 
     const DTYPE dimension = grid.Dimension();
     const NUM_TYPE num_cube_vertices = compute_num_cube_vertices(dimension);
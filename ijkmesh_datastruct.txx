@@ -26,8 +26,10 @@
 
 #include "ijk.txx"
 #include "ijklist.txx"
+#include "ijkthread.txx"
 
 #include <algorithm>
+#include <atomic>
 #include <numeric>
 #include <tuple>
 #include <vector>
@@ -275,6 +277,10 @@ namespace IJK {
     /// Number of polytopes.
     NTYPE num_poly;
 
+    /// Counters used by Set(poly_vert, num_vert_per_poly, num_threads).
+    /// - Kept so that repeated calls do not reallocate them.
+    ATOMIC_COUNT_ARRAY<NTYPE> loc;
+
   protected:
 
     typedef typename ETYPE::POLY_INDEX_TYPE PTYPE;
@@ -343,6 +349,18 @@ namespace IJK {
     template <typename VTYPE2, typename NTYPE2>
     void Set(const POLYMESH<VTYPE2,NTYPE2> & polymesh);
 
+    /// Set vertex poly incidence from list of polytope vertices.
+    /// - Version which reads poly_vert[] directly, without a POLYMESH copy,
+    ///   and counts and stores incidences on num_threads threads.
+    /// - Incident polytopes are listed in increasing order,
+    ///   as in Set(polymesh).
+    /// @param poly_vert[] List of polytope vertices.
+    ///   Polytope ipoly has vertices
+    ///   poly_vert[ipoly*num_vert_per_poly+k], k = 0,...
+    template <typename VTYPE2, typename NTYPE2>
+    void Set(const std::vector<VTYPE2> & poly_vert, 
+             const NTYPE2 num_vert_per_poly, const int num_threads);
+
     /// Clear all lists.
     void Clear();
   };
@@ -454,6 +472,17 @@ namespace IJK {
     /// Number of vertices.
     NTYPE num_vertices;
 
+    /// If true, each list of adjacent vertices is sorted
+    ///   in increasing order.
+    /// - Set by SetFrom2DMesh() and SetFromMeshOfCubes().
+    bool flag_sorted;
+
+    /// Buffers used by SetFromMeshOfCubes(cube_vert, cube, num_threads).
+    /// - Kept so that repeated calls do not reallocate them.
+    LIST_OF_LISTS<NTYPE,NTYPE> adjacent_with_duplicates;
+    std::vector<NTYPE> num_adjacent_buffer;
+    ATOMIC_COUNT_ARRAY<NTYPE> loc;
+
   protected:
     
     typedef typename ETYPE::VERTEX_INDEX_TYPE VTYPE;
@@ -488,7 +517,13 @@ namespace IJK {
     VTYPE AdjacentVertex(const VTYPE2 iv, const NTYPE2 j) const
     { return(Element(iv,j).Vertex()); }
 
+    /// Return true if each list of adjacent vertices is sorted
+    ///   in increasing order.
+    bool AreListsSorted() const
+    { return(flag_sorted); }
+
     /// Return true if iv1 is adjacent to iv0.
+    /// - Uses binary search if AreListsSorted() is true.
     template <typename VTYPE0, typename VTYPE1>
     bool IsAdjacent(const VTYPE0 iv0, const VTYPE1 iv1) const;
 
@@ -512,6 +547,18 @@ namespace IJK {
     (const POLYMESH<VTYPE2,NTYPE2> & polymesh,
      const CUBE_TYPE & cube);
 
+    /// Set adjacency list from list of (hyper) cube vertices.
+    /// - Version which reads cube_vert[] directly, without a POLYMESH copy,
+    ///   and builds the lists on num_threads threads.
+    /// - Adjacent vertices are sorted, as in SetFromMeshOfCubes(polymesh).
+    /// @param cube_vert[] List of cube vertices.
+    ///   Cube ihex has vertices cube_vert[ihex*cube.NumVertices()+k],
+    ///   listed in the order given in SetFromMeshOfCubes(polymesh).
+    template <typename VTYPE2, typename CUBE_TYPE>
+    void SetFromMeshOfCubes
+    (const std::vector<VTYPE2> & cube_vert, const CUBE_TYPE & cube,
+     const int num_threads);
+
     /// Clear all lists.
     void Clear();
   };
@@ -960,6 +1007,73 @@ namespace IJK {
   };
 
 
+  // *****************************************************************
+  // Set LIST_OF_LISTS on multiple threads
+  // *****************************************************************
+
+  /// Return maximum element of list, or 0 if list is empty.
+  /// - Version which scans list on num_threads threads.
+  template <typename VTYPE>
+  VTYPE get_max_element
+  (const std::vector<VTYPE> & list, const int num_threads)
+  {
+    typedef typename std::vector<VTYPE>::size_type SIZE_TYPE;
+
+    const SIZE_TYPE n = list.size();
+
+    if (n == 0) { return(0); }
+
+    const int num_ranges = compute_num_thread_ranges(num_threads, n);
+    LOCAL_ARRAY<VTYPE,NUM_LOCAL_THREAD_RANGES> range_max(num_ranges, 0);
+
+    run_on_thread_ranges
+      (num_threads, n,
+       [&](const int k, const SIZE_TYPE ibegin, const SIZE_TYPE iend)
+       { range_max[k] = 
+           *(std::max_element(list.begin()+ibegin, list.begin()+iend)); });
+
+    return(*(std::max_element
+             (range_max.PtrConst(), range_max.PtrConst()+num_ranges)));
+  }
+
+  /// Set list lengths and first elements from counts of list elements,
+  ///   and allocate array element[].
+  /// - On return, loc[i] is the location in element[]
+  ///   of the first element of list i.
+  /// @param loc[i] Number of elements of list i.
+  /// @pre loc has at least list_of_lists.NumLists() counters.
+  template <typename ETYPE, typename NTYPE>
+  void set_list_of_lists_from_counts
+  (const int num_threads, ATOMIC_COUNT_ARRAY<NTYPE> & loc,
+   LIST_OF_LISTS<ETYPE,NTYPE> & list_of_lists)
+  {
+    const NTYPE num_lists = list_of_lists.NumLists();
+
+    run_on_thread_ranges
+      (num_threads, num_lists, 
+       [&](const int, const NTYPE ibegin, const NTYPE iend)
+       {
+         for (NTYPE i = ibegin; i < iend; i++) {
+           list_of_lists.list_length[i] = 
+             loc[i].load(std::memory_order_relaxed);
+         }
+       });
+
+    list_of_lists.SetFirstElement();
+    list_of_lists.AllocArrayElement();
+
+    run_on_thread_ranges
+      (num_threads, num_lists, 
+       [&](const int, const NTYPE ibegin, const NTYPE iend)
+       {
+         for (NTYPE i = ibegin; i < iend; i++) {
+           loc[i].store(list_of_lists.first_element[i], 
+                        std::memory_order_relaxed);
+         }
+       });
+  }
+
+
   // *****************************************************************
   // POLYMESH compare
   // *****************************************************************
@@ -1157,6 +1271,95 @@ namespace IJK {
 
   }
 
+  template <typename ETYPE, typename NTYPE>
+  template <typename VTYPE2, typename NTYPE2>
+  void VERTEX_POLY_INCIDENCE_BASE<ETYPE,NTYPE>::
+  Set(const std::vector<VTYPE2> & poly_vert, 
+      const NTYPE2 num_vert_per_poly, const int num_threads)
+  {
+    IJK::PROCEDURE_ERROR error("VERTEX_POLY_INCIDENCE_BASE::Set");
+
+    Clear();
+
+    if (num_vert_per_poly <= 0) { return; }
+
+    this->num_poly = poly_vert.size()/num_vert_per_poly;
+    if (this->num_poly > 0) 
+      { this->num_vertices = get_max_element(poly_vert, num_threads)+1; }
+    this->SetNumLists(NumVertices());
+
+    if (this->num_poly == 0) { return; }
+
+    // loc[iv] is shared by all ranges.
+    loc.SetZero(NumVertices());
+
+    // Count poly incident on each vertex, skipping repeated vertices.
+    const int num_ranges = run_on_thread_ranges
+      (num_threads, this->num_poly, 
+       [&](const int, const NTYPE ibegin, const NTYPE iend)
+       {
+         for (NTYPE ipoly = ibegin; ipoly < iend; ipoly++) {
+           const VTYPE2 * vlist = &(poly_vert[ipoly*num_vert_per_poly]);
+           for (NTYPE i = 0; i < num_vert_per_poly; i++) {
+             if (!does_list_contain(vlist, i, vlist[i]))
+               { loc[vlist[i]].fetch_add(1, std::memory_order_relaxed); }
+           }
+         }
+       });
+
+    set_list_of_lists_from_counts(num_threads, loc, *this);
+
+    // Store poly.  loc[iv] is the next free location.
+    run_on_thread_ranges
+      (num_threads, this->num_poly, 
+       [&](const int, const NTYPE ibegin, const NTYPE iend)
+       {
+         for (NTYPE ipoly = ibegin; ipoly < iend; ipoly++) {
+           const VTYPE2 * vlist = &(poly_vert[ipoly*num_vert_per_poly]);
+           for (NTYPE i = 0; i < num_vert_per_poly; i++) {
+             const VTYPE2 iv = vlist[i];
+             if (!does_list_contain(vlist, i, iv)) {
+               const NTYPE j = loc[iv].fetch_add(1, std::memory_order_relaxed);
+               this->element[j].SetPolyIndex(ipoly);
+             }
+           }
+         }
+       });
+
+    // Ranges store poly in arbitrary order.
+    // Sort each list by poly index to match the serial order.
+    if (num_ranges > 1) {
+      run_on_thread_ranges
+        (num_threads, NumVertices(), 
+         [&](const int, const NTYPE ibegin, const NTYPE iend)
+         {
+           for (NTYPE iv = ibegin; iv < iend; iv++) {
+             const NTYPE j = this->FirstElement(iv);
+             std::sort(this->element.begin()+j, 
+                       this->element.begin()+j+this->ListLength(iv),
+                       [](const ETYPE & a, const ETYPE & b)
+                       { return(a.PolyIndex() < b.PolyIndex()); });
+           }
+         });
+    }
+
+    // Check stored correct number of poly for each vertex.
+    for (NTYPE iv = 0; iv < NumVertices(); iv++) {
+      const NTYPE last_loc = loc[iv].load(std::memory_order_relaxed);
+      if (last_loc != this->FirstElement(iv)+this->ListLength(iv)) {
+        error.AddMessage
+          ("Programming error.  Incorrect storage of poly vertices.");
+        error.AddMessage
+          ("  num_incident_poly[", iv, "] = ", this->ListLength(iv), ".");
+        error.AddMessage
+          ("  Stored ", last_loc-this->FirstElement(iv), 
+           " incident poly.");
+        throw error;
+      }
+    }
+
+  }
+
   template <typename ETYPE, typename NTYPE>
   void VERTEX_POLY_INCIDENCE_BASE<ETYPE,NTYPE>::Clear()
   {
@@ -1228,8 +1431,24 @@ namespace IJK {
   bool VERTEX_ADJACENCY_LIST_BASE<ETYPE,NTYPE>::
   IsAdjacent(const VTYPE0 iv0, const VTYPE1 iv1) const
   {
+    const NTYPE list_length = this->ListLength(iv0);
+
+    if (list_length == 0) { return(false); }
+
     const ETYPE * list = this->List(iv0);
-    for (NTYPE i = 0; i < this->ListLength(iv0); i++) {
+
+    if (flag_sorted) {
+      NTYPE ilow = 0;
+      NTYPE ihigh = list_length;
+      while (ilow < ihigh) {
+        const NTYPE imid = ilow + (ihigh-ilow)/2;
+        if (list[imid].Vertex() < iv1) { ilow = imid+1; }
+        else { ihigh = imid; }
+      }
+      return(ilow < list_length && list[ilow].Vertex() == iv1);
+    }
+
+    for (NTYPE i = 0; i < list_length; i++) {
       if (list[i].Vertex() == iv1) { return(true); }
     }
 
@@ -1364,6 +1583,7 @@ namespace IJK {
       }
     }
 
+    flag_sorted = true;
   }
 
 
@@ -1472,6 +1692,142 @@ namespace IJK {
       }
     }
 
+    flag_sorted = true;
+  }
+
+
+  template <typename ETYPE, typename NTYPE>
+  template <typename VTYPE2, typename CUBE_TYPE>
+  void VERTEX_ADJACENCY_LIST_BASE<ETYPE,NTYPE>::
+  SetFromMeshOfCubes(const std::vector<VTYPE2> & cube_vert,
+                     const CUBE_TYPE & cube, const int num_threads)
+  {
+    typedef typename CUBE_TYPE::DIMENSION_TYPE DTYPE;
+
+    const DTYPE dimension = cube.Dimension();
+    const NTYPE num_cube_vertices = cube.NumVertices();
+    LIST_OF_LISTS<NTYPE,NTYPE> & adjacent = adjacent_with_duplicates;
+    std::vector<NTYPE> & num_adjacent = num_adjacent_buffer;
+    IJK::PROCEDURE_ERROR error("VERTEX_ADJACENCY_LIST::SetFromMeshOfCubes");
+ 
+    Clear();
+
+    if (num_cube_vertices <= 1) { return; }
+
+    const NTYPE num_cubes = cube_vert.size()/num_cube_vertices;
+    if (num_cubes > 0) { 
+      const int numv = get_max_element(cube_vert, num_threads)+1; 
+      SetNumVertices(numv);
+    }
+
+    if (NumVertices() == 0) { return; };
+
+    // loc[iv] is shared by all ranges.
+    loc.SetZero(NumVertices());
+
+    // Count cube edges incident on each vertex, including duplicates.
+    run_on_thread_ranges
+      (num_threads, num_cubes, 
+       [&](const int, const NTYPE ibegin, const NTYPE iend)
+       {
+         for (NTYPE icube = ibegin; icube < iend; icube++) {
+           const VTYPE2 * vlist = &(cube_vert[icube*num_cube_vertices]);
+           for (NTYPE i0 = 0; i0 < num_cube_vertices; i0++) {
+             const VTYPE iv0 = vlist[i0];
+             for (DTYPE d = 0; d < dimension; d++) {
+               const VTYPE iv1 = vlist[cube.VertexNeighbor(i0,d)];
+               if (iv0 < iv1) {
+                 loc[iv0].fetch_add(1, std::memory_order_relaxed);
+                 loc[iv1].fetch_add(1, std::memory_order_relaxed);
+               }
+             }
+           }
+         }
+       });
+
+    adjacent.SetNumLists(NumVertices());
+    set_list_of_lists_from_counts(num_threads, loc, adjacent);
+
+    // Store adjacent vertices.  loc[iv] is the next free location.
+    // - Ranges store vertices in arbitrary order.  Lists are sorted below.
+    run_on_thread_ranges
+      (num_threads, num_cubes, 
+       [&](const int, const NTYPE ibegin, const NTYPE iend)
+       {
+         for (NTYPE icube = ibegin; icube < iend; icube++) {
+           const VTYPE2 * vlist = &(cube_vert[icube*num_cube_vertices]);
+           for (NTYPE i0 = 0; i0 < num_cube_vertices; i0++) {
+             const VTYPE iv0 = vlist[i0];
+             for (DTYPE d = 0; d < dimension; d++) {
+               const VTYPE iv1 = vlist[cube.VertexNeighbor(i0,d)];
+               if (iv0 < iv1) {
+                 const NTYPE j0 = 
+                   loc[iv0].fetch_add(1, std::memory_order_relaxed);
+                 adjacent.element[j0] = iv1;
+                 const NTYPE j1 = 
+                   loc[iv1].fetch_add(1, std::memory_order_relaxed);
+                 adjacent.element[j1] = iv0;
+               }
+             }
+           }
+         }
+       });
+
+    // Check stored correct number of adjacent vertices for each vertex.
+    for (NTYPE iv = 0; iv < NumVertices(); iv++) {
+      const NTYPE last_loc = loc[iv].load(std::memory_order_relaxed);
+      if (last_loc != 
+          adjacent.first_element[iv]+adjacent.list_length[iv]) {
+        error.AddMessage
+          ("Programming error.  Problem computing vertices adjacent to vertex ",
+           iv, ".");
+        error.AddMessage
+          ("  Expected ", adjacent.list_length[iv], 
+           " vertices (including duplicates)");
+        error.AddMessage
+          ("  but computed ", last_loc-adjacent.first_element[iv],
+           " adjacent vertices.");
+        throw error;
+      }
+    }
+
+    // Sort adjacent vertices and count distinct vertices in each list.
+    num_adjacent.resize(NumVertices());
+    run_on_thread_ranges
+      (num_threads, NumVertices(), 
+       [&](const int, const NTYPE ibegin, const NTYPE iend)
+       {
+         for (NTYPE iv = ibegin; iv < iend; iv++) {
+           const NTYPE j = adjacent.first_element[iv];
+           std::sort(adjacent.element.begin()+j, 
+                     adjacent.element.begin()+j+adjacent.list_length[iv]);
+           num_adjacent[iv] = adjacent.CountNumDistinct(iv);
+         }
+       });
+
+    AllocateLists(num_adjacent);
+
+    // Copy distinct adjacent vertices.
+    run_on_thread_ranges
+      (num_threads, NumVertices(), 
+       [&](const int, const NTYPE ibegin, const NTYPE iend)
+       {
+         for (NTYPE iv = ibegin; iv < iend; iv++) {
+           if (this->list_length[iv] == 0) { continue; }
+           const NTYPE k = adjacent.first_element[iv];
+           NTYPE n = 0;
+           this->ElementRef(iv, n).SetVertex(adjacent.element[k]);
+           n++;
+           for (NTYPE j = 1; j < adjacent.list_length[iv]; j++) {
+             if (adjacent.element[k+j] != adjacent.element[k+j-1]) {
+               this->ElementRef(iv, n).SetVertex(adjacent.element[k+j]);
+               n++;
+             }
+           }
+         }
+       });
+
+    flag_sorted = true;
   }
 
 
@@ -1479,6 +1835,7 @@ namespace IJK {
   void VERTEX_ADJACENCY_LIST_BASE<ETYPE,NTYPE>::Clear()
   {
     num_vertices = 0;
+    flag_sorted = false;
     LIST_OF_LISTS<ETYPE,NTYPE>::Clear();
   }
 
@@ -0,0 +1,190 @@
+/// \file ijkthread.txx
+/// ijk templates for running loops on multiple threads.
+/// - Version 0.1.0
+
+/*
+  IJK: Isosurface Jeneration Kode
+  Copyright (C) 2017-2018 Rephael Wenger
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public License
+  (LGPL) as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef _IJKTHREAD_
+#define _IJKTHREAD_
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace IJK {
+
+  // **************************************************
+  // SPLIT INTO RANGES
+  // **************************************************
+
+  /// Number of ranges whose per range values fit in
+  ///   IJK::LOCAL_ARRAY<T,NUM_LOCAL_THREAD_RANGES> without 
+  ///   allocating memory.
+  const int NUM_LOCAL_THREAD_RANGES = 16;
+
+  /// Return number of ranges used to split num_items among num_threads.
+  /// - Returns at least 1 and at most num_items ranges.
+  template <typename NTYPE>
+  inline int compute_num_thread_ranges
+  (const int num_threads, const NTYPE num_items)
+  {
+    if (num_threads <= 1 || num_items <= 1) { return(1); }
+    if (NTYPE(num_threads) > num_items) { return(int(num_items)); }
+    return(num_threads);
+  }
+
+  /// Get range [ibegin,iend) of k'th of num_ranges contiguous ranges
+  ///   partitioning [0,num_items).
+  /// - Ranges are ordered, i.e., range k precedes range k+1.
+  template <typename NTYPE>
+  inline void get_thread_range
+  (const int k, const int num_ranges, const NTYPE num_items,
+   NTYPE & ibegin, NTYPE & iend)
+  {
+    ibegin = NTYPE((long(num_items)*k)/num_ranges);
+    iend = NTYPE((long(num_items)*(k+1))/num_ranges);
+  }
+
+
+  // **************************************************
+  // RUN ON MULTIPLE THREADS
+  // **************************************************
+
+  /// Partition [0,num_items) into contiguous ranges and call
+  ///   f(k, ibegin, iend) on each range k in its own thread.
+  /// - If num_threads <= 1, call f(0, 0, num_items) in the calling thread.
+  /// - Returns the number of ranges.
+  /// - f must only write data owned by range k.
+  template <typename NTYPE, typename FTYPE>
+  int run_on_thread_ranges
+  (const int num_threads, const NTYPE num_items, FTYPE f)
+  {
+    const int num_ranges = compute_num_thread_ranges(num_threads, num_items);
+
+    if (num_ranges == 1) {
+      f(0, NTYPE(0), num_items);
+      return(num_ranges);
+    }
+
+    // Store threads in local_thread unless there are more than
+    //   NUM_LOCAL_THREAD_RANGES ranges.
+    // - Each std::thread still allocates its own state.
+    std::thread local_thread[NUM_LOCAL_THREAD_RANGES];
+    std::vector<std::thread> thread_list;
+    std::thread * thread_k = local_thread;
+    if (num_ranges > NUM_LOCAL_THREAD_RANGES) {
+      thread_list.resize(num_ranges);
+      thread_k = thread_list.data();
+    }
+
+    for (int k = 1; k < num_ranges; k++) {
+      NTYPE ibegin, iend;
+      get_thread_range(k, num_ranges, num_items, ibegin, iend);
+      thread_k[k] = std::thread(f, k, ibegin, iend);
+    }
+
+    // Range 0 is run in the calling thread.
+    NTYPE ibegin, iend;
+    get_thread_range(0, num_ranges, num_items, ibegin, iend);
+    f(0, ibegin, iend);
+
+    for (int k = 1; k < num_ranges; k++)
+      { thread_k[k].join(); }
+
+    return(num_ranges);
+  }
+
+
+  // **************************************************
+  // ATOMIC COUNTERS
+  // **************************************************
+
+  /// Array of atomic counters shared by all threads.
+  /// - Counters are reused by repeated calls to SetZero(),
+  ///   so memory is allocated only if the number of counters increases.
+  /// - Copying an ATOMIC_COUNT_ARRAY does not copy the counters.
+  template <typename NTYPE>
+  class ATOMIC_COUNT_ARRAY {
+
+  protected:
+    std::vector< std::atomic<NTYPE> > count;
+
+  public:
+    ATOMIC_COUNT_ARRAY() {};
+    ATOMIC_COUNT_ARRAY(const ATOMIC_COUNT_ARRAY &) {};
+    const ATOMIC_COUNT_ARRAY & operator = (const ATOMIC_COUNT_ARRAY &)
+    { return(*this); }
+
+    /// Set counters 0,...,n-1 to zero.
+    /// - Reallocates only if there are fewer than n counters.
+    template <typename NTYPE2>
+    void SetZero(const NTYPE2 n)
+    {
+      if (count.size() < std::size_t(n)) {
+        // std::atomic is not movable, so count cannot be resized.
+        std::vector< std::atomic<NTYPE> >(n).swap(count);
+      }
+      for (NTYPE2 i = 0; i < n; i++) 
+        { count[i].store(0, std::memory_order_relaxed); }
+    }
+
+    template <typename ITYPE>
+    std::atomic<NTYPE> & operator [] (const ITYPE i)
+    { return(count[i]); }
+  };
+
+
+  // **************************************************
+  // CONCATENATE PER THREAD LISTS
+  // **************************************************
+
+  /// Set number of lists to at least num_ranges and clear every list.
+  /// - Lists are not freed and keep their capacity, so lists
+  ///   reused by repeated calls are not reallocated.
+  template <typename ETYPE>
+  void clear_thread_lists
+  (const int num_ranges, std::vector< std::vector<ETYPE> > & list_k)
+  {
+    if (list_k.size() < std::size_t(num_ranges))
+      { list_k.resize(num_ranges); }
+
+    for (std::size_t k = 0; k < list_k.size(); k++)
+      { list_k[k].clear(); }
+  }
+
+  /// Append list_k[0], list_k[1], ..., in order, to list.
+  template <typename ETYPE>
+  void append_thread_lists
+  (const std::vector< std::vector<ETYPE> > & list_k,
+   std::vector<ETYPE> & list)
+  {
+    std::size_t n = list.size();
+    for (std::size_t k = 0; k < list_k.size(); k++)
+      { n += list_k[k].size(); }
+
+    list.reserve(n);
+    for (std::size_t k = 0; k < list_k.size(); k++)
+      { list.insert(list.end(), list_k[k].begin(), list_k[k].end()); }
+  }
+
+}
+
+#endif
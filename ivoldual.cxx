@@ -22,6 +22,8 @@
 */
 
 
+#include <algorithm>
+
 #include "ijkisopoly.txx"
 #include "ijkmesh.txx"
 #include "ijkmesh_datastruct.txx"
@@ -33,6 +35,7 @@
 #include "ijkdual_query.txx"
 
 #include "ivoldual_ivolpoly.txx"
+#include "ivoldual_thread.txx"
 
 #include "ivoldual.h"
 #include "ivoldual_datastruct.h"
@@ -44,6 +47,11 @@
 
 #include "ijktriangulate.txx"
 
+#if defined(__SSE2__) && !defined(IVOLDUAL_NO_SIMD)
+#define IVOLDUAL_USE_SSE2
+#include <emmintrin.h>
+#endif
+
 using namespace IJK;
 using namespace IVOLDUAL;
 
@@ -61,35 +69,19 @@ void IVOLDUAL::dual_contouring_interval_volume
  const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
  DUAL_INTERVAL_VOLUME & dual_interval_volume, IVOLDUAL_INFO & dualiso_info)
 {
-  const int dimension = ivoldual_data.ScalarGrid().Dimension();
-  const AXIS_SIZE_TYPE * axis_size = ivoldual_data.ScalarGrid().AxisSize();
-  PROCEDURE_ERROR error("dual_contouring_interval_volume");
-
-  clock_t t_start = clock();
-
-  if (!ivoldual_data.Check(error)) { throw error; };
-
-  dual_interval_volume.Clear();
-  dualiso_info.time.Clear();
-
-  IJKDUAL::ISO_MERGE_DATA merge_data(dimension, axis_size);
+  const IVOLDUAL_EXTRACT_OPTIONS options;
 
   dual_contouring_interval_volume
-    (ivoldual_data.ScalarGrid(), isovalue0, isovalue1, ivoldual_data,
-     dual_interval_volume.isopoly_vert, dual_interval_volume.isopoly_info, 
-     dual_interval_volume.ivolv_list,
-     dual_interval_volume.vertex_coord, merge_data, dualiso_info);
-
-  // store times
-  clock_t t_end = clock();
-  clock2seconds(t_end-t_start, dualiso_info.time.total);
+    (ivoldual_data, isovalue0, isovalue1, options, 
+     dual_interval_volume, dualiso_info);
 }
 
 
 // Construct interval volume using dual contouring.
 // - Returns list of interval volume polytope vertices
 //   and list of interval volume vertex coordinates.
-// - Version which creates ivoldual_table and ivolv_list.
+// - Version which gets ivoldual_table from the table cache
+//   and creates ivolv_list.
 void IVOLDUAL::dual_contouring_interval_volume
 (const DUALISO_SCALAR_GRID_BASE & scalar_grid,
  const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
@@ -103,8 +95,8 @@ void IVOLDUAL::dual_contouring_interval_volume
   const int dimension = scalar_grid.Dimension();
   const bool flag_separate_neg = param.SeparateNegFlag();
 
-  IVOLDUAL_CUBE_TABLE
-    ivoldual_table(dimension, flag_separate_neg);
+  const IVOLDUAL_CUBE_TABLE & ivoldual_table = 
+    get_ivoldual_cube_table(dimension, flag_separate_neg, param.table_filename);
   DUAL_IVOLVERT_ARRAY ivolv_list;
 
   dual_contouring_interval_volume
@@ -116,7 +108,7 @@ void IVOLDUAL::dual_contouring_interval_volume
 // Construct interval volume using dual contouring.
 // - Returns list of interval volume polytope vertices
 //   and list of interval volume vertex coordinates.
-// - Version which creates ivoldual_table.
+// - Version which gets ivoldual_table from the table cache.
 void IVOLDUAL::dual_contouring_interval_volume
 (const DUALISO_SCALAR_GRID_BASE & scalar_grid,
  const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
@@ -131,8 +123,8 @@ void IVOLDUAL::dual_contouring_interval_volume
   const int dimension = scalar_grid.Dimension();
   const bool flag_separate_neg = param.SeparateNegFlag();
 
-  IVOLDUAL_CUBE_TABLE
-    ivoldual_table(dimension, flag_separate_neg);
+  const IVOLDUAL_CUBE_TABLE & ivoldual_table = 
+    get_ivoldual_cube_table(dimension, flag_separate_neg, param.table_filename);
 
   dual_contouring_interval_volume
     (scalar_grid, isovalue0, isovalue1, ivoldual_table, param, ivolpoly_vert, 
@@ -156,12 +148,13 @@ void IVOLDUAL::dual_contouring_interval_volume
  MERGE_DATA & merge_data, 
  IVOLDUAL_INFO & dualiso_info)
 {
-  std::vector<GRID_CUBE_DATA> cube_ivolv_list;
+  IVOLDUAL_EXTRACT_OPTIONS options;
+
+  options.SetMergeData(merge_data);
 
   dual_contouring_interval_volume
-    (scalar_grid, isovalue0, isovalue1, ivoldual_table, param, ivolpoly_vert,
-     cube_ivolv_list, ivolv_list, ivolpoly_info, vertex_coord, 
-     merge_data, dualiso_info);
+    (scalar_grid, isovalue0, isovalue1, ivoldual_table, param, options,
+     ivolpoly_vert, ivolv_list, ivolpoly_info, vertex_coord, dualiso_info);
 }
 
 
@@ -181,169 +174,725 @@ void IVOLDUAL::dual_contouring_interval_volume
  MERGE_DATA & merge_data, 
  IVOLDUAL_INFO & dualiso_info)
 {
-  const int dimension = scalar_grid.Dimension();
-  const bool flag_separate_neg = param.SeparateNegFlag();
-  const bool flag_always_separate_opposite(true);
-  const GRID_VERTEX_ENCODING default_interior_code =
-    param.default_interior_code;
-  const VERTEX_INDEX num_grid_vertices = scalar_grid.NumVertices();
-  int num_non_manifold_split(0);
-  IJK::ARRAY<VERTEX_INDEX> index_to_cube_list
-    (num_grid_vertices, num_grid_vertices);
-  IVOL_POLYMESH polymesh;
-  IVOL_VERTEX_ADJACENCY_LIST vertex_adjacency_list(dimension);
-  CUBE_FACE_INFO cube_info(dimension);
-  IJK::PROCEDURE_ERROR error("dual_contouring_interval_volume");
-  clock_t t0, t1, t2;
-
-  if (scalar_grid.Dimension() != ivoldual_table.Dimension()) {
-    error.AddMessage
-      ("Programming error.  Incorrect isodual table dimension.");
-    error.AddMessage
-      ("  Interval volume table dimension does not match scalar grid dimension.");
-    error.AddMessage
-      ("    Interval volume table dimension: ", ivoldual_table.Dimension(), "");
-    error.AddMessage
-      ("    Scalar grid dimension: ", scalar_grid.Dimension(), "");
-    throw error;
+  IVOLDUAL_CONTEXT context;
+  IVOLDUAL_EXTRACT_OPTIONS options;
+
+  options.SetContext(context);
+  options.SetMergeData(merge_data);
+
+  // Construct cube_ivolv_list in context.cube_ivolv_list.
+  context.cube_ivolv_list.swap(cube_ivolv_list);
+
+  dual_contouring_interval_volume
+    (scalar_grid, isovalue0, isovalue1, ivoldual_table, param, options,
+     ivolpoly_vert, ivolv_list, ivolpoly_info, vertex_coord, dualiso_info);
+
+  cube_ivolv_list.swap(context.cube_ivolv_list);
+}
+
+
+namespace {
+
+  /// Ratio of grid vertices to polytope vertices 
+  ///   above which AUTO_CUBE_INDEX selects a sparse index.
+  /// - Dense index and merge data use about 9 bytes per grid vertex.
+  ///   Sparse cube list uses about 20 bytes per active cube.
+  const VERTEX_INDEX SPARSE_CUBE_INDEX_RATIO = 4;
+
+  // Return true if cubes should be located with a sparse cube list.
+  // @param num_poly_vert Number of polytope vertices
+  //   before merging.  Upper bound on the number of active cubes.
+  bool use_sparse_cube_index
+  (const CUBE_INDEX_METHOD cube_index_method,
+   const VERTEX_INDEX num_poly_vert, const VERTEX_INDEX num_grid_vertices)
+  {
+    if (cube_index_method == SPARSE_CUBE_INDEX) { return(true); }
+    if (cube_index_method == DENSE_CUBE_INDEX) { return(false); }
+
+    return(num_poly_vert < num_grid_vertices/SPARSE_CUBE_INDEX_RATIO);
   }
 
-  t0 = clock();
 
-  ivolpoly_vert.clear();
-  dualiso_info.time.Clear();
+  // Construct interval volume from polytopes extracted into
+  //   context.ivolpoly and context.poly_vertex.
+  // - Merge, split and position interval volume vertices
+  //   and improve the interval volume mesh.
+  // @param flag_active_cube_list If true, copy cube table indices 
+  //   from active_cube_list.  Otherwise, compute table indices 
+  //   from encoded_grid.
+  //   - If true, only encodings of vertices of active cubes are read.
+  // @param ivolpoly_info Information about the extracted polytopes.
+  // - Adds the time of each stage to dualiso_info.profile.
+  //   Time to encode the grid and extract the polytopes 
+  //   should already be in dualiso_info.profile.
+  // @param context Buffers for intermediate results.
+  //   - Buffers in context keep their capacity for the next extraction.
+  void dual_contouring_interval_volume_from_ivolpoly
+  (const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+   const IVOLDUAL_ENCODED_GRID & encoded_grid,
+   const bool flag_active_cube_list,
+   const ACTIVE_CUBE_ARRAY & active_cube_list,
+   const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+   const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+   const IVOLDUAL_DATA_FLAGS & param,
+   std::vector<ISO_VERTEX_INDEX> & ivolpoly_vert,
+   std::vector<GRID_CUBE_DATA> & cube_ivolv_list,
+   DUAL_IVOLVERT_ARRAY & ivolv_list,
+   IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
+   COORD_ARRAY & vertex_coord,
+   MERGE_DATA * merge_data, 
+   IVOLDUAL_CONTEXT & context,
+   IVOLDUAL_INFO & dualiso_info)
+  {
+    const int dimension = scalar_grid.Dimension();
+    const bool flag_separate_neg = param.SeparateNegFlag();
+    const bool flag_always_separate_opposite(true);
+    const VERTEX_INDEX num_grid_vertices = scalar_grid.NumVertices();
+    const int num_threads = param.num_threads;
+    int num_non_manifold_split(0);
+    std::vector<VERTEX_INDEX> & index_to_cube_list = 
+      context.index_to_cube_list;
+    IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list =
+      context.vertex_adjacency_list;
+    const IVOLDUAL::CUBE_FACE_INFO & cube_info = ivoldual_table.Cube();
+    IVOLDUAL_PROFILE & profile = dualiso_info.profile;
+    PROFILE_TIMER timer;
+
+    cube_ivolv_list.clear();
+    ivolv_list.clear();
+
+    std::vector<ISO_VERTEX_INDEX> & ivolpoly = context.ivolpoly;
+    std::vector<POLY_VERTEX_INDEX> & poly_vertex = context.poly_vertex;
+
+    std::vector<ISO_VERTEX_INDEX> & cube_list = context.cube_list;
+    std::vector<ISO_VERTEX_INDEX> & ivolpoly_cube = context.ivolpoly_cube;
+    const bool flag_sparse = use_sparse_cube_index
+      (param.cube_index_method, ivolpoly.size(), num_grid_vertices);
+    if (flag_sparse) {
+      merge_identical
+        (ivolpoly, cube_list, ivolpoly_cube, context.sparse_cube_list);
+    }
+    else if (merge_data != NULL) {
+      merge_identical(ivolpoly, cube_list, ivolpoly_cube, *merge_data);
+    }
+    else {
+      merge_identical
+        (ivolpoly, cube_list, ivolpoly_cube, context.MergeData(scalar_grid));
+    }
+    profile.AddTime(PROFILE_MERGE, timer);
 
-  IVOLDUAL_ENCODED_GRID encoded_grid;
-  if (param.flag_set_interior_code_from_scalar) {
-    encode_grid_vertices_set_interior_from_scalar
-      (scalar_grid, isovalue0, isovalue1, encoded_grid, dualiso_info);
+    set_grid_cube_indices(cube_list, cube_ivolv_list);
+    set_grid_coord(scalar_grid, cube_ivolv_list);
+
+    // Cubes in sparse_cube_list have the same locations
+    //   as in cube_ivolv_list.
+    if (!flag_sparse) {
+      context.AllocateIndexToCubeList(scalar_grid);
+      IJK::set_index_to_cube_list(cube_ivolv_list, index_to_cube_list);
+    }
+    const INDEX_TO_CUBE_LIST cube_index = flag_sparse ?
+      INDEX_TO_CUBE_LIST(context.sparse_cube_list, num_grid_vertices) :
+      INDEX_TO_CUBE_LIST(index_to_cube_list.data(), num_grid_vertices);
+
+    if (flag_active_cube_list) {
+      set_cube_ivoltable_info
+        (active_cube_list, cube_index, ivoldual_table, cube_ivolv_list);
+    }
+    else {
+      set_cube_ivoltable_info
+        (encoded_grid, ivoldual_table, num_threads, cube_ivolv_list);
+    }
+    profile.AddTime(PROFILE_TABLE_INFO, timer);
+
+    if (param.flag_split_ambig_pairsB) {
+      // *** Probably not necessary
+      split_non_manifold_ivolv_pairs_ambigB
+        (encoded_grid, ivoldual_table, cube_index, cube_ivolv_list,
+         num_non_manifold_split);
+    }
+    else if (param.flag_split_ambig_pairsC) {
+      split_non_manifold_ivolv_pairs_ambigC
+        (encoded_grid, ivoldual_table, cube_index, cube_ivolv_list,
+         num_non_manifold_split);
+    }
+    else if (param.flag_split_ambig_pairs) {
+      split_non_manifold_ivolv_pairs_ambig
+        (encoded_grid, ivoldual_table, cube_index, cube_ivolv_list,
+         num_non_manifold_split);
+    }
+    else if (param.flag_split_ambig_pairsD) {
+      split_non_manifold_ivolv_pairs_ambigD
+        (encoded_grid, ivoldual_table, cube_index, cube_ivolv_list,
+         num_non_manifold_split);
+    }
+    if (param.flag_split_ambig_pairs || param.flag_split_ambig_pairsB ||
+        param.flag_split_ambig_pairsC || param.flag_split_ambig_pairsD)
+      { profile.AddTime(PROFILE_AMBIG_SPLIT, timer); }
+
+    VERTEX_INDEX num_split;
+    split_dual_ivolvert
+      (ivoldual_table, num_threads, ivolpoly_cube, poly_vertex, ivolpoly_info,
+       cube_ivolv_list, ivolv_list, ivolpoly_vert, num_split);
+    profile.AddTime(PROFILE_VERTEX_SPLIT, timer);
+
+    const IJKDUAL::ISODUAL_CUBE_TABLE_AMBIG & isodual_table =
+      get_isodual_cube_table_ambig
+      (dimension, flag_separate_neg, flag_always_separate_opposite);
+    context.edge_isect_cache.Set
+      (scalar_grid, cube_ivolv_list, cube_index, isovalue0, isovalue1,
+       num_threads);
+    position_all_dual_ivol_vertices
+      (scalar_grid, ivoldual_table, isodual_table, isovalue0, isovalue1, 
+       context.edge_isect_cache, num_threads, ivolv_list, vertex_coord);
+    context.edge_isect_cache.Clear();
+    profile.AddTime(PROFILE_POSITION, timer);
+
+    vertex_adjacency_list.SetFromMeshOfCubes
+      (ivolpoly_vert, cube_info, num_threads);
+    vertex_adjacency_list.SetAllDualFacetsFromVertexAndCubeLists
+      (ivolv_list, cube_ivolv_list);
+    profile.AddTime(PROFILE_ADJACENCY, timer);
+
+    set_ivol_vertex_info
+      (scalar_grid, ivoldual_table, ivolpoly_vert, 
+       cube_ivolv_list, cube_index, vertex_adjacency_list, 
+       context.num_hex_incident_on_ivolv, ivolv_list);
+    profile.AddTime(PROFILE_IVOL_VERTEX_INFO, timer);
+
+    // Expand thin regions.
+    if (param.flag_expand_thin_regions) {
+      int num_moved;
+      expand_thin_regions
+        (scalar_grid, cube_ivolv_list, ivolv_list,
+         param.thin_separation_distance, vertex_coord, num_moved);
+      profile.AddTime(PROFILE_EXPAND_THIN, timer);
+    }
+
+    // Polytopes dual to vertex.
+    const int NUM_VERT_PER_HEXAHEDRON(8);
+    IJK::VERTEX_POLY_INCIDENCE<int,int> & vertex_poly_incidence =
+      context.vertex_poly_incidence;
+    vertex_poly_incidence.Set
+      (ivolpoly_vert, NUM_VERT_PER_HEXAHEDRON, num_threads);
+    profile.AddTime(PROFILE_INCIDENCE, timer);
+
+    // Split or Collapse hexahedron to improve Jacobian.
+    if (param.flag_split_hex) {
+      split_hex
+      (ivolpoly_vert, ivoldual_table, vertex_adjacency_list, ivolv_list,
+       ivolpoly_info, vertex_coord, param.split_hex_threshold);
+      profile.AddTime(PROFILE_SPLIT_HEX, timer);
+    }
+    if (param.flag_collapse_hex) {
+      collapse_hex
+      (ivolpoly_vert, ivoldual_table, vertex_adjacency_list, ivolv_list, 
+       ivolpoly_info, vertex_coord, param.collapse_hex_threshold);
+      profile.AddTime(PROFILE_COLLAPSE_HEX, timer);
+    }
+    if (param.flag_split_hex || param.flag_collapse_hex) {
+      // Hexahedra changed.  Recompute polytopes dual to vertex.
+      vertex_poly_incidence.Set
+        (ivolpoly_vert, NUM_VERT_PER_HEXAHEDRON, num_threads);
+      profile.AddTime(PROFILE_INCIDENCE, timer);
+    }
+    const IVOLDUAL_SMOOTH_CONTROL smooth_control(param);
+
+    // Edge length improvement.
+    if (param.flag_lsmooth_elength) {
+      laplacian_smooth_elength
+      (ivoldual_table, vertex_adjacency_list, ivolv_list, 
+       vertex_coord, param.elength_threshold, param.lsmooth_elength_iter,
+       param.flag_lsmooth_elength_color, num_threads, 
+       smooth_control, dualiso_info.lsmooth_elength_info);
+      profile.AddTime(PROFILE_LSMOOTH_ELENGTH, timer);
+    }
+
+    // Jacobian improvement.
+    if (param.flag_lsmooth_jacobian) {
+      laplacian_smooth_jacobian
+      (ivolpoly_vert, ivoldual_table, vertex_adjacency_list, vertex_poly_incidence, ivolv_list, 
+       vertex_coord, param.jacobian_threshold, param.lsmooth_jacobian_iter,
+       smooth_control, dualiso_info.lsmooth_jacobian_info);
+      profile.AddTime(PROFILE_LSMOOTH_JACOBIAN, timer);
+    } 
+    else if (param.flag_gsmooth_jacobian) {
+      gradient_smooth_jacobian
+      (ivolpoly_vert, ivoldual_table, vertex_adjacency_list, vertex_poly_incidence, ivolv_list, 
+       ivolpoly_info, vertex_coord, param.jacobian_threshold, param.gsmooth_jacobian_iter,
+       smooth_control, dualiso_info.gsmooth_jacobian_info);
+      profile.AddTime(PROFILE_GSMOOTH_JACOBIAN, timer);
+    } 
+
+    // Worst first repair of remaining bad Jacobians.
+    if (param.flag_repair_jacobian) {
+      repair_jacobian_worst_first
+      (ivolpoly_vert, ivoldual_table, vertex_adjacency_list, vertex_poly_incidence, ivolv_list, 
+       vertex_coord, param.jacobian_threshold, param.repair_budget_ms,
+       param.flag_jacobian_gradient, dualiso_info.repair_jacobian_info);
+      profile.AddTime(PROFILE_REPAIR_JACOBIAN, timer);
+    }
+
+
+    if (param.flag_orient_in) {
+      const int num_vert_per_cube_facet =  
+        compute_num_cube_facet_vertices(dimension);
+      IJK::reverse_orientations_cube_list
+        (ivolpoly_vert, num_vert_per_cube_facet);
+    }
+
+    dualiso_info.scalar.num_non_empty_cubes = cube_list.size();
+    dualiso_info.multi_isov.num_cubes_multi_isov = num_split;
+    dualiso_info.multi_isov.num_cubes_single_isov =
+      cube_list.size() - num_split;
+    dualiso_info.multi_isov.num_non_manifold_split = num_non_manifold_split;
+
+    // store times
+    dualiso_info.time.extract = 
+      profile.Wall(PROFILE_ENCODE) + profile.Wall(PROFILE_EXTRACT);
+    dualiso_info.time.merge = profile.Wall(PROFILE_MERGE);
+    dualiso_info.time.position = profile.Wall(PROFILE_POSITION);
   }
-  else {
-    encode_grid_vertices
-      (scalar_grid, isovalue0, isovalue1, default_interior_code, 
-       encoded_grid, dualiso_info);
+
+
+  // Construct interval volume from encoded grid.
+  // - Extract, merge, split and position interval volume vertices
+  //   and improve the interval volume mesh.
+  // @param flag_active_cube_list If true, extract polytopes dual to
+  //   edges and vertices of cubes in active_cube_list and copy 
+  //   cube table indices from active_cube_list.  Otherwise, scan 
+  //   active blocks and compute table indices from encoded_grid.
+  //   - If true, only encodings of vertices of active cubes are read.
+  // - Adds the time of each stage to dualiso_info.profile.
+  //   Time to encode the grid should already be in dualiso_info.profile.
+  // @param context Buffers for intermediate results.
+  //   - Buffers in context keep their capacity for the next extraction.
+  void dual_contouring_interval_volume_from_encoded_grid
+  (const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+   const IVOLDUAL_ENCODED_GRID & encoded_grid,
+   const IVOLDUAL_ENCODED_BLOCKS & encoded_blocks,
+   const bool flag_active_cube_list,
+   const ACTIVE_CUBE_ARRAY & active_cube_list,
+   const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+   const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+   const IVOLDUAL_DATA_FLAGS & param,
+   std::vector<ISO_VERTEX_INDEX> & ivolpoly_vert,
+   std::vector<GRID_CUBE_DATA> & cube_ivolv_list,
+   DUAL_IVOLVERT_ARRAY & ivolv_list,
+   IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
+   COORD_ARRAY & vertex_coord,
+   MERGE_DATA * merge_data, 
+   IVOLDUAL_CONTEXT & context,
+   IVOLDUAL_INFO & dualiso_info)
+  {
+    const int num_threads = param.num_threads;
+    PROFILE_TIMER timer;
+
+    context.SetGrid(scalar_grid);
+    ivolpoly_info.clear();
+
+    std::vector<ISO_VERTEX_INDEX> & ivolpoly = context.ivolpoly;
+    std::vector<POLY_VERTEX_INDEX> & poly_vertex = context.poly_vertex;
+    poly_vertex.clear();
+    if (flag_active_cube_list) {
+      find_dual_grid_edges
+        (encoded_grid, active_cube_list, num_threads, 
+         context.thread_lists, context.dual_edge_list);
+      find_dual_grid_vertices
+        (encoded_grid, active_cube_list, num_threads, 
+         context.thread_lists, context.dual_vertex_list);
+      extract_dual_ivolpoly
+        (encoded_grid, context.dual_edge_list, context.dual_vertex_list,
+         ivolpoly, poly_vertex, ivolpoly_info, dualiso_info);
+    }
+    else {
+      extract_dual_ivolpoly
+        (encoded_grid, encoded_blocks, num_threads, 
+         ivolpoly, poly_vertex, ivolpoly_info, dualiso_info);
+    }
+    dualiso_info.profile.AddTime(PROFILE_EXTRACT, timer);
+
+    dual_contouring_interval_volume_from_ivolpoly
+      (scalar_grid, encoded_grid, flag_active_cube_list, active_cube_list, 
+       isovalue0, isovalue1, ivoldual_table, param, ivolpoly_vert, 
+       cube_ivolv_list, ivolv_list, ivolpoly_info, vertex_coord, 
+       merge_data, context, dualiso_info);
   }
 
-  std::vector<ISO_VERTEX_INDEX> ivolpoly;
-  std::vector<POLY_VERTEX_INDEX> poly_vertex;
-  extract_dual_ivolpoly
-    (encoded_grid, ivolpoly, poly_vertex, ivolpoly_info, dualiso_info);
-  t1 = clock();
 
-  std::vector<ISO_VERTEX_INDEX> cube_list;
-  std::vector<ISO_VERTEX_INDEX> ivolpoly_cube;
-  merge_identical(ivolpoly, cube_list, ivolpoly_cube, merge_data);
-  t2 = clock();
+  // Encode grid and construct interval volume.
+  // - Uses block_index to skip blocks outside the interval volume
+  //   and stores intermediate results in context.
+  // @param merge_data Merge data for scalar_grid.
+  //   - If merge_data is NULL, merge data is allocated in context
+  //     if it is needed.
+  void dual_contouring_interval_volume_in_context
+  (const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+   const IVOLDUAL_BLOCK_INDEX & block_index,
+   const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+   const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+   const IVOLDUAL_DATA_FLAGS & param,
+   std::vector<ISO_VERTEX_INDEX> & ivolpoly_vert,
+   std::vector<GRID_CUBE_DATA> & cube_ivolv_list,
+   DUAL_IVOLVERT_ARRAY & ivolv_list,
+   IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
+   COORD_ARRAY & vertex_coord,
+   MERGE_DATA * merge_data, 
+   IVOLDUAL_CONTEXT & context,
+   IVOLDUAL_INFO & dualiso_info)
+  {
+    const int dimension = scalar_grid.Dimension();
+    const GRID_VERTEX_ENCODING default_interior_code =
+      param.default_interior_code;
+    const int num_threads = param.num_threads;
+    const int num_vertex_types = ivoldual_table.NumVertexTypes();
+    const int DIM3(3);
+    // Compute table indices while encoding the grid (3D only).
+    const bool flag_encode_active_cubes = (dimension == DIM3);
+    IJK::PROCEDURE_ERROR error("dual_contouring_interval_volume");
+
+    if (scalar_grid.Dimension() != ivoldual_table.Dimension()) {
+      error.AddMessage
+        ("Programming error.  Incorrect isodual table dimension.");
+      error.AddMessage
+        ("  Interval volume table dimension does not match scalar grid dimension.");
+      error.AddMessage
+        ("    Interval volume table dimension: ", ivoldual_table.Dimension(), "");
+      error.AddMessage
+        ("    Scalar grid dimension: ", scalar_grid.Dimension(), "");
+      throw error;
+    }
+
+    PROFILE_TIMER timer;
 
-  set_grid_cube_indices(cube_list, cube_ivolv_list);
-  set_grid_coord(scalar_grid, cube_ivolv_list);
+    ivolpoly_vert.clear();
+    dualiso_info.time.Clear();
+    dualiso_info.profile.Clear();
 
-  set_cube_ivoltable_info
-    (encoded_grid, ivoldual_table, cube_ivolv_list);
-  IJK::set_index_to_cube_list(cube_ivolv_list, index_to_cube_list);
+    // Blocks with encoding 0 or 3 are skipped.
+    IVOLDUAL_ENCODED_BLOCKS & encoded_blocks = context.encoded_blocks;
+    encoded_blocks.Set(scalar_grid, block_index, isovalue0, isovalue1);
 
-  if (param.flag_split_ambig_pairsB) {
-    // *** Probably not necessary
-    split_non_manifold_ivolv_pairs_ambigB
-      (encoded_grid, ivoldual_table, cube_ivolv_list, num_non_manifold_split);
-  }
-  else if (param.flag_split_ambig_pairsC) {
-    split_non_manifold_ivolv_pairs_ambigC
-      (encoded_grid, ivoldual_table, cube_ivolv_list, num_non_manifold_split);
+    IVOLDUAL_ENCODED_GRID & encoded_grid = context.encoded_grid;
+    ACTIVE_CUBE_ARRAY & active_cube_list = context.active_cube_list;
+    if (flag_encode_active_cubes) {
+      if (param.flag_set_interior_code_from_scalar) {
+        encode_grid_vertices_and_active_cubes_set_interior_from_scalar
+          (scalar_grid, encoded_blocks, isovalue0, isovalue1, 
+           num_vertex_types, num_threads, context.thread_lists,
+           encoded_grid, active_cube_list, dualiso_info);
+      }
+      else {
+        encode_grid_vertices_and_active_cubes
+          (scalar_grid, encoded_blocks, isovalue0, isovalue1, 
+           default_interior_code, num_vertex_types, num_threads, 
+           context.thread_lists, encoded_grid, active_cube_list, 
+           dualiso_info);
+      }
+    }
+    else if (param.flag_set_interior_code_from_scalar) {
+      encode_grid_vertices_set_interior_from_scalar
+        (scalar_grid, isovalue0, isovalue1, num_threads, 
+         encoded_grid, dualiso_info);
+    }
+    else {
+      encode_grid_vertices
+        (scalar_grid, isovalue0, isovalue1, default_interior_code, 
+         num_threads, encoded_grid, dualiso_info);
+    }
+    dualiso_info.profile.AddTime(PROFILE_ENCODE, timer);
+
+    dual_contouring_interval_volume_from_encoded_grid
+      (scalar_grid, encoded_grid, encoded_blocks, 
+       flag_encode_active_cubes, active_cube_list, isovalue0, isovalue1, 
+       ivoldual_table, param, ivolpoly_vert, cube_ivolv_list, ivolv_list, 
+       ivolpoly_info, vertex_coord, merge_data, context, dualiso_info);
   }
-  else if (param.flag_split_ambig_pairs) {
-    split_non_manifold_ivolv_pairs_ambig
-      (encoded_grid, ivoldual_table, cube_ivolv_list, num_non_manifold_split);
+
+
+  // Encode grid vertices from band_grid and construct interval volume.
+  // - Uses block_index to skip blocks outside the interval volume
+  //   and stores intermediate results in context.
+  // - In 3D, only vertices of active cubes are encoded.  
+  //   Encodings of other vertices are left over from earlier intervals
+  //   and are not read.
+  // @pre isovalue0 == band_grid.Isovalue(interval) and
+  //   isovalue1 == band_grid.Isovalue(interval+1).
+  // @param merge_data Merge data for scalar_grid.
+  //   - If merge_data is NULL, merge data is allocated in context
+  //     if it is needed.
+  void dual_contouring_interval_volume_from_bands_in_context
+  (const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+   const IVOLDUAL_BLOCK_INDEX & block_index,
+   const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+   const IVOLDUAL_BAND_GRID & band_grid,
+   const int interval,
+   const ACTIVE_CUBE_ARRAY & active_cube_list,
+   const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+   const IVOLDUAL_DATA_FLAGS & param,
+   std::vector<ISO_VERTEX_INDEX> & ivolpoly_vert,
+   std::vector<GRID_CUBE_DATA> & cube_ivolv_list,
+   DUAL_IVOLVERT_ARRAY & ivolv_list,
+   IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
+   COORD_ARRAY & vertex_coord,
+   MERGE_DATA * merge_data, 
+   IVOLDUAL_CONTEXT & context,
+   IVOLDUAL_INFO & dualiso_info)
+  {
+    const int dimension = scalar_grid.Dimension();
+    const int DIM3(3);
+    // Active cubes are computed with the bands (3D only).
+    const bool flag_active_cube_list = (dimension == DIM3);
+    IJK::PROCEDURE_ERROR error("dual_contouring_interval_volume");
+
+    if (!band_grid.Check(scalar_grid, "band grid", "scalar grid", error)) 
+      { throw error; }
+
+    if (interval < 0 || interval >= band_grid.NumIntervals()) {
+      error.AddMessage
+        ("Programming error.  Illegal interval ", interval, ".");
+      error.AddMessage
+        ("  Band grid has ", band_grid.NumIntervals(), " intervals.");
+      throw error;
+    }
+
+    if (scalar_grid.Dimension() != ivoldual_table.Dimension()) {
+      error.AddMessage
+        ("Programming error.  Incorrect isodual table dimension.");
+      error.AddMessage
+        ("  Interval volume table dimension does not match scalar grid dimension.");
+      throw error;
+    }
+
+    if (isovalue0 != band_grid.Isovalue(interval) ||
+        isovalue1 != band_grid.Isovalue(interval+1)) {
+      error.AddMessage
+        ("Programming error.  Isovalues do not match band grid interval ",
+         interval, ".");
+      error.AddMessage
+        ("  Isovalues: ", isovalue0, " ", isovalue1, "");
+      error.AddMessage
+        ("  Band grid isovalues: ", band_grid.Isovalue(interval), " ",
+         band_grid.Isovalue(interval+1), "");
+      throw error;
+    }
+
+    PROFILE_TIMER timer;
+
+    ivolpoly_vert.clear();
+    dualiso_info.time.Clear();
+    dualiso_info.profile.Clear();
+
+    // Blocks with encoding 0 or 3 are skipped.
+    IVOLDUAL_ENCODED_BLOCKS & encoded_blocks = context.encoded_blocks;
+    encoded_blocks.Set(scalar_grid, block_index, isovalue0, isovalue1);
+
+    IVOLDUAL_ENCODED_GRID & encoded_grid = context.encoded_grid;
+    if (flag_active_cube_list) {
+      encode_active_cube_vertices_from_bands
+        (band_grid, interval, active_cube_list, encoded_grid);
+    }
+    else {
+      encode_grid_vertices_from_bands
+        (band_grid, interval, param.num_threads, encoded_grid);
+    }
+    dualiso_info.profile.AddTime(PROFILE_ENCODE, timer);
+
+    dual_contouring_interval_volume_from_encoded_grid
+      (scalar_grid, encoded_grid, encoded_blocks, 
+       flag_active_cube_list, active_cube_list, isovalue0, isovalue1, 
+       ivoldual_table, param, ivolpoly_vert, cube_ivolv_list, ivolv_list, 
+       ivolpoly_info, vertex_coord, merge_data, context, dualiso_info);
   }
-  else if (param.flag_split_ambig_pairsD) {
-    split_non_manifold_ivolv_pairs_ambigD
-      (encoded_grid, ivoldual_table, cube_ivolv_list, num_non_manifold_split);
+
+
+  // Update encoding in incremental_grid and construct interval volume.
+  // - Uses block_index to skip blocks outside the interval volume
+  //   and stores intermediate results in context.
+  // - In 3D, extracts polytopes dual to the grid edges and vertices
+  //   in incremental_grid.dual_edge_list and dual_vertex_list.
+  //   Only edges and vertices containing reclassified vertices
+  //   are rechecked.
+  // @param merge_data Merge data for scalar_grid.
+  //   - If merge_data is NULL, merge data is allocated in context
+  //     if it is needed.
+  void dual_contouring_interval_volume_incremental_in_context
+  (const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+   const IVOLDUAL_BLOCK_INDEX & block_index,
+   const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+   IVOLDUAL_INCREMENTAL_GRID & incremental_grid,
+   const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+   const IVOLDUAL_DATA_FLAGS & param,
+   std::vector<ISO_VERTEX_INDEX> & ivolpoly_vert,
+   std::vector<GRID_CUBE_DATA> & cube_ivolv_list,
+   DUAL_IVOLVERT_ARRAY & ivolv_list,
+   IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
+   COORD_ARRAY & vertex_coord,
+   MERGE_DATA * merge_data, 
+   IVOLDUAL_CONTEXT & context,
+   IVOLDUAL_INFO & dualiso_info)
+  {
+    const int dimension = scalar_grid.Dimension();
+    const int DIM3(3);
+    // Active cubes and dual grid edges and vertices are updated 
+    //   with the encoding (3D only).
+    const bool flag_active_cube_list = (dimension == DIM3);
+    IJK::PROCEDURE_ERROR error("dual_contouring_interval_volume");
+
+    if (!incremental_grid.Check
+        (scalar_grid, "incremental grid", "scalar grid", error)) 
+      { throw error; }
+
+    if (scalar_grid.Dimension() != ivoldual_table.Dimension()) {
+      error.AddMessage
+        ("Programming error.  Incorrect isodual table dimension.");
+      error.AddMessage
+        ("  Interval volume table dimension does not match scalar grid dimension.");
+      throw error;
+    }
+
+    PROFILE_TIMER timer;
+
+    ivolpoly_vert.clear();
+    dualiso_info.time.Clear();
+    dualiso_info.profile.Clear();
+
+    encode_grid_vertices_incremental
+      (scalar_grid, isovalue0, isovalue1, ivoldual_table.NumVertexTypes(),
+       param.num_threads, incremental_grid);
+
+    // Blocks with encoding 0 or 3 are skipped.
+    IVOLDUAL_ENCODED_BLOCKS & encoded_blocks = context.encoded_blocks;
+    encoded_blocks.Set(scalar_grid, block_index, isovalue0, isovalue1);
+    dualiso_info.profile.AddTime(PROFILE_ENCODE, timer);
+
+    if (!flag_active_cube_list) {
+      dual_contouring_interval_volume_from_encoded_grid
+        (scalar_grid, incremental_grid, encoded_blocks, 
+         flag_active_cube_list, incremental_grid.active_cube_list, 
+         isovalue0, isovalue1, ivoldual_table, param, 
+         ivolpoly_vert, cube_ivolv_list, ivolv_list, 
+         ivolpoly_info, vertex_coord, merge_data, context, dualiso_info);
+      return;
+    }
+
+    context.SetGrid(scalar_grid);
+    ivolpoly_info.clear();
+    context.poly_vertex.clear();
+    extract_dual_ivolpoly
+      (incremental_grid, incremental_grid.dual_edge_list, 
+       incremental_grid.dual_vertex_list, 
+       context.ivolpoly, context.poly_vertex, ivolpoly_info, dualiso_info);
+    dualiso_info.profile.AddTime(PROFILE_EXTRACT, timer);
+
+    dual_contouring_interval_volume_from_ivolpoly
+      (scalar_grid, incremental_grid, 
+       flag_active_cube_list, incremental_grid.active_cube_list, 
+       isovalue0, isovalue1, ivoldual_table, param, 
+       ivolpoly_vert, cube_ivolv_list, ivolv_list, 
+       ivolpoly_info, vertex_coord, merge_data, context, dualiso_info);
   }
 
-  VERTEX_INDEX num_split;
-  split_dual_ivolvert
-    (ivoldual_table, ivolpoly_cube, poly_vertex, ivolpoly_info, 
-     cube_ivolv_list, ivolv_list, ivolpoly_vert, num_split);
+}
 
-  IJKDUAL::ISODUAL_CUBE_TABLE_AMBIG isodual_table
-    (dimension, flag_separate_neg, flag_always_separate_opposite);
-  position_all_dual_ivol_vertices
-    (scalar_grid, ivoldual_table, isodual_table, isovalue0, isovalue1, 
-     ivolv_list, vertex_coord);
 
-  polymesh.AddPolytopes(ivolpoly_vert, cube_info.NumVertices());
-  vertex_adjacency_list.SetFromMeshOfCubes(polymesh, cube_info);
-  vertex_adjacency_list.SetAllDualFacetsFromVertexAndCubeLists
-    (ivolv_list, cube_ivolv_list);
+// Construct interval volume using dual contouring.
+// - Version with optional data in options.
+void IVOLDUAL::dual_contouring_interval_volume
+(const IVOLDUAL_DATA & ivoldual_data, 
+ const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+ const IVOLDUAL_EXTRACT_OPTIONS & options,
+ DUAL_INTERVAL_VOLUME & dual_interval_volume, IVOLDUAL_INFO & dualiso_info)
+{
+  const DUALISO_SCALAR_GRID_BASE & scalar_grid = ivoldual_data.ScalarGrid();
+  const int dimension = scalar_grid.Dimension();
+  const bool flag_separate_neg = ivoldual_data.SeparateNegFlag();
+  PROCEDURE_ERROR error("dual_contouring_interval_volume");
+
+  PROFILE_TIMER timer;
 
-  set_ivol_vertex_info
-    (scalar_grid, ivoldual_table, ivolpoly_vert, 
-     cube_ivolv_list, index_to_cube_list.PtrConst(),
-     vertex_adjacency_list, ivolv_list);
+  if (!ivoldual_data.Check(error)) { throw error; };
+
+  dual_interval_volume.Clear();
+  dualiso_info.time.Clear();
+
+  const IVOLDUAL_CUBE_TABLE & ivoldual_table = 
+    get_ivoldual_cube_table
+    (dimension, flag_separate_neg, ivoldual_data.table_filename);
+
+  IVOLDUAL_EXTRACT_OPTIONS data_options = options;
+  if (data_options.block_index == NULL) 
+    { data_options.SetBlockIndex(ivoldual_data.BlockIndex()); }
 
-  // Expand thin regions.
-  if (param.flag_expand_thin_regions) {
-    int num_moved;
-    expand_thin_regions
-      (scalar_grid, cube_ivolv_list, ivolv_list,
-       param.thin_separation_distance, vertex_coord, num_moved);
-  }
-
-  // Polytopes dual to vertex.
-  const int NUM_VERT_PER_HEXAHEDRON(8);
-  IJK::POLYMESH_DATA<VERTEX_INDEX,int, 
-    IJK::HEX_TRIANGULATION_INFO<char,char>> hex_data;
-  hex_data.AddPolytopes(ivolpoly_vert, NUM_VERT_PER_HEXAHEDRON);
-  IJK::VERTEX_POLY_INCIDENCE<int,int> vertex_poly_incidence(hex_data);
-
-  // Split or Collapse hexahedron to improve Jacobian.
-  if (param.flag_split_hex) {
-    split_hex
-    (ivolpoly_vert, ivoldual_table, vertex_adjacency_list, ivolv_list,
-     ivolpoly_info, vertex_coord, param.split_hex_threshold);
-  }
-  if (param.flag_collapse_hex) {
-    collapse_hex
-    (ivolpoly_vert, ivoldual_table, vertex_adjacency_list, ivolv_list, 
-     ivolpoly_info, vertex_coord, param.collapse_hex_threshold);
-  }
-  // Edge length improvement.
-  if (param.flag_lsmooth_elength) {
-    laplacian_smooth_elength
-    (ivoldual_table, vertex_adjacency_list, ivolv_list, 
-     vertex_coord, param.elength_threshold, param.lsmooth_elength_iter);         
-  }
-
-  // Jacobian improvement.
-  if (param.flag_lsmooth_jacobian) {
-    laplacian_smooth_jacobian
-    (ivolpoly_vert, ivoldual_table, vertex_adjacency_list, vertex_poly_incidence, ivolv_list, 
-     vertex_coord, param.jacobian_threshold, param.lsmooth_jacobian_iter);
-  } 
-  else if (param.flag_gsmooth_jacobian) {
-    gradient_smooth_jacobian
-    (ivolpoly_vert, ivoldual_table, vertex_adjacency_list, vertex_poly_incidence, ivolv_list, 
-     ivolpoly_info, vertex_coord, param.jacobian_threshold, param.gsmooth_jacobian_iter);
-  } 
-
-
-  if (param.flag_orient_in) {
-    const int num_vert_per_cube_facet =  
-      compute_num_cube_facet_vertices(dimension);
-    IJK::reverse_orientations_cube_list
-      (ivolpoly_vert, num_vert_per_cube_facet);
-  }
-
-  dualiso_info.scalar.num_non_empty_cubes = cube_list.size();
-  dualiso_info.multi_isov.num_cubes_multi_isov = num_split;
-  dualiso_info.multi_isov.num_cubes_single_isov =
-    cube_list.size() - num_split;
-  dualiso_info.multi_isov.num_non_manifold_split = num_non_manifold_split;
+  dual_contouring_interval_volume
+    (scalar_grid, isovalue0, isovalue1, ivoldual_table, ivoldual_data, 
+     data_options, dual_interval_volume.isopoly_vert, 
+     dual_interval_volume.ivolv_list, dual_interval_volume.isopoly_info, 
+     dual_interval_volume.vertex_coord, dualiso_info);
 
   // store times
-  IJK::clock2seconds(t1-t0, dualiso_info.time.extract);
-  IJK::clock2seconds(t2-t1, dualiso_info.time.merge);
+  dualiso_info.time.total = timer.WallSeconds();
+}
+
+
+// Construct interval volume using dual contouring.
+// - Version with optional data in options.
+void IVOLDUAL::dual_contouring_interval_volume
+(const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+ const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+ const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+ const IVOLDUAL_DATA_FLAGS & param,
+ const IVOLDUAL_EXTRACT_OPTIONS & options,
+ std::vector<ISO_VERTEX_INDEX> & ivolpoly_vert,
+ DUAL_IVOLVERT_ARRAY & ivolv_list,
+ IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
+ COORD_ARRAY & vertex_coord,
+ IVOLDUAL_INFO & dualiso_info)
+{
+  // Empty block index.  No blocks are skipped.
+  static const IVOLDUAL_BLOCK_INDEX empty_block_index;
+  PROCEDURE_ERROR error("dual_contouring_interval_volume");
+
+  if (!options.Check(error)) { throw error; }
+
+  if (options.context == NULL) {
+    IVOLDUAL_CONTEXT context;
+    IVOLDUAL_EXTRACT_OPTIONS context_options = options;
 
+    context_options.SetContext(context);
+    dual_contouring_interval_volume
+      (scalar_grid, isovalue0, isovalue1, ivoldual_table, param,
+       context_options, ivolpoly_vert, ivolv_list, ivolpoly_info, 
+       vertex_coord, dualiso_info);
+    return;
+  }
+
+  IVOLDUAL_CONTEXT & context = *options.context;
+  const IVOLDUAL_BLOCK_INDEX & block_index =
+    (options.block_index == NULL) ? empty_block_index : *options.block_index;
+
+  if (options.UseBandGrid()) {
+    dual_contouring_interval_volume_from_bands_in_context
+      (scalar_grid, block_index, isovalue0, isovalue1, *options.band_grid,
+       options.interval, *options.band_active_cube_list, 
+       ivoldual_table, param, ivolpoly_vert, context.cube_ivolv_list, 
+       ivolv_list, ivolpoly_info, vertex_coord, options.merge_data, 
+       context, dualiso_info);
+  }
+  else if (options.UseIncrementalGrid()) {
+    dual_contouring_interval_volume_incremental_in_context
+      (scalar_grid, block_index, isovalue0, isovalue1, 
+       *options.incremental_grid, ivoldual_table, param, 
+       ivolpoly_vert, context.cube_ivolv_list, ivolv_list, 
+       ivolpoly_info, vertex_coord, options.merge_data, 
+       context, dualiso_info);
+  }
+  else {
+    dual_contouring_interval_volume_in_context
+      (scalar_grid, block_index, isovalue0, isovalue1, 
+       ivoldual_table, param, ivolpoly_vert, context.cube_ivolv_list, 
+       ivolv_list, ivolpoly_info, vertex_coord, options.merge_data, 
+       context, dualiso_info);
+  }
 }
 
 
@@ -351,6 +900,106 @@ void IVOLDUAL::dual_contouring_interval_volume
 // ENCODE VERTICES
 // **************************************************
 
+// Encode scalar values as 0, default_interior_code or 3.
+// - Branch free.  Uses SSE2 to encode 16 values at a time, if available.
+void IVOLDUAL::encode_scalar_values
+(const SCALAR_TYPE scalar[], const VERTEX_INDEX num_values,
+ const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+ const GRID_VERTEX_ENCODING default_interior_code,
+ GRID_VERTEX_ENCODING code[])
+{
+  const int ic = default_interior_code;
+  VERTEX_INDEX iv = 0;
+
+#ifdef IVOLDUAL_USE_SSE2
+  const __m128 v_isovalue0 = _mm_set1_ps(isovalue0);
+  const __m128 v_isovalue1 = _mm_set1_ps(isovalue1);
+  const __m128i v_interior = _mm_set1_epi32(ic);
+  const __m128i v_above = _mm_set1_epi32(3);
+  const VERTEX_INDEX NUM_PER_STEP = 16;
+
+  for (; iv+NUM_PER_STEP <= num_values; iv += NUM_PER_STEP) {
+    __m128i c[4];
+    for (int j = 0; j < 4; j++) {
+      const __m128 s = _mm_loadu_ps(scalar+iv+4*j);
+      const __m128i below = _mm_castps_si128(_mm_cmplt_ps(s, v_isovalue0));
+      const __m128i above = _mm_castps_si128(_mm_cmpgt_ps(s, v_isovalue1));
+      const __m128i c_not_below = 
+        _mm_or_si128(_mm_and_si128(above, v_above),
+                     _mm_andnot_si128(above, v_interior));
+      c[j] = _mm_andnot_si128(below, c_not_below);
+    }
+    const __m128i c01 = _mm_packs_epi32(c[0], c[1]);
+    const __m128i c23 = _mm_packs_epi32(c[2], c[3]);
+    _mm_storeu_si128
+      ((__m128i *)(code+iv), _mm_packus_epi16(c01, c23));
+  }
+#endif
+
+  for (; iv < num_values; iv++) {
+    const SCALAR_TYPE s = scalar[iv];
+    const int not_below = !(s < isovalue0);
+    const int above = (s > isovalue1);
+    code[iv] = GRID_VERTEX_ENCODING(not_below*(ic + above*(3-ic)));
+  }
+}
+
+
+// Encode scalar values as 0, 1, 2 or 3.
+// - Values in [isovalue0,isovalue1] below (isovalue0+isovalue1)/2
+//   receive code 1.  Other values in [isovalue0,isovalue1] receive code 2.
+// - Branch free.  Uses SSE2 to encode 16 values at a time, if available.
+void IVOLDUAL::encode_scalar_values_set_interior_from_scalar
+(const SCALAR_TYPE scalar[], const VERTEX_INDEX num_values,
+ const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+ GRID_VERTEX_ENCODING code[])
+{
+  const SCALAR_TYPE isovalue_average = (isovalue0+isovalue1)/2.0;
+  VERTEX_INDEX iv = 0;
+
+#ifdef IVOLDUAL_USE_SSE2
+  const __m128 v_isovalue0 = _mm_set1_ps(isovalue0);
+  const __m128 v_isovalue1 = _mm_set1_ps(isovalue1);
+  const __m128 v_average = _mm_set1_ps(isovalue_average);
+  const __m128i v_one = _mm_set1_epi32(1);
+  const __m128i v_two = _mm_set1_epi32(2);
+  const __m128i v_above = _mm_set1_epi32(3);
+  const VERTEX_INDEX NUM_PER_STEP = 16;
+
+  for (; iv+NUM_PER_STEP <= num_values; iv += NUM_PER_STEP) {
+    __m128i c[4];
+    for (int j = 0; j < 4; j++) {
+      const __m128 s = _mm_loadu_ps(scalar+iv+4*j);
+      const __m128i below = _mm_castps_si128(_mm_cmplt_ps(s, v_isovalue0));
+      const __m128i above = _mm_castps_si128(_mm_cmpgt_ps(s, v_isovalue1));
+      const __m128i lower_half = 
+        _mm_castps_si128(_mm_cmplt_ps(s, v_average));
+      const __m128i c_interior = 
+        _mm_or_si128(_mm_and_si128(lower_half, v_one),
+                     _mm_andnot_si128(lower_half, v_two));
+      const __m128i c_not_below = 
+        _mm_or_si128(_mm_and_si128(above, v_above),
+                     _mm_andnot_si128(above, c_interior));
+      c[j] = _mm_andnot_si128(below, c_not_below);
+    }
+    const __m128i c01 = _mm_packs_epi32(c[0], c[1]);
+    const __m128i c23 = _mm_packs_epi32(c[2], c[3]);
+    _mm_storeu_si128
+      ((__m128i *)(code+iv), _mm_packus_epi16(c01, c23));
+  }
+#endif
+
+  for (; iv < num_values; iv++) {
+    const SCALAR_TYPE s = scalar[iv];
+    const int not_below = !(s < isovalue0);
+    const int above = (s > isovalue1);
+    const int c_interior = 2 - int(s < isovalue_average);
+    code[iv] = 
+      GRID_VERTEX_ENCODING(not_below*(c_interior + above*(3-c_interior)));
+  }
+}
+
+
 void IVOLDUAL::encode_grid_vertices
 (const DUALISO_SCALAR_GRID_BASE & scalar_grid,
  const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
@@ -363,17 +1012,11 @@ void IVOLDUAL::encode_grid_vertices
 
   encoded_grid.SetSize(dimension, axis_size);
 
-  for (VERTEX_INDEX iv = 0; iv < scalar_grid.NumVertices(); iv++) {
-    if (scalar_grid.Scalar(iv) < isovalue0) 
-      { encoded_grid.Set(iv, 0); }
-    else if (scalar_grid.Scalar(iv) > isovalue1) 
-      { encoded_grid.Set(iv, 3); }
-    else {
-      // Set all vertices with scalar value 
-      //   in range [isovalue0,isovalue1] to default_interior_code
-      encoded_grid.Set(iv,default_interior_code);
-    }
-  }
+  // Set all vertices with scalar value 
+  //   in range [isovalue0,isovalue1] to default_interior_code
+  encode_scalar_values
+    (scalar_grid.ScalarPtrConst(), scalar_grid.NumVertices(),
+     isovalue0, isovalue1, default_interior_code, encoded_grid.ScalarPtr());
 }
 
 
@@ -387,522 +1030,2546 @@ void IVOLDUAL::encode_grid_vertices_set_interior_from_scalar
 {
   const int dimension = scalar_grid.Dimension();
   const AXIS_SIZE_TYPE * axis_size = scalar_grid.AxisSize();
-  const SCALAR_TYPE isovalue_average = (isovalue0+isovalue1)/2.0;
 
   encoded_grid.SetSize(dimension, axis_size);
 
-  for (VERTEX_INDEX iv = 0; iv < scalar_grid.NumVertices(); iv++) {
-    if (scalar_grid.Scalar(iv) < isovalue0) 
-      { encoded_grid.Set(iv, 0); }
-    else if (scalar_grid.Scalar(iv) > isovalue1) 
-      { encoded_grid.Set(iv, 3); }
-    else if (scalar_grid.Scalar(iv) < isovalue_average) 
-      { encoded_grid.Set(iv, 1); }
-    else {
-      // (scalar_grid.Scalar(iv) > isovalue_average)
-      encoded_grid.Set(iv, 2);
-    }
-  }
+  encode_scalar_values_set_interior_from_scalar
+    (scalar_grid.ScalarPtrConst(), scalar_grid.NumVertices(),
+     isovalue0, isovalue1, encoded_grid.ScalarPtr());
 }
 
 
-// **************************************************
-// SET IVOLTABLE INFO FOR EACH ACTIVE GRID CUBE
-// **************************************************
-
-namespace {
-
-  TABLE_INDEX compute_table_index_from_encoded_grid
-  (const IVOLDUAL_ENCODED_GRID & encoded_grid,
-   const int num_vertex_types,
-   const VERTEX_INDEX icube)
-  {
-    const int num_cube_vertices = encoded_grid.NumCubeVertices();
-    TABLE_INDEX table_index = 0;
-    TABLE_INDEX factor = 1;
-    for (int j = 0; j < num_cube_vertices; j++) {
-      const int j2 = num_cube_vertices-1-j;
-      const VERTEX_INDEX jv2 = encoded_grid.CubeVertex(icube, j2);
-      table_index = 
-        (table_index*num_vertex_types) + encoded_grid.Scalar(jv2);
-    }
+// Encode grid vertices.
+// - Version which splits the grid vertices among num_threads threads.
+void IVOLDUAL::encode_grid_vertices
+(const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+ const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+ const GRID_VERTEX_ENCODING default_interior_code,
+ const int num_threads,
+ IVOLDUAL_ENCODED_GRID & encoded_grid,
+ IVOLDUAL_INFO & dualiso_info)
+{
+  const int dimension = scalar_grid.Dimension();
+  const AXIS_SIZE_TYPE * axis_size = scalar_grid.AxisSize();
 
-    return(table_index);
+  if (num_threads <= 1) {
+    encode_grid_vertices
+      (scalar_grid, isovalue0, isovalue1, default_interior_code,
+       encoded_grid, dualiso_info);
+    return;
   }
 
+  encoded_grid.SetSize(dimension, axis_size);
+
+  const SCALAR_TYPE * scalar = scalar_grid.ScalarPtrConst();
+  GRID_VERTEX_ENCODING * code = encoded_grid.ScalarPtr();
+
+  run_on_thread_ranges
+    (num_threads, scalar_grid.NumVertices(), 
+     [&](const int, const VERTEX_INDEX ibegin, const VERTEX_INDEX iend)
+     {
+       encode_scalar_values
+         (scalar+ibegin, iend-ibegin, isovalue0, isovalue1, 
+          default_interior_code, code+ibegin);
+     });
 }
 
-void IVOLDUAL::set_cube_ivoltable_info
-(const IVOLDUAL_ENCODED_GRID & encoded_grid,
- const IVOLDUAL_CUBE_TABLE & ivoldual_table,
- std::vector<GRID_CUBE_DATA> & cube_ivolv_list)
-{
-  const int dimension = encoded_grid.Dimension();
-  const int num_vertex_types = ivoldual_table.NumVertexTypes();
 
-  for (int i = 0; i < cube_ivolv_list.size(); i++) {
-    const VERTEX_INDEX cube_index = cube_ivolv_list[i].cube_index;
-    const TABLE_INDEX table_index =
-      compute_table_index_from_encoded_grid
-      (encoded_grid, num_vertex_types, cube_index);
+// Encode grid vertices. Set interior codes based on scalar grid.
+// - Version which splits the grid vertices among num_threads threads.
+void IVOLDUAL::encode_grid_vertices_set_interior_from_scalar
+(const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+ const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+ const int num_threads,
+ IVOLDUAL_ENCODED_GRID & encoded_grid,
+ IVOLDUAL_INFO & dualiso_info)
+{
+  const int dimension = scalar_grid.Dimension();
+  const AXIS_SIZE_TYPE * axis_size = scalar_grid.AxisSize();
 
-    cube_ivolv_list[i].table_index = table_index;
-    cube_ivolv_list[i].num_isov = ivoldual_table.NumIsoVertices(table_index);
+  if (num_threads <= 1) {
+    encode_grid_vertices_set_interior_from_scalar
+      (scalar_grid, isovalue0, isovalue1, encoded_grid, dualiso_info);
+    return;
   }
+
+  encoded_grid.SetSize(dimension, axis_size);
+
+  const SCALAR_TYPE * scalar = scalar_grid.ScalarPtrConst();
+  GRID_VERTEX_ENCODING * code = encoded_grid.ScalarPtr();
+
+  run_on_thread_ranges
+    (num_threads, scalar_grid.NumVertices(), 
+     [&](const int, const VERTEX_INDEX ibegin, const VERTEX_INDEX iend)
+     {
+       encode_scalar_values_set_interior_from_scalar
+         (scalar+ibegin, iend-ibegin, isovalue0, isovalue1, code+ibegin);
+     });
 }
 
 
 // **************************************************
-// SET IVOL VERTEX INFORMATION
+// ENCODE GRID VERTICES AND COMPUTE ACTIVE CUBES
 // **************************************************
 
-void IVOLDUAL::set_ivol_vertex_info
-(const DUALISO_GRID & grid,
- const IVOLDUAL_CUBE_TABLE & ivoldual_table,
- const std::vector<ISO_VERTEX_INDEX> & poly_vert,
- const std::vector<GRID_CUBE_DATA> & cube_list,
- const VERTEX_INDEX index_to_cube_list[],
- const IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
- DUAL_IVOLVERT_ARRAY & ivolv_list)
-{
-  typedef IVOLDUAL_TABLE_VERTEX_INFO::CUBE_VERTEX_TYPE CUBE_VERTEX_TYPE;
-  typedef IVOLDUAL_TABLE_VERTEX_INFO::CUBE_EDGE_TYPE CUBE_EDGE_TYPE;
-
-  const int DIM3(3);
-  const CUBE_VERTEX_TYPE UNDEFINED_CUBE_VERTEX =
-    IVOLDUAL_TABLE_VERTEX_INFO::UNDEFINED_CUBE_VERTEX;
-  const CUBE_EDGE_TYPE UNDEFINED_CUBE_EDGE = 
-    IVOLDUAL_TABLE_VERTEX_INFO::UNDEFINED_CUBE_EDGE;
-  const CUBE_FACE_INFO cube(DIM3);
+namespace {
 
+  /// Encode scalar values using default_interior_code
+  ///   for values in [isovalue0, isovalue1].
+  class ENCODE_DEFAULT_INTERIOR {
+
+  protected:
+    const SCALAR_TYPE isovalue0;
+    const SCALAR_TYPE isovalue1;
+    const GRID_VERTEX_ENCODING interior_code;
+
+  public:
+    ENCODE_DEFAULT_INTERIOR
+    (const SCALAR_TYPE isovalue0, const SCALAR_TYPE isovalue1,
+     const GRID_VERTEX_ENCODING interior_code):
+      isovalue0(isovalue0), isovalue1(isovalue1), 
+      interior_code(interior_code) {};
+
+    void operator () 
+    (const SCALAR_TYPE scalar[], const VERTEX_INDEX num_values,
+     GRID_VERTEX_ENCODING code[]) const
+    {
+      encode_scalar_values
+        (scalar, num_values, isovalue0, isovalue1, interior_code, code);
+    }
+  };
+
+  /// Encode scalar values setting interior codes from the scalar values.
+  class ENCODE_INTERIOR_FROM_SCALAR {
+
+  protected:
+    const SCALAR_TYPE isovalue0;
+    const SCALAR_TYPE isovalue1;
+
+  public:
+    ENCODE_INTERIOR_FROM_SCALAR
+    (const SCALAR_TYPE isovalue0, const SCALAR_TYPE isovalue1):
+      isovalue0(isovalue0), isovalue1(isovalue1) {};
+
+    void operator () 
+    (const SCALAR_TYPE scalar[], const VERTEX_INDEX num_values,
+     GRID_VERTEX_ENCODING code[]) const
+    {
+      encode_scalar_values_set_interior_from_scalar
+        (scalar, num_values, isovalue0, isovalue1, code);
+    }
+  };
 
-  for (IVOL_VERTEX_INDEX ivolv = 0; ivolv < ivolv_list.size(); ivolv++) {
-    const TABLE_INDEX table_index = ivolv_list[ivolv].table_index;
-    const FACET_VERTEX_INDEX patch_index = ivolv_list[ivolv].patch_index;
-    const VERTEX_INDEX cube_index = ivolv_list[ivolv].cube_index;
 
-    // Initialize.
-    ivolv_list[ivolv].separation_vertex = grid.NumVertices();
-    ivolv_list[ivolv].separation_edge_direction = 0;
+  /// Compute table indices of active cubes in layer iz.
+  /// - Cubes in layer iz have lower vertices in grid vertex layer iz.
+  /// - Table index of cube with lower vertex (x,y,z) is
+  ///     column[x] + num_vertex_types*column[x+1]
+  ///   where column[x] encodes the four cube vertices with x-coordinate x.
+  /// - Skips cubes in blocks which are not active.
+  void compute_active_cubes_in_layer_3D
+  (const IVOLDUAL_ENCODED_GRID & encoded_grid,
+   const IVOLDUAL_ENCODED_BLOCKS & encoded_blocks,
+   const int num_vertex_types, const VERTEX_INDEX iz,
+   ACTIVE_CUBE_ARRAY & active_cube_list)
+  {
+    const VERTEX_INDEX nx = encoded_grid.AxisSize(0);
+    const VERTEX_INDEX ny = encoded_grid.AxisSize(1);
+    const VERTEX_INDEX layer_size = nx*ny;
+    const GRID_VERTEX_ENCODING * code = encoded_grid.ScalarPtrConst();
+    const VERTEX_INDEX block_edge_length = encoded_blocks.BlockEdgeLength();
+    const VERTEX_INDEX num_blocks_x = encoded_blocks.AxisSize(0);
+    const TABLE_INDEX w0 = 1;
+    const TABLE_INDEX w2 = w0*num_vertex_types*num_vertex_types;
+    const TABLE_INDEX w4 = w2*num_vertex_types*num_vertex_types;
+    const TABLE_INDEX w6 = w4*num_vertex_types*num_vertex_types;
+    const TABLE_INDEX max_column = 3*(w0+w2+w4+w6);
+    const TABLE_INDEX max_table_index = 
+      max_column + num_vertex_types*max_column;
+
+    if (nx < 2) { return; }
+
+    const VERTEX_INDEX ibz = 
+      encoded_blocks.BlockCoord(iz, 2)*encoded_blocks.AxisIncrement(2);
+
+    for (VERTEX_INDEX iy = 0; iy+1 < ny; iy++) {
+      const VERTEX_INDEX iv_start = iz*layer_size + iy*nx;
+      const GRID_VERTEX_ENCODING * c0 = code + iv_start;
+      const GRID_VERTEX_ENCODING * c2 = c0 + nx;
+      const GRID_VERTEX_ENCODING * c4 = c0 + layer_size;
+      const GRID_VERTEX_ENCODING * c6 = c4 + nx;
+      const VERTEX_INDEX ib_row = ibz +
+        encoded_blocks.BlockCoord(iy, 1)*encoded_blocks.AxisIncrement(1);
+
+      for (VERTEX_INDEX jb = 0; jb < num_blocks_x; jb++) {
+
+        if (!encoded_blocks.IsActive(ib_row+jb)) { continue; }
+
+        // Cubes with lower x-coordinate in [x0,x1) are in block jb.
+        const VERTEX_INDEX x0 = jb*block_edge_length;
+        const VERTEX_INDEX x1 = (jb+1 < num_blocks_x) ?
+          x0+block_edge_length : nx-1;
+
+        TABLE_INDEX column0 = c0[x0]*w0 + c2[x0]*w2 + c4[x0]*w4 + c6[x0]*w6;
+        for (VERTEX_INDEX ix = x0; ix < x1; ix++) {
+          const VERTEX_INDEX ix1 = ix+1;
+          const TABLE_INDEX column1 = 
+            c0[ix1]*w0 + c2[ix1]*w2 + c4[ix1]*w4 + c6[ix1]*w6;
+          const TABLE_INDEX table_index = column0 + num_vertex_types*column1;
+
+          if (table_index != 0 && table_index != max_table_index) {
+            active_cube_list.push_back
+              (ACTIVE_CUBE(iv_start+ix, table_index));
+          }
+          column0 = column1;
+        }
+      }
+    }
+  }
 
-    ivolv_list[ivolv].connect_dir = 
-      ivoldual_table.VertexInfo(table_index, patch_index).connect_dir;
 
-    ivolv_list[ivolv].num_incident_hex = 
-      ivoldual_table.VertexInfo(table_index, patch_index).NumIncidentPoly();
+  /// Encode vertex layer iz.
+  /// - Vertices in blocks with encoding 0 or 3 are set to the 
+  ///   block encoding.  Scalar values in those blocks are not read.
+  /// - Consecutive active blocks in a row are encoded by a single call
+  ///   to encode.  If all blocks containing the layer are active,
+  ///   the layer is encoded by a single call.
+  template <typename ENCODE_TYPE>
+  void encode_layer_3D
+  (const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+   const IVOLDUAL_ENCODED_BLOCKS & encoded_blocks,
+   const ENCODE_TYPE & encode,
+   const VERTEX_INDEX iz,
+   IVOLDUAL_ENCODED_GRID & encoded_grid)
+  {
+    const VERTEX_INDEX nx = scalar_grid.AxisSize(0);
+    const VERTEX_INDEX ny = scalar_grid.AxisSize(1);
+    const VERTEX_INDEX layer_size = nx*ny;
+    const SCALAR_TYPE * scalar = scalar_grid.ScalarPtrConst();
+    GRID_VERTEX_ENCODING * code = encoded_grid.ScalarPtr();
+    const VERTEX_INDEX block_edge_length = encoded_blocks.BlockEdgeLength();
+    const VERTEX_INDEX num_blocks_x = encoded_blocks.AxisSize(0);
+    const VERTEX_INDEX num_blocks_in_layer = 
+      encoded_blocks.AxisIncrement(2);
+    const VERTEX_INDEX ibz = 
+      encoded_blocks.BlockCoord(iz, 2)*num_blocks_in_layer;
+    const VERTEX_INDEX iv_layer = iz*layer_size;
+
+    bool flag_all_active = true;
+    for (VERTEX_INDEX ib = ibz; ib < ibz+num_blocks_in_layer; ib++) {
+      if (!encoded_blocks.IsActive(ib)) {
+        flag_all_active = false;
+        break;
+      }
+    }
 
-    ivolv_list[ivolv].num_incident_iso_quad = 
-      ivoldual_table.VertexInfo(table_index, patch_index).NumIncidentIsoPoly();
+    if (flag_all_active) {
+      encode(scalar+iv_layer, layer_size, code+iv_layer);
+      return;
+    }
 
-    ivolv_list[ivolv].flag_lower_isosurface = 
-      ivoldual_table.OnLowerIsosurface(table_index, patch_index);
+    for (VERTEX_INDEX iy = 0; iy < ny; iy++) {
+      const VERTEX_INDEX iv_start = iv_layer + iy*nx;
+      const VERTEX_INDEX ib_row = ibz +
+        encoded_blocks.BlockCoord(iy, 1)*encoded_blocks.AxisIncrement(1);
 
-    ivolv_list[ivolv].flag_upper_isosurface = 
-      ivoldual_table.OnUpperIsosurface(table_index, patch_index);
+      VERTEX_INDEX jb = 0;
+      while (jb < num_blocks_x) {
+        const GRID_VERTEX_ENCODING block_code = 
+          encoded_blocks.Scalar(ib_row+jb);
 
-    const CUBE_VERTEX_TYPE icorner =
-      ivoldual_table.VertexInfo(table_index, patch_index).separation_vertex;
+        // Find run [jb,jb_end) of blocks with the same encoding.
+        VERTEX_INDEX jb_end = jb+1;
+        while (jb_end < num_blocks_x &&
+               encoded_blocks.Scalar(ib_row+jb_end) == block_code)
+          { jb_end++; }
 
-    if (icorner != UNDEFINED_CUBE_VERTEX) {
-      ivolv_list[ivolv].separation_vertex = 
-        grid.CubeVertex(cube_index, icorner);
-    }
+        const VERTEX_INDEX x0 = jb*block_edge_length;
+        const VERTEX_INDEX x1 = (jb_end < num_blocks_x) ?
+          jb_end*block_edge_length : nx;
 
-    const CUBE_EDGE_TYPE iedge =
-      ivoldual_table.VertexInfo(table_index, patch_index).separation_edge;
+        if (block_code == IVOLDUAL_ENCODED_BLOCKS::ACTIVE_BLOCK) 
+          { encode(scalar+iv_start+x0, x1-x0, code+iv_start+x0); }
+        else
+          { std::fill(code+iv_start+x0, code+iv_start+x1, block_code); }
 
-    if (iedge != UNDEFINED_CUBE_EDGE) {
-      const CUBE_VERTEX_TYPE icorner = cube.EdgeEndpoint(iedge, 0);
-      ivolv_list[ivolv].separation_vertex = 
-        grid.CubeVertex(cube_index, icorner);
-      ivolv_list[ivolv].separation_edge_direction = cube.EdgeDir(iedge);
+        jb = jb_end;
+      }
     }
-
-    ivolv_list[ivolv].is_doubly_connected =
-      ivoldual_table.VertexInfo(table_index, patch_index).is_doubly_connected;
-    ivolv_list[ivolv].doubly_connected_facet =
-      ivoldual_table.VertexInfo(table_index, patch_index).
-      doubly_connected_facet;
-    ivolv_list[ivolv].map_to = ivolv;
   }
 
 
+  /// Encode grid vertices and compute active cubes in a 3D grid.
+  /// - Grid vertex layers are split into num_threads contiguous slabs.
+  /// - The cube layer between two slabs is computed after
+  ///   both slabs are encoded.
+  /// - Active cubes in slab 0 are stored directly in active_cube_list.
+  ///   Active cubes in other slabs are stored in thread_lists
+  ///   and appended in slab order.
+  template <typename ENCODE_TYPE>
+  void encode_grid_vertices_and_active_cubes_3D
+  (const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+   const IVOLDUAL_ENCODED_BLOCKS & encoded_blocks,
+   const ENCODE_TYPE & encode,
+   const int num_vertex_types,
+   const int num_threads,
+   IVOLDUAL_THREAD_LISTS & thread_lists,
+   IVOLDUAL_ENCODED_GRID & encoded_grid,
+   ACTIVE_CUBE_ARRAY & active_cube_list)
+  {
+    const int DIM3(3);
+    const int dimension = scalar_grid.Dimension();
+    const AXIS_SIZE_TYPE * axis_size = scalar_grid.AxisSize();
+    IJK::PROCEDURE_ERROR error("encode_grid_vertices_and_active_cubes");
+
+    if (dimension != DIM3) {
+      error.AddMessage
+        ("Programming error.  Grid dimension must be ", DIM3, ".");
+      error.AddMessage("  Grid dimension: ", dimension, "");
+      throw error;
+    }
+
+    if (encoded_blocks.Dimension() != DIM3) {
+      error.AddMessage
+        ("Programming error.  Encoded blocks dimension must be ", 
+         DIM3, ".");
+      throw error;
+    }
 
-  determine_ivol_vertices_missing_incident_hex
-    (ivoldual_table, poly_vert, ivolv_list);
+    encoded_grid.SetSize(dimension, axis_size);
+    active_cube_list.clear();
+
+    if (scalar_grid.NumVertices() == 0) { return; }
+
+    const VERTEX_INDEX nz = axis_size[2];
+    const int num_slabs = compute_num_thread_ranges(num_threads, nz);
+    std::vector<ACTIVE_CUBE_ARRAY> & slab_cube = thread_lists.slab_cube;
+    std::vector<ACTIVE_CUBE_ARRAY> & seam_cube = thread_lists.seam_cube;
+    std::vector<VERTEX_INDEX> & slab_end = thread_lists.slab_end;
+
+    clear_thread_lists(num_slabs, slab_cube);
+    clear_thread_lists(num_slabs, seam_cube);
+    if (slab_end.size() < std::size_t(num_slabs)) 
+      { slab_end.resize(num_slabs); }
+
+    run_on_thread_ranges
+      (num_threads, nz,
+       [&](const int k, const VERTEX_INDEX z0, const VERTEX_INDEX z1)
+       {
+         ACTIVE_CUBE_ARRAY & cube_k = 
+           (k == 0) ? active_cube_list : slab_cube[k];
+
+         slab_end[k] = z1;
+         for (VERTEX_INDEX iz = z0; iz < z1; iz++) {
+           encode_layer_3D
+             (scalar_grid, encoded_blocks, encode, iz, encoded_grid);
+
+           if (iz > z0) {
+             compute_active_cubes_in_layer_3D
+               (encoded_grid, encoded_blocks, num_vertex_types, iz-1, 
+                cube_k);
+           }
+         }
+       });
+
+    // Cube layers between slabs.
+    for (int k = 0; k+1 < num_slabs; k++) {
+      compute_active_cubes_in_layer_3D
+        (encoded_grid, encoded_blocks, num_vertex_types, slab_end[k]-1, 
+         seam_cube[k]);
+    }
 
-  determine_ivol_vertices_in_isosurface_boxes
-    (vertex_adjacency_list, ivolv_list);
+    // Concatenate in slab order so that list is sorted by cube index.
+    for (int k = 0; k < num_slabs; k++) {
+      if (k > 0) {
+        active_cube_list.insert
+          (active_cube_list.end(), slab_cube[k].begin(), slab_cube[k].end());
+      }
+      active_cube_list.insert
+        (active_cube_list.end(), seam_cube[k].begin(), seam_cube[k].end());
+    }
+  }
 
-  determine_ivol_vertices_in_isosurface_pseudoboxes
-    (vertex_adjacency_list, cube_list, ivolv_list);
+}
 
-  determine_ivol_vertices_adjacent_to_upper_and_lower_isosurfaces
-    (vertex_adjacency_list, ivolv_list);
 
-  determine_thin_regions
-    (grid, cube_list, index_to_cube_list, vertex_adjacency_list, ivolv_list);
+void IVOLDUAL::encode_grid_vertices_and_active_cubes
+(const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+ const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+ const GRID_VERTEX_ENCODING default_interior_code,
+ const int num_vertex_types,
+ const int num_threads,
+ IVOLDUAL_ENCODED_GRID & encoded_grid,
+ ACTIVE_CUBE_ARRAY & active_cube_list,
+ IVOLDUAL_INFO & dualiso_info)
+{
+  IVOLDUAL_ENCODED_BLOCKS encoded_blocks;
+  encoded_blocks.SetAllActive(scalar_grid);
 
+  encode_grid_vertices_and_active_cubes
+    (scalar_grid, encoded_blocks, isovalue0, isovalue1, 
+     default_interior_code, num_vertex_types, num_threads, 
+     encoded_grid, active_cube_list, dualiso_info);
 }
 
 
-void IVOLDUAL::determine_ivol_vertices_missing_incident_hex
-(const IVOLDUAL_CUBE_TABLE & ivoldual_table,
- const std::vector<ISO_VERTEX_INDEX> & poly_vert,
- DUAL_IVOLVERT_ARRAY & ivolv_list)
+void IVOLDUAL::encode_grid_vertices_and_active_cubes_set_interior_from_scalar
+(const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+ const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+ const int num_vertex_types,
+ const int num_threads,
+ IVOLDUAL_ENCODED_GRID & encoded_grid,
+ ACTIVE_CUBE_ARRAY & active_cube_list,
+ IVOLDUAL_INFO & dualiso_info)
 {
-  std::vector<ISO_VERTEX_INDEX> 
-    num_hex_incident_on_ivolv(ivolv_list.size(), 0);
+  IVOLDUAL_ENCODED_BLOCKS encoded_blocks;
+  encoded_blocks.SetAllActive(scalar_grid);
 
-  for (int i = 0; i < poly_vert.size(); i++) {
-    ISO_VERTEX_INDEX ivolv = poly_vert[i];
-    num_hex_incident_on_ivolv[ivolv]++;
-  }
+  encode_grid_vertices_and_active_cubes_set_interior_from_scalar
+    (scalar_grid, encoded_blocks, isovalue0, isovalue1, 
+     num_vertex_types, num_threads, 
+     encoded_grid, active_cube_list, dualiso_info);
+}
 
-  for (ISO_VERTEX_INDEX ivolv = 0; ivolv < ivolv_list.size(); ivolv++) {
-    const TABLE_INDEX table_index = ivolv_list[ivolv].table_index;
-    const FACET_VERTEX_INDEX patch_index = ivolv_list[ivolv].patch_index;
-    const int num_incident_hex = 
-      ivoldual_table.VertexInfo(table_index, patch_index).NumIncidentPoly();
 
-    if (num_incident_hex == num_hex_incident_on_ivolv[ivolv]) {
-      ivolv_list[ivolv].flag_missing_ivol_hexahedra = false;
-    }
-    else {
-      ivolv_list[ivolv].flag_missing_ivol_hexahedra = true;
-    }
-  }
+// Encode grid vertices and compute table index of every active cube.
+// - Version which skips blocks outside the interval volume.
+void IVOLDUAL::encode_grid_vertices_and_active_cubes
+(const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+ const IVOLDUAL_ENCODED_BLOCKS & encoded_blocks,
+ const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+ const GRID_VERTEX_ENCODING default_interior_code,
+ const int num_vertex_types,
+ const int num_threads,
+ IVOLDUAL_ENCODED_GRID & encoded_grid,
+ ACTIVE_CUBE_ARRAY & active_cube_list,
+ IVOLDUAL_INFO & dualiso_info)
+{
+  IVOLDUAL_THREAD_LISTS thread_lists;
 
+  encode_grid_vertices_and_active_cubes
+    (scalar_grid, encoded_blocks, isovalue0, isovalue1, 
+     default_interior_code, num_vertex_types, num_threads, thread_lists,
+     encoded_grid, active_cube_list, dualiso_info);
 }
 
 
-void IVOLDUAL::determine_ivol_vertices_in_isosurface_boxes
-(const IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
- DUAL_IVOLVERT_ARRAY & ivolv_list)
+// Encode grid vertices and compute table index of every active cube.
+// - Version which skips blocks outside the interval volume.
+void IVOLDUAL::encode_grid_vertices_and_active_cubes_set_interior_from_scalar
+(const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+ const IVOLDUAL_ENCODED_BLOCKS & encoded_blocks,
+ const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+ const int num_vertex_types,
+ const int num_threads,
+ IVOLDUAL_ENCODED_GRID & encoded_grid,
+ ACTIVE_CUBE_ARRAY & active_cube_list,
+ IVOLDUAL_INFO & dualiso_info)
 {
-  const int NUM_CUBE_VERTICES(8);
-  VERTEX_INDEX box_corner[NUM_CUBE_VERTICES];
-
-  for (IVOL_VERTEX_INDEX ivolv = 0; ivolv < ivolv_list.size(); ivolv++) 
-    { ivolv_list[ivolv].in_box = false; }
+  IVOLDUAL_THREAD_LISTS thread_lists;
 
-  for (IVOL_VERTEX_INDEX ivolv = 0; 
-       ivolv < vertex_adjacency_list.NumVertices(); ivolv++) {
+  encode_grid_vertices_and_active_cubes_set_interior_from_scalar
+    (scalar_grid, encoded_blocks, isovalue0, isovalue1, 
+     num_vertex_types, num_threads, thread_lists,
+     encoded_grid, active_cube_list, dualiso_info);
+}
 
-    if (is_ivolv_lower_left_vertex_of_isosurface_box
-        (vertex_adjacency_list, ivolv_list, ivolv, box_corner)) {
 
-      for (int j = 0; j < NUM_CUBE_VERTICES; j++) 
-        { ivolv_list[box_corner[j]].in_box = true; }
+// Encode grid vertices and compute table index of every active cube.
+// - Version which skips blocks outside the interval volume.
+// - Version which stores per thread lists in thread_lists.
+void IVOLDUAL::encode_grid_vertices_and_active_cubes
+(const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+ const IVOLDUAL_ENCODED_BLOCKS & encoded_blocks,
+ const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+ const GRID_VERTEX_ENCODING default_interior_code,
+ const int num_vertex_types,
+ const int num_threads,
+ IVOLDUAL_THREAD_LISTS & thread_lists,
+ IVOLDUAL_ENCODED_GRID & encoded_grid,
+ ACTIVE_CUBE_ARRAY & active_cube_list,
+ IVOLDUAL_INFO & dualiso_info)
+{
+  const ENCODE_DEFAULT_INTERIOR 
+    encode(isovalue0, isovalue1, default_interior_code);
 
-    }
-  }
+  encode_grid_vertices_and_active_cubes_3D
+    (scalar_grid, encoded_blocks, encode, num_vertex_types, num_threads,
+     thread_lists, encoded_grid, active_cube_list);
 }
 
 
-void IVOLDUAL::determine_ivol_vertices_in_isosurface_pseudoboxes
-(const IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
- const std::vector<GRID_CUBE_DATA> & cube_list,
- DUAL_IVOLVERT_ARRAY & ivolv_list)
+// Encode grid vertices and compute table index of every active cube.
+// - Version which skips blocks outside the interval volume.
+// - Version which stores per thread lists in thread_lists.
+void IVOLDUAL::encode_grid_vertices_and_active_cubes_set_interior_from_scalar
+(const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+ const IVOLDUAL_ENCODED_BLOCKS & encoded_blocks,
+ const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+ const int num_vertex_types,
+ const int num_threads,
+ IVOLDUAL_THREAD_LISTS & thread_lists,
+ IVOLDUAL_ENCODED_GRID & encoded_grid,
+ ACTIVE_CUBE_ARRAY & active_cube_list,
+ IVOLDUAL_INFO & dualiso_info)
 {
-  const int NUM_CUBE_VERTICES(8);
-  VERTEX_INDEX cube_list_index[NUM_CUBE_VERTICES];
+  const ENCODE_INTERIOR_FROM_SCALAR encode(isovalue0, isovalue1);
 
-  for (IVOL_VERTEX_INDEX ivolv = 0; ivolv < ivolv_list.size(); ivolv++) 
-    { ivolv_list[ivolv].in_pseudobox = false; }
+  encode_grid_vertices_and_active_cubes_3D
+    (scalar_grid, encoded_blocks, encode, num_vertex_types, num_threads,
+     thread_lists, encoded_grid, active_cube_list);
+}
 
-  for (int i = 0; i < cube_list.size(); i++) {
 
-    if (is_upper_right_grid_vertex_in_isosurface_pseudobox
-        (vertex_adjacency_list, cube_list, ivolv_list, i, cube_list_index)) {
+// **************************************************
+// ENCODE GRID VERTEX BANDS
+// **************************************************
 
-      for (int j = 0; j < NUM_CUBE_VERTICES; j++) 
-        { set_in_pseudobox(cube_list[cube_list_index[j]], ivolv_list); }
+// Encode array of scalar values as bands.
+// - Band of s is the number of thresholds t with !(s < t)
+//   plus the number of thresholds t with s > t.
+// - Branch free.  Uses SSE2 to encode 16 values at a time, if available.
+void IVOLDUAL::encode_scalar_bands
+(const SCALAR_TYPE scalar[], const VERTEX_INDEX num_values,
+ const SCALAR_TYPE threshold[], const int num_thresholds,
+ GRID_VERTEX_ENCODING band[])
+{
+  const int nan_band = IVOLDUAL_BAND_GRID::NAN_BAND;
+  VERTEX_INDEX iv = 0;
+
+#ifdef IVOLDUAL_USE_SSE2
+  const __m128i v_nan_band = _mm_set1_epi32(nan_band);
+  const VERTEX_INDEX NUM_PER_STEP = 16;
+
+  for (; iv+NUM_PER_STEP <= num_values; iv += NUM_PER_STEP) {
+    __m128i b[4];
+    for (int j = 0; j < 4; j++) {
+      const __m128 s = _mm_loadu_ps(scalar+iv+4*j);
+      __m128i count = _mm_setzero_si128();
+      for (int k = 0; k < num_thresholds; k++) {
+        const __m128 t = _mm_set1_ps(threshold[k]);
+        // Comparison masks are -1, so subtracting adds 1.
+        count = _mm_sub_epi32(count, _mm_castps_si128(_mm_cmpnlt_ps(s, t)));
+        count = _mm_sub_epi32(count, _mm_castps_si128(_mm_cmpgt_ps(s, t)));
+      }
+      const __m128i is_nan = _mm_castps_si128(_mm_cmpunord_ps(s, s));
+      b[j] = _mm_or_si128(_mm_and_si128(is_nan, v_nan_band),
+                          _mm_andnot_si128(is_nan, count));
     }
+    const __m128i b01 = _mm_packs_epi32(b[0], b[1]);
+    const __m128i b23 = _mm_packs_epi32(b[2], b[3]);
+    _mm_storeu_si128
+      ((__m128i *)(band+iv), _mm_packus_epi16(b01, b23));
+  }
+#endif
+
+  for (; iv < num_values; iv++) {
+    const SCALAR_TYPE s = scalar[iv];
+    int count = 0;
+    for (int k = 0; k < num_thresholds; k++) 
+      { count += int(!(s < threshold[k])) + int(s > threshold[k]); }
+    const int is_nan = (s != s);
+    band[iv] = GRID_VERTEX_ENCODING(count + is_nan*(nan_band-count));
   }
 }
 
 
-void IVOLDUAL::set_in_pseudobox
-(const GRID_CUBE_DATA & cube_ivolv,
- DUAL_IVOLVERT_ARRAY & ivolv_list)
+// Encode grid vertices as bands.
+void IVOLDUAL::encode_grid_vertex_bands
+(const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+ const int num_threads,
+ IVOLDUAL_BAND_GRID & band_grid,
+ IVOLDUAL_INFO & dualiso_info)
 {
-  for (int i = 0; i < cube_ivolv.num_isov; i++) {
-    const IVOL_VERTEX_INDEX ivolv = cube_ivolv.first_isov + i;
-    if (ivolv_list[ivolv].NumIncidentIsoQuad() > 0) 
-      { ivolv_list[ivolv].in_pseudobox = true; }
-  }
+  const int dimension = scalar_grid.Dimension();
+  const AXIS_SIZE_TYPE * axis_size = scalar_grid.AxisSize();
+  const SCALAR_TYPE * scalar = scalar_grid.ScalarPtrConst();
+  const SCALAR_TYPE * threshold = band_grid.ThresholdPtrConst();
+  const int num_thresholds = band_grid.NumThresholds();
+
+  band_grid.SetSize(dimension, axis_size);
+  GRID_VERTEX_ENCODING * band = band_grid.ScalarPtr();
+
+  run_on_thread_ranges
+    (num_threads, scalar_grid.NumVertices(), 
+     [&](const int, const VERTEX_INDEX ibegin, const VERTEX_INDEX iend)
+     {
+       encode_scalar_bands
+         (scalar+ibegin, iend-ibegin, threshold, num_thresholds, 
+          band+ibegin);
+     });
 }
 
 
-void IVOLDUAL::determine_ivol_vertices_adjacent_to_upper_and_lower_isosurfaces
-(const IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
- DUAL_IVOLVERT_ARRAY & ivolv_list)
-{
-  const int NUM_CUBE_VERTICES(8);
-  VERTEX_INDEX box_corner[NUM_CUBE_VERTICES];
-
-  for (IVOL_VERTEX_INDEX ivolv = 0; ivolv < ivolv_list.size(); ivolv++) {
-    ivolv_list[ivolv].flag_adjacent_to_upper_isosurface = false;
-    ivolv_list[ivolv].flag_adjacent_to_lower_isosurface = false;
-  }
+namespace {
 
+  /// Encode scalar values as bands.
+  class ENCODE_BANDS {
 
-  for (IVOL_VERTEX_INDEX ivolv0 = 0; 
-       ivolv0 < vertex_adjacency_list.NumVertices(); ivolv0++) {
+  protected:
+    const SCALAR_TYPE * threshold;
+    const int num_thresholds;
 
-    ivolv_list[ivolv0].flag_adjacent_to_lower_isosurface = false;
-    ivolv_list[ivolv0].flag_adjacent_to_upper_isosurface = false;
+  public:
+    ENCODE_BANDS(const IVOLDUAL_BAND_GRID & band_grid):
+      threshold(band_grid.ThresholdPtrConst()),
+      num_thresholds(band_grid.NumThresholds()) {};
 
-    for (int j = 0; j < vertex_adjacency_list.NumAdjacent(ivolv0); j++) {
-      IVOL_VERTEX_INDEX ivolv1 = 
-        vertex_adjacency_list.AdjacentVertex(ivolv0, j);
+    void operator () 
+    (const SCALAR_TYPE scalar[], const VERTEX_INDEX num_values,
+     GRID_VERTEX_ENCODING band[]) const
+    {
+      encode_scalar_bands
+        (scalar, num_values, threshold, num_thresholds, band);
+    }
+  };
 
-      if (ivolv_list[ivolv1].flag_lower_isosurface) 
-        { ivolv_list[ivolv0].flag_adjacent_to_lower_isosurface = true; }
 
-      if (ivolv_list[ivolv1].flag_upper_isosurface) 
-        { ivolv_list[ivolv0].flag_adjacent_to_upper_isosurface = true; }
+  /// Compute table indices of cubes in layer iz for every interval
+  ///   where the cube is active.
+  /// - Cubes in layer iz have lower vertices in grid vertex layer iz.
+  /// - Cube vertex bands are read once for all the intervals.
+  void compute_multi_interval_active_cubes_in_layer_3D
+  (const IVOLDUAL_BAND_GRID & band_grid,
+   const int num_vertex_types, const VERTEX_INDEX iz,
+   std::vector<ACTIVE_CUBE_ARRAY> & active_cube_list)
+  {
+    const int NUM_CUBE_VERTICES3D(8);
+    const VERTEX_INDEX nx = band_grid.AxisSize(0);
+    const VERTEX_INDEX ny = band_grid.AxisSize(1);
+    const VERTEX_INDEX layer_size = nx*ny;
+    const GRID_VERTEX_ENCODING * band = band_grid.ScalarPtrConst();
+    const VERTEX_INDEX vertex_offset[NUM_CUBE_VERTICES3D] = 
+      { 0, 1, nx, nx+1, 
+        layer_size, layer_size+1, layer_size+nx, layer_size+nx+1 };
+    GRID_VERTEX_ENCODING cube_band[NUM_CUBE_VERTICES3D];
+
+    for (VERTEX_INDEX iy = 0; iy+1 < ny; iy++) {
+      const VERTEX_INDEX iv_start = iz*layer_size + iy*nx;
+
+      for (VERTEX_INDEX ix = 0; ix+1 < nx; ix++) {
+        const VERTEX_INDEX icube = iv_start + ix;
+        int ibegin, iend;
+
+        for (int k = 0; k < NUM_CUBE_VERTICES3D; k++)
+          { cube_band[k] = band[icube+vertex_offset[k]]; }
+
+        band_grid.ComputeActiveIntervals
+          (cube_band, NUM_CUBE_VERTICES3D, ibegin, iend);
+
+        for (int i = ibegin; i < iend; i++) {
+          const GRID_VERTEX_ENCODING * code = 
+            band_grid.IntervalCodePtrConst(i);
+          TABLE_INDEX table_index = 0;
+          for (int k = NUM_CUBE_VERTICES3D-1; k >= 0; k--) {
+            table_index = 
+              table_index*num_vertex_types + code[cube_band[k]];
+          }
+          active_cube_list[i].push_back(ACTIVE_CUBE(icube, table_index));
+        }
+      }
     }
   }
+
 }
 
 
-void IVOLDUAL::determine_thin_regions
-(const DUALISO_GRID & grid,
- const std::vector<GRID_CUBE_DATA> & cube_list,
- const VERTEX_INDEX index_to_cube_list[],
- const IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
- DUAL_IVOLVERT_ARRAY & ivolv_list)
+// Encode grid vertices as bands and compute the active cubes
+//   of every interval in a single pass over the scalar grid.
+void IVOLDUAL::encode_grid_vertex_bands_and_active_cubes
+(const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+ const int num_vertex_types,
+ const int num_threads,
+ IVOLDUAL_BAND_GRID & band_grid,
+ std::vector<ACTIVE_CUBE_ARRAY> & active_cube_list,
+ IVOLDUAL_INFO & dualiso_info)
 {
-  typedef DUAL_IVOLVERT::DIR_BITS_TYPE DIR_BITS_TYPE;
-
   const int DIM3(3);
-  DIR_BITS_TYPE mask[DIM3] = 
-    { DIR_BITS_TYPE(1), DIR_BITS_TYPE(2), DIR_BITS_TYPE(4) };
-  IJK::PROCEDURE_ERROR error("determine_thin_regions");
+  const int dimension = scalar_grid.Dimension();
+  const AXIS_SIZE_TYPE * axis_size = scalar_grid.AxisSize();
+  const int num_intervals = band_grid.NumIntervals();
+  IJK::PROCEDURE_ERROR error("encode_grid_vertex_bands_and_active_cubes");
 
-  for (IVOL_VERTEX_INDEX ivolv = 0; ivolv < ivolv_list.size(); ivolv++) 
-    { ivolv_list[ivolv].in_thin_region = false; }
+  if (dimension != DIM3) {
+    error.AddMessage
+      ("Programming error.  Grid dimension must be ", DIM3, ".");
+    error.AddMessage("  Grid dimension: ", dimension, "");
+    throw error;
+  }
 
-  for (IVOL_VERTEX_INDEX ivolv0 = 0; 
-       ivolv0 < vertex_adjacency_list.NumVertices(); ivolv0++) {
+  band_grid.SetSize(dimension, axis_size);
+  active_cube_list.assign(num_intervals, ACTIVE_CUBE_ARRAY());
+
+  if (scalar_grid.NumVertices() == 0) { return; }
+
+  // Bands are encoded in every block.
+  IVOLDUAL_ENCODED_BLOCKS all_blocks;
+  all_blocks.SetAllActive(scalar_grid);
+  const ENCODE_BANDS encode(band_grid);
+
+  const VERTEX_INDEX nz = axis_size[2];
+  const int num_slabs = compute_num_thread_ranges(num_threads, nz);
+  std::vector< std::vector<ACTIVE_CUBE_ARRAY> > slab_cube
+    (num_slabs, std::vector<ACTIVE_CUBE_ARRAY>(num_intervals));
+  std::vector< std::vector<ACTIVE_CUBE_ARRAY> > seam_cube
+    (num_slabs, std::vector<ACTIVE_CUBE_ARRAY>(num_intervals));
+  std::vector<VERTEX_INDEX> slab_end(num_slabs);
+
+  run_on_thread_ranges
+    (num_threads, nz,
+     [&](const int k, const VERTEX_INDEX z0, const VERTEX_INDEX z1)
+     {
+       slab_end[k] = z1;
+       for (VERTEX_INDEX iz = z0; iz < z1; iz++) {
+         encode_layer_3D(scalar_grid, all_blocks, encode, iz, band_grid);
+
+         if (iz > z0) {
+           compute_multi_interval_active_cubes_in_layer_3D
+             (band_grid, num_vertex_types, iz-1, slab_cube[k]);
+         }
+       }
+     });
+
+  // Cube layers between slabs.
+  for (int k = 0; k+1 < num_slabs; k++) {
+    compute_multi_interval_active_cubes_in_layer_3D
+      (band_grid, num_vertex_types, slab_end[k]-1, seam_cube[k]);
+  }
 
-    const VERTEX_INDEX cube_index0 = ivolv_list[ivolv0].cube_index;
+  // Concatenate in slab order so that lists are sorted by cube index.
+  for (int i = 0; i < num_intervals; i++) {
+    for (int k = 0; k < num_slabs; k++) {
+      active_cube_list[i].insert
+        (active_cube_list[i].end(), 
+         slab_cube[k][i].begin(), slab_cube[k][i].end());
+      active_cube_list[i].insert
+        (active_cube_list[i].end(), 
+         seam_cube[k][i].begin(), seam_cube[k][i].end());
+    }
+  }
+}
 
-    // Skip vertices which are not on isosurface or not bent degree 4.
-    if (ivolv_list[ivolv0].NumIncidentIsoQuad() != 4) { continue; }
-    if (ivolv_list[ivolv0].separation_vertex >= grid.NumVertices()) 
-      { continue; }
 
-    if (ivolv_list[ivolv0].in_thin_region) {
-      // Already flagged as in thin region
-      continue;
-    }
+// Encode grid vertices as bands and compute the active cubes
+//   of every interval.
+// - Version which gets the table from the table cache.
+void IVOLDUAL::encode_grid_vertex_bands_and_active_cubes
+(const IVOLDUAL_DATA & ivoldual_data,
+ IVOLDUAL_BAND_GRID & band_grid,
+ std::vector<ACTIVE_CUBE_ARRAY> & active_cube_list,
+ IVOLDUAL_INFO & dualiso_info)
+{
+  const DUALISO_SCALAR_GRID_BASE & scalar_grid = ivoldual_data.ScalarGrid();
+  const int dimension = scalar_grid.Dimension();
+  const int num_threads = ivoldual_data.num_threads;
+  const int DIM3(3);
 
-    if (ivolv_list[ivolv0].flag_missing_ivol_hexahedra) { 
-      // Separation edge is on grid boundary.
-      continue; 
-    }
+  PROFILE_TIMER timer;
 
-    const int edge_dir = ivolv_list[ivolv0].separation_edge_direction;
+  dualiso_info.time.Clear();
+  dualiso_info.profile.Clear();
 
-    const int d1 = (edge_dir+1)%DIM3;
-    const int d2 = (edge_dir+2)%DIM3;
-    const DIR_BITS_TYPE connect_dir = ivolv_list[ivolv0].connect_dir;
+  if (dimension == DIM3) {
+    const IVOLDUAL_CUBE_TABLE & ivoldual_table = 
+      get_ivoldual_cube_table
+      (dimension, ivoldual_data.SeparateNegFlag(), 
+       ivoldual_data.table_filename);
 
-    VERTEX_INDEX cube_index1;
+    encode_grid_vertex_bands_and_active_cubes
+      (scalar_grid, ivoldual_table.NumVertexTypes(), num_threads,
+       band_grid, active_cube_list, dualiso_info);
+  }
+  else {
+    encode_grid_vertex_bands
+      (scalar_grid, num_threads, band_grid, dualiso_info);
+    active_cube_list.assign(band_grid.NumIntervals(), ACTIVE_CUBE_ARRAY());
+  }
+
+  dualiso_info.time.preprocessing = timer.WallSeconds();
+  dualiso_info.profile.AddTime(PROFILE_ENCODE, timer);
+}
+
+
+// Encode grid vertices for interval from their bands.
+void IVOLDUAL::encode_grid_vertices_from_bands
+(const IVOLDUAL_BAND_GRID & band_grid,
+ const int interval,
+ const int num_threads,
+ IVOLDUAL_ENCODED_GRID & encoded_grid)
+{
+  const GRID_VERTEX_ENCODING * band = band_grid.ScalarPtrConst();
+  const GRID_VERTEX_ENCODING * code = band_grid.IntervalCodePtrConst(interval);
+
+  encoded_grid.SetSize(band_grid);
+  GRID_VERTEX_ENCODING * encoding = encoded_grid.ScalarPtr();
+
+  run_on_thread_ranges
+    (num_threads, band_grid.NumVertices(), 
+     [&](const int, const VERTEX_INDEX ibegin, const VERTEX_INDEX iend)
+     {
+       for (VERTEX_INDEX iv = ibegin; iv < iend; iv++) 
+         { encoding[iv] = code[band[iv]]; }
+     });
+}
+
+
+// Encode vertices of active cubes for interval from their bands.
+// - Each vertex is encoded once for each active cube containing it.
+void IVOLDUAL::encode_active_cube_vertices_from_bands
+(const IVOLDUAL_BAND_GRID & band_grid,
+ const int interval,
+ const ACTIVE_CUBE_ARRAY & active_cube_list,
+ IVOLDUAL_ENCODED_GRID & encoded_grid)
+{
+  const int num_cube_vertices = band_grid.NumCubeVertices();
+  const GRID_VERTEX_ENCODING * band = band_grid.ScalarPtrConst();
+  const GRID_VERTEX_ENCODING * code = band_grid.IntervalCodePtrConst(interval);
+
+  encoded_grid.SetSize(band_grid);
+  GRID_VERTEX_ENCODING * encoding = encoded_grid.ScalarPtr();
+
+  for (std::size_t i = 0; i < active_cube_list.size(); i++) {
+    const VERTEX_INDEX icube = active_cube_list[i].cube_index;
+    for (int k = 0; k < num_cube_vertices; k++) {
+      const VERTEX_INDEX iv = band_grid.CubeVertex(icube, k);
+      encoding[iv] = code[band[iv]];
+    }
+  }
+}
+
+
+// **************************************************
+// SET IVOLTABLE INFO FOR EACH ACTIVE GRID CUBE
+// **************************************************
+
+namespace {
+
+  TABLE_INDEX compute_table_index_from_encoded_grid
+  (const IVOLDUAL_ENCODED_GRID & encoded_grid,
+   const int num_vertex_types,
+   const VERTEX_INDEX icube)
+  {
+    const int num_cube_vertices = encoded_grid.NumCubeVertices();
+    TABLE_INDEX table_index = 0;
+    TABLE_INDEX factor = 1;
+    for (int j = 0; j < num_cube_vertices; j++) {
+      const int j2 = num_cube_vertices-1-j;
+      const VERTEX_INDEX jv2 = encoded_grid.CubeVertex(icube, j2);
+      table_index = 
+        (table_index*num_vertex_types) + encoded_grid.Scalar(jv2);
+    }
+
+    return(table_index);
+  }
+
+}
+
+void IVOLDUAL::set_cube_ivoltable_info
+(const IVOLDUAL_ENCODED_GRID & encoded_grid,
+ const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+ std::vector<GRID_CUBE_DATA> & cube_ivolv_list)
+{
+  const int dimension = encoded_grid.Dimension();
+  const int num_vertex_types = ivoldual_table.NumVertexTypes();
+
+  for (int i = 0; i < cube_ivolv_list.size(); i++) {
+    const VERTEX_INDEX cube_index = cube_ivolv_list[i].cube_index;
+    const TABLE_INDEX table_index =
+      compute_table_index_from_encoded_grid
+      (encoded_grid, num_vertex_types, cube_index);
+
+    cube_ivolv_list[i].table_index = table_index;
+    cube_ivolv_list[i].num_isov = ivoldual_table.NumIsoVertices(table_index);
+  }
+}
+
+
+// Set ivoltable information for each cube in cube_ivolv_list.
+// - Version which splits cube_ivolv_list among num_threads threads.
+void IVOLDUAL::set_cube_ivoltable_info
+(const IVOLDUAL_ENCODED_GRID & encoded_grid,
+ const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+ const int num_threads,
+ std::vector<GRID_CUBE_DATA> & cube_ivolv_list)
+{
+  const int num_vertex_types = ivoldual_table.NumVertexTypes();
+
+  run_on_thread_ranges
+    (num_threads, int(cube_ivolv_list.size()),
+     [&](const int, const int ibegin, const int iend)
+     {
+       for (int i = ibegin; i < iend; i++) {
+         const VERTEX_INDEX cube_index = cube_ivolv_list[i].cube_index;
+         const TABLE_INDEX table_index =
+           compute_table_index_from_encoded_grid
+           (encoded_grid, num_vertex_types, cube_index);
+
+         cube_ivolv_list[i].table_index = table_index;
+         cube_ivolv_list[i].num_isov = 
+           ivoldual_table.NumIsoVertices(table_index);
+       }
+     });
+}
+
+
+// Set ivoltable information for each cube in cube_ivolv_list.
+// - Version which copies table indices from active_cube_list.
+void IVOLDUAL::set_cube_ivoltable_info
+(const ACTIVE_CUBE_ARRAY & active_cube_list,
+ const VERTEX_INDEX index_to_cube_list[],
+ const VERTEX_INDEX num_grid_vertices,
+ const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+ std::vector<GRID_CUBE_DATA> & cube_ivolv_list)
+{
+  const INDEX_TO_CUBE_LIST index(index_to_cube_list, num_grid_vertices);
+
+  set_cube_ivoltable_info
+    (active_cube_list, index, ivoldual_table, cube_ivolv_list);
+}
+
+
+// Set ivoltable information for each cube in cube_ivolv_list.
+// - Version which copies table indices from active_cube_list
+//   and locates cubes with index_to_cube_list.
+void IVOLDUAL::set_cube_ivoltable_info
+(const ACTIVE_CUBE_ARRAY & active_cube_list,
+ const INDEX_TO_CUBE_LIST & index_to_cube_list,
+ const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+ std::vector<GRID_CUBE_DATA> & cube_ivolv_list)
+{
+  const VERTEX_INDEX num_grid_vertices = index_to_cube_list.NumGridVertices();
+
+  for (int j = 0; j < active_cube_list.size(); j++) {
+    const VERTEX_INDEX cube_index = active_cube_list[j].cube_index;
+    const VERTEX_INDEX i = index_to_cube_list.Location(cube_index);
+
+    if (i == num_grid_vertices) {
+      // Cube cube_index is active but has no ivol vertices.
+      continue;
+    }
+
+    const TABLE_INDEX table_index = active_cube_list[j].table_index;
+    cube_ivolv_list[i].table_index = table_index;
+    cube_ivolv_list[i].num_isov = ivoldual_table.NumIsoVertices(table_index);
+  }
+}
+
+
+// **************************************************
+// INCREMENTAL ENCODING
+// **************************************************
+
+namespace {
+
+  /// Encode every grid vertex and, in 3D, compute every active cube
+  ///   and every grid edge and vertex dual to an interval volume polytope.
+  void encode_incremental_grid_full
+  (const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+   const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+   const int num_vertex_types,
+   const int num_threads,
+   IVOLDUAL_INCREMENTAL_GRID & incremental_grid)
+  {
+    const int DIM3(3);
+    const bool flag_set_interior_code_from_scalar =
+      incremental_grid.SetInteriorCodeFromScalarFlag();
+    const GRID_VERTEX_ENCODING default_interior_code =
+      incremental_grid.DefaultInteriorCode();
+    IVOLDUAL_INFO dualiso_info;
+
+    if (scalar_grid.Dimension() == DIM3) {
+      if (flag_set_interior_code_from_scalar) {
+        encode_grid_vertices_and_active_cubes_set_interior_from_scalar
+          (scalar_grid, isovalue0, isovalue1, num_vertex_types, num_threads,
+           incremental_grid, incremental_grid.active_cube_list, 
+           dualiso_info);
+      }
+      else {
+        encode_grid_vertices_and_active_cubes
+          (scalar_grid, isovalue0, isovalue1, default_interior_code,
+           num_vertex_types, num_threads, 
+           incremental_grid, incremental_grid.active_cube_list, 
+           dualiso_info);
+      }
+
+      find_dual_grid_edges
+        (incremental_grid, incremental_grid.active_cube_list, num_threads,
+         incremental_grid.dual_edge_list);
+      find_dual_grid_vertices
+        (incremental_grid, incremental_grid.active_cube_list, num_threads,
+         incremental_grid.dual_vertex_list);
+    }
+    else if (flag_set_interior_code_from_scalar) {
+      encode_grid_vertices_set_interior_from_scalar
+        (scalar_grid, isovalue0, isovalue1, num_threads, 
+         incremental_grid, dualiso_info);
+    }
+    else {
+      encode_grid_vertices
+        (scalar_grid, isovalue0, isovalue1, default_interior_code, 
+         num_threads, incremental_grid, dualiso_info);
+    }
+
+    incremental_grid.SetIsovalues(isovalue0, isovalue1);
+    incremental_grid.SetUpdateCounts
+      (scalar_grid.NumVertices(), scalar_grid.ComputeNumCubes());
+  }
+
+
+  /// Reclassify sorted vertices in range [ibegin,iend).
+  /// - Append vertices whose encoding changes to changed_vertex.
+  void reclassify_sorted_vertices
+  (const VERTEX_INDEX ibegin, const VERTEX_INDEX iend,
+   const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+   IVOLDUAL_INCREMENTAL_GRID & incremental_grid,
+   std::vector<GRID_VERTEX_ENCODING> & new_code,
+   std::vector<VERTEX_INDEX> & changed_vertex)
+  {
+    const VERTEX_INDEX * sorted_vertex = 
+      incremental_grid.SortedVertexPtrConst();
+    const SCALAR_TYPE * sorted_scalar = 
+      incremental_grid.SortedScalarPtrConst();
+    GRID_VERTEX_ENCODING * code = incremental_grid.ScalarPtr();
+
+    if (iend <= ibegin) { return; }
+
+    // Sorted scalar values are contiguous, so use the same 
+    //   (vectorized) encoding as the full grid.
+    new_code.resize(iend-ibegin);
+    if (incremental_grid.SetInteriorCodeFromScalarFlag()) {
+      encode_scalar_values_set_interior_from_scalar
+        (sorted_scalar+ibegin, iend-ibegin, isovalue0, isovalue1, 
+         new_code.data());
+    }
+    else {
+      encode_scalar_values
+        (sorted_scalar+ibegin, iend-ibegin, isovalue0, isovalue1, 
+         incremental_grid.DefaultInteriorCode(), new_code.data());
+    }
+
+    for (VERTEX_INDEX i = ibegin; i < iend; i++) {
+      const VERTEX_INDEX iv = sorted_vertex[i];
+      if (code[iv] != new_code[i-ibegin]) {
+        code[iv] = new_code[i-ibegin];
+        changed_vertex.push_back(iv);
+      }
+    }
+  }
+
+
+  /// Update active cubes incident on changed vertices (3D only).
+  /// - Return number of cubes whose table indices were recomputed.
+  VERTEX_INDEX update_active_cubes_3D
+  (const std::vector<VERTEX_INDEX> & changed_vertex,
+   const int num_vertex_types,
+   IVOLDUAL_INCREMENTAL_GRID & incremental_grid)
+  {
+    const int NUM_CUBE_VERTICES3D(8);
+    const VERTEX_INDEX nx = incremental_grid.AxisSize(0);
+    const VERTEX_INDEX ny = incremental_grid.AxisSize(1);
+    const VERTEX_INDEX nz = incremental_grid.AxisSize(2);
+    const VERTEX_INDEX layer_size = nx*ny;
+    ACTIVE_CUBE_ARRAY & active_cube_list = incremental_grid.active_cube_list;
+    std::vector<VERTEX_INDEX> cube_list;
+    ACTIVE_CUBE_ARRAY new_active_cube_list;
+
+    // Table index of a cube with all vertices above isovalue1.
+    TABLE_INDEX max_table_index = 0;
+    for (int k = 0; k < NUM_CUBE_VERTICES3D; k++)
+      { max_table_index = max_table_index*num_vertex_types + 3; }
+
+    // Cubes incident on changed vertices.
+    for (VERTEX_INDEX j = 0; j < changed_vertex.size(); j++) {
+      const VERTEX_INDEX iv = changed_vertex[j];
+      const VERTEX_INDEX x = iv%nx;
+      const VERTEX_INDEX y = (iv/nx)%ny;
+      const VERTEX_INDEX z = iv/layer_size;
+
+      for (VERTEX_INDEX z0 = std::max(z-1, 0); z0 <= z && z0+1 < nz; z0++)
+        for (VERTEX_INDEX y0 = std::max(y-1, 0); y0 <= y && y0+1 < ny; y0++)
+          for (VERTEX_INDEX x0 = std::max(x-1, 0); x0 <= x && x0+1 < nx; 
+               x0++) {
+            cube_list.push_back(z0*layer_size + y0*nx + x0);
+          }
+    }
+
+    std::sort(cube_list.begin(), cube_list.end());
+    cube_list.erase
+      (std::unique(cube_list.begin(), cube_list.end()), cube_list.end());
+
+    // Merge unchanged active cubes with updated cubes, 
+    //   keeping the list sorted by cube index.
+    new_active_cube_list.reserve(active_cube_list.size()+cube_list.size());
+    VERTEX_INDEX i = 0;
+    for (VERTEX_INDEX j = 0; j < cube_list.size(); j++) {
+      const VERTEX_INDEX icube = cube_list[j];
+
+      while (i < active_cube_list.size() && 
+             active_cube_list[i].cube_index < icube) {
+        new_active_cube_list.push_back(active_cube_list[i]);
+        i++;
+      }
+      if (i < active_cube_list.size() && 
+          active_cube_list[i].cube_index == icube)
+        { i++; }
+
+      const TABLE_INDEX table_index = 
+        compute_table_index_from_encoded_grid
+        (incremental_grid, num_vertex_types, icube);
+      if (table_index != 0 && table_index != max_table_index) {
+        new_active_cube_list.push_back(ACTIVE_CUBE(icube, table_index));
+      }
+    }
+    new_active_cube_list.insert
+      (new_active_cube_list.end(), 
+       active_cube_list.begin()+i, active_cube_list.end());
+
+    active_cube_list.swap(new_active_cube_list);
+
+    return(cube_list.size());
+  }
+
+}
+
+
+// Update encoding of grid vertices and active cubes
+//   for interval [isovalue0,isovalue1].
+void IVOLDUAL::encode_grid_vertices_incremental
+(const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+ const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+ const int num_vertex_types,
+ const int num_threads,
+ IVOLDUAL_INCREMENTAL_GRID & incremental_grid)
+{
+  const int DIM3(3);
+  const VERTEX_INDEX num_grid_vertices = scalar_grid.NumVertices();
+  const bool flag_set_interior_code_from_scalar =
+    incremental_grid.SetInteriorCodeFromScalarFlag();
+  SCALAR_TYPE old_threshold[3], new_threshold[3];
+  VERTEX_INDEX ibegin[3], iend[3];
+
+  if (!incremental_grid.IsEncoded()) {
+    encode_incremental_grid_full
+      (scalar_grid, isovalue0, isovalue1, num_vertex_types, num_threads,
+       incremental_grid);
+    return;
+  }
+
+  // Encoding changes only if a comparison with a threshold changes.
+  // Same threshold computations as encode_scalar_values and
+  //   encode_scalar_values_set_interior_from_scalar.
+  const int num_thresholds = (flag_set_interior_code_from_scalar ? 3 : 2);
+  old_threshold[0] = incremental_grid.Isovalue(0);
+  old_threshold[1] = incremental_grid.Isovalue(1);
+  old_threshold[2] = (old_threshold[0]+old_threshold[1])/2.0;
+  new_threshold[0] = isovalue0;
+  new_threshold[1] = isovalue1;
+  new_threshold[2] = (isovalue0+isovalue1)/2.0;
+
+  VERTEX_INDEX num_in_range = 0;
+  bool flag_nan = false;
+  for (int k = 0; k < num_thresholds; k++) {
+    const SCALAR_TYPE s0 = std::min(old_threshold[k], new_threshold[k]);
+    const SCALAR_TYPE s1 = std::max(old_threshold[k], new_threshold[k]);
+
+    if (s0 != s0 || s1 != s1) {
+      // Scalar values cannot be compared to NaN thresholds.
+      flag_nan = true;
+      break;
+    }
+    incremental_grid.SortedRange(s0, s1, ibegin[k], iend[k]);
+    num_in_range += (iend[k]-ibegin[k]);
+  }
+
+  if (flag_nan || 2*num_in_range > num_grid_vertices) {
+    // Encoding every vertex is faster.
+    encode_incremental_grid_full
+      (scalar_grid, isovalue0, isovalue1, num_vertex_types, num_threads,
+       incremental_grid);
+    return;
+  }
+
+  std::vector<GRID_VERTEX_ENCODING> new_code;
+  std::vector<VERTEX_INDEX> changed_vertex;
+  for (int k = 0; k < num_thresholds; k++) {
+    reclassify_sorted_vertices
+      (ibegin[k], iend[k], isovalue0, isovalue1, incremental_grid,
+       new_code, changed_vertex);
+  }
+
+  VERTEX_INDEX num_updated_cubes = 0;
+  if (scalar_grid.Dimension() == DIM3) {
+    num_updated_cubes = update_active_cubes_3D
+      (changed_vertex, num_vertex_types, incremental_grid);
+    update_dual_grid_elements
+      (incremental_grid, changed_vertex, incremental_grid.dual_edge_list,
+       incremental_grid.dual_vertex_list);
+  }
+
+  incremental_grid.SetIsovalues(isovalue0, isovalue1);
+  incremental_grid.SetUpdateCounts(changed_vertex.size(), num_updated_cubes);
+}
+
+
+// **************************************************
+// SET IVOL VERTEX INFORMATION
+// **************************************************
+
+void IVOLDUAL::set_ivol_vertex_info
+(const DUALISO_GRID & grid,
+ const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+ const std::vector<ISO_VERTEX_INDEX> & poly_vert,
+ const std::vector<GRID_CUBE_DATA> & cube_list,
+ const VERTEX_INDEX index_to_cube_list[],
+ const IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
+ DUAL_IVOLVERT_ARRAY & ivolv_list)
+{
+  const INDEX_TO_CUBE_LIST index(index_to_cube_list, grid.NumVertices());
+
+  set_ivol_vertex_info
+    (grid, ivoldual_table, poly_vert, cube_list, index, 
+     vertex_adjacency_list, ivolv_list);
+}
+
+
+// Set ivol vertex information.
+// - Version which locates cubes with index_to_cube_list.
+void IVOLDUAL::set_ivol_vertex_info
+(const DUALISO_GRID & grid,
+ const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+ const std::vector<ISO_VERTEX_INDEX> & poly_vert,
+ const std::vector<GRID_CUBE_DATA> & cube_list,
+ const INDEX_TO_CUBE_LIST & index_to_cube_list,
+ const IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
+ DUAL_IVOLVERT_ARRAY & ivolv_list)
+{
+  std::vector<ISO_VERTEX_INDEX> num_hex_incident_on_ivolv;
+
+  set_ivol_vertex_info
+    (grid, ivoldual_table, poly_vert, cube_list, index_to_cube_list,
+     vertex_adjacency_list, num_hex_incident_on_ivolv, ivolv_list);
+}
+
+
+// Set ivol vertex information.
+// - Version which counts incident hexahedra in num_hex_incident_on_ivolv.
+void IVOLDUAL::set_ivol_vertex_info
+(const DUALISO_GRID & grid,
+ const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+ const std::vector<ISO_VERTEX_INDEX> & poly_vert,
+ const std::vector<GRID_CUBE_DATA> & cube_list,
+ const INDEX_TO_CUBE_LIST & index_to_cube_list,
+ const IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
+ std::vector<ISO_VERTEX_INDEX> & num_hex_incident_on_ivolv,
+ DUAL_IVOLVERT_ARRAY & ivolv_list)
+{
+  typedef IVOLDUAL_TABLE_VERTEX_INFO::CUBE_VERTEX_TYPE CUBE_VERTEX_TYPE;
+  typedef IVOLDUAL_TABLE_VERTEX_INFO::CUBE_EDGE_TYPE CUBE_EDGE_TYPE;
+
+  const int DIM3(3);
+  const CUBE_VERTEX_TYPE UNDEFINED_CUBE_VERTEX =
+    IVOLDUAL_TABLE_VERTEX_INFO::UNDEFINED_CUBE_VERTEX;
+  const CUBE_EDGE_TYPE UNDEFINED_CUBE_EDGE = 
+    IVOLDUAL_TABLE_VERTEX_INFO::UNDEFINED_CUBE_EDGE;
+  static const CUBE_FACE_INFO cube(DIM3);
+
+
+  for (IVOL_VERTEX_INDEX ivolv = 0; ivolv < ivolv_list.size(); ivolv++) {
+    const TABLE_INDEX table_index = ivolv_list[ivolv].table_index;
+    const FACET_VERTEX_INDEX patch_index = ivolv_list[ivolv].patch_index;
+    const VERTEX_INDEX cube_index = ivolv_list[ivolv].cube_index;
+
+    // Initialize.
+    ivolv_list[ivolv].separation_vertex = grid.NumVertices();
+    ivolv_list[ivolv].separation_edge_direction = 0;
+
+    ivolv_list[ivolv].connect_dir = 
+      ivoldual_table.VertexInfo(table_index, patch_index).connect_dir;
+
+    ivolv_list[ivolv].num_incident_hex = 
+      ivoldual_table.VertexInfo(table_index, patch_index).NumIncidentPoly();
+
+    ivolv_list[ivolv].num_incident_iso_quad = 
+      ivoldual_table.VertexInfo(table_index, patch_index).NumIncidentIsoPoly();
+
+    ivolv_list[ivolv].flag_lower_isosurface = 
+      ivoldual_table.OnLowerIsosurface(table_index, patch_index);
+
+    ivolv_list[ivolv].flag_upper_isosurface = 
+      ivoldual_table.OnUpperIsosurface(table_index, patch_index);
+
+    const CUBE_VERTEX_TYPE icorner =
+      ivoldual_table.VertexInfo(table_index, patch_index).separation_vertex;
+
+    if (icorner != UNDEFINED_CUBE_VERTEX) {
+      ivolv_list[ivolv].separation_vertex = 
+        grid.CubeVertex(cube_index, icorner);
+    }
+
+    const CUBE_EDGE_TYPE iedge =
+      ivoldual_table.VertexInfo(table_index, patch_index).separation_edge;
+
+    if (iedge != UNDEFINED_CUBE_EDGE) {
+      const CUBE_VERTEX_TYPE icorner = cube.EdgeEndpoint(iedge, 0);
+      ivolv_list[ivolv].separation_vertex = 
+        grid.CubeVertex(cube_index, icorner);
+      ivolv_list[ivolv].separation_edge_direction = cube.EdgeDir(iedge);
+    }
+
+    ivolv_list[ivolv].is_doubly_connected =
+      ivoldual_table.VertexInfo(table_index, patch_index).is_doubly_connected;
+    ivolv_list[ivolv].doubly_connected_facet =
+      ivoldual_table.VertexInfo(table_index, patch_index).
+      doubly_connected_facet;
+    ivolv_list[ivolv].map_to = ivolv;
+  }
+
+
+
+  determine_ivol_vertices_missing_incident_hex
+    (ivoldual_table, poly_vert, num_hex_incident_on_ivolv, ivolv_list);
+
+  determine_ivol_vertices_in_isosurface_boxes
+    (vertex_adjacency_list, ivolv_list);
+
+  determine_ivol_vertices_in_isosurface_pseudoboxes
+    (vertex_adjacency_list, cube_list, ivolv_list);
+
+  determine_ivol_vertices_adjacent_to_upper_and_lower_isosurfaces
+    (vertex_adjacency_list, ivolv_list);
+
+  determine_thin_regions
+    (grid, cube_list, index_to_cube_list, vertex_adjacency_list, ivolv_list);
+
+}
+
+
+void IVOLDUAL::determine_ivol_vertices_missing_incident_hex
+(const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+ const std::vector<ISO_VERTEX_INDEX> & poly_vert,
+ DUAL_IVOLVERT_ARRAY & ivolv_list)
+{
+  std::vector<ISO_VERTEX_INDEX> num_hex_incident_on_ivolv;
+
+  determine_ivol_vertices_missing_incident_hex
+    (ivoldual_table, poly_vert, num_hex_incident_on_ivolv, ivolv_list);
+}
+
+
+void IVOLDUAL::determine_ivol_vertices_missing_incident_hex
+(const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+ const std::vector<ISO_VERTEX_INDEX> & poly_vert,
+ std::vector<ISO_VERTEX_INDEX> & num_hex_incident_on_ivolv,
+ DUAL_IVOLVERT_ARRAY & ivolv_list)
+{
+  // assign() reallocates only if ivolv_list has grown.
+  num_hex_incident_on_ivolv.assign(ivolv_list.size(), 0);
+
+  for (int i = 0; i < poly_vert.size(); i++) {
+    ISO_VERTEX_INDEX ivolv = poly_vert[i];
+    num_hex_incident_on_ivolv[ivolv]++;
+  }
+
+  for (ISO_VERTEX_INDEX ivolv = 0; ivolv < ivolv_list.size(); ivolv++) {
+    const TABLE_INDEX table_index = ivolv_list[ivolv].table_index;
+    const FACET_VERTEX_INDEX patch_index = ivolv_list[ivolv].patch_index;
+    const int num_incident_hex = 
+      ivoldual_table.VertexInfo(table_index, patch_index).NumIncidentPoly();
+
+    if (num_incident_hex == num_hex_incident_on_ivolv[ivolv]) {
+      ivolv_list[ivolv].flag_missing_ivol_hexahedra = false;
+    }
+    else {
+      ivolv_list[ivolv].flag_missing_ivol_hexahedra = true;
+    }
+  }
+
+}
+
+
+void IVOLDUAL::determine_ivol_vertices_in_isosurface_boxes
+(const IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
+ DUAL_IVOLVERT_ARRAY & ivolv_list)
+{
+  const int NUM_CUBE_VERTICES(8);
+  VERTEX_INDEX box_corner[NUM_CUBE_VERTICES];
+
+  for (IVOL_VERTEX_INDEX ivolv = 0; ivolv < ivolv_list.size(); ivolv++) 
+    { ivolv_list[ivolv].in_box = false; }
+
+  for (IVOL_VERTEX_INDEX ivolv = 0; 
+       ivolv < vertex_adjacency_list.NumVertices(); ivolv++) {
+
+    if (is_ivolv_lower_left_vertex_of_isosurface_box
+        (vertex_adjacency_list, ivolv_list, ivolv, box_corner)) {
+
+      for (int j = 0; j < NUM_CUBE_VERTICES; j++) 
+        { ivolv_list[box_corner[j]].in_box = true; }
+
+    }
+  }
+}
+
+
+void IVOLDUAL::determine_ivol_vertices_in_isosurface_pseudoboxes
+(const IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
+ const std::vector<GRID_CUBE_DATA> & cube_list,
+ DUAL_IVOLVERT_ARRAY & ivolv_list)
+{
+  const int NUM_CUBE_VERTICES(8);
+  VERTEX_INDEX cube_list_index[NUM_CUBE_VERTICES];
+
+  for (IVOL_VERTEX_INDEX ivolv = 0; ivolv < ivolv_list.size(); ivolv++) 
+    { ivolv_list[ivolv].in_pseudobox = false; }
+
+  for (int i = 0; i < cube_list.size(); i++) {
+
+    if (is_upper_right_grid_vertex_in_isosurface_pseudobox
+        (vertex_adjacency_list, cube_list, ivolv_list, i, cube_list_index)) {
+
+      for (int j = 0; j < NUM_CUBE_VERTICES; j++) 
+        { set_in_pseudobox(cube_list[cube_list_index[j]], ivolv_list); }
+    }
+  }
+}
+
+
+void IVOLDUAL::set_in_pseudobox
+(const GRID_CUBE_DATA & cube_ivolv,
+ DUAL_IVOLVERT_ARRAY & ivolv_list)
+{
+  for (int i = 0; i < cube_ivolv.num_isov; i++) {
+    const IVOL_VERTEX_INDEX ivolv = cube_ivolv.first_isov + i;
+    if (ivolv_list[ivolv].NumIncidentIsoQuad() > 0) 
+      { ivolv_list[ivolv].in_pseudobox = true; }
+  }
+}
+
+
+void IVOLDUAL::determine_ivol_vertices_adjacent_to_upper_and_lower_isosurfaces
+(const IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
+ DUAL_IVOLVERT_ARRAY & ivolv_list)
+{
+  const int NUM_CUBE_VERTICES(8);
+  VERTEX_INDEX box_corner[NUM_CUBE_VERTICES];
+
+  for (IVOL_VERTEX_INDEX ivolv = 0; ivolv < ivolv_list.size(); ivolv++) {
+    ivolv_list[ivolv].flag_adjacent_to_upper_isosurface = false;
+    ivolv_list[ivolv].flag_adjacent_to_lower_isosurface = false;
+  }
+
+
+  for (IVOL_VERTEX_INDEX ivolv0 = 0; 
+       ivolv0 < vertex_adjacency_list.NumVertices(); ivolv0++) {
+
+    ivolv_list[ivolv0].flag_adjacent_to_lower_isosurface = false;
+    ivolv_list[ivolv0].flag_adjacent_to_upper_isosurface = false;
+
+    for (int j = 0; j < vertex_adjacency_list.NumAdjacent(ivolv0); j++) {
+      IVOL_VERTEX_INDEX ivolv1 = 
+        vertex_adjacency_list.AdjacentVertex(ivolv0, j);
+
+      if (ivolv_list[ivolv1].flag_lower_isosurface) 
+        { ivolv_list[ivolv0].flag_adjacent_to_lower_isosurface = true; }
+
+      if (ivolv_list[ivolv1].flag_upper_isosurface) 
+        { ivolv_list[ivolv0].flag_adjacent_to_upper_isosurface = true; }
+    }
+  }
+}
+
+
+void IVOLDUAL::determine_thin_regions
+(const DUALISO_GRID & grid,
+ const std::vector<GRID_CUBE_DATA> & cube_list,
+ const VERTEX_INDEX index_to_cube_list[],
+ const IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
+ DUAL_IVOLVERT_ARRAY & ivolv_list)
+{
+  const INDEX_TO_CUBE_LIST index(index_to_cube_list, grid.NumVertices());
+
+  determine_thin_regions
+    (grid, cube_list, index, vertex_adjacency_list, ivolv_list);
+}
+
+
+// Determine thin regions.
+// - Version which locates cubes with index_to_cube_list.
+void IVOLDUAL::determine_thin_regions
+(const DUALISO_GRID & grid,
+ const std::vector<GRID_CUBE_DATA> & cube_list,
+ const INDEX_TO_CUBE_LIST & index_to_cube_list,
+ const IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
+ DUAL_IVOLVERT_ARRAY & ivolv_list)
+{
+  typedef DUAL_IVOLVERT::DIR_BITS_TYPE DIR_BITS_TYPE;
+
+  const int DIM3(3);
+  DIR_BITS_TYPE mask[DIM3] = 
+    { DIR_BITS_TYPE(1), DIR_BITS_TYPE(2), DIR_BITS_TYPE(4) };
+  IJK::PROCEDURE_ERROR error("determine_thin_regions");
+
+  for (IVOL_VERTEX_INDEX ivolv = 0; ivolv < ivolv_list.size(); ivolv++) 
+    { ivolv_list[ivolv].in_thin_region = false; }
+
+  for (IVOL_VERTEX_INDEX ivolv0 = 0; 
+       ivolv0 < vertex_adjacency_list.NumVertices(); ivolv0++) {
+
+    const VERTEX_INDEX cube_index0 = ivolv_list[ivolv0].cube_index;
+
+    // Skip vertices which are not on isosurface or not bent degree 4.
+    if (ivolv_list[ivolv0].NumIncidentIsoQuad() != 4) { continue; }
+    if (ivolv_list[ivolv0].separation_vertex >= grid.NumVertices()) 
+      { continue; }
+
+    if (ivolv_list[ivolv0].in_thin_region) {
+      // Already flagged as in thin region
+      continue;
+    }
+
+    if (ivolv_list[ivolv0].flag_missing_ivol_hexahedra) { 
+      // Separation edge is on grid boundary.
+      continue; 
+    }
+
+    const int edge_dir = ivolv_list[ivolv0].separation_edge_direction;
+
+    const int d1 = (edge_dir+1)%DIM3;
+    const int d2 = (edge_dir+2)%DIM3;
+    const DIR_BITS_TYPE connect_dir = ivolv_list[ivolv0].connect_dir;
+
+    VERTEX_INDEX cube_index1;
     if ((mask[d1] & connect_dir) == 0) 
       { cube_index1 = grid.NextVertex(cube_index0, d1); }
     else
       { cube_index1 = grid.PrevVertex(cube_index0, d1); }
 
-    if ((mask[d2] & connect_dir) == 0) 
-      { cube_index1 = grid.NextVertex(cube_index1, d2); }
-    else
-      { cube_index1 = grid.PrevVertex(cube_index1, d2); }
+    if ((mask[d2] & connect_dir) == 0) 
+      { cube_index1 = grid.NextVertex(cube_index1, d2); }
+    else
+      { cube_index1 = grid.PrevVertex(cube_index1, d2); }
+
+    const int i1 = index_to_cube_list.Location(cube_index1);
+
+    if (i1 == grid.NumVertices()) {
+      // Grid cube cube_index1 is not active.  Skip.
+      continue;
+    }
+
+    IVOL_VERTEX_INDEX ivolv1 = cube_list[i1].first_isov;
+    for (int j = 0; j < cube_list[i1].num_isov; j++) {
+
+      // Skip vertices which are not on isosurface or not bent degree 4.
+      if (ivolv_list[ivolv1].NumIncidentIsoQuad() != 4) { continue; }
+      if (ivolv_list[ivolv1].separation_vertex >= grid.NumVertices()) 
+      { continue; }
+
+      if ((ivolv_list[ivolv1].separation_vertex ==
+           ivolv_list[ivolv0].separation_vertex) &&
+          (ivolv_list[ivolv1].separation_edge_direction ==
+           ivolv_list[ivolv0].separation_edge_direction)) {
+        ivolv_list[ivolv0].in_thin_region = true;
+        ivolv_list[ivolv1].in_thin_region = true;
+        break;
+      }
+    }
+  }
+
+}
+
+
+// **************************************************
+// EXTRACT DUAL INTERVAL VOLUME POLYTOPES
+// **************************************************
+
+void IVOLDUAL::extract_dual_ivolpoly
+(const IVOLDUAL_ENCODED_GRID & encoded_grid,
+ std::vector<ISO_VERTEX_INDEX> & ivolpoly,
+ std::vector<POLY_VERTEX_INDEX> & poly_vertex,
+ IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
+ IVOLDUAL_INFO & dualiso_info)
+{
+  dualiso_info.time.extract = 0;
+
+  clock_t t0 = clock();
+
+  // Initialize output
+  ivolpoly.clear();
+
+  if (encoded_grid.NumCubeVertices() < 1) { return; }
+
+  extract_ivolpoly_dual_to_grid_edges
+    (encoded_grid, ivolpoly, poly_vertex, ivolpoly_info, dualiso_info);
+  extract_ivolpoly_dual_to_grid_vertices
+    (encoded_grid, ivolpoly, poly_vertex, ivolpoly_info, dualiso_info);
+
+  clock_t t1 = clock();
+  IJK::clock2seconds(t1-t0, dualiso_info.time.extract);
+}
+
+namespace {
+
+  void add_grid_facet_vertices
+  (const DUALISO_GRID & grid, const VERTEX_INDEX iv0, const int edge_dir,
+   std::vector<ISO_VERTEX_INDEX> & ivolpoly,
+   std::vector<POLY_VERTEX_INDEX> & poly_vertex)
+  {
+    const int num_facet_vertices = grid.NumFacetVertices();
+
+    for (int k = 0; k < num_facet_vertices; k++) {
+
+      // jcube is the index of the cube containing the k'th vertex
+      //   of the facet.
+      const VERTEX_INDEX jcube = grid.FacetVertex(iv0, edge_dir, k);
+      ivolpoly.push_back(jcube);
+      poly_vertex.push_back(edge_dir*num_facet_vertices+k);
+    }
+  }
+
+  // \param[out] flag_reverse_orient True if orientation of dual polytope
+  //   should be reversed.
+  bool does_grid_edge_have_dual_ivolpoly
+  (const IVOLDUAL_ENCODED_GRID & encoded_grid,
+   const VERTEX_INDEX iend0, const int edge_dir,
+   bool & flag_reverse_orient)
+  {
+    VERTEX_INDEX iend1 = encoded_grid.NextVertex(iend0, edge_dir);
+    GRID_VERTEX_ENCODING s0 = encoded_grid.Scalar(iend0);
+    GRID_VERTEX_ENCODING s1 = encoded_grid.Scalar(iend1);
+
+    flag_reverse_orient = false;
+
+    if (s0 > s1) { 
+      std::swap(s0,s1); 
+      flag_reverse_orient = true;
+    }
+
+    if (s0 == 0) {
+      if (s1 >= 2) { return(true); }
+    }
+    else if (s0 == 1) {
+      if (s1 > 1)
+        { return(true); }
+    }
+
+    return(false);
+  }
+
+  bool does_grid_vertex_have_dual_ivolpoly
+  (const IVOLDUAL_ENCODED_GRID & encoded_grid, const VERTEX_INDEX iv0)
+  {
+    GRID_VERTEX_ENCODING s0 = encoded_grid.Scalar(iv0);
+
+    if (s0 == 1 || s0 == 2) { return(true); }
+    return(false);
+  }
+
+}
+
+void IVOLDUAL::extract_ivolpoly_dual_to_grid_edges
+(const IVOLDUAL_ENCODED_GRID & encoded_grid,
+ std::vector<ISO_VERTEX_INDEX> & ivolpoly,
+ std::vector<POLY_VERTEX_INDEX> & poly_vertex,
+ IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
+ IVOLDUAL_INFO & dualiso_info)
+{
+  const int num_facet_vertices = encoded_grid.NumFacetVertices();
+  bool flag_reverse_orient;
+
+  if (num_facet_vertices == 0) { return; }
+
+  IJK_FOR_EACH_INTERIOR_GRID_EDGE(iend0, edge_dir, encoded_grid, VERTEX_INDEX) {
+
+    if (does_grid_edge_have_dual_ivolpoly
+        (encoded_grid, iend0, edge_dir, flag_reverse_orient)) {
+
+      const VERTEX_INDEX increment = 
+        encoded_grid.FacetVertexIncrement(edge_dir,num_facet_vertices-1);
+      const VERTEX_INDEX iv0 = iend0 - increment;
+
+      for (int j = 0; j < 2; j++) {
+        add_grid_facet_vertices
+          (encoded_grid, iv0, edge_dir, ivolpoly, poly_vertex);
+      }
+
+      IVOLDUAL_POLY_INFO info;
+      info.SetDualToEdge(iend0, edge_dir, flag_reverse_orient);
+      ivolpoly_info.push_back(info);
+    }
+  }
+
+}
+
+
+void IVOLDUAL::extract_ivolpoly_dual_to_grid_vertices
+(const IVOLDUAL_ENCODED_GRID & encoded_grid,
+ std::vector<ISO_VERTEX_INDEX> & ivolpoly,
+ std::vector<POLY_VERTEX_INDEX> & poly_vertex,
+ IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
+ IVOLDUAL_INFO & dualiso_info)
+{
+  const int num_facet_vertices = encoded_grid.NumFacetVertices();
+  const int num_cube_vertices = encoded_grid.NumCubeVertices();
+
+  if (num_facet_vertices == 0) { return; }
+
+  IJK_FOR_EACH_INTERIOR_GRID_VERTEX(iv0, encoded_grid, VERTEX_INDEX) {
+
+    if (does_grid_vertex_have_dual_ivolpoly(encoded_grid, iv0)) {
+      const VERTEX_INDEX increment = 
+        encoded_grid.CubeVertexIncrement(num_cube_vertices-1);
+      const VERTEX_INDEX iv1 = iv0 - increment;
+
 
-    const int i1 = index_to_cube_list[cube_index1];
+      for (int k = 0; k < num_cube_vertices; k++) {
+        ivolpoly.push_back(encoded_grid.CubeVertex(iv1, k));
+        poly_vertex.push_back(k);
+      }
 
-    if (i1 == grid.NumVertices()) {
-      // Grid cube cube_index1 is not active.  Skip.
-      continue;
+      IVOLDUAL_POLY_INFO info;
+      info.SetDualToVertex(iv0);
+      ivolpoly_info.push_back(info);
     }
+  }
+}
 
-    IVOL_VERTEX_INDEX ivolv1 = cube_list[i1].first_isov;
-    for (int j = 0; j < cube_list[i1].num_isov; j++) {
 
-      // Skip vertices which are not on isosurface or not bent degree 4.
-      if (ivolv_list[ivolv1].NumIncidentIsoQuad() != 4) { continue; }
-      if (ivolv_list[ivolv1].separation_vertex >= grid.NumVertices()) 
-      { continue; }
+// Extract dual interval volume polytopes.
+// - Multithreaded version.
+void IVOLDUAL::extract_dual_ivolpoly
+(const IVOLDUAL_ENCODED_GRID & encoded_grid,
+ const int num_threads,
+ std::vector<ISO_VERTEX_INDEX> & ivolpoly,
+ std::vector<POLY_VERTEX_INDEX> & poly_vertex,
+ IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
+ IVOLDUAL_INFO & dualiso_info)
+{
+  if (num_threads <= 1) {
+    extract_dual_ivolpoly
+      (encoded_grid, ivolpoly, poly_vertex, ivolpoly_info, dualiso_info);
+    return;
+  }
 
-      if ((ivolv_list[ivolv1].separation_vertex ==
-           ivolv_list[ivolv0].separation_vertex) &&
-          (ivolv_list[ivolv1].separation_edge_direction ==
-           ivolv_list[ivolv0].separation_edge_direction)) {
-        ivolv_list[ivolv0].in_thin_region = true;
-        ivolv_list[ivolv1].in_thin_region = true;
-        break;
+  dualiso_info.time.extract = 0;
+
+  clock_t t0 = clock();
+
+  // Initialize output
+  ivolpoly.clear();
+
+  if (encoded_grid.NumCubeVertices() < 1) { return; }
+
+  extract_ivolpoly_dual_to_grid_edges
+    (encoded_grid, num_threads, ivolpoly, poly_vertex, ivolpoly_info);
+  extract_ivolpoly_dual_to_grid_vertices
+    (encoded_grid, num_threads, ivolpoly, poly_vertex, ivolpoly_info);
+
+  clock_t t1 = clock();
+  IJK::clock2seconds(t1-t0, dualiso_info.time.extract);
+}
+
+
+namespace {
+
+  /// Interval volume polytopes extracted from one slab.
+  class SLAB_IVOLPOLY {
+
+  public:
+    std::vector<ISO_VERTEX_INDEX> ivolpoly;
+    std::vector<POLY_VERTEX_INDEX> poly_vertex;
+    IVOLDUAL_POLY_INFO_ARRAY ivolpoly_info;
+  };
+
+  /// Append polytopes from each slab, in slab order.
+  void append_slab_ivolpoly
+  (const std::vector<SLAB_IVOLPOLY> & slab,
+   std::vector<ISO_VERTEX_INDEX> & ivolpoly,
+   std::vector<POLY_VERTEX_INDEX> & poly_vertex,
+   IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info)
+  {
+    for (int k = 0; k < slab.size(); k++) {
+      ivolpoly.insert
+        (ivolpoly.end(), slab[k].ivolpoly.begin(), slab[k].ivolpoly.end());
+      poly_vertex.insert
+        (poly_vertex.end(), slab[k].poly_vertex.begin(), 
+         slab[k].poly_vertex.end());
+      ivolpoly_info.insert
+        (ivolpoly_info.end(), slab[k].ivolpoly_info.begin(), 
+         slab[k].ivolpoly_info.end());
+    }
+  }
+
+}
+
+
+// Extract interval volume polytopes dual to grid edges.
+// - Multithreaded version.
+void IVOLDUAL::extract_ivolpoly_dual_to_grid_edges
+(const IVOLDUAL_ENCODED_GRID & encoded_grid,
+ const int num_threads,
+ std::vector<ISO_VERTEX_INDEX> & ivolpoly,
+ std::vector<POLY_VERTEX_INDEX> & poly_vertex,
+ IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info)
+{
+  IVOLDUAL_ENCODED_BLOCKS encoded_blocks;
+  encoded_blocks.SetAllActive(encoded_grid);
+
+  extract_ivolpoly_dual_to_grid_edges
+    (encoded_grid, encoded_blocks, num_threads, 
+     ivolpoly, poly_vertex, ivolpoly_info);
+}
+
+
+// Extract interval volume polytopes dual to grid vertices.
+// - Multithreaded version.
+void IVOLDUAL::extract_ivolpoly_dual_to_grid_vertices
+(const IVOLDUAL_ENCODED_GRID & encoded_grid,
+ const int num_threads,
+ std::vector<ISO_VERTEX_INDEX> & ivolpoly,
+ std::vector<POLY_VERTEX_INDEX> & poly_vertex,
+ IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info)
+{
+  IVOLDUAL_ENCODED_BLOCKS encoded_blocks;
+  encoded_blocks.SetAllActive(encoded_grid);
+
+  extract_ivolpoly_dual_to_grid_vertices
+    (encoded_grid, encoded_blocks, num_threads, 
+     ivolpoly, poly_vertex, ivolpoly_info);
+}
+
+
+// Extract dual interval volume polytopes.
+// - Multithreaded version which skips blocks outside the interval volume.
+void IVOLDUAL::extract_dual_ivolpoly
+(const IVOLDUAL_ENCODED_GRID & encoded_grid,
+ const IVOLDUAL_ENCODED_BLOCKS & encoded_blocks,
+ const int num_threads,
+ std::vector<ISO_VERTEX_INDEX> & ivolpoly,
+ std::vector<POLY_VERTEX_INDEX> & poly_vertex,
+ IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
+ IVOLDUAL_INFO & dualiso_info)
+{
+  dualiso_info.time.extract = 0;
+
+  clock_t t0 = clock();
+
+  // Initialize output
+  ivolpoly.clear();
+
+  if (encoded_grid.NumCubeVertices() < 1) { return; }
+
+  extract_ivolpoly_dual_to_grid_edges
+    (encoded_grid, encoded_blocks, num_threads, 
+     ivolpoly, poly_vertex, ivolpoly_info);
+  extract_ivolpoly_dual_to_grid_vertices
+    (encoded_grid, encoded_blocks, num_threads, 
+     ivolpoly, poly_vertex, ivolpoly_info);
+
+  clock_t t1 = clock();
+  IJK::clock2seconds(t1-t0, dualiso_info.time.extract);
+}
+
+
+namespace {
+
+  /// Return index of block containing the row of grid vertices
+  ///   starting at iv_start.
+  /// - The row is parallel to axis row_dir.
+  /// - Block coordinate along row_dir is 0.
+  VERTEX_INDEX compute_row_block_index
+  (const IVOLDUAL_ENCODED_GRID & encoded_grid,
+   const IVOLDUAL_ENCODED_BLOCKS & encoded_blocks,
+   const VERTEX_INDEX iv_start, const int row_dir,
+   std::vector<GRID_COORD_TYPE> & coord)
+  {
+    const int dimension = encoded_grid.Dimension();
+    VERTEX_INDEX ib = 0;
+
+    encoded_grid.ComputeCoord(iv_start, coord.data());
+    for (int d = 0; d < dimension; d++) {
+      if (d != row_dir) {
+        ib += encoded_blocks.BlockCoord(coord[d], d)*
+          encoded_blocks.AxisIncrement(d);
       }
     }
+
+    return(ib);
   }
 
 }
 
 
-// **************************************************
-// EXTRACT DUAL INTERVAL VOLUME POLYTOPES
-// **************************************************
+// Extract interval volume polytopes dual to grid edges.
+// - Multithreaded version which skips blocks outside the interval volume.
+// - Visits grid edges in the same order as 
+//   IJK_FOR_EACH_INTERIOR_GRID_EDGE, but splits the list of edge rows
+//   in each direction into contiguous slabs.
+// - Grid edges in blocks which are not active are skipped.
+void IVOLDUAL::extract_ivolpoly_dual_to_grid_edges
+(const IVOLDUAL_ENCODED_GRID & encoded_grid,
+ const IVOLDUAL_ENCODED_BLOCKS & encoded_blocks,
+ const int num_threads,
+ std::vector<ISO_VERTEX_INDEX> & ivolpoly,
+ std::vector<POLY_VERTEX_INDEX> & poly_vertex,
+ IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info)
+{
+  const int dimension = encoded_grid.Dimension();
+  const int num_facet_vertices = encoded_grid.NumFacetVertices();
+  const VERTEX_INDEX block_edge_length = encoded_blocks.BlockEdgeLength();
+
+  if (num_facet_vertices == 0) { return; }
+
+  for (int edge_dir = 0; edge_dir < dimension; edge_dir++) {
+
+    if (encoded_grid.AxisSize(edge_dir) < 1) { continue; }
+
+    const VERTEX_INDEX axis_inc = encoded_grid.AxisIncrement(edge_dir);
+    const VERTEX_INDEX axis_size = encoded_grid.AxisSize(edge_dir);
+    const VERTEX_INDEX increment = 
+      encoded_grid.FacetVertexIncrement(edge_dir,num_facet_vertices-1);
+    const VERTEX_INDEX num_blocks_along_edge_dir = 
+      encoded_blocks.AxisSize(edge_dir);
+    const VERTEX_INDEX block_inc = encoded_blocks.AxisIncrement(edge_dir);
+    IJK::FACET_INTERIOR_VERTEX_LIST<VERTEX_INDEX> 
+      vlist(encoded_grid, edge_dir, false, true);
+    std::vector<SLAB_IVOLPOLY> slab
+      (compute_num_thread_ranges(num_threads, vlist.NumVertices()));
+
+    run_on_thread_ranges
+      (num_threads, vlist.NumVertices(),
+       [&](const int k, const VERTEX_INDEX ibegin, const VERTEX_INDEX iend)
+       {
+         std::vector<GRID_COORD_TYPE> coord(dimension);
+         bool flag_reverse_orient;
+
+         for (VERTEX_INDEX i = ibegin; i < iend; i++) {
+           const VERTEX_INDEX iv_start = vlist.VertexIndex(i);
+           const VERTEX_INDEX ib_row = compute_row_block_index
+             (encoded_grid, encoded_blocks, iv_start, edge_dir, coord);
+
+           for (VERTEX_INDEX jb = 0; jb < num_blocks_along_edge_dir; jb++) {
+
+             if (!encoded_blocks.IsActive(ib_row+jb*block_inc)) 
+               { continue; }
+
+             // Edges with lower coordinate in [x0,x1) are in block jb.
+             const VERTEX_INDEX x0 = jb*block_edge_length;
+             const VERTEX_INDEX x1 = (jb+1 < num_blocks_along_edge_dir) ?
+               x0+block_edge_length : axis_size-1;
+             const VERTEX_INDEX iv0_start = iv_start + x0*axis_inc;
+             const VERTEX_INDEX iv0_end = iv_start + x1*axis_inc;
+
+             for (VERTEX_INDEX iend0 = iv0_start; iend0 < iv0_end; 
+                  iend0 += axis_inc) {
+
+               if (does_grid_edge_have_dual_ivolpoly
+                   (encoded_grid, iend0, edge_dir, flag_reverse_orient)) {
+
+                 const VERTEX_INDEX iv0 = iend0 - increment;
+
+                 for (int j = 0; j < 2; j++) {
+                   add_grid_facet_vertices
+                     (encoded_grid, iv0, edge_dir, 
+                      slab[k].ivolpoly, slab[k].poly_vertex);
+                 }
+
+                 IVOLDUAL_POLY_INFO info;
+                 info.SetDualToEdge(iend0, edge_dir, flag_reverse_orient);
+                 slab[k].ivolpoly_info.push_back(info);
+               }
+             }
+           }
+         }
+       });
+
+    append_slab_ivolpoly(slab, ivolpoly, poly_vertex, ivolpoly_info);
+  }
+
+}
+
+
+// Extract interval volume polytopes dual to grid vertices.
+// - Multithreaded version which skips blocks outside the interval volume.
+// - Visits grid vertices in the same order as 
+//   IJK_FOR_EACH_INTERIOR_GRID_VERTEX, but splits the list of 
+//   vertex rows into contiguous slabs.
+// - Grid vertices in blocks which are not active are skipped.
+void IVOLDUAL::extract_ivolpoly_dual_to_grid_vertices
+(const IVOLDUAL_ENCODED_GRID & encoded_grid,
+ const IVOLDUAL_ENCODED_BLOCKS & encoded_blocks,
+ const int num_threads,
+ std::vector<ISO_VERTEX_INDEX> & ivolpoly,
+ std::vector<POLY_VERTEX_INDEX> & poly_vertex,
+ IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info)
+{
+  const int dimension = encoded_grid.Dimension();
+  const int num_facet_vertices = encoded_grid.NumFacetVertices();
+  const int num_cube_vertices = encoded_grid.NumCubeVertices();
+  const VERTEX_INDEX block_edge_length = encoded_blocks.BlockEdgeLength();
+
+  if (num_facet_vertices == 0) { return; }
+  if (dimension < 1) { return; }
+  if (encoded_grid.AxisSize(0) < 2) { return; }
+
+  const VERTEX_INDEX axis_size0 = encoded_grid.AxisSize(0);
+  const VERTEX_INDEX increment = 
+    encoded_grid.CubeVertexIncrement(num_cube_vertices-1);
+  const VERTEX_INDEX num_blocks_x = encoded_blocks.AxisSize(0);
+  IJK::FACET_INTERIOR_VERTEX_LIST<VERTEX_INDEX> 
+    vlist(encoded_grid, 0, false, true);
+  std::vector<SLAB_IVOLPOLY> slab
+    (compute_num_thread_ranges(num_threads, vlist.NumVertices()));
+
+  run_on_thread_ranges
+    (num_threads, vlist.NumVertices(),
+     [&](const int k, const VERTEX_INDEX ibegin, const VERTEX_INDEX iend)
+     {
+       std::vector<GRID_COORD_TYPE> coord(dimension);
+
+       for (VERTEX_INDEX i = ibegin; i < iend; i++) {
+         const VERTEX_INDEX iv_row = vlist.VertexIndex(i);
+         const VERTEX_INDEX ib_row = compute_row_block_index
+           (encoded_grid, encoded_blocks, iv_row, 0, coord);
+
+         for (VERTEX_INDEX jb = 0; jb < num_blocks_x; jb++) {
+
+           if (!encoded_blocks.IsActive(ib_row+jb)) { continue; }
+
+           // Interior vertices with x-coordinate in [x0,x1) 
+           //   are in block jb.
+           const VERTEX_INDEX x0 = std::max(jb*block_edge_length, VERTEX_INDEX(1));
+           const VERTEX_INDEX x1 = (jb+1 < num_blocks_x) ?
+             (jb+1)*block_edge_length : axis_size0-1;
+
+           for (VERTEX_INDEX iv0 = iv_row+x0; iv0 < iv_row+x1; iv0++) {
+
+             if (does_grid_vertex_have_dual_ivolpoly(encoded_grid, iv0)) {
+               const VERTEX_INDEX iv1 = iv0 - increment;
+
+               for (int j = 0; j < num_cube_vertices; j++) {
+                 slab[k].ivolpoly.push_back(encoded_grid.CubeVertex(iv1, j));
+                 slab[k].poly_vertex.push_back(j);
+               }
+
+               IVOLDUAL_POLY_INFO info;
+               info.SetDualToVertex(iv0);
+               slab[k].ivolpoly_info.push_back(info);
+             }
+           }
+         }
+       }
+     });
+
+  append_slab_ivolpoly(slab, ivolpoly, poly_vertex, ivolpoly_info);
+}
+
+// Extract dual interval volume polytopes.
+// - Version which extracts only polytopes dual to edges and vertices
+//   of cubes in active_cube_list.
+void IVOLDUAL::extract_dual_ivolpoly
+(const IVOLDUAL_ENCODED_GRID & encoded_grid,
+ const ACTIVE_CUBE_ARRAY & active_cube_list,
+ const int num_threads,
+ std::vector<ISO_VERTEX_INDEX> & ivolpoly,
+ std::vector<POLY_VERTEX_INDEX> & poly_vertex,
+ IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
+ IVOLDUAL_INFO & dualiso_info)
+{
+  dualiso_info.time.extract = 0;
+
+  clock_t t0 = clock();
+
+  // Initialize output
+  ivolpoly.clear();
+
+  if (encoded_grid.NumCubeVertices() < 1) { return; }
+
+  extract_ivolpoly_dual_to_grid_edges
+    (encoded_grid, active_cube_list, num_threads, 
+     ivolpoly, poly_vertex, ivolpoly_info, dualiso_info);
+  extract_ivolpoly_dual_to_grid_vertices
+    (encoded_grid, active_cube_list, num_threads, 
+     ivolpoly, poly_vertex, ivolpoly_info, dualiso_info);
+
+  clock_t t1 = clock();
+  IJK::clock2seconds(t1-t0, dualiso_info.time.extract);
+}
 
+
+// Extract dual interval volume polytopes.
+// - Version which extracts polytopes dual to the grid edges
+//   and grid vertices in dual_edge_list and dual_vertex_list.
 void IVOLDUAL::extract_dual_ivolpoly
 (const IVOLDUAL_ENCODED_GRID & encoded_grid,
+ const std::vector<DUAL_GRID_EDGE_ARRAY> & dual_edge_list,
+ const std::vector<VERTEX_INDEX> & dual_vertex_list,
  std::vector<ISO_VERTEX_INDEX> & ivolpoly,
  std::vector<POLY_VERTEX_INDEX> & poly_vertex,
  IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
  IVOLDUAL_INFO & dualiso_info)
 {
-  dualiso_info.time.extract = 0;
+  dualiso_info.time.extract = 0;
+
+  clock_t t0 = clock();
+
+  // Initialize output
+  ivolpoly.clear();
+
+  if (encoded_grid.NumCubeVertices() < 1) { return; }
+
+  extract_ivolpoly_dual_to_grid_edges
+    (encoded_grid, dual_edge_list, 
+     ivolpoly, poly_vertex, ivolpoly_info, dualiso_info);
+  extract_ivolpoly_dual_to_grid_vertices
+    (encoded_grid, dual_vertex_list, 
+     ivolpoly, poly_vertex, ivolpoly_info, dualiso_info);
+
+  clock_t t1 = clock();
+  IJK::clock2seconds(t1-t0, dualiso_info.time.extract);
+}
+
+
+namespace {
+
+  /// Return true if the last vertex of the cube is interior
+  ///   in every direction except skip_dir.
+  /// @param coord[] Coordinates of vertex 0 of the cube.
+  /// @param skip_dir Direction which is not checked.
+  ///   Set skip_dir to grid.Dimension() to check all directions.
+  bool is_cube_max_vertex_interior
+  (const DUALISO_GRID & grid, const GRID_COORD_TYPE coord[],
+   const int skip_dir)
+  {
+    for (int d = 0; d < grid.Dimension(); d++) {
+      if (d == skip_dir) { continue; }
+      if (coord[d]+2 >= grid.AxisSize(d)) { return(false); }
+    }
+    return(true);
+  }
+
+  /// Return true if the grid edge is interior.
+  /// - An edge is interior if it is not contained in the grid boundary.
+  /// @param coord[] Coordinates of the lower endpoint of the edge.
+  bool is_grid_edge_interior
+  (const DUALISO_GRID & grid, const GRID_COORD_TYPE coord[],
+   const int edge_dir)
+  {
+    if (coord[edge_dir]+1 >= grid.AxisSize(edge_dir)) { return(false); }
+
+    for (int d = 0; d < grid.Dimension(); d++) {
+      if (d == edge_dir) { continue; }
+      if (coord[d] < 1 || coord[d]+1 >= grid.AxisSize(d)) { return(false); }
+    }
+    return(true);
+  }
+
+  /// Return true if the grid vertex is interior.
+  bool is_grid_vertex_interior
+  (const DUALISO_GRID & grid, const GRID_COORD_TYPE coord[])
+  {
+    for (int d = 0; d < grid.Dimension(); d++) {
+      if (coord[d] < 1 || coord[d]+1 >= grid.AxisSize(d)) { return(false); }
+    }
+    return(true);
+  }
+
+  bool is_same_grid_edge
+  (const DUAL_GRID_EDGE & edgeA, const DUAL_GRID_EDGE & edgeB)
+  {
+    return(edgeA.iend0 == edgeB.iend0);
+  }
+
+}
+
+
+// Find grid edges which are dual to interval volume polytopes.
+// - Each grid edge with a dual polytope is interior, so the cubes
+//   containing the edge are all active.  The edge is found from
+//   the cube containing it which has the lowest index, i.e., 
+//   the cube whose vertex 0 is iend0 - FacetVertexIncrement(edge_dir,last).
+// - Edges are sorted into the order visited by
+//   IJK_FOR_EACH_INTERIOR_GRID_EDGE.
+void IVOLDUAL::find_dual_grid_edges
+(const IVOLDUAL_ENCODED_GRID & encoded_grid,
+ const ACTIVE_CUBE_ARRAY & active_cube_list,
+ const int num_threads,
+ std::vector<DUAL_GRID_EDGE_ARRAY> & dual_edge_list)
+{
+  IVOLDUAL_THREAD_LISTS thread_lists;
+
+  find_dual_grid_edges
+    (encoded_grid, active_cube_list, num_threads, thread_lists, 
+     dual_edge_list);
+}
+
+
+// Find grid edges which are dual to interval volume polytopes.
+// - Version which stores per thread lists in thread_lists.
+void IVOLDUAL::find_dual_grid_edges
+(const IVOLDUAL_ENCODED_GRID & encoded_grid,
+ const ACTIVE_CUBE_ARRAY & active_cube_list,
+ const int num_threads,
+ IVOLDUAL_THREAD_LISTS & thread_lists,
+ std::vector<DUAL_GRID_EDGE_ARRAY> & dual_edge_list)
+{
+  const int DIM3(3);
+  const int dimension = encoded_grid.Dimension();
+  const int num_facet_vertices = encoded_grid.NumFacetVertices();
+  const VERTEX_INDEX num_active = active_cube_list.size();
+
+  dual_edge_list.resize(dimension);
+  for (int edge_dir = 0; edge_dir < dimension; edge_dir++) 
+    { dual_edge_list[edge_dir].clear(); }
+
+  if (num_facet_vertices == 0) { return; }
+
+  std::vector<DUAL_GRID_EDGE_ARRAY> & range_edge_list = 
+    thread_lists.edge_list;
+
+  for (int edge_dir = 0; edge_dir < dimension; edge_dir++) {
+
+    const VERTEX_INDEX axis_inc = encoded_grid.AxisIncrement(edge_dir);
+    const VERTEX_INDEX increment = 
+      encoded_grid.FacetVertexIncrement(edge_dir,num_facet_vertices-1);
+
+    clear_thread_lists
+      (compute_num_thread_ranges(num_threads, num_active), range_edge_list);
+
+    run_on_thread_ranges
+      (num_threads, num_active,
+       [&](const int k, const VERTEX_INDEX ibegin, const VERTEX_INDEX iend)
+       {
+         IJK::LOCAL_ARRAY<GRID_COORD_TYPE,DIM3> coord(dimension);
+         DUAL_GRID_EDGE edge;
+
+         for (VERTEX_INDEX i = ibegin; i < iend; i++) {
+           const VERTEX_INDEX icube = active_cube_list[i].cube_index;
+
+           encoded_grid.ComputeCoord(icube, coord.Ptr());
+           if (!is_cube_max_vertex_interior
+               (encoded_grid, coord.PtrConst(), edge_dir)) { continue; }
+
+           edge.iend0 = icube + increment;
+           if (does_grid_edge_have_dual_ivolpoly
+               (encoded_grid, edge.iend0, edge_dir, 
+                edge.flag_reverse_orient)) {
+             edge.row = edge.iend0 - coord[edge_dir]*axis_inc;
+             range_edge_list[k].push_back(edge);
+           }
+         }
+       });
+
+    DUAL_GRID_EDGE_ARRAY & edge_list = dual_edge_list[edge_dir];
+    append_thread_lists(range_edge_list, edge_list);
+    std::sort(edge_list.begin(), edge_list.end());
+  }
+}
+
+
+// Find grid vertices which are dual to interval volume polytopes.
+// - Each grid vertex with a dual polytope is interior, so the cubes
+//   containing the vertex are all active.  The vertex is found from
+//   the cube containing it which has the lowest index.
+// - Cubes in active_cube_list are sorted by cube index, 
+//   so vertices are found in increasing order.
+void IVOLDUAL::find_dual_grid_vertices
+(const IVOLDUAL_ENCODED_GRID & encoded_grid,
+ const ACTIVE_CUBE_ARRAY & active_cube_list,
+ const int num_threads,
+ std::vector<VERTEX_INDEX> & dual_vertex_list)
+{
+  IVOLDUAL_THREAD_LISTS thread_lists;
+
+  find_dual_grid_vertices
+    (encoded_grid, active_cube_list, num_threads, thread_lists, 
+     dual_vertex_list);
+}
+
+
+// Find grid vertices which are dual to interval volume polytopes.
+// - Version which stores per thread lists in thread_lists.
+void IVOLDUAL::find_dual_grid_vertices
+(const IVOLDUAL_ENCODED_GRID & encoded_grid,
+ const ACTIVE_CUBE_ARRAY & active_cube_list,
+ const int num_threads,
+ IVOLDUAL_THREAD_LISTS & thread_lists,
+ std::vector<VERTEX_INDEX> & dual_vertex_list)
+{
+  const int DIM3(3);
+  const int dimension = encoded_grid.Dimension();
+  const int num_cube_vertices = encoded_grid.NumCubeVertices();
+  const VERTEX_INDEX num_active = active_cube_list.size();
+
+  dual_vertex_list.clear();
+
+  if (encoded_grid.NumFacetVertices() == 0) { return; }
+
+  const VERTEX_INDEX increment = 
+    encoded_grid.CubeVertexIncrement(num_cube_vertices-1);
+  std::vector< std::vector<VERTEX_INDEX> > & range_vertex_list =
+    thread_lists.vertex_list;
+
+  clear_thread_lists
+    (compute_num_thread_ranges(num_threads, num_active), range_vertex_list);
+
+  run_on_thread_ranges
+    (num_threads, num_active,
+     [&](const int k, const VERTEX_INDEX ibegin, const VERTEX_INDEX iend)
+     {
+       IJK::LOCAL_ARRAY<GRID_COORD_TYPE,DIM3> coord(dimension);
+
+       for (VERTEX_INDEX i = ibegin; i < iend; i++) {
+         const VERTEX_INDEX iv1 = active_cube_list[i].cube_index;
+
+         encoded_grid.ComputeCoord(iv1, coord.Ptr());
+         if (!is_cube_max_vertex_interior
+             (encoded_grid, coord.PtrConst(), dimension)) { continue; }
+
+         const VERTEX_INDEX iv0 = iv1 + increment;
+         if (does_grid_vertex_have_dual_ivolpoly(encoded_grid, iv0)) 
+           { range_vertex_list[k].push_back(iv0); }
+       }
+     });
+
+  append_thread_lists(range_vertex_list, dual_vertex_list);
+}
+
+
+// Update grid edges and grid vertices which are dual to 
+//   interval volume polytopes.
+// - Only grid edges and vertices containing vertices in changed_vertex
+//   are checked.  Other entries are copied unchanged.
+// - Lists stay sorted as in find_dual_grid_edges() 
+//   and find_dual_grid_vertices().
+void IVOLDUAL::update_dual_grid_elements
+(const IVOLDUAL_ENCODED_GRID & encoded_grid,
+ const std::vector<VERTEX_INDEX> & changed_vertex,
+ std::vector<DUAL_GRID_EDGE_ARRAY> & dual_edge_list,
+ std::vector<VERTEX_INDEX> & dual_vertex_list)
+{
+  const int dimension = encoded_grid.Dimension();
+  std::vector<GRID_COORD_TYPE> coord(dimension);
+  DUAL_GRID_EDGE_ARRAY edge_list, new_edge_list;
+  std::vector<VERTEX_INDEX> vertex_list, new_vertex_list;
+  IJK::PROCEDURE_ERROR error("update_dual_grid_elements");
 
-  clock_t t0 = clock();
+  if (int(dual_edge_list.size()) != dimension) {
+    error.AddMessage
+      ("Programming error.  Dual edge lists have not been set.");
+    error.AddMessage
+      ("  Call find_dual_grid_edges() before update_dual_grid_elements().");
+    throw error;
+  }
 
-  // Initialize output
-  ivolpoly.clear();
+  if (encoded_grid.NumFacetVertices() == 0) { return; }
 
-  if (encoded_grid.NumCubeVertices() < 1) { return; }
+  for (int edge_dir = 0; edge_dir < dimension; edge_dir++) {
 
-  extract_ivolpoly_dual_to_grid_edges
-    (encoded_grid, ivolpoly, poly_vertex, ivolpoly_info, dualiso_info);
-  extract_ivolpoly_dual_to_grid_vertices
-    (encoded_grid, ivolpoly, poly_vertex, ivolpoly_info, dualiso_info);
+    const VERTEX_INDEX axis_inc = encoded_grid.AxisIncrement(edge_dir);
+    DUAL_GRID_EDGE_ARRAY & old_edge_list = dual_edge_list[edge_dir];
+    DUAL_GRID_EDGE edge;
 
-  clock_t t1 = clock();
-  IJK::clock2seconds(t1-t0, dualiso_info.time.extract);
-}
+    // Interior edges in direction edge_dir containing changed vertices.
+    edge_list.clear();
+    for (std::size_t j = 0; j < changed_vertex.size(); j++) {
+      const VERTEX_INDEX iv = changed_vertex[j];
 
-namespace {
+      encoded_grid.ComputeCoord(iv, coord.data());
+      if (is_grid_edge_interior(encoded_grid, coord.data(), edge_dir)) {
+        edge.iend0 = iv;
+        edge.row = iv - coord[edge_dir]*axis_inc;
+        edge_list.push_back(edge);
+      }
 
-  void add_grid_facet_vertices
-  (const DUALISO_GRID & grid, const VERTEX_INDEX iv0, const int edge_dir,
-   std::vector<ISO_VERTEX_INDEX> & ivolpoly,
-   std::vector<POLY_VERTEX_INDEX> & poly_vertex)
-  {
-    const int num_facet_vertices = grid.NumFacetVertices();
+      if (coord[edge_dir] > 0) {
+        coord[edge_dir]--;
+        if (is_grid_edge_interior(encoded_grid, coord.data(), edge_dir)) {
+          edge.iend0 = iv - axis_inc;
+          edge.row = edge.iend0 - coord[edge_dir]*axis_inc;
+          edge_list.push_back(edge);
+        }
+      }
+    }
 
-    for (int k = 0; k < num_facet_vertices; k++) {
+    std::sort(edge_list.begin(), edge_list.end());
+    edge_list.erase
+      (std::unique(edge_list.begin(), edge_list.end(), is_same_grid_edge),
+       edge_list.end());
+
+    // Merge unchanged edges with rechecked edges, keeping the list sorted.
+    new_edge_list.clear();
+    new_edge_list.reserve(old_edge_list.size()+edge_list.size());
+    std::size_t i = 0;
+    for (std::size_t j = 0; j < edge_list.size(); j++) {
+      edge = edge_list[j];
+
+      while (i < old_edge_list.size() && old_edge_list[i] < edge) {
+        new_edge_list.push_back(old_edge_list[i]);
+        i++;
+      }
+      if (i < old_edge_list.size() && 
+          old_edge_list[i].iend0 == edge.iend0)
+        { i++; }
 
-      // jcube is the index of the cube containing the k'th vertex
-      //   of the facet.
-      const VERTEX_INDEX jcube = grid.FacetVertex(iv0, edge_dir, k);
-      ivolpoly.push_back(jcube);
-      poly_vertex.push_back(edge_dir*num_facet_vertices+k);
+      if (does_grid_edge_have_dual_ivolpoly
+          (encoded_grid, edge.iend0, edge_dir, edge.flag_reverse_orient)) 
+        { new_edge_list.push_back(edge); }
     }
+    new_edge_list.insert
+      (new_edge_list.end(), old_edge_list.begin()+i, old_edge_list.end());
+
+    old_edge_list.swap(new_edge_list);
   }
 
-  // \param[out] flag_reverse_orient True if orientation of dual polytope
-  //   should be reversed.
-  bool does_grid_edge_have_dual_ivolpoly
-  (const IVOLDUAL_ENCODED_GRID & encoded_grid,
-   const VERTEX_INDEX iend0, const int edge_dir,
-   bool & flag_reverse_orient)
-  {
-    VERTEX_INDEX iend1 = encoded_grid.NextVertex(iend0, edge_dir);
-    GRID_VERTEX_ENCODING s0 = encoded_grid.Scalar(iend0);
-    GRID_VERTEX_ENCODING s1 = encoded_grid.Scalar(iend1);
+  // Interior changed vertices.
+  for (std::size_t j = 0; j < changed_vertex.size(); j++) {
+    const VERTEX_INDEX iv = changed_vertex[j];
 
-    flag_reverse_orient = false;
+    encoded_grid.ComputeCoord(iv, coord.data());
+    if (is_grid_vertex_interior(encoded_grid, coord.data())) 
+      { vertex_list.push_back(iv); }
+  }
 
-    if (s0 > s1) { 
-      std::swap(s0,s1); 
-      flag_reverse_orient = true;
-    }
+  std::sort(vertex_list.begin(), vertex_list.end());
+  vertex_list.erase
+    (std::unique(vertex_list.begin(), vertex_list.end()), vertex_list.end());
 
-    if (s0 == 0) {
-      if (s1 >= 2) { return(true); }
-    }
-    else if (s0 == 1) {
-      if (s1 > 1)
-        { return(true); }
+  // Merge unchanged vertices with rechecked vertices.
+  new_vertex_list.reserve(dual_vertex_list.size()+vertex_list.size());
+  std::size_t i = 0;
+  for (std::size_t j = 0; j < vertex_list.size(); j++) {
+    const VERTEX_INDEX iv = vertex_list[j];
+
+    while (i < dual_vertex_list.size() && dual_vertex_list[i] < iv) {
+      new_vertex_list.push_back(dual_vertex_list[i]);
+      i++;
     }
+    if (i < dual_vertex_list.size() && dual_vertex_list[i] == iv) 
+      { i++; }
 
-    return(false);
+    if (does_grid_vertex_have_dual_ivolpoly(encoded_grid, iv)) 
+      { new_vertex_list.push_back(iv); }
   }
+  new_vertex_list.insert
+    (new_vertex_list.end(), dual_vertex_list.begin()+i, 
+     dual_vertex_list.end());
 
-  bool does_grid_vertex_have_dual_ivolpoly
-  (const IVOLDUAL_ENCODED_GRID & encoded_grid, const VERTEX_INDEX iv0)
-  {
-    GRID_VERTEX_ENCODING s0 = encoded_grid.Scalar(iv0);
+  dual_vertex_list.swap(new_vertex_list);
+}
+
+
+// Extract interval volume polytopes dual to grid edges.
+// - Version which extracts only polytopes dual to edges of cubes
+//   in active_cube_list.
+void IVOLDUAL::extract_ivolpoly_dual_to_grid_edges
+(const IVOLDUAL_ENCODED_GRID & encoded_grid,
+ const ACTIVE_CUBE_ARRAY & active_cube_list,
+ const int num_threads,
+ std::vector<ISO_VERTEX_INDEX> & ivolpoly,
+ std::vector<POLY_VERTEX_INDEX> & poly_vertex,
+ IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
+ IVOLDUAL_INFO & dualiso_info)
+{
+  std::vector<DUAL_GRID_EDGE_ARRAY> dual_edge_list;
+
+  find_dual_grid_edges
+    (encoded_grid, active_cube_list, num_threads, dual_edge_list);
+  extract_ivolpoly_dual_to_grid_edges
+    (encoded_grid, dual_edge_list, 
+     ivolpoly, poly_vertex, ivolpoly_info, dualiso_info);
+}
 
-    if (s0 == 1 || s0 == 2) { return(true); }
-    return(false);
-  }
 
+// Extract interval volume polytopes dual to grid vertices.
+// - Version which extracts only polytopes dual to vertices of cubes
+//   in active_cube_list.
+void IVOLDUAL::extract_ivolpoly_dual_to_grid_vertices
+(const IVOLDUAL_ENCODED_GRID & encoded_grid,
+ const ACTIVE_CUBE_ARRAY & active_cube_list,
+ const int num_threads,
+ std::vector<ISO_VERTEX_INDEX> & ivolpoly,
+ std::vector<POLY_VERTEX_INDEX> & poly_vertex,
+ IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
+ IVOLDUAL_INFO & dualiso_info)
+{
+  std::vector<VERTEX_INDEX> dual_vertex_list;
+
+  find_dual_grid_vertices
+    (encoded_grid, active_cube_list, num_threads, dual_vertex_list);
+  extract_ivolpoly_dual_to_grid_vertices
+    (encoded_grid, dual_vertex_list, 
+     ivolpoly, poly_vertex, ivolpoly_info, dualiso_info);
 }
 
+
+// Extract interval volume polytopes dual to grid edges.
+// - Version which extracts polytopes dual to the edges in dual_edge_list.
 void IVOLDUAL::extract_ivolpoly_dual_to_grid_edges
 (const IVOLDUAL_ENCODED_GRID & encoded_grid,
+ const std::vector<DUAL_GRID_EDGE_ARRAY> & dual_edge_list,
  std::vector<ISO_VERTEX_INDEX> & ivolpoly,
  std::vector<POLY_VERTEX_INDEX> & poly_vertex,
  IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
  IVOLDUAL_INFO & dualiso_info)
 {
   const int num_facet_vertices = encoded_grid.NumFacetVertices();
-  bool flag_reverse_orient;
 
   if (num_facet_vertices == 0) { return; }
 
-  IJK_FOR_EACH_INTERIOR_GRID_EDGE(iend0, edge_dir, encoded_grid, VERTEX_INDEX) {
+  for (int edge_dir = 0; edge_dir < int(dual_edge_list.size()); 
+       edge_dir++) {
 
-    if (does_grid_edge_have_dual_ivolpoly
-        (encoded_grid, iend0, edge_dir, flag_reverse_orient)) {
+    const DUAL_GRID_EDGE_ARRAY & edge_list = dual_edge_list[edge_dir];
+    const VERTEX_INDEX increment = 
+      encoded_grid.FacetVertexIncrement(edge_dir,num_facet_vertices-1);
 
-      const VERTEX_INDEX increment = 
-        encoded_grid.FacetVertexIncrement(edge_dir,num_facet_vertices-1);
+    for (std::size_t j = 0; j < edge_list.size(); j++) {
+      const VERTEX_INDEX iend0 = edge_list[j].iend0;
       const VERTEX_INDEX iv0 = iend0 - increment;
 
-      for (int j = 0; j < 2; j++) {
+      for (int i = 0; i < 2; i++) {
         add_grid_facet_vertices
           (encoded_grid, iv0, edge_dir, ivolpoly, poly_vertex);
       }
 
       IVOLDUAL_POLY_INFO info;
-      info.SetDualToEdge(iend0, edge_dir, flag_reverse_orient);
+      info.SetDualToEdge(iend0, edge_dir, edge_list[j].flag_reverse_orient);
       ivolpoly_info.push_back(info);
     }
   }
-
 }
 
 
+// Extract interval volume polytopes dual to grid vertices.
+// - Version which extracts polytopes dual to the vertices 
+//   in dual_vertex_list.
 void IVOLDUAL::extract_ivolpoly_dual_to_grid_vertices
 (const IVOLDUAL_ENCODED_GRID & encoded_grid,
+ const std::vector<VERTEX_INDEX> & dual_vertex_list,
  std::vector<ISO_VERTEX_INDEX> & ivolpoly,
  std::vector<POLY_VERTEX_INDEX> & poly_vertex,
  IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
  IVOLDUAL_INFO & dualiso_info)
 {
-  const int num_facet_vertices = encoded_grid.NumFacetVertices();
   const int num_cube_vertices = encoded_grid.NumCubeVertices();
 
-  if (num_facet_vertices == 0) { return; }
-
-  IJK_FOR_EACH_INTERIOR_GRID_VERTEX(iv0, encoded_grid, VERTEX_INDEX) {
-
-    if (does_grid_vertex_have_dual_ivolpoly(encoded_grid, iv0)) {
-      const VERTEX_INDEX increment = 
-        encoded_grid.CubeVertexIncrement(num_cube_vertices-1);
-      const VERTEX_INDEX iv1 = iv0 - increment;
+  if (encoded_grid.NumFacetVertices() == 0) { return; }
 
+  const VERTEX_INDEX increment = 
+    encoded_grid.CubeVertexIncrement(num_cube_vertices-1);
 
-      for (int k = 0; k < num_cube_vertices; k++) {
-        ivolpoly.push_back(encoded_grid.CubeVertex(iv1, k));
-        poly_vertex.push_back(k);
-      }
+  for (std::size_t i = 0; i < dual_vertex_list.size(); i++) {
+    const VERTEX_INDEX iv0 = dual_vertex_list[i];
+    const VERTEX_INDEX iv1 = iv0 - increment;
 
-      IVOLDUAL_POLY_INFO info;
-      info.SetDualToVertex(iv0);
-      ivolpoly_info.push_back(info);
+    for (int j = 0; j < num_cube_vertices; j++) {
+      ivolpoly.push_back(encoded_grid.CubeVertex(iv1, j));
+      poly_vertex.push_back(j);
     }
+
+    IVOLDUAL_POLY_INFO info;
+    info.SetDualToVertex(iv0);
+    ivolpoly_info.push_back(info);
   }
 }
 
@@ -913,22 +3580,102 @@ void IVOLDUAL::extract_ivolpoly_dual_to_grid_vertices
 
 namespace {
 
+  // Construct list of interval volume vertices from cube_list.
+  // - Set cube_list[i].num_isov and cube_list[i].first_isov.
+  // - Cubes are split among num_threads contiguous ranges.
+  //   Each range counts its vertices, an exclusive prefix sum
+  //   of the range counts gives the first vertex of each range,
+  //   and each range then numbers its own vertices.
+  // - Vertex numbering is identical to the numbering 
+  //   from IJK::construct_dual_isovert_list().
+  // - Also return number of cubes with more than one vertex.
+  void construct_dual_ivolvert_list
+  (const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+   const int num_threads,
+   std::vector<GRID_CUBE_DATA> & cube_list,
+   DUAL_IVOLVERT_ARRAY & ivolv_list,
+   int & num_split)
+  {
+    typedef std::vector<GRID_CUBE_DATA>::size_type SIZE_TYPE;
+
+    const SIZE_TYPE num_cubes = cube_list.size();
+    const int num_ranges = 
+      compute_num_thread_ranges(num_threads, num_cubes);
+    LOCAL_ARRAY<SIZE_TYPE,NUM_LOCAL_THREAD_RANGES> 
+      range_num_isov(num_ranges, 0);
+    LOCAL_ARRAY<SIZE_TYPE,NUM_LOCAL_THREAD_RANGES> 
+      range_first_isov(num_ranges, 0);
+    LOCAL_ARRAY<int,NUM_LOCAL_THREAD_RANGES> range_num_split(num_ranges, 0);
+
+    // Count number of vertices in each range.
+    run_on_thread_ranges
+      (num_threads, num_cubes,
+       [&](const int k, const SIZE_TYPE ibegin, const SIZE_TYPE iend)
+       {
+         SIZE_TYPE n = 0;
+         int nsplit = 0;
+         for (SIZE_TYPE i = ibegin; i < iend; i++) {
+           const TABLE_INDEX it = cube_list[i].table_index;
+           cube_list[i].num_isov = ivoldual_table.NumIsoVertices(it);
+           n += cube_list[i].num_isov;
+           if (cube_list[i].num_isov > 1) { nsplit++; }
+         }
+         range_num_isov[k] = n;
+         range_num_split[k] = nsplit;
+       });
+
+    // Exclusive prefix sum of range counts.
+    SIZE_TYPE total_num_isov = 0;
+    num_split = 0;
+    for (int k = 0; k < num_ranges; k++) {
+      range_first_isov[k] = total_num_isov;
+      total_num_isov += range_num_isov[k];
+      num_split += range_num_split[k];
+    }
+
+    ivolv_list.resize(total_num_isov);
+
+    // Set interval volume vertices.
+    run_on_thread_ranges
+      (num_threads, num_cubes,
+       [&](const int k, const SIZE_TYPE ibegin, const SIZE_TYPE iend)
+       {
+         SIZE_TYPE m = range_first_isov[k];
+         for (SIZE_TYPE i = ibegin; i < iend; i++) {
+           const TABLE_INDEX it = cube_list[i].table_index;
+           const SIZE_TYPE num_isov = cube_list[i].num_isov;
+
+           cube_list[i].first_isov = m;
+           for (SIZE_TYPE j = 0; j < num_isov; j++) {
+             ivolv_list[m+j].cube_index = cube_list[i].cube_index;
+             ivolv_list[m+j].patch_index = j;
+             ivolv_list[m+j].table_index = it;
+             ivolv_list[m+j].cube_list_index = i;
+           }
+           m += num_isov;
+         }
+       });
+  }
+
+
+  // Set interval volume polytope vertices ivolpoly_vert[i]
+  //   for i in [ibegin,iend).
+  // @pre ivolpoly_vert.size() equals ivolpoly_cube.size().
   void set_dual_ivolv_vertices
   (const IVOLDUAL_CUBE_TABLE & ivoldual_table,
    const std::vector<GRID_CUBE_DATA> & cube_list,
    const std::vector<VERTEX_INDEX> & ivolpoly_cube, 
    const std::vector<POLY_VERTEX_INDEX> & poly_vertex,
    const IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
+   const ISO_VERTEX_INDEX ibegin,
+   const ISO_VERTEX_INDEX iend,
    std::vector<ISO_VERTEX_INDEX> & ivolpoly_vert)
   {
-    const int dimension = ivoldual_table.Dimension();
-    IJK::CUBE_FACE_INFO<int,int,int> cube(dimension);
+    const IVOLDUAL::CUBE_FACE_INFO & cube = ivoldual_table.Cube();
     const int num_cube_vertices = cube.NumVertices();
     const int num_facet_vertices = cube.NumFacetVertices();
 
-    ivolpoly_vert.resize(ivolpoly_cube.size());
-
-    for (ISO_VERTEX_INDEX i = 0; i < ivolpoly_cube.size(); i++) {
+    for (ISO_VERTEX_INDEX i = ibegin; i < iend; i++) {
       const VERTEX_INDEX k = ivolpoly_cube[i];
       const TABLE_INDEX it = cube_list[k].table_index;
       const int ipoly = i/num_cube_vertices;
@@ -965,6 +3712,33 @@ namespace {
   }
 
 
+  // Set interval volume polytope vertices.
+  // - Version which splits the polytope vertices among num_threads threads.
+  void set_dual_ivolv_vertices
+  (const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+   const int num_threads,
+   const std::vector<GRID_CUBE_DATA> & cube_list,
+   const std::vector<VERTEX_INDEX> & ivolpoly_cube, 
+   const std::vector<POLY_VERTEX_INDEX> & poly_vertex,
+   const IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
+   std::vector<ISO_VERTEX_INDEX> & ivolpoly_vert)
+  {
+    const ISO_VERTEX_INDEX n = ivolpoly_cube.size();
+
+    ivolpoly_vert.resize(n);
+
+    run_on_thread_ranges
+      (num_threads, n,
+       [&](const int, const ISO_VERTEX_INDEX ibegin, 
+           const ISO_VERTEX_INDEX iend)
+       {
+         set_dual_ivolv_vertices
+           (ivoldual_table, cube_list, ivolpoly_cube, poly_vertex,
+            ivolpoly_info, ibegin, iend, ivolpoly_vert);
+       });
+  }
+
+
   // Return true if ivol vertices in cube are candidates for splitting
   //   to avoid pair ambiguity.
   bool is_cube_ambig_split_candidate
@@ -1222,13 +3996,33 @@ void IVOLDUAL::split_dual_ivolvert
  std::vector<ISO_VERTEX_INDEX> & ivolpoly_vert,
  int & num_split)
 {
-  IJK::construct_dual_isovert_list(ivoldual_table, cube_list, ivolv_list);
+  const int num_threads(1);
 
-  set_dual_ivolv_vertices
-    (ivoldual_table, cube_list, ivolpoly_cube, poly_vertex, ivolpoly_info, 
-     ivolpoly_vert);
+  split_dual_ivolvert
+    (ivoldual_table, num_threads, ivolpoly_cube, poly_vertex, ivolpoly_info,
+     cube_list, ivolv_list, ivolpoly_vert, num_split);
+}
+
+
+// Split interval volume vertices in each cube.
+// - Version which splits the cubes and polytopes among num_threads threads.
+void IVOLDUAL::split_dual_ivolvert
+(const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+ const int num_threads,
+ const std::vector<VERTEX_INDEX> & ivolpoly_cube, 
+ const std::vector<POLY_VERTEX_INDEX> & poly_vertex,
+ const IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
+ std::vector<GRID_CUBE_DATA> & cube_list,
+ DUAL_IVOLVERT_ARRAY & ivolv_list,
+ std::vector<ISO_VERTEX_INDEX> & ivolpoly_vert,
+ int & num_split)
+{
+  construct_dual_ivolvert_list
+    (ivoldual_table, num_threads, cube_list, ivolv_list, num_split);
 
-  compute_num_splitB(ivoldual_table, cube_list, num_split);
+  set_dual_ivolv_vertices
+    (ivoldual_table, num_threads, cube_list, ivolpoly_cube, poly_vertex, 
+     ivolpoly_info, ivolpoly_vert);
 }
 
 
@@ -1238,6 +4032,22 @@ void IVOLDUAL::split_non_manifold_ivolv_pairs_ambig
  const VERTEX_INDEX index_to_cube_list[],
  std::vector<GRID_CUBE_DATA> & cube_list,
  int & num_split)
+{
+  const INDEX_TO_CUBE_LIST index(index_to_cube_list, grid.NumVertices());
+
+  split_non_manifold_ivolv_pairs_ambig
+    (grid, ivoldual_table, index, cube_list, num_split);
+}
+
+
+// Split interval volume vertex pairs which create non-manifold edges.
+// - Version which locates cubes with index_to_cube_list.
+void IVOLDUAL::split_non_manifold_ivolv_pairs_ambig
+(const DUALISO_GRID & grid,
+ const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+ const INDEX_TO_CUBE_LIST & index_to_cube_list,
+ std::vector<GRID_CUBE_DATA> & cube_list,
+ int & num_split)
 {
   typedef typename DUALISO_GRID::NUMBER_TYPE NUM_TYPE;
 
@@ -1267,7 +4077,7 @@ void IVOLDUAL::split_non_manifold_ivolv_pairs_ambig
       else {
         const VERTEX_INDEX cube_index1 =
           grid.AdjacentVertex(cube_index0, orth_dir, side);
-        const VERTEX_INDEX i1 = index_to_cube_list[cube_index1];
+        const VERTEX_INDEX i1 = index_to_cube_list.Location(cube_index1);
         if (is_cube_ambig_split_candidate(ivoldual_table, cube_list[i1])) {
           const TABLE_INDEX it1 = cube_list[i1].table_index;
 
@@ -1308,6 +4118,22 @@ void IVOLDUAL::split_non_manifold_ivolv_pairs_ambigB
  const VERTEX_INDEX index_to_cube_list[],
  std::vector<GRID_CUBE_DATA> & cube_list,
  int & num_split)
+{
+  const INDEX_TO_CUBE_LIST index(index_to_cube_list, grid.NumVertices());
+
+  split_non_manifold_ivolv_pairs_ambigB
+    (grid, ivoldual_table, index, cube_list, num_split);
+}
+
+
+// Split interval volume vertex pairs which create non-manifold edges.
+// - Version which locates cubes with index_to_cube_list.
+void IVOLDUAL::split_non_manifold_ivolv_pairs_ambigB
+(const DUALISO_GRID & grid,
+ const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+ const INDEX_TO_CUBE_LIST & index_to_cube_list,
+ std::vector<GRID_CUBE_DATA> & cube_list,
+ int & num_split)
 {
   typedef typename DUALISO_GRID::NUMBER_TYPE NUM_TYPE;
 
@@ -1337,7 +4163,7 @@ void IVOLDUAL::split_non_manifold_ivolv_pairs_ambigB
       else {
         const VERTEX_INDEX cube_index1 =
           grid.AdjacentVertex(cube_index0, orth_dir, side);
-        const VERTEX_INDEX i1 = index_to_cube_list[cube_index1];
+        const VERTEX_INDEX i1 = index_to_cube_list.Location(cube_index1);
         if (is_cube_ambig_split_candidateB(ivoldual_table, cube_list[i1])) {
           const TABLE_INDEX it1 = cube_list[i1].table_index;
 
@@ -1378,6 +4204,22 @@ void IVOLDUAL::split_non_manifold_ivolv_pairs_ambigC
  const VERTEX_INDEX index_to_cube_list[],
  std::vector<GRID_CUBE_DATA> & cube_list,
  int & num_split)
+{
+  const INDEX_TO_CUBE_LIST index(index_to_cube_list, grid.NumVertices());
+
+  split_non_manifold_ivolv_pairs_ambigC
+    (grid, ivoldual_table, index, cube_list, num_split);
+}
+
+
+// Split interval volume vertex pairs which create non-manifold edges.
+// - Version which locates cubes with index_to_cube_list.
+void IVOLDUAL::split_non_manifold_ivolv_pairs_ambigC
+(const DUALISO_GRID & grid,
+ const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+ const INDEX_TO_CUBE_LIST & index_to_cube_list,
+ std::vector<GRID_CUBE_DATA> & cube_list,
+ int & num_split)
 {
   typedef typename DUALISO_GRID::NUMBER_TYPE NUM_TYPE;
 
@@ -1412,7 +4254,7 @@ void IVOLDUAL::split_non_manifold_ivolv_pairs_ambigC
       else {
         const VERTEX_INDEX cube_index1 =
           grid.AdjacentVertex(cube_index0, orth_dir, side);
-        const VERTEX_INDEX i1 = index_to_cube_list[cube_index1];
+        const VERTEX_INDEX i1 = index_to_cube_list.Location(cube_index1);
 
         if (is_cube_pair_ambig_split_candidate
             (ivoldual_table, cube_list[i0], cube_list[i1])) {
@@ -1455,6 +4297,22 @@ void IVOLDUAL::split_non_manifold_ivolv_pairs_ambigD
  const VERTEX_INDEX index_to_cube_list[],
  std::vector<GRID_CUBE_DATA> & cube_list,
  int & num_split)
+{
+  const INDEX_TO_CUBE_LIST index(index_to_cube_list, grid.NumVertices());
+
+  split_non_manifold_ivolv_pairs_ambigD
+    (grid, ivoldual_table, index, cube_list, num_split);
+}
+
+
+// Split interval volume vertex pairs which create non-manifold edges.
+// - Version which locates cubes with index_to_cube_list.
+void IVOLDUAL::split_non_manifold_ivolv_pairs_ambigD
+(const DUALISO_GRID & grid,
+ const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+ const INDEX_TO_CUBE_LIST & index_to_cube_list,
+ std::vector<GRID_CUBE_DATA> & cube_list,
+ int & num_split)
 {
   typedef typename DUALISO_GRID::NUMBER_TYPE NUM_TYPE;
 
@@ -1489,7 +4347,7 @@ void IVOLDUAL::split_non_manifold_ivolv_pairs_ambigD
       else {
         const VERTEX_INDEX cube_index1 =
           grid.AdjacentVertex(cube_index0, orth_dir, side);
-        const VERTEX_INDEX i1 = index_to_cube_list[cube_index1];
+        const VERTEX_INDEX i1 = index_to_cube_list.Location(cube_index1);
 
         if (is_cube_pair_ambig_split_candidateD
             (ivoldual_table, cube_list[i0], cube_list[i1])) {
@@ -1538,40 +4396,92 @@ void IVOLDUAL::position_all_dual_ivol_vertices
  const DUAL_IVOLVERT_ARRAY & ivolv_list,
  COORD_TYPE * vertex_coord)
 {
+  const int num_threads(1);
+  const IVOLDUAL_EDGE_ISECT_CACHE edge_cache;
+
+  position_all_dual_ivol_vertices
+    (scalar_grid, ivoldual_table, isodual_table, isovalue0, isovalue1,
+     edge_cache, num_threads, ivolv_list, vertex_coord);
+}
+
+
+// Position all the dual interval volume vertices.
+// - Version using intersections stored in edge_cache.
+// - Version which splits the vertices among num_threads threads.
+void IVOLDUAL::position_all_dual_ivol_vertices
+(const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+ const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+ const IJKDUAL::ISODUAL_CUBE_TABLE_AMBIG & isodual_table,
+ const SCALAR_TYPE isovalue0,
+ const SCALAR_TYPE isovalue1,
+ const IVOLDUAL_EDGE_ISECT_CACHE & edge_cache,
+ const int num_threads,
+ const DUAL_IVOLVERT_ARRAY & ivolv_list,
+ COORD_TYPE * vertex_coord)
+{
+  const int DIM3(3);
   const int dimension = scalar_grid.Dimension();
+  const ISO_VERTEX_INDEX num_ivolv = ivolv_list.size();
+  const CUBE_FACE_INFO & cube = ivoldual_table.Cube();
 
   if (dimension < 1) { return; }
 
-  IJK::ARRAY<COORD_TYPE> coord0(dimension);
-  IJK::ARRAY<COORD_TYPE> coord1(dimension);
-  IJK::ARRAY<COORD_TYPE> coord2(dimension);
-  CUBE_FACE_INFO cube(dimension);
+  run_on_thread_ranges
+    (num_threads, num_ivolv,
+     [&](const int, const ISO_VERTEX_INDEX ibegin, 
+         const ISO_VERTEX_INDEX iend)
+     {
+       IJK::LOCAL_ARRAY<COORD_TYPE,DIM3> coord0(dimension);
+       IJK::LOCAL_ARRAY<COORD_TYPE,DIM3> coord1(dimension);
+       IJK::LOCAL_ARRAY<COORD_TYPE,DIM3> coord2(dimension);
+
+       for (ISO_VERTEX_INDEX ivolv = ibegin; ivolv < iend; ivolv++) {
+         position_dual_ivolv_centroid_multi
+           (scalar_grid, ivoldual_table, isovalue0, isovalue1, 
+            ivolv_list[ivolv], cube, edge_cache,
+            vertex_coord+ivolv*dimension, 
+            coord0.Ptr(), coord1.Ptr(), coord2.Ptr());
+       }
+     });
+}
 
-  for (ISO_VERTEX_INDEX ivolv = 0; ivolv < ivolv_list.size(); ivolv++) {
-    position_dual_ivolv_centroid_multi
-      (scalar_grid, ivoldual_table, isovalue0, isovalue1, 
-       ivolv_list[ivolv], cube, 
-       vertex_coord+ivolv*dimension, 
-       coord0.Ptr(), coord1.Ptr(), coord2.Ptr());
-  }
+void IVOLDUAL::position_all_dual_ivol_vertices
+(const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+ const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+ const IJKDUAL::ISODUAL_CUBE_TABLE_AMBIG & isodual_table,
+ const SCALAR_TYPE isovalue0,
+ const SCALAR_TYPE isovalue1,
+ const DUAL_IVOLVERT_ARRAY & ivolv_list,
+ COORD_ARRAY & vertex_coord)
+{
+  const int dimension = scalar_grid.Dimension();
 
+  vertex_coord.resize(ivolv_list.size()*dimension);
+  position_all_dual_ivol_vertices
+    (scalar_grid, ivoldual_table, isodual_table, isovalue0, isovalue1, 
+     ivolv_list, &(vertex_coord.front()));
 }
 
+
 void IVOLDUAL::position_all_dual_ivol_vertices
 (const DUALISO_SCALAR_GRID_BASE & scalar_grid,
  const IVOLDUAL_CUBE_TABLE & ivoldual_table,
  const IJKDUAL::ISODUAL_CUBE_TABLE_AMBIG & isodual_table,
  const SCALAR_TYPE isovalue0,
  const SCALAR_TYPE isovalue1,
+ const IVOLDUAL_EDGE_ISECT_CACHE & edge_cache,
+ const int num_threads,
  const DUAL_IVOLVERT_ARRAY & ivolv_list,
  COORD_ARRAY & vertex_coord)
 {
   const int dimension = scalar_grid.Dimension();
 
   vertex_coord.resize(ivolv_list.size()*dimension);
+  if (vertex_coord.empty()) { return; }
+
   position_all_dual_ivol_vertices
     (scalar_grid, ivoldual_table, isodual_table, isovalue0, isovalue1, 
-     ivolv_list, &(vertex_coord.front()));
+     edge_cache, num_threads, ivolv_list, &(vertex_coord.front()));
 }
 
 
@@ -1582,6 +4492,7 @@ void IVOLDUAL::position_dual_ivolv_centroid_multi
  const SCALAR_TYPE isovalue1,
  const DUAL_IVOLVERT & ivolv_info,
  const CUBE_FACE_INFO & cube,
+ const IVOLDUAL_EDGE_ISECT_CACHE & edge_cache,
  COORD_TYPE * vcoord, 
  COORD_TYPE * temp_coord0, COORD_TYPE * temp_coord1, COORD_TYPE * temp_coord2)
 {
@@ -1591,18 +4502,18 @@ void IVOLDUAL::position_dual_ivolv_centroid_multi
 
   if (ivoldual_table.OnLowerIsosurface(it, ivolv)) {
     position_dual_ivolv_on_lower_isosurface_centroid_multi
-      (scalar_grid, ivoldual_table, isovalue0, ivolv_info, cube,
+      (scalar_grid, ivoldual_table, isovalue0, ivolv_info, cube, edge_cache,
        vcoord, temp_coord0, temp_coord1, temp_coord2);
   }
   else if (ivoldual_table.OnUpperIsosurface(it, ivolv)) {
     position_dual_ivolv_on_upper_isosurface_centroid_multi
-      (scalar_grid, ivoldual_table, isovalue1, ivolv_info, cube,
+      (scalar_grid, ivoldual_table, isovalue1, ivolv_info, cube, edge_cache,
        vcoord, temp_coord0, temp_coord1, temp_coord2);
   }
   else {
     position_dual_ivolv_in_interval_volume_centroid_multi
       (scalar_grid, ivoldual_table, isovalue0, isovalue1, ivolv_info, cube,
-       vcoord, temp_coord0, temp_coord1, temp_coord2);
+       edge_cache, vcoord, temp_coord0, temp_coord1, temp_coord2);
   }
 
 }
@@ -1614,6 +4525,7 @@ void IVOLDUAL::position_dual_ivolv_on_lower_isosurface_centroid_multi
  const SCALAR_TYPE isovalue,
  const DUAL_IVOLVERT & ivolv_info,
  const CUBE_FACE_INFO & cube,
+ const IVOLDUAL_EDGE_ISECT_CACHE & edge_cache,
  COORD_TYPE * vcoord, 
  COORD_TYPE * temp_coord0, COORD_TYPE * temp_coord1, COORD_TYPE * temp_coord2)
 {
@@ -1663,27 +4575,14 @@ void IVOLDUAL::position_dual_ivolv_on_lower_isosurface_centroid_multi
       }
     }
 
-    VERTEX_INDEX iend0 = scalar_grid.CubeVertex(icube, k0);
-    VERTEX_INDEX iend1 = scalar_grid.CubeVertex(icube, k1);
-
-    SCALAR_TYPE s0 = scalar_grid.Scalar(iend0);
-    SCALAR_TYPE s1 = scalar_grid.Scalar(iend1);
-
-    scalar_grid.ComputeCoord(iend0, temp_coord0);
-    scalar_grid.ComputeCoord(iend1, temp_coord1);
-
+    const VERTEX_INDEX iend0 = scalar_grid.CubeVertex(icube, k0);
+    const VERTEX_INDEX iend1 = scalar_grid.CubeVertex(icube, k1);
+    const SCALAR_TYPE s0 = scalar_grid.Scalar(iend0);
+    const SCALAR_TYPE s1 = scalar_grid.Scalar(iend1);
 
-    if ((s0 < isovalue && s1 < isovalue) || 
-        (s0 > isovalue && s1 > isovalue)) {
-      // Use edge midpoint.
-      IJK::linear_interpolate_coord
-        (dimension, 0.5, temp_coord0, temp_coord1, temp_coord2);
-    }
-    else {
-      IJK::linear_interpolate_coord
-        (dimension, s0, temp_coord0, s1, temp_coord1, isovalue, 
-         temp_coord2);
-    }
+    edge_cache.ComputeIntersection
+      (scalar_grid, iend0, cube.EdgeDir(ie), s0, s1, isovalue,
+       temp_coord0, temp_coord1, temp_coord2);
 
     IJK::add_coord(dimension, vcoord, temp_coord2, vcoord);
     num_intersected_edges++;
@@ -1706,6 +4605,7 @@ void IVOLDUAL::position_dual_ivolv_on_upper_isosurface_centroid_multi
  const SCALAR_TYPE isovalue,
  const DUAL_IVOLVERT & ivolv_info,
  const CUBE_FACE_INFO & cube,
+ const IVOLDUAL_EDGE_ISECT_CACHE & edge_cache,
  COORD_TYPE * vcoord, 
  COORD_TYPE * temp_coord0, COORD_TYPE * temp_coord1, COORD_TYPE * temp_coord2)
 {
@@ -1755,27 +4655,14 @@ void IVOLDUAL::position_dual_ivolv_on_upper_isosurface_centroid_multi
       }
     }
 
-    VERTEX_INDEX iend0 = scalar_grid.CubeVertex(icube, k0);
-    VERTEX_INDEX iend1 = scalar_grid.CubeVertex(icube, k1);
-
-    SCALAR_TYPE s0 = scalar_grid.Scalar(iend0);
-    SCALAR_TYPE s1 = scalar_grid.Scalar(iend1);
-
-    scalar_grid.ComputeCoord(iend0, temp_coord0);
-    scalar_grid.ComputeCoord(iend1, temp_coord1);
-
+    const VERTEX_INDEX iend0 = scalar_grid.CubeVertex(icube, k0);
+    const VERTEX_INDEX iend1 = scalar_grid.CubeVertex(icube, k1);
+    const SCALAR_TYPE s0 = scalar_grid.Scalar(iend0);
+    const SCALAR_TYPE s1 = scalar_grid.Scalar(iend1);
 
-    if ((s0 < isovalue && s1 < isovalue) || 
-        (s0 > isovalue && s1 > isovalue)) {
-      // Use edge midpoint.
-      IJK::linear_interpolate_coord
-        (dimension, 0.5, temp_coord0, temp_coord1, temp_coord2);
-    }
-    else {
-      IJK::linear_interpolate_coord
-        (dimension, s0, temp_coord0, s1, temp_coord1, isovalue, 
-         temp_coord2);
-    }
+    edge_cache.ComputeIntersection
+      (scalar_grid, iend0, cube.EdgeDir(ie), s0, s1, isovalue,
+       temp_coord0, temp_coord1, temp_coord2);
 
     IJK::add_coord(dimension, vcoord, temp_coord2, vcoord);
     num_intersected_edges++;
@@ -1888,6 +4775,7 @@ void IVOLDUAL::position_dual_ivolv_in_interval_volume_centroid_multi
  const SCALAR_TYPE isovalue1,
  const DUAL_IVOLVERT & ivolv_info,
  const CUBE_FACE_INFO & cube,
+ const IVOLDUAL_EDGE_ISECT_CACHE & edge_cache,
  COORD_TYPE * vcoord, 
  COORD_TYPE * temp_coord0, COORD_TYPE * temp_coord1, COORD_TYPE * temp_coord2)
 {
@@ -1912,19 +4800,9 @@ void IVOLDUAL::position_dual_ivolv_in_interval_volume_centroid_multi
         (ivoldual_table, isovalue0, isovalue1, table_index, ivolv,
          ie, k0, k1, s0, s1, isovalueX)) {
 
-      scalar_grid.ComputeCoord(iend0, temp_coord0);
-      scalar_grid.ComputeCoord(iend1, temp_coord1);
-
-      if ((s0 < isovalueX && s1 < isovalueX) || 
-          (s0 > isovalueX && s1 > isovalueX)) {
-        // Use edge midpoint.
-        IJK::linear_interpolate_coord
-          (dimension, 0.5, temp_coord0, temp_coord1, temp_coord2);
-      }
-      else {
-        IJK::linear_interpolate_coord
-          (dimension, s0, temp_coord0, s1, temp_coord1, isovalueX, temp_coord2);
-      }
+      edge_cache.ComputeIntersection
+        (scalar_grid, iend0, cube.EdgeDir(ie), s0, s1, isovalueX,
+         temp_coord0, temp_coord1, temp_coord2);
 
       IJK::add_coord(dimension, vcoord, temp_coord2, vcoord);
       num_intersected_edges++;
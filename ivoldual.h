@@ -51,6 +51,19 @@ namespace IVOLDUAL {
    const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
    DUAL_INTERVAL_VOLUME & dual_interval_volume, IVOLDUAL_INFO & dualiso_info);
 
+  /// Construct interval volume using dual contouring.
+  /// - Version with optional data in options.
+  /// - Output is identical to the version without options.
+  /// - If options.block_index is NULL, uses ivoldual_data.BlockIndex().
+  /// - Calling with the same options.context for a sequence 
+  ///   of intervals avoids reallocating the encoded grid, 
+  ///   active cube list, merge data and mesh buffers on each call.
+  void dual_contouring_interval_volume
+  (const IVOLDUAL_DATA & ivoldual_data, 
+   const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+   const IVOLDUAL_EXTRACT_OPTIONS & options,
+   DUAL_INTERVAL_VOLUME & dual_interval_volume, IVOLDUAL_INFO & dualiso_info);
+
   /// Construct interval volume using dual contouring.
   /// - Returns list of interval volume polytope vertices
   ///   and list of interval volume vertex coordinates.
@@ -68,7 +81,8 @@ namespace IVOLDUAL {
   /// Construct interval volume using dual contouring.
   /// - Returns list of interval volume polytope vertices
   ///   and list of interval volume vertex coordinates.
-  /// - Version which creates ivoldual_table and ivolv_list.
+  /// - Version which gets ivoldual_table from the table cache
+  ///   and creates ivolv_list.
   void dual_contouring_interval_volume
   (const DUALISO_SCALAR_GRID_BASE & scalar_grid,
    const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
@@ -82,7 +96,7 @@ namespace IVOLDUAL {
   /// Construct interval volume using dual contouring.
   /// - Returns list of interval volume polytope vertices
   ///   and list of interval volume vertex coordinates.
-  /// - Version which creates ivoldual_table.
+  /// - Version which gets ivoldual_table from the table cache.
   void dual_contouring_interval_volume
   (const DUALISO_SCALAR_GRID_BASE & scalar_grid,
    const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
@@ -126,11 +140,65 @@ namespace IVOLDUAL {
    MERGE_DATA & merge_data, 
    IVOLDUAL_INFO & dualiso_info);
 
+  /// Construct interval volume using dual contouring.
+  /// - Version with optional data in options.
+  ///   See IVOLDUAL_EXTRACT_OPTIONS.
+  /// - Output is identical to the version without options.
+  /// - If options.context is not NULL, cubes containing interval 
+  ///   volume vertices are returned in options.context->cube_ivolv_list.
+  /// - Buffers in options.context keep their capacity between calls.
+  ///   Reuse the context for repeated extractions on grids of the same size.
+  /// - Merge data is allocated in context only if options.merge_data 
+  ///   is NULL and cubes are located with a dense index.
+  ///   See IVOLDUAL_DATA_FLAGS::cube_index_method.
+  /// - If options.band_grid is set, isovalue0 and isovalue1 must equal
+  ///   band_grid.Isovalue(interval) and band_grid.Isovalue(interval+1).
+  ///   In 3D, only vertices of active cubes are encoded.
+  /// - If options.incremental_grid is set, interior codes are set 
+  ///   as specified by incremental_grid.SetScalarGrid(), not by param.
+  ///   In 3D, only grid edges and vertices containing vertices
+  ///   whose encoding changed are rechecked for dual polytopes.
+  void dual_contouring_interval_volume
+  (const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+   const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+   const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+   const IVOLDUAL_DATA_FLAGS & param,
+   const IVOLDUAL_EXTRACT_OPTIONS & options,
+   std::vector<ISO_VERTEX_INDEX> & ivolpoly_vert,
+   DUAL_IVOLVERT_ARRAY & ivolv_list,
+   IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
+   COORD_ARRAY & vertex_coord,
+   IVOLDUAL_INFO & dualiso_info);
+
 
   // **************************************************
   // ENCODE GRID VERTICES
   // **************************************************
 
+  /// Encode array of scalar values as 0, default_interior_code or 3.
+  /// - 0: Below lower isovalue.
+  /// - default_interior_code: Between lower and upper isovalue.
+  /// - 3: Above upper isovalue.
+  /// - Branch free.  Uses SSE2 instructions, if available,
+  ///   to encode 16 values at a time.
+  ///   Compile with -DIVOLDUAL_NO_SIMD to use only the scalar loop.
+  /// @param[out] code[] Encoded values.
+  /// @pre Array code[] has length at least num_values.
+  void encode_scalar_values
+  (const SCALAR_TYPE scalar[], const VERTEX_INDEX num_values,
+   const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+   const GRID_VERTEX_ENCODING default_interior_code,
+   GRID_VERTEX_ENCODING code[]);
+
+  /// Encode array of scalar values as 0, 1, 2 or 3.
+  /// - Set interior codes based on scalar values as in
+  ///   encode_grid_vertices_set_interior_from_scalar().
+  /// - Branch free.  Uses SSE2 instructions, if available.
+  void encode_scalar_values_set_interior_from_scalar
+  (const SCALAR_TYPE scalar[], const VERTEX_INDEX num_values,
+   const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+   GRID_VERTEX_ENCODING code[]);
+
   /// Encode grid vertices as 0, 1, 2 or 3.
   /// - 0: Below lower isovalue.
   /// - 1: Between lower and upper isovalue.
@@ -157,6 +225,205 @@ namespace IVOLDUAL {
    IVOLDUAL_ENCODED_GRID & encoded_grid,
    IVOLDUAL_INFO & dualiso_info);
 
+  /// Encode grid vertices as 0, 1, 2 or 3.
+  /// - Version which splits the grid vertices among num_threads threads.
+  /// - Encoding is identical to the single thread version.
+  void encode_grid_vertices
+  (const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+   const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+   const GRID_VERTEX_ENCODING default_interior_code,
+   const int num_threads,
+   IVOLDUAL_ENCODED_GRID & encoded_grid,
+   IVOLDUAL_INFO & dualiso_info);
+
+  /// Encode grid vertices. Set interior codes based on scalar grid.
+  /// - Version which splits the grid vertices among num_threads threads.
+  void encode_grid_vertices_set_interior_from_scalar
+  (const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+   const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+   const int num_threads,
+   IVOLDUAL_ENCODED_GRID & encoded_grid,
+   IVOLDUAL_INFO & dualiso_info);
+
+
+  // **************************************************
+  // ENCODE GRID VERTICES AND COMPUTE ACTIVE CUBES
+  // **************************************************
+
+  /// Encode grid vertices and compute the interval volume table index
+  ///   of every active grid cube in a single pass over the scalar grid.
+  /// - Each z-layer of grid vertices is encoded and then the table indices
+  ///   of the cubes below it are computed while the layer is in cache.
+  /// - Table indices are computed along each row of cubes using
+  ///   a sliding window.  The four vertices shared by consecutive cubes
+  ///   in the row are read only once.
+  /// - Encoding is identical to encode_grid_vertices().
+  /// @param num_vertex_types Number of vertex types in the lookup table.
+  /// @param[out] active_cube_list List of active cubes.
+  ///   - active_cube_list is sorted by increasing cube index.
+  /// @pre scalar_grid.Dimension() == 3.
+  void encode_grid_vertices_and_active_cubes
+  (const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+   const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+   const GRID_VERTEX_ENCODING default_interior_code,
+   const int num_vertex_types,
+   const int num_threads,
+   IVOLDUAL_ENCODED_GRID & encoded_grid,
+   ACTIVE_CUBE_ARRAY & active_cube_list,
+   IVOLDUAL_INFO & dualiso_info);
+
+  /// Encode grid vertices and compute table index of every active cube.
+  /// - Set interior codes based on scalar grid as in
+  ///   encode_grid_vertices_set_interior_from_scalar().
+  /// @pre scalar_grid.Dimension() == 3.
+  void encode_grid_vertices_and_active_cubes_set_interior_from_scalar
+  (const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+   const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+   const int num_vertex_types,
+   const int num_threads,
+   IVOLDUAL_ENCODED_GRID & encoded_grid,
+   ACTIVE_CUBE_ARRAY & active_cube_list,
+   IVOLDUAL_INFO & dualiso_info);
+
+  /// Encode grid vertices and compute table index of every active cube.
+  /// - Version which skips blocks outside the interval volume.
+  /// - Vertices in blocks with encoding 0 or 3 are set to the
+  ///   block encoding without reading the scalar grid.
+  /// - Cubes in blocks with encoding 0 or 3 are not active.
+  /// @param encoded_blocks Encoded blocks for isovalue0 and isovalue1.
+  /// @pre scalar_grid.Dimension() == 3.
+  void encode_grid_vertices_and_active_cubes
+  (const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+   const IVOLDUAL_ENCODED_BLOCKS & encoded_blocks,
+   const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+   const GRID_VERTEX_ENCODING default_interior_code,
+   const int num_vertex_types,
+   const int num_threads,
+   IVOLDUAL_ENCODED_GRID & encoded_grid,
+   ACTIVE_CUBE_ARRAY & active_cube_list,
+   IVOLDUAL_INFO & dualiso_info);
+
+  /// Encode grid vertices and compute table index of every active cube.
+  /// - Version which skips blocks outside the interval volume.
+  /// @pre scalar_grid.Dimension() == 3.
+  void encode_grid_vertices_and_active_cubes_set_interior_from_scalar
+  (const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+   const IVOLDUAL_ENCODED_BLOCKS & encoded_blocks,
+   const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+   const int num_vertex_types,
+   const int num_threads,
+   IVOLDUAL_ENCODED_GRID & encoded_grid,
+   ACTIVE_CUBE_ARRAY & active_cube_list,
+   IVOLDUAL_INFO & dualiso_info);
+
+  /// Encode grid vertices and compute table index of every active cube.
+  /// - Version which skips blocks outside the interval volume.
+  /// - Version which stores per thread lists in thread_lists.
+  ///   Lists in thread_lists keep their capacity, so repeated calls
+  ///   with the same thread_lists do not reallocate them.
+  /// @pre scalar_grid.Dimension() == 3.
+  void encode_grid_vertices_and_active_cubes
+  (const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+   const IVOLDUAL_ENCODED_BLOCKS & encoded_blocks,
+   const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+   const GRID_VERTEX_ENCODING default_interior_code,
+   const int num_vertex_types,
+   const int num_threads,
+   IVOLDUAL_THREAD_LISTS & thread_lists,
+   IVOLDUAL_ENCODED_GRID & encoded_grid,
+   ACTIVE_CUBE_ARRAY & active_cube_list,
+   IVOLDUAL_INFO & dualiso_info);
+
+  /// Encode grid vertices and compute table index of every active cube.
+  /// - Version which skips blocks outside the interval volume.
+  /// - Version which stores per thread lists in thread_lists.
+  /// @pre scalar_grid.Dimension() == 3.
+  void encode_grid_vertices_and_active_cubes_set_interior_from_scalar
+  (const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+   const IVOLDUAL_ENCODED_BLOCKS & encoded_blocks,
+   const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+   const int num_vertex_types,
+   const int num_threads,
+   IVOLDUAL_THREAD_LISTS & thread_lists,
+   IVOLDUAL_ENCODED_GRID & encoded_grid,
+   ACTIVE_CUBE_ARRAY & active_cube_list,
+   IVOLDUAL_INFO & dualiso_info);
+
+
+  // **************************************************
+  // ENCODE GRID VERTEX BANDS
+  // **************************************************
+
+  /// Encode array of scalar values as bands.
+  /// - Band of s is 2k if threshold[k-1] < s < threshold[k]
+  ///   and 2k+1 if s equals threshold[k].
+  /// - Band of NaN is IVOLDUAL_BAND_GRID::NAN_BAND.
+  /// - Branch free.  Uses SSE2 instructions, if available.
+  /// @pre threshold[] is strictly increasing.
+  /// @pre num_thresholds <= IVOLDUAL_BAND_GRID::MAX_NUM_THRESHOLDS.
+  void encode_scalar_bands
+  (const SCALAR_TYPE scalar[], const VERTEX_INDEX num_values,
+   const SCALAR_TYPE threshold[], const int num_thresholds,
+   GRID_VERTEX_ENCODING band[]);
+
+  /// Encode grid vertices as bands.
+  /// @pre band_grid.SetIsovalues() has been called.
+  void encode_grid_vertex_bands
+  (const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+   const int num_threads,
+   IVOLDUAL_BAND_GRID & band_grid,
+   IVOLDUAL_INFO & dualiso_info);
+
+  /// Encode grid vertices as bands and compute the active cubes
+  ///   of every interval in a single pass over the scalar grid.
+  /// - Each cube is listed with its table index for every interval
+  ///   where it is active.
+  /// @param[out] active_cube_list Active cubes of each interval.
+  ///   - active_cube_list[i] is identical to the active_cube_list
+  ///     computed by encode_grid_vertices_and_active_cubes()
+  ///     for interval i.
+  /// @pre band_grid.SetIsovalues() has been called.
+  /// @pre scalar_grid.Dimension() == 3.
+  void encode_grid_vertex_bands_and_active_cubes
+  (const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+   const int num_vertex_types,
+   const int num_threads,
+   IVOLDUAL_BAND_GRID & band_grid,
+   std::vector<ACTIVE_CUBE_ARRAY> & active_cube_list,
+   IVOLDUAL_INFO & dualiso_info);
+
+  /// Encode grid vertices as bands and compute the active cubes
+  ///   of every interval.
+  /// - Version which gets the table from the table cache.
+  /// - If scalar grid dimension is not 3, active cube lists are empty.
+  /// - Stores encoding time in dualiso_info.time.preprocessing.
+  void encode_grid_vertex_bands_and_active_cubes
+  (const IVOLDUAL_DATA & ivoldual_data,
+   IVOLDUAL_BAND_GRID & band_grid,
+   std::vector<ACTIVE_CUBE_ARRAY> & active_cube_list,
+   IVOLDUAL_INFO & dualiso_info);
+
+  /// Encode grid vertices for interval from their bands.
+  /// - Encoding is identical to encode_grid_vertices()
+  ///   for the interval isovalues.
+  void encode_grid_vertices_from_bands
+  (const IVOLDUAL_BAND_GRID & band_grid,
+   const int interval,
+   const int num_threads,
+   IVOLDUAL_ENCODED_GRID & encoded_grid);
+
+  /// Encode vertices of active cubes for interval from their bands.
+  /// - Encodings of other grid vertices are not changed.
+  /// - Extraction from active_cube_list reads only the encodings
+  ///   of vertices of active cubes.  
+  ///   See extract_dual_ivolpoly() with active_cube_list.
+  /// @param active_cube_list Active cubes of the interval.
+  void encode_active_cube_vertices_from_bands
+  (const IVOLDUAL_BAND_GRID & band_grid,
+   const int interval,
+   const ACTIVE_CUBE_ARRAY & active_cube_list,
+   IVOLDUAL_ENCODED_GRID & encoded_grid);
+
 
   // **************************************************
   // SET IVOLTABLE INFO FOR EACH ACTIVE GRID CUBE
@@ -172,6 +439,66 @@ namespace IVOLDUAL {
    const IVOLDUAL_CUBE_TABLE & ivoldual_table,
    std::vector<GRID_CUBE_DATA> & cube_ivolv_list);
 
+  /// Set ivoltable information for each cube in cube_ivolv_list.
+  /// - Version which splits cube_ivolv_list among num_threads threads.
+  void set_cube_ivoltable_info
+  (const IVOLDUAL_ENCODED_GRID & encoded_grid,
+   const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+   const int num_threads,
+   std::vector<GRID_CUBE_DATA> & cube_ivolv_list);
+
+  /// Set ivoltable information for each cube in cube_ivolv_list.
+  /// - Version which copies table indices from active_cube_list.
+  /// @param active_cube_list List of active cubes and their table indices.
+  /// @pre active_cube_list contains every cube in cube_ivolv_list.
+  /// @param index_to_cube_list[] Index to array cube_ivolv_list[].
+  ///   - index_to_cube_list[icube] equals num_grid_vertices if
+  ///     icube is not in cube_ivolv_list.
+  void set_cube_ivoltable_info
+  (const ACTIVE_CUBE_ARRAY & active_cube_list,
+   const VERTEX_INDEX index_to_cube_list[],
+   const VERTEX_INDEX num_grid_vertices,
+   const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+   std::vector<GRID_CUBE_DATA> & cube_ivolv_list);
+
+  /// Set ivoltable information for each cube in cube_ivolv_list.
+  /// - Version which copies table indices from active_cube_list
+  ///   and locates cubes with index_to_cube_list.
+  void set_cube_ivoltable_info
+  (const ACTIVE_CUBE_ARRAY & active_cube_list,
+   const INDEX_TO_CUBE_LIST & index_to_cube_list,
+   const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+   std::vector<GRID_CUBE_DATA> & cube_ivolv_list);
+
+
+  // **************************************************
+  // INCREMENTAL ENCODING
+  // **************************************************
+
+  /// Update encoding of grid vertices and active cubes
+  ///   for interval [isovalue0,isovalue1].
+  /// - The first update after incremental_grid.SetScalarGrid()
+  ///   encodes every grid vertex.
+  /// - Later updates reclassify only grid vertices whose scalar values 
+  ///   lie between the previous and the new isovalues.
+  ///   Table indices are recomputed only for cubes incident
+  ///   on reclassified vertices.
+  /// - Encoding is identical to encode_grid_vertices() or
+  ///   encode_grid_vertices_set_interior_from_scalar().
+  /// - In 3D, incremental_grid.active_cube_list is identical to
+  ///   the active_cube_list computed by 
+  ///   encode_grid_vertices_and_active_cubes().
+  /// - In 3D, incremental_grid.dual_edge_list and dual_vertex_list
+  ///   are updated by update_dual_grid_elements().
+  /// @pre incremental_grid.SetScalarGrid() has been called
+  ///   with scalar_grid.
+  void encode_grid_vertices_incremental
+  (const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+   const SCALAR_TYPE isovalue0,  const SCALAR_TYPE isovalue1, 
+   const int num_vertex_types,
+   const int num_threads,
+   IVOLDUAL_INCREMENTAL_GRID & incremental_grid);
+
 
   // **************************************************
   // SET IVOL VERTEX INFORMATION
@@ -186,9 +513,44 @@ namespace IVOLDUAL {
    const IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
    DUAL_IVOLVERT_ARRAY & ivolv_list);
 
+  /// Set ivol vertex information.
+  /// - Version which locates cubes with index_to_cube_list.
+  void set_ivol_vertex_info
+  (const DUALISO_GRID & grid,
+   const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+   const std::vector<ISO_VERTEX_INDEX> & poly_vert,
+   const std::vector<GRID_CUBE_DATA> & cube_list,
+   const INDEX_TO_CUBE_LIST & index_to_cube_list,
+   const IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
+   DUAL_IVOLVERT_ARRAY & ivolv_list);
+
+  /// Set ivol vertex information.
+  /// - Version which counts hexahedra incident on each ivol vertex
+  ///   in num_hex_incident_on_ivolv.
+  /// - num_hex_incident_on_ivolv is reallocated only if it is smaller
+  ///   than ivolv_list, so repeated calls can reuse it.
+  void set_ivol_vertex_info
+  (const DUALISO_GRID & grid,
+   const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+   const std::vector<ISO_VERTEX_INDEX> & poly_vert,
+   const std::vector<GRID_CUBE_DATA> & cube_list,
+   const INDEX_TO_CUBE_LIST & index_to_cube_list,
+   const IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
+   std::vector<ISO_VERTEX_INDEX> & num_hex_incident_on_ivolv,
+   DUAL_IVOLVERT_ARRAY & ivolv_list);
+
+  void determine_ivol_vertices_missing_incident_hex
+  (const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+   const std::vector<ISO_VERTEX_INDEX> & poly_vert,
+   DUAL_IVOLVERT_ARRAY & ivolv_list);
+
+  /// Determine ivol vertices missing incident hexahedra.
+  /// - Version which counts hexahedra incident on each ivol vertex
+  ///   in num_hex_incident_on_ivolv.
   void determine_ivol_vertices_missing_incident_hex
   (const IVOLDUAL_CUBE_TABLE & ivoldual_table,
    const std::vector<ISO_VERTEX_INDEX> & poly_vert,
+   std::vector<ISO_VERTEX_INDEX> & num_hex_incident_on_ivolv,
    DUAL_IVOLVERT_ARRAY & ivolv_list);
 
   void determine_ivol_vertices_in_isosurface_boxes
@@ -211,6 +573,15 @@ namespace IVOLDUAL {
    const IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
    DUAL_IVOLVERT_ARRAY & ivolv_list);
 
+  /// Determine thin regions.
+  /// - Version which locates cubes with index_to_cube_list.
+  void determine_thin_regions
+  (const DUALISO_GRID & grid,
+   const std::vector<GRID_CUBE_DATA> & cube_list,
+   const INDEX_TO_CUBE_LIST & index_to_cube_list,
+   const IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
+   DUAL_IVOLVERT_ARRAY & ivolv_list);
+
   /// Set flag in_pseudobox to true for all ivol vertices in cube cube_ivolv.
   void set_in_pseudobox
   (const GRID_CUBE_DATA & cube_ivolv,
@@ -260,6 +631,223 @@ namespace IVOLDUAL {
    IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
    IVOLDUAL_INFO & dualiso_info);
 
+  /// Extract dual interval volume polytopes.
+  /// - Version which splits the grid into slabs and extracts
+  ///   the polytopes in each slab in a separate thread.
+  /// - Slabs are formed from contiguous rows of grid edges/vertices.
+  ///   Polytopes from the slabs are concatenated in slab order,
+  ///   so output is identical to the single thread version.
+  /// @param num_threads Number of threads.
+  ///   If num_threads <= 1, calls the single thread version.
+  void extract_dual_ivolpoly
+  (const IVOLDUAL_ENCODED_GRID & encoded_grid,
+   const int num_threads,
+   std::vector<ISO_VERTEX_INDEX> & ivolpoly,
+   std::vector<POLY_VERTEX_INDEX> & poly_vertex,
+   IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
+   IVOLDUAL_INFO & dualiso_info);
+
+  /// Extract interval volume polytopes dual to grid edges.
+  /// - Multithreaded version.
+  void extract_ivolpoly_dual_to_grid_edges
+  (const IVOLDUAL_ENCODED_GRID & encoded_grid,
+   const int num_threads,
+   std::vector<ISO_VERTEX_INDEX> & ivolpoly,
+   std::vector<POLY_VERTEX_INDEX> & poly_vertex,
+   IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info);
+
+  /// Extract interval volume polytopes dual to grid vertices.
+  /// - Multithreaded version.
+  void extract_ivolpoly_dual_to_grid_vertices
+  (const IVOLDUAL_ENCODED_GRID & encoded_grid,
+   const int num_threads,
+   std::vector<ISO_VERTEX_INDEX> & ivolpoly,
+   std::vector<POLY_VERTEX_INDEX> & poly_vertex,
+   IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info);
+
+  /// Extract dual interval volume polytopes.
+  /// - Multithreaded version which skips blocks outside
+  ///   the interval volume.
+  /// - Output is identical to the version without encoded_blocks.
+  /// @param encoded_blocks Encoded blocks for the isovalues
+  ///   used to compute encoded_grid.
+  void extract_dual_ivolpoly
+  (const IVOLDUAL_ENCODED_GRID & encoded_grid,
+   const IVOLDUAL_ENCODED_BLOCKS & encoded_blocks,
+   const int num_threads,
+   std::vector<ISO_VERTEX_INDEX> & ivolpoly,
+   std::vector<POLY_VERTEX_INDEX> & poly_vertex,
+   IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
+   IVOLDUAL_INFO & dualiso_info);
+
+  /// Extract interval volume polytopes dual to grid edges.
+  /// - Multithreaded version which skips blocks outside
+  ///   the interval volume.
+  void extract_ivolpoly_dual_to_grid_edges
+  (const IVOLDUAL_ENCODED_GRID & encoded_grid,
+   const IVOLDUAL_ENCODED_BLOCKS & encoded_blocks,
+   const int num_threads,
+   std::vector<ISO_VERTEX_INDEX> & ivolpoly,
+   std::vector<POLY_VERTEX_INDEX> & poly_vertex,
+   IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info);
+
+  /// Extract interval volume polytopes dual to grid vertices.
+  /// - Multithreaded version which skips blocks outside
+  ///   the interval volume.
+  void extract_ivolpoly_dual_to_grid_vertices
+  (const IVOLDUAL_ENCODED_GRID & encoded_grid,
+   const IVOLDUAL_ENCODED_BLOCKS & encoded_blocks,
+   const int num_threads,
+   std::vector<ISO_VERTEX_INDEX> & ivolpoly,
+   std::vector<POLY_VERTEX_INDEX> & poly_vertex,
+   IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info);
+
+  /// Extract dual interval volume polytopes.
+  /// - Multithreaded version which extracts only polytopes dual to
+  ///   edges and vertices of active cubes.
+  /// - Running time is proportional to the number of active cubes,
+  ///   not to the grid size.
+  /// - Output is identical to the version without active_cube_list.
+  /// @param active_cube_list Active cubes for the isovalues
+  ///   used to compute encoded_grid, sorted by cube index.
+  ///   - Only encodings of vertices of active cubes are read.
+  void extract_dual_ivolpoly
+  (const IVOLDUAL_ENCODED_GRID & encoded_grid,
+   const ACTIVE_CUBE_ARRAY & active_cube_list,
+   const int num_threads,
+   std::vector<ISO_VERTEX_INDEX> & ivolpoly,
+   std::vector<POLY_VERTEX_INDEX> & poly_vertex,
+   IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
+   IVOLDUAL_INFO & dualiso_info);
+
+  /// Extract interval volume polytopes dual to grid edges.
+  /// - Multithreaded version which extracts only polytopes dual to
+  ///   edges of active cubes.
+  void extract_ivolpoly_dual_to_grid_edges
+  (const IVOLDUAL_ENCODED_GRID & encoded_grid,
+   const ACTIVE_CUBE_ARRAY & active_cube_list,
+   const int num_threads,
+   std::vector<ISO_VERTEX_INDEX> & ivolpoly,
+   std::vector<POLY_VERTEX_INDEX> & poly_vertex,
+   IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
+   IVOLDUAL_INFO & dualiso_info);
+
+  /// Extract interval volume polytopes dual to grid vertices.
+  /// - Multithreaded version which extracts only polytopes dual to
+  ///   vertices of active cubes.
+  void extract_ivolpoly_dual_to_grid_vertices
+  (const IVOLDUAL_ENCODED_GRID & encoded_grid,
+   const ACTIVE_CUBE_ARRAY & active_cube_list,
+   const int num_threads,
+   std::vector<ISO_VERTEX_INDEX> & ivolpoly,
+   std::vector<POLY_VERTEX_INDEX> & poly_vertex,
+   IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
+   IVOLDUAL_INFO & dualiso_info);
+
+  /// Extract dual interval volume polytopes.
+  /// - Version which extracts polytopes dual to the grid edges
+  ///   in dual_edge_list and the grid vertices in dual_vertex_list.
+  /// - Running time is proportional to the number of polytopes.
+  /// - Output is identical to the version with active_cube_list
+  ///   if the lists are set by find_dual_grid_edges()
+  ///   and find_dual_grid_vertices() from active_cube_list.
+  /// @param dual_edge_list[d] Grid edges in direction d
+  ///   with dual polytopes.
+  /// @param dual_vertex_list Grid vertices with dual polytopes.
+  void extract_dual_ivolpoly
+  (const IVOLDUAL_ENCODED_GRID & encoded_grid,
+   const std::vector<DUAL_GRID_EDGE_ARRAY> & dual_edge_list,
+   const std::vector<VERTEX_INDEX> & dual_vertex_list,
+   std::vector<ISO_VERTEX_INDEX> & ivolpoly,
+   std::vector<POLY_VERTEX_INDEX> & poly_vertex,
+   IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
+   IVOLDUAL_INFO & dualiso_info);
+
+  /// Extract interval volume polytopes dual to grid edges.
+  /// - Version which extracts polytopes dual to the grid edges
+  ///   in dual_edge_list.
+  void extract_ivolpoly_dual_to_grid_edges
+  (const IVOLDUAL_ENCODED_GRID & encoded_grid,
+   const std::vector<DUAL_GRID_EDGE_ARRAY> & dual_edge_list,
+   std::vector<ISO_VERTEX_INDEX> & ivolpoly,
+   std::vector<POLY_VERTEX_INDEX> & poly_vertex,
+   IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
+   IVOLDUAL_INFO & dualiso_info);
+
+  /// Extract interval volume polytopes dual to grid vertices.
+  /// - Version which extracts polytopes dual to the grid vertices
+  ///   in dual_vertex_list.
+  void extract_ivolpoly_dual_to_grid_vertices
+  (const IVOLDUAL_ENCODED_GRID & encoded_grid,
+   const std::vector<VERTEX_INDEX> & dual_vertex_list,
+   std::vector<ISO_VERTEX_INDEX> & ivolpoly,
+   std::vector<POLY_VERTEX_INDEX> & poly_vertex,
+   IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
+   IVOLDUAL_INFO & dualiso_info);
+
+
+  // **************************************************
+  // FIND GRID EDGES AND VERTICES DUAL TO POLYTOPES
+  // **************************************************
+
+  /// Find grid edges which are dual to interval volume polytopes.
+  /// - Multithreaded version which checks only edges of active cubes.
+  /// @param[out] dual_edge_list[d] Grid edges in direction d
+  ///   with dual polytopes, sorted in the order visited by
+  ///   IJK_FOR_EACH_INTERIOR_GRID_EDGE.
+  void find_dual_grid_edges
+  (const IVOLDUAL_ENCODED_GRID & encoded_grid,
+   const ACTIVE_CUBE_ARRAY & active_cube_list,
+   const int num_threads,
+   std::vector<DUAL_GRID_EDGE_ARRAY> & dual_edge_list);
+
+  /// Find grid edges which are dual to interval volume polytopes.
+  /// - Version which stores per thread lists in thread_lists.
+  ///   Lists in thread_lists keep their capacity, so repeated calls
+  ///   with the same thread_lists do not reallocate them.
+  void find_dual_grid_edges
+  (const IVOLDUAL_ENCODED_GRID & encoded_grid,
+   const ACTIVE_CUBE_ARRAY & active_cube_list,
+   const int num_threads,
+   IVOLDUAL_THREAD_LISTS & thread_lists,
+   std::vector<DUAL_GRID_EDGE_ARRAY> & dual_edge_list);
+
+  /// Find grid vertices which are dual to interval volume polytopes.
+  /// - Multithreaded version which checks only vertices of active cubes.
+  /// @param[out] dual_vertex_list Grid vertices with dual polytopes,
+  ///   sorted by vertex index.
+  void find_dual_grid_vertices
+  (const IVOLDUAL_ENCODED_GRID & encoded_grid,
+   const ACTIVE_CUBE_ARRAY & active_cube_list,
+   const int num_threads,
+   std::vector<VERTEX_INDEX> & dual_vertex_list);
+
+  /// Find grid vertices which are dual to interval volume polytopes.
+  /// - Version which stores per thread lists in thread_lists.
+  void find_dual_grid_vertices
+  (const IVOLDUAL_ENCODED_GRID & encoded_grid,
+   const ACTIVE_CUBE_ARRAY & active_cube_list,
+   const int num_threads,
+   IVOLDUAL_THREAD_LISTS & thread_lists,
+   std::vector<VERTEX_INDEX> & dual_vertex_list);
+
+  /// Update grid edges and vertices which are dual to 
+  ///   interval volume polytopes after a change in encoding.
+  /// - Only grid edges and vertices containing a vertex in 
+  ///   changed_vertex are rechecked.
+  /// - Lists are identical to the lists computed by 
+  ///   find_dual_grid_edges() and find_dual_grid_vertices()
+  ///   from the new encoding.
+  /// @param changed_vertex Vertices whose encoding changed.
+  ///   - May contain duplicates.
+  /// @pre dual_edge_list and dual_vertex_list were computed
+  ///   from the old encoding.
+  void update_dual_grid_elements
+  (const IVOLDUAL_ENCODED_GRID & encoded_grid,
+   const std::vector<VERTEX_INDEX> & changed_vertex,
+   std::vector<DUAL_GRID_EDGE_ARRAY> & dual_edge_list,
+   std::vector<VERTEX_INDEX> & dual_vertex_list);
+
 
   // **************************************************
   // SPLIT DUAL INTERVAL VOLUME VERTICES
@@ -279,6 +867,23 @@ namespace IVOLDUAL {
    std::vector<ISO_VERTEX_INDEX> & isopoly,
    int & num_split);
 
+  /// Split interval volume vertices in each cube.
+  /// - Version which splits the cubes and polytopes among num_threads threads.
+  /// - Vertices of cube cube_list[k] are numbered starting at
+  ///   cube_list[k].first_isov, an exclusive prefix sum 
+  ///   of cube_list[*].num_isov.
+  /// - Output is identical for any number of threads.
+  void split_dual_ivolvert
+  (const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+   const int num_threads,
+   const std::vector<VERTEX_INDEX> & ivolpoly_cube, 
+   const std::vector<POLY_VERTEX_INDEX> & poly_vertex,
+   const IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
+   std::vector<GRID_CUBE_DATA> & cube_list,
+   DUAL_IVOLVERT_ARRAY & ivolv_list,
+   std::vector<ISO_VERTEX_INDEX> & isopoly,
+   int & num_split);
+
 
   /// Split interval volume vertex pairs which create non-manifold edges.
   /// - Cubes containing vertices have only one ambiguous facet.
@@ -304,6 +909,15 @@ namespace IVOLDUAL {
    std::vector<GRID_CUBE_DATA> & cube_list,
    int & num_split);
 
+  /// Split interval volume vertex pairs which create non-manifold edges.
+  /// - Version which locates cubes with index_to_cube_list.
+  void split_non_manifold_ivolv_pairs_ambig
+  (const DUALISO_GRID & grid,
+   const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+   const INDEX_TO_CUBE_LIST & index_to_cube_list,
+   std::vector<GRID_CUBE_DATA> & cube_list,
+   int & num_split);
+
   /// Split interval volume vertex pairs which create non-manifold edges.
   /// - Version which creates array index_to_cube_list[].
   void split_non_manifold_ivolv_pairs_ambig
@@ -324,6 +938,15 @@ namespace IVOLDUAL {
    std::vector<GRID_CUBE_DATA> & cube_list,
    int & num_split);
 
+  /// Split interval volume vertex pairs which create non-manifold edges.
+  /// - Version which locates cubes with index_to_cube_list.
+  void split_non_manifold_ivolv_pairs_ambigB
+  (const DUALISO_GRID & grid,
+   const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+   const INDEX_TO_CUBE_LIST & index_to_cube_list,
+   std::vector<GRID_CUBE_DATA> & cube_list,
+   int & num_split);
+
   /// Split interval volume vertex pairs which create non-manifold edges.
   /// - Version which creates array index_to_cube_list[].
   /// - Version which allows more splits.
@@ -345,6 +968,15 @@ namespace IVOLDUAL {
    std::vector<GRID_CUBE_DATA> & cube_list,
    int & num_split);
 
+  /// Split interval volume vertex pairs which create non-manifold edges.
+  /// - Version which locates cubes with index_to_cube_list.
+  void split_non_manifold_ivolv_pairs_ambigC
+  (const DUALISO_GRID & grid,
+   const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+   const INDEX_TO_CUBE_LIST & index_to_cube_list,
+   std::vector<GRID_CUBE_DATA> & cube_list,
+   int & num_split);
+
   /// Split interval volume vertex pairs which create non-manifold edges.
   /// - Version which creates array index_to_cube_list[].
   /// - Version which allows more splits.
@@ -369,6 +1001,15 @@ namespace IVOLDUAL {
    std::vector<GRID_CUBE_DATA> & cube_list,
    int & num_split);
 
+  /// Split interval volume vertex pairs which create non-manifold edges.
+  /// - Version which locates cubes with index_to_cube_list.
+  void split_non_manifold_ivolv_pairs_ambigD
+  (const DUALISO_GRID & grid,
+   const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+   const INDEX_TO_CUBE_LIST & index_to_cube_list,
+   std::vector<GRID_CUBE_DATA> & cube_list,
+   int & num_split);
+
   /// Split interval volume vertex pairs which create non-manifold edges.
   /// - Version which creates array index_to_cube_list[].
   /// - Version which allows more splits.
@@ -405,6 +1046,38 @@ namespace IVOLDUAL {
    const DUAL_IVOLVERT_ARRAY & ivolv_list,
    COORD_ARRAY & vertex_coord);
 
+  /// Position all the dual interval volume vertices.
+  /// - Version using isosurface-grid edge intersections 
+  ///   stored in edge_cache.  Intersections not in edge_cache 
+  ///   are computed.  Vertex coordinates do not depend 
+  ///   on the contents of edge_cache.
+  /// - Version which splits the vertices among num_threads threads.
+  void position_all_dual_ivol_vertices
+  (const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+   const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+   const IJKDUAL::ISODUAL_CUBE_TABLE_AMBIG & isodual_table,
+   const SCALAR_TYPE isovalue0,
+   const SCALAR_TYPE isovalue1,
+   const IVOLDUAL_EDGE_ISECT_CACHE & edge_cache,
+   const int num_threads,
+   const DUAL_IVOLVERT_ARRAY & ivolv_list,
+   COORD_TYPE * vertex_coord);
+
+  /// Position all the dual interval volume vertices.
+  /// - Version using isosurface-grid edge intersections 
+  ///   stored in edge_cache.
+  /// - Version with vertex coordinates stored in C++ STL vector vertex_coord.
+  void position_all_dual_ivol_vertices
+  (const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+   const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+   const IJKDUAL::ISODUAL_CUBE_TABLE_AMBIG & isodual_table,
+   const SCALAR_TYPE isovalue0,
+   const SCALAR_TYPE isovalue1,
+   const IVOLDUAL_EDGE_ISECT_CACHE & edge_cache,
+   const int num_threads,
+   const DUAL_IVOLVERT_ARRAY & ivolv_list,
+   COORD_ARRAY & vertex_coord);
+
   /// Position interval volume vertex described by ivolv_info
   /// at the centroid of the interpolated isosurface-grid edge
   /// intersection points.
@@ -415,6 +1088,7 @@ namespace IVOLDUAL {
    const SCALAR_TYPE isovalue1,
    const DUAL_IVOLVERT & ivolv_info,
    const CUBE_FACE_INFO & cube,
+   const IVOLDUAL_EDGE_ISECT_CACHE & edge_cache,
    COORD_TYPE * vcoord, 
    COORD_TYPE * temp_coord0, COORD_TYPE * temp_coord1, 
    COORD_TYPE * temp_coord2);
@@ -426,6 +1100,7 @@ namespace IVOLDUAL {
    const SCALAR_TYPE isovalue,
    const DUAL_IVOLVERT & ivolv_info,
    const CUBE_FACE_INFO & cube,
+   const IVOLDUAL_EDGE_ISECT_CACHE & edge_cache,
    COORD_TYPE * vcoord, 
    COORD_TYPE * temp_coord0, COORD_TYPE * temp_coord1, 
    COORD_TYPE * temp_coord2);
@@ -437,6 +1112,7 @@ namespace IVOLDUAL {
    const SCALAR_TYPE isovalue,
    const DUAL_IVOLVERT & ivolv_info,
    const CUBE_FACE_INFO & cube,
+   const IVOLDUAL_EDGE_ISECT_CACHE & edge_cache,
    COORD_TYPE * vcoord, 
    COORD_TYPE * temp_coord0, COORD_TYPE * temp_coord1, 
    COORD_TYPE * temp_coord2);
@@ -450,6 +1126,7 @@ namespace IVOLDUAL {
    const SCALAR_TYPE isovalue1,
    const DUAL_IVOLVERT & ivolv_info,
    const CUBE_FACE_INFO & cube,
+   const IVOLDUAL_EDGE_ISECT_CACHE & edge_cache,
    COORD_TYPE * vcoord, 
    COORD_TYPE * temp_coord0, COORD_TYPE * temp_coord1, 
    COORD_TYPE * temp_coord2);
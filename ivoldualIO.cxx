@@ -75,11 +75,16 @@ namespace {
      NO_WRITE_OPT, SILENT_OPT, NO_WARN_OPT,
      INFO_OPT, TIME_OPT, OUT_IVOLV_OPT, OUT_IVOLP_OPT, WRITE_SCALAR_OPT,
      SPLIT_HEX_OPT, COLLAPSE_HEX_OPT, 
-     LSMOOTH_ELENGTH_OPT, LSMOOTH_JACOBIAN_OPT, GSMOOTH_JACOBIAN_OPT,
+     LSMOOTH_ELENGTH_OPT, LSMOOTH_ELENGTH_COLOR_OPT, LSMOOTH_JACOBIAN_OPT, GSMOOTH_JACOBIAN_OPT,
      SPLIT_HEX_THRESHOLD_OPT, COLLAPSE_HEX_THRESHOLD_OPT, 
      ELENGTH_THRESHOLD_OPT, JACOBIAN_THRESHOLD_OPT,
+     SMOOTH_EPSILON_OPT, SMOOTH_STOP_STALLED_OPT, SMOOTH_TIME_LIMIT_OPT,
+     JACOBIAN_GRADIENT_OPT, REPAIR_JACOBIAN_OPT, REPAIR_BUDGET_MS_OPT,
      ADD_OUTER_LAYER_OPT,
      EXPAND_THIN_REGIONS_OPT,
+     THREADS_OPT, BLOCK_EDGE_LENGTH_OPT, TABLE_FILE_OPT,
+     MULTI_INTERVAL_OPT, INCREMENTAL_OPT, STREAM_SLAB_OPT,
+     CUBE_INDEX_OPT, PROFILE_OPT,
      UNKNOWN_OPT} OPTION_TYPE;
 
   typedef enum {
@@ -143,6 +148,30 @@ namespace {
     return(method);
   }
 
+  CUBE_INDEX_METHOD get_cube_index_method(char * s)
+  // convert string s into parameter token
+  {
+    CUBE_INDEX_METHOD method = AUTO_CUBE_INDEX;
+    string str = s;
+
+    if (str == "auto") {
+      method = AUTO_CUBE_INDEX;
+    }
+    else if (str == "dense") {
+      method = DENSE_CUBE_INDEX;
+    }
+    else if (str == "sparse") {
+      method = SPARSE_CUBE_INDEX;
+    }
+    else {
+      cerr << "Error in input parameter -cube_index.  Illegal method: " 
+           << str << "." << endl;
+      exit(1030);
+    }
+
+    return(method);
+  }
+
 }
 
 namespace {
@@ -339,6 +368,15 @@ namespace {
     options.AddToHelpMessage
       (LSMOOTH_ELENGTH_OPT, "S is the minimum accepted edge length.");
 
+    options.AddOptionNoArg
+      (LSMOOTH_ELENGTH_COLOR_OPT, "LSMOOTH_ELENGTH_COLOR_OPT", EXTENDED_OPTG, 
+       "-lsmooth_elength_color", 
+       "Color the vertex adjacency graph and run -lsmooth_elength");
+    options.AddToHelpMessage
+      (LSMOOTH_ELENGTH_COLOR_OPT, 
+       "on each color class in parallel using -threads N threads.",
+       "Output is independent of N but differs from serial smoothing.");
+
     options.AddOption1Arg
       (LSMOOTH_JACOBIAN_OPT, "LSMOOTH_JACOBIAN_OPT", REGULAR_OPTG, 
        "-lsmooth_jacobian", "S", 
@@ -365,6 +403,55 @@ namespace {
 
     options.AddUsageOptionNewline(REGULAR_OPTG);
 
+    options.AddOption1Arg
+      (SMOOTH_EPSILON_OPT, "SMOOTH_EPSILON_OPT", REGULAR_OPTG, 
+       "-smooth_epsilon", "E", 
+       "Stop smoothing when no vertex moves more than E in an iteration.");
+
+    options.AddOptionNoArg
+      (SMOOTH_STOP_STALLED_OPT, "SMOOTH_STOP_STALLED_OPT", REGULAR_OPTG, 
+       "-smooth_stop_stalled", 
+       "Stop Jacobian smoothing when the number of hexahedra");
+    options.AddToHelpMessage
+      (SMOOTH_STOP_STALLED_OPT, 
+       "with Jacobian below the Jacobian threshold stops decreasing.");
+
+    options.AddOption1Arg
+      (SMOOTH_TIME_LIMIT_OPT, "SMOOTH_TIME_LIMIT_OPT", REGULAR_OPTG, 
+       "-smooth_time_limit", "T", 
+       "Stop each smoothing pass after T wall clock seconds.");
+    options.AddToHelpMessage
+      (SMOOTH_TIME_LIMIT_OPT, 
+       "The iteration in progress is completed.",
+       "Use -info to report iterations and why smoothing stopped.");
+
+    options.AddOptionNoArg
+      (JACOBIAN_GRADIENT_OPT, "JACOBIAN_GRADIENT_OPT", REGULAR_OPTG, 
+       "-jacobian_gradient", 
+       "Move interior vertices along the analytic gradient of the min");
+    options.AddToHelpMessage
+      (JACOBIAN_GRADIENT_OPT, 
+       "Jacobian with a line search in -lsmooth_jacobian and",
+       "-gsmooth_jacobian.  Default is probing candidate positions.");
+
+    options.AddOptionNoArg
+      (REPAIR_JACOBIAN_OPT, "REPAIR_JACOBIAN_OPT", REGULAR_OPTG, 
+       "-repair_jacobian", 
+       "After smoothing, repair hexahedra with Jacobian below");
+    options.AddToHelpMessage
+      (REPAIR_JACOBIAN_OPT, 
+       "the Jacobian threshold, worst hexahedron first.");
+
+    options.AddOption1Arg
+      (REPAIR_BUDGET_MS_OPT, "REPAIR_BUDGET_MS_OPT", REGULAR_OPTG, 
+       "-repair_budget_ms", "T", 
+       "Stop -repair_jacobian after T wall clock milliseconds.");
+    options.AddToHelpMessage
+      (REPAIR_BUDGET_MS_OPT, 
+       "The hexahedron repair in progress is completed.");
+
+    options.AddUsageOptionNewline(REGULAR_OPTG);
+
     options.AddOption1Arg
       (SPLIT_HEX_THRESHOLD_OPT, "SPLIT_HEX_THRESHOLD_OPT", REGULAR_OPTG, 
        "-split_hex_threshold", "S", 
@@ -399,6 +486,108 @@ namespace {
        "away from grid facets.");
     options.AddSynonym(EXPAND_THIN_REGIONS_OPT, "-expand_thin");
 
+    options.AddUsageOptionNewline(REGULAR_OPTG);
+
+    options.AddOption1Arg
+      (THREADS_OPT, "THREADS_OPT", REGULAR_OPTG, "-threads", "{N}",
+       "Encode grid and extract interval volume using N threads.");
+    options.AddToHelpMessage
+      (THREADS_OPT, 
+       "Grid is split into slabs which are processed in parallel.",
+       "Output is identical to output using one thread.");
+
+    options.AddOption1Arg
+      (BLOCK_EDGE_LENGTH_OPT, "BLOCK_EDGE_LENGTH_OPT", REGULAR_OPTG, 
+       "-block_edge_length", "{L}",
+       "Skip grid blocks with L edges per block edge");
+    options.AddToHelpMessage
+      (BLOCK_EDGE_LENGTH_OPT, 
+       "whose scalar values are all below the lower isovalue",
+       "or all above the upper isovalue.");
+    options.AddToHelpMessage
+      (BLOCK_EDGE_LENGTH_OPT, 
+       "Block min/max values are computed once and reused",
+       "for every pair of isovalues.",
+       "L = 0 disables block skipping.  Default L = 16.");
+
+    options.AddOption1Arg
+      (TABLE_FILE_OPT, "TABLE_FILE_OPT", REGULAR_OPTG, 
+       "-table_file", "{F}",
+       "Read interval volume lookup table from binary file F.");
+    options.AddToHelpMessage
+      (TABLE_FILE_OPT, 
+       "If F does not exist or contains a different table,",
+       "create the table and write it to F.");
+
+    options.AddOptionNoArg
+      (MULTI_INTERVAL_OPT, "MULTI_INTERVAL_OPT", REGULAR_OPTG, 
+       "-multi_interval", 
+       "Classify grid vertices once for all intervals.");
+    options.AddToHelpMessage
+      (MULTI_INTERVAL_OPT, 
+       "Grid vertices are classified into bands between consecutive",
+       "isovalues and the active cubes of every interval are found",
+       "in a single pass over the scalar grid.",
+       "Isovalues must be strictly increasing.");
+    options.AddToHelpMessage
+      (MULTI_INTERVAL_OPT, 
+       "Output is identical to output without -multi_interval.");
+
+    options.AddOptionNoArg
+      (INCREMENTAL_OPT, "INCREMENTAL_OPT", REGULAR_OPTG, 
+       "-incremental", 
+       "Update the classification of the previous interval.");
+    options.AddToHelpMessage
+      (INCREMENTAL_OPT, 
+       "Only grid vertices with scalar values between the previous",
+       "and the current isovalues are reclassified and only cubes",
+       "incident on those vertices are updated.");
+    options.AddToHelpMessage
+      (INCREMENTAL_OPT, 
+       "Output is identical to output without -incremental.");
+
+    options.AddOption1Arg
+      (STREAM_SLAB_OPT, "STREAM_SLAB_OPT", REGULAR_OPTG, 
+       "-stream_slab", "{N}",
+       "Read the grid in z-slabs of N vertex layers and construct");
+    options.AddToHelpMessage
+      (STREAM_SLAB_OPT, 
+       "the interval volume slab by slab.",
+       "Only one slab is in memory at a time.",
+       "Requires a 3D nrrd file with raw encoding.");
+    options.AddToHelpMessage
+      (STREAM_SLAB_OPT, 
+       "Output is a Geomview OFF file.  Options which subsample",
+       "the grid or improve the mesh are not supported.");
+
+    options.AddOption1Arg
+      (CUBE_INDEX_OPT, "CUBE_INDEX_OPT", REGULAR_OPTG, 
+       "-cube_index", "{auto|dense|sparse}",
+       "Method for locating active cubes.");
+    iarg = options.AddArgChoice
+      (CUBE_INDEX_OPT, "auto", 
+       "Use sparse if few grid cubes are active.  (Default.)");
+    iarg = options.AddArgChoice
+      (CUBE_INDEX_OPT, "dense", 
+       "Use arrays with one entry per grid vertex.");
+    iarg = options.AddArgChoice
+      (CUBE_INDEX_OPT, "sparse", 
+       "Use a hash table with size proportional");
+    options.AddToHelpArgMessage
+      (CUBE_INDEX_OPT, iarg,
+       "to the number of active cubes.");
+    options.AddToHelpMessage
+      (CUBE_INDEX_OPT, 
+       "Output is identical for all methods.");
+
+    options.AddOption1Arg
+      (PROFILE_OPT, "PROFILE_OPT", REGULAR_OPTG, 
+       "-profile", "{F}",
+       "Write wall and cpu time of each stage to file {F}.");
+    options.AddToHelpMessage
+      (PROFILE_OPT, 
+       "File is CSV if {F} ends in \".csv\" and JSON otherwise.");
+
     options.AddUsageOptionNewline(REGULAR_OPTG);
     options.AddUsageOptionBeginOr(REGULAR_OPTG);
 
@@ -809,6 +998,10 @@ bool process_option
     iarg++;
     break;
 
+  case LSMOOTH_ELENGTH_COLOR_OPT:
+    io_info.flag_lsmooth_elength_color = true;
+    break;
+
   case LSMOOTH_JACOBIAN_OPT:
     io_info.lsmooth_jacobian_iter = get_arg_int(iarg, argc, argv, error);
     io_info.flag_lsmooth_jacobian = true;
@@ -831,6 +1024,33 @@ bool process_option
     iarg++;
     break;
 
+  case SMOOTH_EPSILON_OPT:
+    io_info.smooth_move_epsilon = get_arg_float(iarg, argc, argv, error);
+    iarg++;
+    break;
+
+  case SMOOTH_STOP_STALLED_OPT:
+    io_info.flag_smooth_stop_stalled = true;
+    break;
+
+  case SMOOTH_TIME_LIMIT_OPT:
+    io_info.smooth_time_limit = get_arg_float(iarg, argc, argv, error);
+    iarg++;
+    break;
+
+  case JACOBIAN_GRADIENT_OPT:
+    io_info.flag_jacobian_gradient = true;
+    break;
+
+  case REPAIR_JACOBIAN_OPT:
+    io_info.flag_repair_jacobian = true;
+    break;
+
+  case REPAIR_BUDGET_MS_OPT:
+    io_info.repair_budget_ms = get_arg_float(iarg, argc, argv, error);
+    iarg++;
+    break;
+
   case SPLIT_HEX_THRESHOLD_OPT:
     io_info.split_hex_threshold = get_arg_float(iarg, argc, argv, error);
     iarg++;
@@ -849,6 +1069,48 @@ bool process_option
     io_info.flag_expand_thin_regions = true;
     break;
 
+  case THREADS_OPT:
+    io_info.num_threads = get_arg_int(iarg, argc, argv, error);
+    iarg++;
+    break;
+
+  case BLOCK_EDGE_LENGTH_OPT:
+    io_info.block_edge_length = get_arg_int(iarg, argc, argv, error);
+    iarg++;
+    break;
+
+  case TABLE_FILE_OPT:
+    iarg++;
+    if (iarg >= argc) usage_error();
+    io_info.table_filename = argv[iarg];
+    break;
+
+  case MULTI_INTERVAL_OPT:
+    io_info.flag_multi_interval = true;
+    break;
+
+  case INCREMENTAL_OPT:
+    io_info.flag_incremental = true;
+    break;
+
+  case CUBE_INDEX_OPT:
+    iarg++;
+    if (iarg >= argc) usage_error();
+    io_info.cube_index_method = get_cube_index_method(argv[iarg]);
+    break;
+
+  case STREAM_SLAB_OPT:
+    io_info.stream_slab_thickness = get_arg_int(iarg, argc, argv, error);
+    iarg++;
+    break;
+
+  case PROFILE_OPT:
+    iarg++;
+    if (iarg >= argc) usage_error();
+    io_info.profile_filename = argv[iarg];
+    io_info.flag_write_profile = true;
+    break;
+
   case OFF_OPT:
     io_info.flag_output_off = true;
     io_info.is_file_format_set = true;
@@ -1008,6 +1270,24 @@ void process_io_info(IO_INFO_TYPE & io_info)
     exit(230);
   };
 
+  if (io_info.num_threads < 1) {
+    cerr << "Error.  Number of threads must be a positive integer."
+         << endl;
+    exit(230);
+  };
+
+  if (io_info.block_edge_length < 0) {
+    cerr << "Error.  Block edge length must be a non-negative integer."
+         << endl;
+    exit(230);
+  };
+
+  if (io_info.stream_slab_thickness < 0) {
+    cerr << "Error.  Stream slab thickness must be a non-negative integer."
+         << endl;
+    exit(230);
+  };
+
   if (io_info.output_filename != "" && io_info.flag_use_stdout) {
     cerr << "Error.  Can't use both -o and -stdout parameters."
          << endl;
@@ -2106,6 +2386,34 @@ void IVOLDUAL::report_ivol_info
     // print total number of changes for eliminating non-manifold
     report_non_manifold_changes(ivoldual_info); 
   }
+
+  if (output_info.flag_lsmooth_elength) {
+    report_smooth_info
+      ("Laplacian edge length smoothing", 
+       ivoldual_info.lsmooth_elength_info);
+  }
+  if (output_info.flag_lsmooth_jacobian) {
+    report_smooth_info
+      ("Laplacian Jacobian smoothing", ivoldual_info.lsmooth_jacobian_info);
+  }
+  else if (output_info.flag_gsmooth_jacobian) {
+    report_smooth_info
+      ("Gradient Jacobian smoothing", ivoldual_info.gsmooth_jacobian_info);
+  }
+  if (output_info.flag_repair_jacobian) {
+    report_smooth_info
+      ("Worst first Jacobian repair", ivoldual_info.repair_jacobian_info);
+  }
+}
+
+
+/// Report number of smoothing iterations and why smoothing stopped.
+void IVOLDUAL::report_smooth_info
+(const char * smooth_name, const IVOLDUAL_SMOOTH_INFO & smooth_info)
+{
+  std::cout << "    " << smooth_name << ": "
+            << smooth_info.num_iterations << " iterations, stopped on " 
+            << smooth_info.StopReasonName() << "." << std::endl;
 }
 
 
@@ -2427,6 +2735,89 @@ void IVOLDUAL::report_time
        << " seconds." << endl;
 }
 
+
+// Write per-stage profile to io_info.profile_filename.
+void IVOLDUAL::write_profile
+(const IO_INFO & io_info, const IVOLDUAL_PROFILE & profile,
+ const double total_elapsed_time)
+{
+  string prefix, suffix;
+  ofstream output_file;
+  PROCEDURE_ERROR error("write_profile");
+
+  IJK::split_string(io_info.profile_filename, '.', prefix, suffix);
+  const bool flag_csv = (suffix == "csv");
+
+  output_file.open(io_info.profile_filename.c_str(), ios::out);
+  if (!output_file.good()) {
+    error.AddMessage
+      ("Unable to open profile file ", io_info.profile_filename, ".");
+    throw error;
+  }
+
+  output_file << setprecision(9);
+
+  if (flag_csv) {
+    output_file << "stage,wall_seconds,cpu_seconds,count" << endl;
+    for (int i = 0; i < NUM_PROFILE_STAGES; i++) {
+      const PROFILE_STAGE stage = PROFILE_STAGE(i);
+      if (profile.Count(stage) == 0) { continue; }
+      output_file << IVOLDUAL_PROFILE::StageName(stage) << ","
+                  << profile.Wall(stage) << ","
+                  << profile.Cpu(stage) << ","
+                  << profile.Count(stage) << endl;
+    }
+    output_file << "total," << profile.TotalWall() << ","
+                << profile.TotalCpu() << ",1" << endl;
+    output_file << "elapsed," << total_elapsed_time << ",,1" << endl;
+  }
+  else {
+    output_file << "{" << endl;
+    output_file << "  \"input_filename\": \"";
+    for (unsigned int i = 0; i < io_info.input_filename.size(); i++) {
+      const char c = io_info.input_filename[i];
+      if (c == '"' || c == '\\') { output_file << '\\'; }
+      output_file << c;
+    }
+    output_file << "\"," << endl;
+    output_file << "  \"isovalues\": [";
+    for (unsigned int i = 0; i < io_info.isovalue.size(); i++) {
+      if (i > 0) { output_file << ", "; }
+      output_file << io_info.isovalue[i];
+    }
+    output_file << "]," << endl;
+    output_file << "  \"num_threads\": " << io_info.num_threads 
+                << "," << endl;
+    output_file << "  \"stages\": {";
+
+    bool flag_first = true;
+    for (int i = 0; i < NUM_PROFILE_STAGES; i++) {
+      const PROFILE_STAGE stage = PROFILE_STAGE(i);
+      if (profile.Count(stage) == 0) { continue; }
+      if (!flag_first) { output_file << ","; }
+      output_file << endl;
+      output_file << "    \"" << IVOLDUAL_PROFILE::StageName(stage) << "\": "
+                  << "{ \"wall\": " << profile.Wall(stage)
+                  << ", \"cpu\": " << profile.Cpu(stage)
+                  << ", \"count\": " << profile.Count(stage) << " }";
+      flag_first = false;
+    }
+    output_file << endl << "  }," << endl;
+    output_file << "  \"total_wall\": " << profile.TotalWall() 
+                << "," << endl;
+    output_file << "  \"total_cpu\": " << profile.TotalCpu() 
+                << "," << endl;
+    output_file << "  \"elapsed\": " << total_elapsed_time << endl;
+    output_file << "}" << endl;
+  }
+
+  output_file.close();
+
+  if (!io_info.flag_silent) {
+    cout << "Wrote profile to file: " << io_info.profile_filename << endl;
+  }
+}
+
 // **************************************************
 // USAGE/HELP MESSAGES
 // **************************************************
@@ -2565,12 +2956,14 @@ void IVOLDUAL::IO_INFO::Init()
   flag_report_all_isov = false;
   flag_report_all_ivol_poly = false;
   flag_write_scalar = false;
+  flag_write_profile = false;
   subsample_resolution = 2;
   flag_supersample = false;
   supersample_resolution = 2;
   flag_subdivide = false;
   flag_rm_diag_ambig = false;
   flag_add_outer_layer = false;
+  stream_slab_thickness = 0;
   flag_color_alternating = false;  // color simplices in alternating cubes
   flag_color_vert = false;         // color isosurface boundary vertices
   region_length = 1;
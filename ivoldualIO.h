@@ -23,6 +23,7 @@
 #ifndef _IVOLDUALIO_
 #define _IVOLDUALIO_
 
+#include <chrono>
 #include <ctime>
 #include <string>
 
@@ -91,12 +92,25 @@ namespace IVOLDUAL {
     std::string report_ivol_poly_filename;
     bool flag_write_scalar;
     std::string write_scalar_filename;
+
+    /// Write per-stage wall and cpu times to profile_filename.
+    /// - Profile is CSV if profile_filename ends in ".csv",
+    ///   and JSON otherwise.
+    bool flag_write_profile;
+    std::string profile_filename;
     int subsample_resolution;
     bool flag_supersample;
     int supersample_resolution;
     bool flag_subdivide;
     bool flag_rm_diag_ambig;
     bool flag_add_outer_layer;
+
+    /// Number of grid vertex layers in each z-slab in streaming mode.
+    /// - If stream_slab_thickness is positive, read the nrrd file
+    ///   and construct the interval volume slab by slab.
+    /// - If stream_slab_thickness is 0, read the entire nrrd file.
+    AXIS_SIZE_TYPE stream_slab_thickness;
+
     bool flag_color_alternating;  ///< Color simplices in alternating cubes
     int region_length;
 
@@ -200,18 +214,19 @@ namespace IVOLDUAL {
   };
 
   /// Elapsed wall time.
+  /// - Uses a monotonic clock with sub-second resolution.
   class ELAPSED_TIME {
 
   protected:
-    time_t t;
+    std::chrono::steady_clock::time_point t;
 
   public:
-    ELAPSED_TIME() { time(&t);  };
+    ELAPSED_TIME() { t = std::chrono::steady_clock::now();  };
 
     double getElapsed() {
-      time_t old_t = t;
-      time(&t);
-      return(difftime(t,old_t));
+      const std::chrono::steady_clock::time_point old_t = t;
+      t = std::chrono::steady_clock::now();
+      return(std::chrono::duration<double>(t-old_t).count());
     };
   };
 
@@ -527,6 +542,10 @@ namespace IVOLDUAL {
   /// Report number of changes for eliminating non-manifold
   void report_non_manifold_changes(const IVOLDUAL_INFO & dualiso_info);
 
+  /// Report number of smoothing iterations and why smoothing stopped.
+  void report_smooth_info
+  (const char * smooth_name, const IVOLDUAL_SMOOTH_INFO & smooth_info);
+
   void warn_non_manifold(const IO_INFO & io_info);
 
 
@@ -575,6 +594,13 @@ namespace IVOLDUAL {
     (const IO_INFO & io_info, const IO_TIME & io_time, 
      const DUALISO_TIME & dualiso_time, const double total_elapsed_time);
 
+  /// Write per-stage profile to io_info.profile_filename.
+  /// - Writes CSV if the filename ends in ".csv", and JSON otherwise.
+  /// - Stages with zero count are omitted.
+  void write_profile
+    (const IO_INFO & io_info, const IVOLDUAL_PROFILE & profile,
+     const double total_elapsed_time);
+
 
   // **************************************************
   // USAGE/HELP MESSAGES
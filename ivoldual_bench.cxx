@@ -0,0 +1,668 @@
+/// \file ivoldual_bench.cxx
+/// Benchmark interval volume construction on synthetic scalar fields.
+
+/*
+  IJK: Isosurface Jeneration Kode
+  Copyright (C) 2018 Rephael Wenger
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public License
+  (LGPL) as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <sys/resource.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ivoldual.h"
+#include "ivoldualtable.h"
+#include "ivoldual_thread.txx"
+
+using namespace IJK;
+using namespace IVOLDUAL;
+
+using namespace std;
+
+
+// **************************************************
+// TYPES
+// **************************************************
+
+typedef enum { SPHERE_FIELD, TORI_FIELD, GYROID_FIELD, NOISE_FIELD,
+               AMBIG_FIELD, NUM_FIELDS } FIELD_TYPE;
+
+typedef enum { EXTRACT_FLAGS, SPLIT_FLAGS, LSMOOTH_FLAGS, GSMOOTH_FLAGS,
+               NUM_FLAG_SETS } FLAG_SET;
+
+// Benchmark parameters.
+class BENCH_INFO {
+
+public:
+  std::vector<FIELD_TYPE> field;
+  std::vector<AXIS_SIZE_TYPE> size;
+  std::vector<FLAG_SET> flag_set;
+  int num_threads;
+  int num_repeat;
+  AXIS_SIZE_TYPE block_edge_length;
+  unsigned int seed;
+  bool flag_csv;
+
+  BENCH_INFO()
+  {
+    num_threads = 1;
+    num_repeat = 1;
+    block_edge_length = 16;
+    seed = 1;
+    flag_csv = false;
+  }
+};
+
+
+// **************************************************
+// LOCAL SUBROUTINES
+// **************************************************
+
+void parse_command_line(int argc, char **argv, BENCH_INFO & bench_info);
+void run_benchmark
+(const BENCH_INFO & bench_info, const FIELD_TYPE field,
+ const AXIS_SIZE_TYPE size);
+void usage_error(), help();
+
+
+// **************************************************
+// MAIN
+// **************************************************
+
+int main(int argc, char **argv)
+{
+  BENCH_INFO bench_info;
+
+  try {
+
+    parse_command_line(argc, argv, bench_info);
+
+    if (bench_info.flag_csv) {
+      cout << "field,size,flags,threads,stage,wall_seconds,cpu_seconds,"
+           << "count,mcubes_per_second,khex_per_second,"
+           << "num_hex,peak_rss_mb" << endl;
+    }
+
+    for (int i = 0; i < bench_info.size.size(); i++) {
+      for (int j = 0; j < bench_info.field.size(); j++)
+        { run_benchmark(bench_info, bench_info.field[j], bench_info.size[i]); }
+    }
+
+  }
+  catch (ERROR & error) {
+    if (error.NumMessages() == 0) {
+      cerr << "Unknown error." << endl;
+    }
+    else { error.Print(cerr); }
+    cerr << "Exiting." << endl;
+    exit(20);
+  }
+  catch (...) {
+    cerr << "Unknown error." << endl;
+    exit(50);
+  };
+
+}
+
+
+// **************************************************
+// SYNTHETIC SCALAR FIELDS
+// **************************************************
+
+namespace {
+
+  const char * field_name[NUM_FIELDS] =
+    { "sphere", "tori", "gyroid", "noise", "ambig" };
+
+  const char * flag_set_name[NUM_FLAG_SETS] =
+    { "extract", "split", "lsmooth", "gsmooth" };
+
+  const double PI = 3.14159265358979323846;
+
+  // Isovalues of the benchmark interval volume of each field.
+  // - Fields are evaluated in unit cube coordinates, so the interval
+  //   volume has the same shape at every grid size.
+  const SCALAR_TYPE field_isovalue[NUM_FIELDS][2] =
+    { { 0.25, 0.35 }, { 0.02, 0.05 }, { -0.4, 0.4 },
+      { -0.05, 0.05 }, { -0.5, 0.5 } };
+
+
+  // Hash integer coordinates to [0,2^32).
+  inline unsigned int hash_coord
+  (const unsigned int seed, const int x, const int y, const int z)
+  {
+    unsigned int h = seed*0x9E3779B1u;
+    h ^= unsigned(x)*0x85EBCA77u;  h = (h << 13) | (h >> 19);
+    h ^= unsigned(y)*0xC2B2AE3Du;  h = (h << 13) | (h >> 19);
+    h ^= unsigned(z)*0x27D4EB2Fu;
+    h ^= h >> 16;  h *= 0x85EBCA6Bu;
+    h ^= h >> 13;  h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return(h);
+  }
+
+  // Dot product of offset (dx,dy,dz) with one of 12 cube edge directions.
+  inline double gradient_dot
+  (const unsigned int h, const double dx, const double dy, const double dz)
+  {
+    switch(h % 12) {
+    case 0:  return(dx+dy);
+    case 1:  return(-dx+dy);
+    case 2:  return(dx-dy);
+    case 3:  return(-dx-dy);
+    case 4:  return(dx+dz);
+    case 5:  return(-dx+dz);
+    case 6:  return(dx-dz);
+    case 7:  return(-dx-dz);
+    case 8:  return(dy+dz);
+    case 9:  return(-dy+dz);
+    case 10: return(dy-dz);
+    default: return(-dy-dz);
+    }
+  }
+
+  inline double fade(const double t)
+  { return(t*t*t*(t*(t*6-15)+10)); }
+
+  inline double lerp(const double t, const double a, const double b)
+  { return(a + t*(b-a)); }
+
+  // Perlin-style gradient noise in [-1,1].
+  double gradient_noise
+  (const unsigned int seed, const double x, const double y, const double z)
+  {
+    const int ix = int(std::floor(x));
+    const int iy = int(std::floor(y));
+    const int iz = int(std::floor(z));
+    const double fx = x - ix;
+    const double fy = y - iy;
+    const double fz = z - iz;
+    const double u = fade(fx);
+    const double v = fade(fy);
+    const double w = fade(fz);
+    double c[2][2][2];
+
+    for (int k = 0; k < 2; k++)
+      for (int j = 0; j < 2; j++)
+        for (int i = 0; i < 2; i++) {
+          const unsigned int h = hash_coord(seed, ix+i, iy+j, iz+k);
+          c[k][j][i] = gradient_dot(h, fx-i, fy-j, fz-k);
+        }
+
+    return(lerp(w, lerp(v, lerp(u, c[0][0][0], c[0][0][1]),
+                        lerp(u, c[0][1][0], c[0][1][1])),
+                lerp(v, lerp(u, c[1][0][0], c[1][0][1]),
+                     lerp(u, c[1][1][0], c[1][1][1]))));
+  }
+
+  // Distance from (x,y,z) to torus with major radius R and minor radius r
+  //   around the z-axis.
+  inline double torus_distance
+  (const double x, const double y, const double z,
+   const double R, const double r)
+  {
+    const double q = std::sqrt(x*x+y*y) - R;
+    return(std::abs(std::sqrt(q*q+z*z) - r));
+  }
+
+  // Evaluate field at (x,y,z) in unit cube coordinates.
+  // - (ix,iy,iz) are the integer grid coordinates.
+  SCALAR_TYPE evaluate_field
+  (const FIELD_TYPE field, const unsigned int seed,
+   const double x, const double y, const double z,
+   const int ix, const int iy, const int iz)
+  {
+    switch(field) {
+
+    case SPHERE_FIELD:
+      {
+        const double dx = x-0.5, dy = y-0.5, dz = z-0.5;
+        return(std::sqrt(dx*dx+dy*dy+dz*dz));
+      }
+
+    case TORI_FIELD:
+      {
+        // Three nested tori around alternating axes.
+        const double dx = x-0.5, dy = y-0.5, dz = z-0.5;
+        double d = torus_distance(dx, dy, dz, 0.35, 0.05);
+        d = std::min(d, torus_distance(dy, dz, dx, 0.22, 0.05));
+        d = std::min(d, torus_distance(dz, dx, dy, 0.10, 0.04));
+        return(d);
+      }
+
+    case GYROID_FIELD:
+      {
+        const double K = 2*PI*4;
+        return(std::sin(K*x)*std::cos(K*y) + std::sin(K*y)*std::cos(K*z) +
+               std::sin(K*z)*std::cos(K*x));
+      }
+
+    case NOISE_FIELD:
+      {
+        // Four octaves of gradient noise.
+        double s = 0, amplitude = 0.5, frequency = 8;
+        for (int k = 0; k < 4; k++) {
+          s += amplitude*gradient_noise
+            (seed+k, frequency*x, frequency*y, frequency*z);
+          amplitude *= 0.5;
+          frequency *= 2;
+        }
+        return(s);
+      }
+
+    case AMBIG_FIELD:
+    default:
+      {
+        // Alternate values below isovalue0 and above isovalue1
+        //   so every grid facet is ambiguous.
+        const double perturb = (hash_coord(seed, ix, iy, iz) % 1024)/4096.0;
+        if ((ix+iy+iz)%2 == 0) { return(-1-perturb); }
+        else { return(1+perturb); }
+      }
+    }
+  }
+
+  // Set scalar_grid to size^3 samples of field.
+  void generate_field
+  (const FIELD_TYPE field, const AXIS_SIZE_TYPE size,
+   const unsigned int seed, const int num_threads,
+   DUALISO_SCALAR_GRID & scalar_grid)
+  {
+    const int DIM3(3);
+    const AXIS_SIZE_TYPE axis_size[DIM3] = { size, size, size };
+    const double scale = 1.0/(size-1);
+
+    scalar_grid.SetSize(DIM3, axis_size);
+    SCALAR_TYPE * scalar = scalar_grid.ScalarPtr();
+
+    run_on_thread_ranges
+      (num_threads, size,
+       [=](const int, const AXIS_SIZE_TYPE z0, const AXIS_SIZE_TYPE z1)
+       {
+         for (AXIS_SIZE_TYPE iz = z0; iz < z1; iz++)
+           for (AXIS_SIZE_TYPE iy = 0; iy < size; iy++) {
+             const VERTEX_INDEX iv0 = (VERTEX_INDEX(iz)*size + iy)*size;
+             for (AXIS_SIZE_TYPE ix = 0; ix < size; ix++) {
+               scalar[iv0+ix] = evaluate_field
+                 (field, seed, ix*scale, iy*scale, iz*scale, ix, iy, iz);
+             }
+           }
+       });
+  }
+
+  void set_flags
+  (const BENCH_INFO & bench_info, const FLAG_SET flag_set,
+   IVOLDUAL_DATA_FLAGS & flags)
+  {
+    flags.num_threads = bench_info.num_threads;
+    flags.block_edge_length = bench_info.block_edge_length;
+
+    if (flag_set != EXTRACT_FLAGS) {
+      flags.flag_split_ambig_pairs = true;
+      flags.flag_expand_thin_regions = true;
+    }
+
+    if (flag_set == LSMOOTH_FLAGS) {
+      flags.flag_lsmooth_elength = true;
+      flags.lsmooth_elength_iter = 2;
+      flags.flag_lsmooth_jacobian = true;
+      flags.lsmooth_jacobian_iter = 2;
+    }
+    else if (flag_set == GSMOOTH_FLAGS) {
+      // Gradient smoothing is skipped if flag_lsmooth_jacobian is set.
+      flags.flag_gsmooth_jacobian = true;
+      flags.gsmooth_jacobian_iter = 2;
+    }
+  }
+
+  // Peak resident set size in megabytes.
+  double peak_rss_mb()
+  {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) { return(0); }
+    // Linux reports ru_maxrss in kilobytes.
+    return(usage.ru_maxrss/1024.0);
+  }
+
+  void report_stage
+  (const BENCH_INFO & bench_info, const FIELD_TYPE field,
+   const AXIS_SIZE_TYPE size, const FLAG_SET flag_set,
+   const char * stage_name, const double wall, const double cpu,
+   const int count, const double num_cubes, const double num_hex,
+   const double rss)
+  {
+    const double mcubes_per_second = (wall > 0) ? num_cubes/wall/1.0e6 : 0;
+    const double khex_per_second = (wall > 0) ? num_hex/wall/1.0e3 : 0;
+
+    if (bench_info.flag_csv) {
+      cout << field_name[field] << "," << size << ","
+           << flag_set_name[flag_set] << "," << bench_info.num_threads << ","
+           << stage_name << "," << wall << "," << cpu << "," << count << ","
+           << mcubes_per_second << "," << khex_per_second << ","
+           << num_hex << "," << rss << endl;
+    }
+    else {
+      cout << "    " << left << setw(18) << stage_name << right
+           << setw(10) << wall << " s"
+           << setw(10) << cpu << " s cpu"
+           << setw(12) << mcubes_per_second << " Mcubes/s"
+           << setw(12) << khex_per_second << " Khex/s" << endl;
+    }
+  }
+
+}
+
+
+// **************************************************
+// RUN BENCHMARK
+// **************************************************
+
+void run_benchmark
+(const BENCH_INFO & bench_info, const FIELD_TYPE field,
+ const AXIS_SIZE_TYPE size)
+{
+  const int DIM3(3);
+  DUALISO_SCALAR_GRID scalar_grid;
+  IVOLDUAL_BLOCK_INDEX block_index;
+  std::vector<ISO_VERTEX_INDEX> ivolpoly_vert;
+  IVOLDUAL_POLY_INFO_ARRAY ivolpoly_info;
+  DUAL_IVOLVERT_ARRAY ivolv_list;
+  COORD_ARRAY vertex_coord;
+  IVOLDUAL_CONTEXT context;
+  IVOLDUAL_EXTRACT_OPTIONS options;
+  PROFILE_TIMER timer;
+
+  options.SetContext(context);
+  options.SetBlockIndex(block_index);
+
+  generate_field
+    (field, size, bench_info.seed, bench_info.num_threads, scalar_grid);
+  const double generate_time = timer.WallSeconds();
+
+  if (bench_info.block_edge_length > 0)
+    { block_index.Set(scalar_grid, bench_info.block_edge_length); }
+
+  const double num_cubes = scalar_grid.ComputeNumCubes();
+  const SCALAR_TYPE isovalue0 = field_isovalue[field][0];
+  const SCALAR_TYPE isovalue1 = field_isovalue[field][1];
+
+  if (!bench_info.flag_csv) {
+    cout << "Field " << field_name[field] << "  "
+         << size << "x" << size << "x" << size
+         << "  interval [" << isovalue0 << "," << isovalue1 << "]"
+         << "  threads " << bench_info.num_threads
+         << "  (generated in " << generate_time << " s)" << endl;
+  }
+
+  for (int j = 0; j < bench_info.flag_set.size(); j++) {
+    const FLAG_SET flag_set = bench_info.flag_set[j];
+    IVOLDUAL_DATA_FLAGS flags;
+    IVOLDUAL_INFO best_info(DIM3);
+    double best_time = -1;
+
+    set_flags(bench_info, flag_set, flags);
+
+    const IVOLDUAL_CUBE_TABLE & ivoldual_table =
+      get_ivoldual_cube_table(DIM3, flags.SeparateNegFlag(), "");
+
+    // Report the fastest of num_repeat runs.
+    for (int k = 0; k < bench_info.num_repeat; k++) {
+      IVOLDUAL_INFO ivoldual_info(DIM3);
+
+      ivolpoly_vert.clear();
+      ivolpoly_info.clear();
+      ivolv_list.clear();
+      vertex_coord.clear();
+
+      timer.Restart();
+      dual_contouring_interval_volume
+        (scalar_grid, isovalue0, isovalue1, ivoldual_table, flags, options,
+         ivolpoly_vert, ivolv_list, ivolpoly_info, vertex_coord, 
+         ivoldual_info);
+      const double t = timer.WallSeconds();
+
+      if (best_time < 0 || t < best_time) {
+        best_time = t;
+        best_info.profile = ivoldual_info.profile;
+      }
+    }
+
+    const IVOLDUAL_PROFILE & profile = best_info.profile;
+    const double num_hex = ivolpoly_info.size();
+    const double rss = peak_rss_mb();
+
+    if (!bench_info.flag_csv) {
+      cout << "  Flags " << flag_set_name[flag_set] << ":  "
+           << ivolpoly_info.size() << " hexahedra  "
+           << ivolv_list.size() << " vertices  "
+           << "peak RSS " << rss << " MB" << endl;
+    }
+
+    for (int i = 0; i < NUM_PROFILE_STAGES; i++) {
+      const PROFILE_STAGE stage = PROFILE_STAGE(i);
+      if (profile.Count(stage) == 0) { continue; }
+      report_stage
+        (bench_info, field, size, flag_set,
+         IVOLDUAL_PROFILE::StageName(stage), profile.Wall(stage),
+         profile.Cpu(stage), profile.Count(stage), num_cubes, num_hex, rss);
+    }
+    report_stage
+      (bench_info, field, size, flag_set, "total",
+       profile.TotalWall(), profile.TotalCpu(), 1, num_cubes, num_hex, rss);
+  }
+
+  if (!bench_info.flag_csv) { cout << endl; }
+}
+
+
+// **************************************************
+// PARSE COMMAND LINE
+// **************************************************
+
+namespace {
+
+  FIELD_TYPE get_field(const char * s)
+  {
+    for (int i = 0; i < NUM_FIELDS; i++) {
+      if (strcmp(s, field_name[i]) == 0)
+        { return(FIELD_TYPE(i)); }
+    }
+
+    cerr << "Error.  Illegal field " << s << "." << endl;
+    usage_error();
+    return(SPHERE_FIELD);
+  }
+
+  FLAG_SET get_flag_set(const char * s)
+  {
+    for (int i = 0; i < NUM_FLAG_SETS; i++) {
+      if (strcmp(s, flag_set_name[i]) == 0)
+        { return(FLAG_SET(i)); }
+    }
+
+    cerr << "Error.  Illegal flag set " << s << "." << endl;
+    usage_error();
+    return(EXTRACT_FLAGS);
+  }
+
+  int get_int(const int iarg, const int argc, char **argv)
+  {
+    if (iarg+1 >= argc) { usage_error(); }
+
+    char * end;
+    const long x = strtol(argv[iarg+1], &end, 10);
+    if (*end != '\0') {
+      cerr << "Error.  Argument of " << argv[iarg]
+           << " is not an integer." << endl;
+      usage_error();
+    }
+    return(int(x));
+  }
+
+}
+
+
+void parse_command_line(int argc, char **argv, BENCH_INFO & bench_info)
+{
+  int iarg = 1;
+  while (iarg < argc) {
+    const string s = argv[iarg];
+
+    if (s == "-field") {
+      iarg++;
+      if (iarg >= argc) { usage_error(); }
+      if (strcmp(argv[iarg], "all") == 0) {
+        for (int i = 0; i < NUM_FIELDS; i++)
+          { bench_info.field.push_back(FIELD_TYPE(i)); }
+      }
+      else
+        { bench_info.field.push_back(get_field(argv[iarg])); }
+    }
+    else if (s == "-size") {
+      const int size = get_int(iarg, argc, argv);
+      if (size < 2 || size > 1024) {
+        cerr << "Error.  Size must be in range [2,1024]." << endl;
+        usage_error();
+      }
+      bench_info.size.push_back(size);
+      iarg++;
+    }
+    else if (s == "-flags") {
+      iarg++;
+      if (iarg >= argc) { usage_error(); }
+      if (strcmp(argv[iarg], "all") == 0) {
+        for (int i = 0; i < NUM_FLAG_SETS; i++)
+          { bench_info.flag_set.push_back(FLAG_SET(i)); }
+      }
+      else
+        { bench_info.flag_set.push_back(get_flag_set(argv[iarg])); }
+    }
+    else if (s == "-threads") {
+      bench_info.num_threads = get_int(iarg, argc, argv);
+      iarg++;
+    }
+    else if (s == "-repeat") {
+      bench_info.num_repeat = std::max(1, get_int(iarg, argc, argv));
+      iarg++;
+    }
+    else if (s == "-block_edge_length") {
+      bench_info.block_edge_length = get_int(iarg, argc, argv);
+      iarg++;
+    }
+    else if (s == "-seed") {
+      bench_info.seed = get_int(iarg, argc, argv);
+      iarg++;
+    }
+    else if (s == "-csv")
+      { bench_info.flag_csv = true; }
+    else if (s == "-help")
+      { help(); }
+    else {
+      cerr << "Error.  Illegal option " << s << "." << endl;
+      usage_error();
+    }
+
+    iarg++;
+  }
+
+  // Defaults.
+  if (bench_info.field.size() == 0) {
+    for (int i = 0; i < NUM_FIELDS; i++)
+      { bench_info.field.push_back(FIELD_TYPE(i)); }
+  }
+  if (bench_info.size.size() == 0) {
+    bench_info.size.push_back(64);
+    bench_info.size.push_back(128);
+  }
+  if (bench_info.flag_set.size() == 0)
+    { bench_info.flag_set.push_back(EXTRACT_FLAGS); }
+}
+
+
+// **************************************************
+// USAGE/HELP MESSAGES
+// **************************************************
+
+void usage_msg(std::ostream & out)
+{
+  out << "Usage: ivoldual_bench [OPTIONS]" << endl;
+  out << "OPTIONS:" << endl;
+  out << "  [-field {sphere|tori|gyroid|noise|ambig|all}]..." << endl;
+  out << "  [-size {N}]... [-flags {extract|split|lsmooth|gsmooth|all}]..."
+      << endl;
+  out << "  [-threads {N}] [-repeat {N}] [-block_edge_length {N}]" << endl;
+  out << "  [-seed {S}] [-csv] [-help]" << endl;
+}
+
+void usage_error()
+{
+  usage_msg(cerr);
+  exit(10);
+}
+
+void help()
+{
+  usage_msg(cout);
+  cout << endl;
+  cout << "ivoldual_bench - Benchmark interval volume construction"
+       << " on synthetic scalar fields." << endl;
+  cout << endl;
+  cout << "  Each field is sampled on an N x N x N grid of the unit cube"
+       << endl
+       << "  so the interval volume has the same shape at every size."
+       << endl;
+  cout << "  Reports wall and cpu time of each stage, throughput in"
+       << endl
+       << "  millions of grid cubes and thousands of hexahedra per second,"
+       << endl
+       << "  and peak resident set size of the process." << endl;
+  cout << endl;
+  cout << "  -field {F}:  Synthetic field.  May be repeated.  Default all."
+       << endl;
+  cout << "     sphere:  Distance from center.  Spherical shell." << endl;
+  cout << "     tori:    Distance to three nested tori." << endl;
+  cout << "     gyroid:  Gyroid with four periods." << endl;
+  cout << "     noise:   Four octaves of Perlin-style gradient noise." << endl;
+  cout << "     ambig:   Alternating values.  Every cube is ambiguous."
+       << endl;
+  cout << "  -size {N}:  Grid size, 2 <= N <= 1024.  May be repeated."
+       << endl
+       << "     Default 64 and 128." << endl;
+  cout << "  -flags {S}:  Flag set.  May be repeated.  Default extract."
+       << endl;
+  cout << "     extract: No mesh improvement." << endl;
+  cout << "     split:   Split ambiguous pairs and expand thin regions."
+       << endl;
+  cout << "     lsmooth: split and Laplacian edge length and Jacobian"
+       << " smoothing." << endl;
+  cout << "     gsmooth: split and gradient Jacobian smoothing." << endl;
+  cout << "  -threads {N}:  Number of threads.  Default 1." << endl;
+  cout << "  -repeat {N}:  Report fastest of N runs.  Default 1." << endl;
+  cout << "  -block_edge_length {N}:  Block index edge length.  Default 16."
+       << endl;
+  cout << "  -seed {S}:  Seed for noise and ambig fields.  Default 1."
+       << endl;
+  cout << "  -csv:  Write one CSV line per stage." << endl;
+  cout << "  -help:  Print this help message." << endl;
+  exit(0);
+}
@@ -22,10 +22,276 @@
 */
 
 
+#include <cmath>
+
 #include "ijkcoord.txx"
 
 #include "ivoldual_compute.h"
 
+#if defined(__SSE2__) && !defined(IVOLDUAL_NO_SIMD)
+#define IVOLDUAL_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+
+// **************************************************
+// LOCAL HEXAHEDRON JACOBIAN ROUTINES
+// **************************************************
+
+namespace {
+
+  using IVOLDUAL::COORD_TYPE;
+  using IVOLDUAL::VERTEX_INDEX;
+
+  const int DIM3(3);
+  const int NUM_HEX_CORNERS(8);
+  const int NUM_HEX_EDGES(12);
+
+  // hex_edge_end[ie] = endpoints of hex edge ie.
+  // - Edges 4*d,...,4*d+3 are in direction d.
+  // - hex_edge_end[ie][1] = hex_edge_end[ie][0]^(1 << d).
+  constexpr int hex_edge_end[NUM_HEX_EDGES][2] =
+    { {0,1}, {2,3}, {4,5}, {6,7},
+      {0,2}, {1,3}, {4,6}, {5,7},
+      {0,4}, {1,5}, {2,6}, {3,7} };
+
+  // hex_corner_edge[k][d] = hex edge incident on corner k in direction d.
+  // - Edge is directed away from corner k if bit d of k is 0,
+  //   and towards corner k if bit d of k is 1.
+  constexpr int hex_corner_edge[NUM_HEX_CORNERS][DIM3] =
+    { {0,4,8}, {0,5,9}, {1,4,10}, {1,5,11},
+      {2,6,8}, {2,7,9}, {3,6,10}, {3,7,11} };
+
+  // Multiply determinant at corner k by corner_orient_factor[k]
+  //   to get correct sign of Jacobian determinant.
+  // - Same as orient_factor[] in 
+  //   IJK::compute_Jacobian_determinant_at_hex_vertex_3D.
+  constexpr COORD_TYPE corner_orient_factor[NUM_HEX_CORNERS] =
+    { 1, -1, -1, 1, -1, 1, 1, -1 };
+
+  // Compute the normalized Jacobian determinants at the eight corners
+  //   of hexahedron hex_vert[] with positive orientation.
+  // - Returns the same values as 
+  //   IJK::compute_normalized_Jacobian_determinant_at_hex_vertex_3D
+  //   with max_small_magnitude 0.
+  // - Each of the twelve hex edges and its length is computed once
+  //   and shared by its two endpoints.  Reversing an edge only
+  //   negates it, which is exact, so the determinants are unchanged.
+  // - Uses SSE2 to compute four corners at a time, if available.
+  //   Each lane performs the same operations as the scalar loop,
+  //   so the results are identical.
+  void compute_normalized_Jacobian_determinants_at_hex_corners
+  (const VERTEX_INDEX hex_vert[], const COORD_TYPE * vertex_coord,
+   COORD_TYPE Jacobian_determinant[NUM_HEX_CORNERS])
+  {
+#ifdef IVOLDUAL_USE_SSE2
+    // Lanes of lo[ic] and hi[ic] hold coordinate ic of corners 0-3 and 4-7.
+    __m128 lo[DIM3], hi[DIM3];
+    for (int ic = 0; ic < DIM3; ic++) {
+      const COORD_TYPE * c = vertex_coord + ic;
+      lo[ic] = _mm_setr_ps(c[hex_vert[0]*DIM3], c[hex_vert[1]*DIM3],
+                           c[hex_vert[2]*DIM3], c[hex_vert[3]*DIM3]);
+      hi[ic] = _mm_setr_ps(c[hex_vert[4]*DIM3], c[hex_vert[5]*DIM3],
+                           c[hex_vert[6]*DIM3], c[hex_vert[7]*DIM3]);
+    }
+
+    // Lane j of edge[d][ic] holds coordinate ic of hex edge 4*d+j.
+    __m128 edge[DIM3][DIM3];
+    for (int ic = 0; ic < DIM3; ic++) {
+      edge[0][ic] = 
+        _mm_sub_ps(_mm_shuffle_ps(lo[ic], hi[ic], _MM_SHUFFLE(3,1,3,1)),
+                   _mm_shuffle_ps(lo[ic], hi[ic], _MM_SHUFFLE(2,0,2,0)));
+      edge[1][ic] = 
+        _mm_sub_ps(_mm_shuffle_ps(lo[ic], hi[ic], _MM_SHUFFLE(3,2,3,2)),
+                   _mm_shuffle_ps(lo[ic], hi[ic], _MM_SHUFFLE(1,0,1,0)));
+      edge[2][ic] = _mm_sub_ps(hi[ic], lo[ic]);
+    }
+
+    __m128 edge_length[DIM3];
+    for (int d = 0; d < DIM3; d++) {
+      edge_length[d] = _mm_sqrt_ps
+        (_mm_add_ps(_mm_add_ps(_mm_mul_ps(edge[d][0], edge[d][0]),
+                               _mm_mul_ps(edge[d][1], edge[d][1])),
+                    _mm_mul_ps(edge[d][2], edge[d][2])));
+    }
+
+    // Negate lanes by flipping the sign bit.  Negation is exact.
+    const __m128 v_zero = _mm_setzero_ps();
+    const __m128 negate_odd = _mm_setr_ps(0.0f, -0.0f, 0.0f, -0.0f);
+    const __m128 negate_high = _mm_setr_ps(0.0f, 0.0f, -0.0f, -0.0f);
+    const __m128 negate_all = _mm_set1_ps(-0.0f);
+
+    // Lane j of J[d][ic] and L[d] is for corner 4*g+j.
+    for (int g = 0; g < 2; g++) {
+      __m128 J[DIM3][DIM3];
+      __m128 L[DIM3];
+
+      // Corners 4*g,...,4*g+3 use edges (2g,2g,2g+1,2g+1) in direction 0,
+      //   (4+2g,5+2g,4+2g,5+2g) in direction 1 and (8,9,10,11)
+      //   in direction 2.
+      if (g == 0) {
+        L[0] = _mm_unpacklo_ps(edge_length[0], edge_length[0]);
+        L[1] = _mm_movelh_ps(edge_length[1], edge_length[1]);
+        L[2] = edge_length[2];
+      }
+      else {
+        L[0] = _mm_unpackhi_ps(edge_length[0], edge_length[0]);
+        L[1] = _mm_movehl_ps(edge_length[1], edge_length[1]);
+        L[2] = edge_length[2];
+      }
+
+      for (int ic = 0; ic < DIM3; ic++) {
+        if (g == 0) {
+          J[0][ic] = _mm_unpacklo_ps(edge[0][ic], edge[0][ic]);
+          J[1][ic] = _mm_movelh_ps(edge[1][ic], edge[1][ic]);
+          J[2][ic] = edge[2][ic];
+        }
+        else {
+          J[0][ic] = _mm_unpackhi_ps(edge[0][ic], edge[0][ic]);
+          J[1][ic] = _mm_movehl_ps(edge[1][ic], edge[1][ic]);
+          J[2][ic] = _mm_xor_ps(edge[2][ic], negate_all);
+        }
+        J[0][ic] = _mm_xor_ps(J[0][ic], negate_odd);
+        J[1][ic] = _mm_xor_ps(J[1][ic], negate_high);
+      }
+
+      // Same operation order as IJK::determinant_3x3.
+      __m128 det, D;
+      D = _mm_sub_ps(_mm_mul_ps(J[1][1], J[2][2]), 
+                     _mm_mul_ps(J[1][2], J[2][1]));
+      det = _mm_mul_ps(J[0][0], D);
+      D = _mm_sub_ps(_mm_mul_ps(J[2][1], J[0][2]), 
+                     _mm_mul_ps(J[2][2], J[0][1]));
+      det = _mm_add_ps(det, _mm_mul_ps(J[1][0], D));
+      D = _mm_sub_ps(_mm_mul_ps(J[0][1], J[1][2]), 
+                     _mm_mul_ps(J[0][2], J[1][1]));
+      det = _mm_add_ps(det, _mm_mul_ps(J[2][0], D));
+
+      const __m128 orient = _mm_loadu_ps(corner_orient_factor+4*g);
+      const __m128 value = 
+        _mm_div_ps(_mm_mul_ps(det, orient),
+                   _mm_mul_ps(_mm_mul_ps(L[0], L[1]), L[2]));
+
+      // Zero if det == 0 or some edge length is not positive.
+      const __m128 L_positive =
+        _mm_and_ps(_mm_cmpgt_ps(L[0], v_zero),
+                   _mm_and_ps(_mm_cmpgt_ps(L[1], v_zero),
+                              _mm_cmpgt_ps(L[2], v_zero)));
+      const __m128 is_nonzero = 
+        _mm_and_ps(_mm_cmpneq_ps(det, v_zero), L_positive);
+      _mm_storeu_ps
+        (Jacobian_determinant+4*g, _mm_and_ps(is_nonzero, value));
+    }
+#else
+    const COORD_TYPE * corner_coord[NUM_HEX_CORNERS];
+    COORD_TYPE edge[NUM_HEX_EDGES][DIM3];
+    COORD_TYPE edge_length[NUM_HEX_EDGES];
+
+    for (int k = 0; k < NUM_HEX_CORNERS; k++)
+      { corner_coord[k] = vertex_coord + hex_vert[k]*DIM3; }
+
+    for (int ie = 0; ie < NUM_HEX_EDGES; ie++) {
+      const COORD_TYPE * v0coord = corner_coord[hex_edge_end[ie][0]];
+      const COORD_TYPE * v1coord = corner_coord[hex_edge_end[ie][1]];
+      for (int d = 0; d < DIM3; d++)
+        { edge[ie][d] = v1coord[d] - v0coord[d]; }
+      edge_length[ie] = std::sqrt
+        (edge[ie][0]*edge[ie][0] + edge[ie][1]*edge[ie][1] + 
+         edge[ie][2]*edge[ie][2]);
+    }
+
+    for (int k = 0; k < NUM_HEX_CORNERS; k++) {
+      COORD_TYPE J[DIM3][DIM3];
+      COORD_TYPE L[DIM3];
+
+      for (int d = 0; d < DIM3; d++) {
+        const int ie = hex_corner_edge[k][d];
+        L[d] = edge_length[ie];
+        if ((k & (1 << d)) == 0) {
+          J[d][0] = edge[ie][0];
+          J[d][1] = edge[ie][1];
+          J[d][2] = edge[ie][2];
+        }
+        else {
+          J[d][0] = -edge[ie][0];
+          J[d][1] = -edge[ie][1];
+          J[d][2] = -edge[ie][2];
+        }
+      }
+
+      // Same operation order as IJK::determinant_3x3.
+      COORD_TYPE det, D;
+      D = J[1][1]*J[2][2] - J[1][2]*J[2][1];
+      det = J[0][0]*D;
+      D = J[2][1]*J[0][2] - J[2][2]*J[0][1];
+      det += J[1][0]*D;
+      D = J[0][1]*J[1][2] - J[0][2]*J[1][1];
+      det += J[2][0]*D;
+
+      if (det == 0 || !(L[0] > 0 && L[1] > 0 && L[2] > 0)) 
+        { Jacobian_determinant[k] = 0; }
+      else {
+        Jacobian_determinant[k] = 
+          (det*corner_orient_factor[k])/(L[0]*L[1]*L[2]);
+      }
+    }
+#endif
+  }
+
+
+  // Compute the gradient of normalized Jacobian determinant J_k 
+  //   at hex corner k with respect to the coordinates of vertex iv.
+  // - J_k = f*det(E)/(L0*L1*L2) where row d of E is edge 
+  //   e_d = corner k^(1<<d) - corner k, L_d = |e_d| 
+  //   and f = corner_orient_factor[k].
+  // - dJ_k/de_d = f*C_d/(L0*L1*L2) - J_k*e_d/L_d^2, where C_d 
+  //   is the cross product of the other two rows (cyclic order).
+  // - e_d decreases with corner k and increases with corner k^(1<<d).
+  void compute_normalized_Jacobian_gradient_at_hex_corner
+  (const VERTEX_INDEX hex_vert[], const COORD_TYPE * vertex_coord,
+   const int k, const COORD_TYPE Jacobian_determinant, 
+   const VERTEX_INDEX iv, COORD_TYPE gradient[DIM3])
+  {
+    COORD_TYPE e[DIM3][DIM3];
+    COORD_TYPE L[DIM3];
+
+    IJK::set_coord_3D(0, gradient);
+
+    const COORD_TYPE * kcoord = vertex_coord + hex_vert[k]*DIM3;
+    for (int d = 0; d < DIM3; d++) {
+      const COORD_TYPE * coord = vertex_coord + hex_vert[k^(1 << d)]*DIM3;
+      IJK::subtract_coord_3D(coord, kcoord, e[d]);
+      L[d] = std::sqrt(e[d][0]*e[d][0] + e[d][1]*e[d][1] + e[d][2]*e[d][2]);
+    }
+
+    if (!(L[0] > 0 && L[1] > 0 && L[2] > 0)) { return; }
+
+    const COORD_TYPE scale = corner_orient_factor[k]/(L[0]*L[1]*L[2]);
+
+    for (int d = 0; d < DIM3; d++) {
+      const COORD_TYPE * e1 = e[(d+1)%DIM3];
+      const COORD_TYPE * e2 = e[(d+2)%DIM3];
+      const COORD_TYPE s = Jacobian_determinant/(L[d]*L[d]);
+      COORD_TYPE dJ_de[DIM3];
+
+      dJ_de[0] = scale*(e1[1]*e2[2] - e1[2]*e2[1]) - s*e[d][0];
+      dJ_de[1] = scale*(e1[2]*e2[0] - e1[0]*e2[2]) - s*e[d][1];
+      dJ_de[2] = scale*(e1[0]*e2[1] - e1[1]*e2[0]) - s*e[d][2];
+
+      if (hex_vert[k] == iv) 
+        { IJK::subtract_coord_3D(gradient, dJ_de, gradient); }
+      if (hex_vert[k^(1 << d)] == iv) 
+        { IJK::add_coord_3D(gradient, dJ_de, gradient); }
+    }
+  }
+
+}
+
+
+// **************************************************
+// HEXAHEDRON JACOBIAN
+// **************************************************
+
 // Compute min/max of the nine Jacobian matrix determinants of a hexahedron.
 void IVOLDUAL::compute_min_max_hexahedron_Jacobian_determinant
 (const std::vector<VERTEX_INDEX> & hex_vert,
@@ -85,10 +351,77 @@ void IVOLDUAL::compute_hexahedron_normalized_Jacobian_determinant
 
   COORD_TYPE max_small_magnitude(0.0);
   bool flag_zero;
-  IJK::CUBE_FACE_INFO<int,int,int> cube(DIM3);
+  static const IJK::CUBE_FACE_INFO<int,int,int> cube(DIM3);
 
   IJK::compute_normalized_Jacobian_determinant_at_hex_vertex_3D
     (hex_i_vert, POSITIVE_ORIENTATION, vcoord, cube, icorner,
       max_small_magnitude, Jacobian_determinant, flag_zero);
 }
 
+
+// Compute the normalized Jacobian matrix determinants of a hexahedron
+//   at all eight corners.
+void IVOLDUAL::compute_hexahedron_normalized_Jacobian_determinants
+(const std::vector<VERTEX_INDEX> & hex_vert,
+ const int ihex,
+ const std::vector<COORD_TYPE> & vertex_coord,
+ COORD_TYPE Jacobian_determinant[8])
+{
+  const VERTEX_INDEX * hex_i_vert = &(hex_vert[ihex*NUM_HEX_CORNERS]);
+  const COORD_TYPE * vcoord = IJK::vector2pointer(vertex_coord);
+
+  compute_normalized_Jacobian_determinants_at_hex_corners
+    (hex_i_vert, vcoord, Jacobian_determinant);
+}
+
+
+// Compute the minimum normalized Jacobian matrix determinant
+//   of a hexahedron and the corner where it is attained.
+void IVOLDUAL::compute_min_hexahedron_normalized_Jacobian_determinant
+(const std::vector<VERTEX_INDEX> & hex_vert,
+ const int ihex,
+ const std::vector<COORD_TYPE> & vertex_coord,
+ COORD_TYPE & min_Jacobian_determinant,
+ int & corner_with_min)
+{
+  COORD_TYPE Jacobian_determinant[NUM_HEX_CORNERS];
+
+  compute_hexahedron_normalized_Jacobian_determinants
+    (hex_vert, ihex, vertex_coord, Jacobian_determinant);
+
+  min_Jacobian_determinant = Jacobian_determinant[0];
+  corner_with_min = 0;
+  for (int k = 1; k < NUM_HEX_CORNERS; k++) {
+    if (Jacobian_determinant[k] < min_Jacobian_determinant) {
+      min_Jacobian_determinant = Jacobian_determinant[k];
+      corner_with_min = k;
+    }
+  }
+}
+
+
+// Compute the normalized Jacobian matrix determinants of a hexahedron
+//   and their gradients with respect to the coordinates of vertex iv.
+bool IVOLDUAL::compute_hexahedron_normalized_Jacobian_gradients
+(const std::vector<VERTEX_INDEX> & hex_vert,
+ const int ihex,
+ const std::vector<COORD_TYPE> & vertex_coord,
+ const VERTEX_INDEX iv,
+ COORD_TYPE Jacobian_determinant[8],
+ COORD_TYPE gradient[8][3])
+{
+  const VERTEX_INDEX * hex_i_vert = &(hex_vert[ihex*NUM_HEX_CORNERS]);
+  const COORD_TYPE * vcoord = IJK::vector2pointer(vertex_coord);
+  bool is_corner = false;
+
+  compute_normalized_Jacobian_determinants_at_hex_corners
+    (hex_i_vert, vcoord, Jacobian_determinant);
+
+  for (int k = 0; k < NUM_HEX_CORNERS; k++) {
+    compute_normalized_Jacobian_gradient_at_hex_corner
+      (hex_i_vert, vcoord, k, Jacobian_determinant[k], iv, gradient[k]);
+    if (hex_i_vert[k] == iv) { is_corner = true; }
+  }
+
+  return(is_corner);
+}
@@ -57,6 +57,48 @@ namespace IVOLDUAL {
    const int icorner,
    COORD_TYPE & Jacobian_determinant);
 
+  /// Compute the normalized Jacobian matrix determinants of 
+  /// a hexahedron at all eight corners.
+  /// - Gathers the hexahedron vertex coordinates once.
+  /// - Jacobian_determinant[k] equals the determinant computed by
+  ///   compute_hexahedron_normalized_Jacobian_determinant() at corner k.
+  /// - Uses SSE2 instructions, if available, to compute
+  ///   four corners at a time.
+  ///   Compile with -DIVOLDUAL_NO_SIMD to use only the scalar loop.
+  void compute_hexahedron_normalized_Jacobian_determinants
+  (const std::vector<VERTEX_INDEX> & hex_vert,
+   const int ihex,
+   const std::vector<COORD_TYPE> & vertex_coord,
+   COORD_TYPE Jacobian_determinant[8]);
+
+  /// Compute the minimum normalized Jacobian matrix determinant 
+  /// of a hexahedron over its eight corners.
+  /// @param[out] corner_with_min Lowest corner index 
+  ///   with the minimum determinant.
+  void compute_min_hexahedron_normalized_Jacobian_determinant
+  (const std::vector<VERTEX_INDEX> & hex_vert,
+   const int ihex,
+   const std::vector<COORD_TYPE> & vertex_coord,
+   COORD_TYPE & min_Jacobian_determinant,
+   int & corner_with_min);
+
+  /// Compute the normalized Jacobian matrix determinants of 
+  /// a hexahedron at all eight corners and their gradients 
+  /// with respect to the coordinates of vertex iv.
+  /// - Jacobian_determinant[k] equals the value computed by
+  ///   compute_hexahedron_normalized_Jacobian_determinants().
+  /// - gradient[k] is the gradient of Jacobian_determinant[k].
+  ///   It is zero if corner k and its three hex neighbors are not iv,
+  ///   or if an edge incident on corner k has zero length.
+  /// - Returns true if iv is a corner of the hexahedron.
+  bool compute_hexahedron_normalized_Jacobian_gradients
+  (const std::vector<VERTEX_INDEX> & hex_vert,
+   const int ihex,
+   const std::vector<COORD_TYPE> & vertex_coord,
+   const VERTEX_INDEX iv,
+   COORD_TYPE Jacobian_determinant[8],
+   COORD_TYPE gradient[8][3]);
+
 }
 
 #endif
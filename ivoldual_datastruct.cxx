@@ -20,9 +20,14 @@
   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 */
 
+#include <algorithm>
+
 #include "ivoldual_datastruct.h"
+#include "ivoldual_compute.h"
 #include "ijkgrid_macros.h"
+#include "ijkinterpolate.txx"
 #include "ivoldual_ivolpoly.txx"
+#include "ivoldual_thread.txx"
 #include "ivoldualtable.h"
 
 // **************************************************
@@ -43,8 +48,12 @@ void IVOLDUAL::IVOLDUAL_DATA_FLAGS::Init()
   flag_add_isov_dual_to_hexahedra = false;
   flag_orient_in = false;
   flag_lsmooth_elength = false;
+  flag_lsmooth_elength_color = false;
+  flag_smooth_stop_stalled = false;
+  flag_jacobian_gradient = false;
   flag_lsmooth_jacobian = false;
   flag_gsmooth_jacobian = false;
+  flag_repair_jacobian = false;
   flag_split_hex = false;
   flag_collapse_hex = false;
   flag_set_interior_code_from_scalar = false;
@@ -56,9 +65,19 @@ void IVOLDUAL::IVOLDUAL_DATA_FLAGS::Init()
   jacobian_threshold = 0.0;
   split_hex_threshold = 0.0;
   collapse_hex_threshold = 0.0;
+  smooth_move_epsilon = -1.0;
+  smooth_time_limit = 0.0;
+  repair_budget_ms = 0.0;
 
   flag_expand_thin_regions = false;
   thin_separation_distance = ONE_THIRD;
+
+  num_threads = 1;
+  block_edge_length = 16;
+  table_filename = "";
+  flag_multi_interval = false;
+  flag_incremental = false;
+  cube_index_method = AUTO_CUBE_INDEX;
 }
 
 // **************************************************
@@ -68,9 +87,695 @@ void IVOLDUAL::IVOLDUAL_DATA_FLAGS::Init()
 // Initialize
 void IVOLDUAL::IVOLDUAL_POLY_INFO::Init()
 {
+  flag_dual_to_edge = false;
+  flag_reverse_orient = false;
   flag_subdivide_hex = false;
+  v0 = 0;
+  edge_direction = 0;
+}
+
+// **************************************************
+// CLASS IVOLDUAL_BLOCK_INDEX
+// **************************************************
+
+// Compute min and max scalar values of each block.
+void IVOLDUAL::IVOLDUAL_BLOCK_INDEX::Set
+(const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+ const AXIS_SIZE_TYPE block_edge_length)
+{
+  ComputeMinMax(scalar_grid, block_edge_length);
+  SetContainsNaN(scalar_grid);
+}
+
+
+// Flag blocks containing a grid vertex with NaN scalar value.
+// - Grid vertex with coordinate c along an axis is in block c/L
+//   and, if c is a positive multiple of L, in block c/L-1.
+void IVOLDUAL::IVOLDUAL_BLOCK_INDEX::SetContainsNaN
+(const DUALISO_SCALAR_GRID_BASE & scalar_grid)
+{
+  const int dimension = scalar_grid.Dimension();
+  const AXIS_SIZE_TYPE L = BlockEdgeLength();
+  const int num_combinations = (1 << dimension);
+  IJK::ARRAY<GRID_COORD_TYPE> coord(dimension);
+  IJK::ARRAY<GRID_COORD_TYPE> block_coord(dimension);
+
+  flag_contains_nan.assign(NumRegions(), false);
+
+  for (VERTEX_INDEX iv = 0; iv < scalar_grid.NumVertices(); iv++) {
+    const SCALAR_TYPE s = scalar_grid.Scalar(iv);
+    if (s == s) { continue; }
+
+    scalar_grid.ComputeCoord(iv, coord.Ptr());
+    for (int k = 0; k < num_combinations; k++) {
+      bool flag_in_block = true;
+      for (int d = 0; d < dimension; d++) {
+        block_coord[d] = coord[d]/L;
+        if ((k >> d) & 1) {
+          if (coord[d] % L != 0 || block_coord[d] == 0) 
+            { flag_in_block = false; }
+          else
+            { block_coord[d]--; }
+        }
+        else if (block_coord[d] >= AxisSize(d)) 
+          { flag_in_block = false; }
+      }
+
+      if (flag_in_block) 
+        { flag_contains_nan[ComputeVertexIndex(block_coord.PtrConst())] = true; }
+    }
+  }
+}
+
+
+// Clear block index.
+void IVOLDUAL::IVOLDUAL_BLOCK_INDEX::Clear()
+{
+  region_edge_length = 0;
+  flag_contains_nan.clear();
+}
+
+
+// Return true if block index was computed from a grid
+//   with the same dimension and axis sizes as grid.
+bool IVOLDUAL::IVOLDUAL_BLOCK_INDEX::IsIndexOf
+(const DUALISO_GRID & grid) const
+{
+  if (!IsSet()) { return(false); }
+  if (Dimension() != grid.Dimension()) { return(false); }
+
+  for (int d = 0; d < Dimension(); d++) {
+    const AXIS_SIZE_TYPE num_blocks_along_axis =
+      IJK::compute_num_regions_along_axis
+      (grid.AxisSize(d), BlockEdgeLength());
+    if (AxisSize(d) != num_blocks_along_axis) { return(false); }
+  }
+
+  return(true);
+}
+
+
+// **************************************************
+// CLASS IVOLDUAL_ENCODED_BLOCKS
+// **************************************************
+
+// Set block encoding from block_index and isovalues.
+void IVOLDUAL::IVOLDUAL_ENCODED_BLOCKS::Set
+(const DUALISO_GRID & grid,
+ const IVOLDUAL_BLOCK_INDEX & block_index,
+ const IVOLDUAL::SCALAR_TYPE isovalue0, 
+ const IVOLDUAL::SCALAR_TYPE isovalue1)
+{
+  IJK::PROCEDURE_ERROR error("IVOLDUAL_ENCODED_BLOCKS::Set");
+
+  if (!block_index.IsSet()) {
+    SetAllActive(grid);
+    return;
+  }
+
+  if (!block_index.IsIndexOf(grid)) {
+    error.AddMessage
+      ("Programming error.  Block index does not match grid.");
+    error.AddMessage
+      ("  Recompute block index after changing the scalar grid.");
+    throw error;
+  }
+
+  SetSize(block_index);
+  block_edge_length = block_index.BlockEdgeLength();
+
+  // Encoding matches encode_scalar_values:
+  //   0 if s < isovalue0, else 3 if s > isovalue1.
+  // - If isovalue0 > isovalue1, a value s > isovalue1 may still
+  //   be below isovalue0, so both isovalues are compared
+  //   with the block min and max.
+  // - encode_scalar_values encodes NaN as interior, 
+  //   so blocks containing NaN are active.
+  GRID_VERTEX_ENCODING * block_code = ScalarPtr();
+  for (VERTEX_INDEX ib = 0; ib < NumVertices(); ib++) {
+    const IVOLDUAL::SCALAR_TYPE block_min = block_index.Min(ib);
+    const IVOLDUAL::SCALAR_TYPE block_max = block_index.Max(ib);
+    if (block_index.ContainsNaN(ib))
+      { block_code[ib] = ACTIVE_BLOCK; }
+    else if (block_max < isovalue0 && block_max <= isovalue1) 
+      { block_code[ib] = 0; }
+    else if (block_min >= isovalue0 && block_min > isovalue1)
+      { block_code[ib] = 3; }
+    else
+      { block_code[ib] = ACTIVE_BLOCK; }
+  }
+}
+
+
+// Set a single active block containing all of grid.
+void IVOLDUAL::IVOLDUAL_ENCODED_BLOCKS::SetAllActive
+(const DUALISO_GRID & grid)
+{
+  const int DIM3(3);
+  const int dimension = grid.Dimension();
+  IJK::LOCAL_ARRAY<AXIS_SIZE_TYPE,DIM3> num_blocks_along_axis(dimension, 1);
+
+  block_edge_length = 1;
+  for (int d = 0; d < dimension; d++) {
+    if (grid.AxisSize(d) > block_edge_length)
+      { block_edge_length = grid.AxisSize(d); }
+  }
+
+  SetSize(dimension, num_blocks_along_axis.PtrConst());
+  SetAll(ACTIVE_BLOCK);
+}
+
+
+// Return number of active blocks.
+IVOLDUAL::VERTEX_INDEX IVOLDUAL::IVOLDUAL_ENCODED_BLOCKS::CountActive() 
+  const
+{
+  VERTEX_INDEX num_active = 0;
+  for (VERTEX_INDEX ib = 0; ib < NumVertices(); ib++) {
+    if (IsActive(ib)) { num_active++; }
+  }
+  return(num_active);
+}
+
+
+// **************************************************
+// CLASS IVOLDUAL_BAND_GRID
+// **************************************************
+
+// Set thresholds and band encodings from list of isovalues.
+bool IVOLDUAL::IVOLDUAL_BAND_GRID::SetIsovalues
+(const IVOLDUAL::SCALAR_ARRAY & isovalue,
+ const bool flag_set_interior_code_from_scalar,
+ const GRID_VERTEX_ENCODING default_interior_code)
+{
+  // Thresholds per interval: lower isovalue and, optionally, average.
+  const int threshold_step = (flag_set_interior_code_from_scalar ? 2 : 1);
+
+  this->isovalue.clear();
+  threshold.clear();
+  interval_code.clear();
+  first_interval_from_above.clear();
+  end_interval_from_not_below.clear();
+
+  if (isovalue.size() < 2) { return(false); }
+
+  const int num_intervals = isovalue.size()-1;
+  for (int i = 0; i < num_intervals; i++) {
+    threshold.push_back(isovalue[i]);
+    if (flag_set_interior_code_from_scalar) {
+      // Same computation as encode_scalar_values_set_interior_from_scalar.
+      const IVOLDUAL::SCALAR_TYPE isovalue_average =
+        (isovalue[i]+isovalue[i+1])/2.0;
+      threshold.push_back(isovalue_average);
+    }
+  }
+  threshold.push_back(isovalue.back());
+
+  const int num_thresholds = threshold.size();
+  if (num_thresholds > MAX_NUM_THRESHOLDS) {
+    threshold.clear();
+    return(false);
+  }
+
+  for (int k = 0; k+1 < num_thresholds; k++) {
+    if (!(threshold[k] < threshold[k+1])) {
+      threshold.clear();
+      return(false);
+    }
+  }
+
+  this->isovalue = isovalue;
+
+  for (int b = 0; b < NUM_BANDS; b++) {
+    if (b == NAN_BAND) {
+      num_not_below[b] = num_thresholds;
+      num_above[b] = 0;
+    }
+    else if (b <= 2*num_thresholds) {
+      num_not_below[b] = (b+1)/2;
+      num_above[b] = b/2;
+    }
+    else {
+      // Unused band.
+      num_not_below[b] = num_thresholds;
+      num_above[b] = num_thresholds;
+    }
+  }
+
+  interval_code.resize(num_intervals*NUM_BANDS);
+  for (int i = 0; i < num_intervals; i++) {
+    const int j0 = i*threshold_step;
+    const int j1 = j0 + threshold_step;
+    GRID_VERTEX_ENCODING * code = interval_code.data() + i*NUM_BANDS;
+
+    for (int b = 0; b < NUM_BANDS; b++) {
+      if (num_not_below[b] <= j0)
+        { code[b] = 0; }
+      else if (num_above[b] > j1)
+        { code[b] = 3; }
+      else if (flag_set_interior_code_from_scalar)
+        { code[b] = ((num_not_below[b] <= j0+1) ? 1 : 2); }
+      else
+        { code[b] = default_interior_code; }
+    }
+  }
+
+  first_interval_from_above.resize(num_thresholds+1);
+  end_interval_from_not_below.resize(num_thresholds+1);
+  for (int k = 0; k <= num_thresholds; k++) {
+    int i = 0;
+    while (i < num_intervals && (i+1)*threshold_step < k) { i++; }
+    first_interval_from_above[k] = i;
+
+    i = 0;
+    while (i < num_intervals && i*threshold_step < k) { i++; }
+    end_interval_from_not_below[k] = i;
+  }
+
+  return(true);
+}
+
+
+// **************************************************
+// CLASS IVOLDUAL_INCREMENTAL_GRID
+// **************************************************
+
+// Set grid size and sort grid vertices by scalar value.
+void IVOLDUAL::IVOLDUAL_INCREMENTAL_GRID::SetScalarGrid
+(const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+ const bool flag_set_interior_code_from_scalar,
+ const GRID_VERTEX_ENCODING default_interior_code)
+{
+  const IVOLDUAL::SCALAR_TYPE * scalar = scalar_grid.ScalarPtrConst();
+
+  SetSize(scalar_grid);
+  this->flag_set_interior_code_from_scalar =
+    flag_set_interior_code_from_scalar;
+  this->default_interior_code = default_interior_code;
+  flag_encoded = false;
+  num_reclassified = 0;
+  num_updated_cubes = 0;
+  active_cube_list.clear();
+  dual_edge_list.clear();
+  dual_vertex_list.clear();
+
+  // Sort as in IJK::sort_grid_vertices, but skip NaN values
+  //   which cannot be compared.
+  sorted_vertex.clear();
+  for (VERTEX_INDEX iv = 0; iv < scalar_grid.NumVertices(); iv++) {
+    if (scalar[iv] == scalar[iv])
+      { sorted_vertex.push_back(iv); }
+  }
+  std::sort(sorted_vertex.begin(), sorted_vertex.end(),
+            IJK::SCALAR_LESS_THAN<IVOLDUAL::SCALAR_TYPE>(scalar));
+
+  sorted_scalar.resize(sorted_vertex.size());
+  for (VERTEX_INDEX i = 0; i < sorted_vertex.size(); i++)
+    { sorted_scalar[i] = scalar[sorted_vertex[i]]; }
+}
+
+
+// Return range [ibegin,iend) of sorted vertices
+//   with scalar values in [s0,s1].
+void IVOLDUAL::IVOLDUAL_INCREMENTAL_GRID::SortedRange
+(const IVOLDUAL::SCALAR_TYPE s0, const IVOLDUAL::SCALAR_TYPE s1,
+ VERTEX_INDEX & ibegin, VERTEX_INDEX & iend) const
+{
+  ibegin = std::lower_bound(sorted_scalar.begin(), sorted_scalar.end(), s0)
+    - sorted_scalar.begin();
+  iend = std::upper_bound(sorted_scalar.begin(), sorted_scalar.end(), s1)
+    - sorted_scalar.begin();
+  if (iend < ibegin) { iend = ibegin; }
+}
+
+
+// **************************************************
+// CLASS SPARSE_CUBE_LIST
+// **************************************************
+
+// Resize table to hold at least n cubes and reinsert list.
+void IVOLDUAL::SPARSE_CUBE_LIST::Rehash(const VERTEX_INDEX n)
+{
+  // Keep the table at most half full.
+  VERTEX_INDEX table_size = 16;
+  while (table_size < 2*n) { table_size *= 2; }
+
+  if (table_size <= VERTEX_INDEX(table.size())) { return; }
+
+  ENTRY empty_entry;
+  empty_entry.cube_index = EMPTY;
+  empty_entry.loc = 0;
+  table.assign(table_size, empty_entry);
+  mask = table_size-1;
+
+  for (VERTEX_INDEX loc = 0; loc < list.size(); loc++) {
+    VERTEX_INDEX k = Hash(list[loc]);
+    while (table[k].cube_index != EMPTY) { k = (k+1) & mask; }
+    table[k].cube_index = list[loc];
+    table[k].loc = loc;
+  }
+}
+
+
+// Reserve space for n cubes.
+void IVOLDUAL::SPARSE_CUBE_LIST::Reserve(const VERTEX_INDEX n)
+{
+  list.reserve(n);
+  Rehash(n);
+}
+
+
+// Clear list.
+void IVOLDUAL::SPARSE_CUBE_LIST::ClearList()
+{
+  if (list.empty()) { return; }
+
+  // Removing single entries would break linear probing sequences.
+  for (VERTEX_INDEX k = 0; k < table.size(); k++)
+    { table[k].cube_index = EMPTY; }
+  list.clear();
+}
+
+
+// **************************************************
+// CLASS IVOLDUAL_CONTEXT
+// **************************************************
+
+IVOLDUAL::IVOLDUAL_CONTEXT::~IVOLDUAL_CONTEXT()
+{
+  delete merge_data;
+  merge_data = NULL;
+}
+
+
+// Prepare buffers for an extraction from grid.
+void IVOLDUAL::IVOLDUAL_CONTEXT::SetGrid(const DUALISO_GRID & grid)
+{
+  const VERTEX_INDEX num_grid_vertices = grid.NumVertices();
+
+  vertex_adjacency_list.SetDimension(grid.Dimension());
+
+  if (index_to_cube_list.size() != num_grid_vertices) {
+    // Allocated by AllocateIndexToCubeList() if needed.
+    std::vector<VERTEX_INDEX>().swap(index_to_cube_list);
+  }
+  else {
+    // Reset only the entries set by the previous extraction.
+    for (VERTEX_INDEX i = 0; i < cube_list.size(); i++)
+      { index_to_cube_list[cube_list[i]] = num_grid_vertices; }
+  }
+  cube_list.clear();
+  sparse_cube_list.ClearList();
+}
+
+
+// Allocate index_to_cube_list with one entry per grid vertex.
+void IVOLDUAL::IVOLDUAL_CONTEXT::AllocateIndexToCubeList
+(const DUALISO_GRID & grid)
+{
+  const VERTEX_INDEX num_grid_vertices = grid.NumVertices();
+
+  if (index_to_cube_list.size() != num_grid_vertices) 
+    { index_to_cube_list.assign(num_grid_vertices, num_grid_vertices); }
+}
+
+
+// **************************************************
+// CLASS IVOLDUAL_EDGE_ISECT_CACHE
+// **************************************************
+
+namespace {
+
+  using IVOLDUAL::COORD_TYPE;
+  using IVOLDUAL::DUALISO_SCALAR_GRID_BASE;
+  using IVOLDUAL::SCALAR_TYPE;
+  using IVOLDUAL::VERTEX_INDEX;
+
+  // Return true if s0 and s1 are both below or both above isovalue.
+  inline bool is_edge_not_bipolar
+  (const SCALAR_TYPE s0, const SCALAR_TYPE s1, const SCALAR_TYPE isovalue)
+  {
+    return((s0 < isovalue && s1 < isovalue) || 
+           (s0 > isovalue && s1 > isovalue));
+  }
+
+  // Compute intersection of grid edge (iend0,iend1) with isovalue.
+  // - Use edge midpoint if edge is not bipolar.
+  void compute_edge_isovalue_intersection
+  (const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+   const VERTEX_INDEX iend0, const VERTEX_INDEX iend1,
+   const SCALAR_TYPE s0, const SCALAR_TYPE s1,
+   const SCALAR_TYPE isovalue,
+   COORD_TYPE * temp_coord0, COORD_TYPE * temp_coord1,
+   COORD_TYPE * coord)
+  {
+    const int dimension = scalar_grid.Dimension();
+
+    scalar_grid.ComputeCoord(iend0, temp_coord0);
+    scalar_grid.ComputeCoord(iend1, temp_coord1);
+
+    if (is_edge_not_bipolar(s0, s1, isovalue)) {
+      // Use edge midpoint.
+      IJK::linear_interpolate_coord
+        (dimension, 0.5, temp_coord0, temp_coord1, coord);
+    }
+    else {
+      IJK::linear_interpolate_coord
+        (dimension, s0, temp_coord0, s1, temp_coord1, isovalue, coord);
+    }
+  }
+
+}
+
+
+void IVOLDUAL::IVOLDUAL_EDGE_ISECT_CACHE::Clear()
+{
+  dimension = 0;
+  isovalue[0] = isovalue[1] = 0;
+  index_to_cube_list = INDEX_TO_CUBE_LIST();
+  edge_bits.clear();
+  first_point.clear();
+  point_coord.clear();
+}
+
+
+void IVOLDUAL::IVOLDUAL_EDGE_ISECT_CACHE::Set
+(const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+ const std::vector<GRID_CUBE_DATA> & cube_list,
+ const INDEX_TO_CUBE_LIST & index_to_cube_list,
+ const SCALAR_TYPE isovalue0, const SCALAR_TYPE isovalue1,
+ const int num_threads)
+{
+  typedef std::vector<GRID_CUBE_DATA>::size_type SIZE_TYPE;
+
+  const int MAX_DIMENSION = 4;
+  const SIZE_TYPE num_cubes = cube_list.size();
+
+  Clear();
+
+  if (scalar_grid.Dimension() < 1 || 
+      scalar_grid.Dimension() > MAX_DIMENSION) { return; }
+
+  this->dimension = scalar_grid.Dimension();
+  this->isovalue[0] = isovalue0;
+  this->isovalue[1] = isovalue1;
+  this->index_to_cube_list = index_to_cube_list;
+  edge_bits.resize(num_cubes);
+  first_point.resize(num_cubes);
+
+  const int num_ranges = compute_num_thread_ranges(num_threads, num_cubes);
+  IJK::LOCAL_ARRAY<VERTEX_INDEX,IJK::NUM_LOCAL_THREAD_RANGES> 
+    range_num_points(num_ranges, 0);
+  IJK::LOCAL_ARRAY<VERTEX_INDEX,IJK::NUM_LOCAL_THREAD_RANGES> 
+    range_first_point(num_ranges, 0);
+
+  // Mark stored edges and count points in each range.
+  run_on_thread_ranges
+    (num_threads, num_cubes,
+     [&](const int k, const SIZE_TYPE ibegin, const SIZE_TYPE iend)
+     {
+       VERTEX_INDEX n = 0;
+       for (SIZE_TYPE i = ibegin; i < iend; i++) {
+         const VERTEX_INDEX iend0 = cube_list[i].cube_index;
+         const SCALAR_TYPE s0 = scalar_grid.Scalar(iend0);
+         unsigned char bits = 0;
+         for (int d = 0; d < dimension; d++) {
+           const VERTEX_INDEX iend1 = scalar_grid.NextVertex(iend0, d);
+           const SCALAR_TYPE s1 = scalar_grid.Scalar(iend1);
+           for (int j = 0; j < 2; j++) {
+             if (!is_edge_not_bipolar(s0, s1, isovalue[j])) {
+               bits |= (1 << (2*d+j));
+               n++;
+             }
+           }
+         }
+         edge_bits[i] = bits;
+       }
+       range_num_points[k] = n;
+     });
+
+  VERTEX_INDEX num_points = 0;
+  for (int k = 0; k < num_ranges; k++) {
+    range_first_point[k] = num_points;
+    num_points += range_num_points[k];
+  }
+
+  point_coord.resize(num_points*dimension);
+
+  // Compute intersections.
+  run_on_thread_ranges
+    (num_threads, num_cubes,
+     [&](const int k, const SIZE_TYPE ibegin, const SIZE_TYPE iend)
+     {
+       IJK::LOCAL_ARRAY<COORD_TYPE,MAX_DIMENSION> temp_coord0(dimension);
+       IJK::LOCAL_ARRAY<COORD_TYPE,MAX_DIMENSION> temp_coord1(dimension);
+       VERTEX_INDEX m = range_first_point[k];
+       for (SIZE_TYPE i = ibegin; i < iend; i++) {
+         const VERTEX_INDEX iend0 = cube_list[i].cube_index;
+         const SCALAR_TYPE s0 = scalar_grid.Scalar(iend0);
+         const unsigned char bits = edge_bits[i];
+         first_point[i] = m;
+         if (bits == 0) { continue; }
+         for (int d = 0; d < dimension; d++) {
+           const VERTEX_INDEX iend1 = scalar_grid.NextVertex(iend0, d);
+           const SCALAR_TYPE s1 = scalar_grid.Scalar(iend1);
+           for (int j = 0; j < 2; j++) {
+             if (bits & (1 << (2*d+j))) {
+               compute_edge_isovalue_intersection
+                 (scalar_grid, iend0, iend1, s0, s1, isovalue[j],
+                  temp_coord0.Ptr(), temp_coord1.Ptr(), 
+                  &(point_coord[m*dimension]));
+               m++;
+             }
+           }
+         }
+       }
+     });
+}
+
+
+const COORD_TYPE * IVOLDUAL::IVOLDUAL_EDGE_ISECT_CACHE::StoredIntersection
+(const VERTEX_INDEX iend0, const int edge_dir, 
+ const SCALAR_TYPE isovalue) const
+{
+  int j;
+  if (isovalue == this->isovalue[0]) { j = 0; }
+  else if (isovalue == this->isovalue[1]) { j = 1; }
+  else { return(NULL); }
+
+  if (edge_bits.empty()) { return(NULL); }
+
+  const VERTEX_INDEX i = index_to_cube_list.Location(iend0);
+  if (i >= edge_bits.size()) { return(NULL); }
+
+  const unsigned int ibit = 2*edge_dir+j;
+  const unsigned int bits = edge_bits[i];
+  if ((bits & (1u << ibit)) == 0) { return(NULL); }
+
+  // Count stored intersections preceding ibit.
+  unsigned int b = bits & ((1u << ibit)-1);
+  VERTEX_INDEX m = first_point[i];
+  while (b != 0) { b &= (b-1); m++; }
+
+  return(&(point_coord[m*dimension]));
+}
+
+
+void IVOLDUAL::IVOLDUAL_EDGE_ISECT_CACHE::ComputeIntersection
+(const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+ const VERTEX_INDEX iend0, const int edge_dir,
+ const SCALAR_TYPE s0, const SCALAR_TYPE s1,
+ const SCALAR_TYPE isovalue, 
+ COORD_TYPE * temp_coord0, COORD_TYPE * temp_coord1,
+ COORD_TYPE * coord) const
+{
+  const COORD_TYPE * stored_coord = 
+    StoredIntersection(iend0, edge_dir, isovalue);
+
+  if (stored_coord != NULL) {
+    IJK::copy_coord(scalar_grid.Dimension(), stored_coord, coord);
+  }
+  else {
+    const VERTEX_INDEX iend1 = scalar_grid.NextVertex(iend0, edge_dir);
+    compute_edge_isovalue_intersection
+      (scalar_grid, iend0, iend1, s0, s1, isovalue, 
+       temp_coord0, temp_coord1, coord);
+  }
+}
+
+
+// Return merge data for grid.
+IVOLDUAL::MERGE_DATA & IVOLDUAL::IVOLDUAL_CONTEXT::MergeData
+(const DUALISO_GRID & grid)
+{
+  const int dimension = grid.Dimension();
+  bool flag_same_size = 
+    (merge_data != NULL && merge_data_axis_size.size() == dimension);
+
+  for (int d = 0; d < dimension && flag_same_size; d++) {
+    if (merge_data_axis_size[d] != grid.AxisSize(d)) 
+      { flag_same_size = false; }
+  }
+
+  if (!flag_same_size) {
+    delete merge_data;
+    merge_data = new IJKDUAL::ISO_MERGE_DATA(dimension, grid.AxisSize());
+    merge_data_axis_size.assign
+      (grid.AxisSize(), grid.AxisSize()+dimension);
+  }
+
+  return(*merge_data);
+}
+
+
+// **************************************************
+// CLASS IVOLDUAL_EXTRACT_OPTIONS
+// **************************************************
+
+void IVOLDUAL::IVOLDUAL_EXTRACT_OPTIONS::Init()
+{
+  block_index = NULL;
+  band_grid = NULL;
+  interval = 0;
+  band_active_cube_list = NULL;
+  incremental_grid = NULL;
+  context = NULL;
+  merge_data = NULL;
+}
+
+
+// Encode grid vertices from interval of band_grid.
+void IVOLDUAL::IVOLDUAL_EXTRACT_OPTIONS::SetBandGrid
+(const IVOLDUAL_BAND_GRID & band_grid, const int interval,
+ const ACTIVE_CUBE_ARRAY & active_cube_list)
+{
+  this->band_grid = &band_grid;
+  this->interval = interval;
+  band_active_cube_list = &active_cube_list;
+}
+
+
+// Check options.
+bool IVOLDUAL::IVOLDUAL_EXTRACT_OPTIONS::Check(IJK::ERROR & error) const
+{
+  if (UseBandGrid() && UseIncrementalGrid()) {
+    error.AddMessage
+      ("Programming error.  Band grid and incremental grid are both set.");
+    error.AddMessage
+      ("  Set at most one of band_grid and incremental_grid.");
+    return(false);
+  }
+
+  if (UseBandGrid() && band_active_cube_list == NULL) {
+    error.AddMessage
+      ("Programming error.  Band grid active cube list is not set.");
+    return(false);
+  }
+
+  return(true);
 }
 
+
 // **************************************************
 // CLASS DUALISO INFO MEMBER FUNCTIONS
 // **************************************************
@@ -88,6 +793,162 @@ void IVOLDUAL::IVOLDUAL_INFO::Clear()
 {
   num_non_manifold_changes = 0;
   num_vertices_moved_in_expand_thin = 0;
+  lsmooth_elength_info.Clear();
+  lsmooth_jacobian_info.Clear();
+  gsmooth_jacobian_info.Clear();
+  repair_jacobian_info.Clear();
+  profile.Clear();
+}
+
+// **************************************************
+// CLASS IVOLDUAL_SMOOTH_INFO MEMBER FUNCTIONS
+// **************************************************
+
+const char * IVOLDUAL::IVOLDUAL_SMOOTH_INFO::StopReasonName
+(const SMOOTH_STOP_REASON reason)
+{
+  switch(reason) {
+  case SMOOTH_NOT_RUN: return("not run");
+  case SMOOTH_STOP_MAX_ITERATIONS: return("max iterations");
+  case SMOOTH_STOP_NO_BAD_ELEMENTS: return("no bad elements");
+  case SMOOTH_STOP_MOVE_EPSILON: return("vertex moves below epsilon");
+  case SMOOTH_STOP_STALLED: return("bad element count stalled");
+  case SMOOTH_STOP_TIME_LIMIT: return("time limit");
+  case SMOOTH_STOP_NO_IMPROVEMENT: return("no bad element improved");
+  default: return("unknown");
+  }
+}
+
+
+// **************************************************
+// CLASS IVOLDUAL_SMOOTH_CONTROL MEMBER FUNCTIONS
+// **************************************************
+
+void IVOLDUAL::IVOLDUAL_SMOOTH_CONTROL::Init()
+{
+  move_epsilon = -1.0;
+  flag_stop_stalled = false;
+  time_limit = 0.0;
+  flag_jacobian_gradient = false;
+}
+
+void IVOLDUAL::IVOLDUAL_SMOOTH_CONTROL::Set
+(const IVOLDUAL_DATA_FLAGS & flags)
+{
+  move_epsilon = flags.smooth_move_epsilon;
+  flag_stop_stalled = flags.flag_smooth_stop_stalled;
+  time_limit = flags.smooth_time_limit;
+  flag_jacobian_gradient = flags.flag_jacobian_gradient;
+}
+
+void IVOLDUAL::IVOLDUAL_SMOOTH_CONTROL::Start
+(IVOLDUAL_SMOOTH_INFO & smooth_info)
+{
+  timer.Restart();
+  smooth_info.num_iterations = 0;
+  smooth_info.stop_reason = SMOOTH_STOP_MAX_ITERATIONS;
+}
+
+bool IVOLDUAL::IVOLDUAL_SMOOTH_CONTROL::StopBeforeIteration
+(const int it, const VERTEX_INDEX num_bad, const VERTEX_INDEX num_bad_prev,
+ IVOLDUAL_SMOOTH_INFO & smooth_info) const
+{
+  if (num_bad == 0) {
+    // Smoothing moves only vertices of hexahedra with bad Jacobian.
+    smooth_info.stop_reason = SMOOTH_STOP_NO_BAD_ELEMENTS;
+    return(true);
+  }
+
+  if (flag_stop_stalled && it > 0 && num_bad >= num_bad_prev) {
+    smooth_info.stop_reason = SMOOTH_STOP_STALLED;
+    return(true);
+  }
+
+  return(false);
+}
+
+bool IVOLDUAL::IVOLDUAL_SMOOTH_CONTROL::EndIteration
+(const COORD_TYPE max_move, IVOLDUAL_SMOOTH_INFO & smooth_info) const
+{
+  smooth_info.num_iterations++;
+
+  if (CheckMove() && max_move <= move_epsilon) {
+    smooth_info.stop_reason = SMOOTH_STOP_MOVE_EPSILON;
+    return(true);
+  }
+
+  if (time_limit > 0 && timer.WallSeconds() >= time_limit) {
+    smooth_info.stop_reason = SMOOTH_STOP_TIME_LIMIT;
+    return(true);
+  }
+
+  return(false);
+}
+
+
+// **************************************************
+// CLASS IVOLDUAL_PROFILE MEMBER FUNCTIONS
+// **************************************************
+
+// Name of stage.
+const char * IVOLDUAL::IVOLDUAL_PROFILE::StageName
+(const PROFILE_STAGE stage)
+{
+  switch(stage) {
+  case PROFILE_READ: return("read");
+  case PROFILE_ENCODE: return("encode");
+  case PROFILE_EXTRACT: return("extract");
+  case PROFILE_MERGE: return("merge");
+  case PROFILE_TABLE_INFO: return("table_info");
+  case PROFILE_AMBIG_SPLIT: return("ambig_split");
+  case PROFILE_VERTEX_SPLIT: return("vertex_split");
+  case PROFILE_POSITION: return("position");
+  case PROFILE_ADJACENCY: return("adjacency");
+  case PROFILE_IVOL_VERTEX_INFO: return("ivol_vertex_info");
+  case PROFILE_EXPAND_THIN: return("expand_thin");
+  case PROFILE_INCIDENCE: return("incidence");
+  case PROFILE_SPLIT_HEX: return("split_hex");
+  case PROFILE_COLLAPSE_HEX: return("collapse_hex");
+  case PROFILE_LSMOOTH_ELENGTH: return("lsmooth_elength");
+  case PROFILE_LSMOOTH_JACOBIAN: return("lsmooth_jacobian");
+  case PROFILE_GSMOOTH_JACOBIAN: return("gsmooth_jacobian");
+  case PROFILE_REPAIR_JACOBIAN: return("repair_jacobian");
+  case PROFILE_TRIANGULATE: return("triangulate");
+  case PROFILE_WRITE: return("write");
+  default: return("unknown");
+  }
+}
+
+double IVOLDUAL::IVOLDUAL_PROFILE::TotalWall() const
+{
+  double t = 0;
+  for (int i = 0; i < NUM_PROFILE_STAGES; i++) { t += wall[i]; }
+  return(t);
+}
+
+double IVOLDUAL::IVOLDUAL_PROFILE::TotalCpu() const
+{
+  double t = 0;
+  for (int i = 0; i < NUM_PROFILE_STAGES; i++) { t += cpu[i]; }
+  return(t);
+}
+
+void IVOLDUAL::IVOLDUAL_PROFILE::Clear()
+{
+  for (int i = 0; i < NUM_PROFILE_STAGES; i++) {
+    wall[i] = 0;
+    cpu[i] = 0;
+    count[i] = 0;
+  }
+}
+
+void IVOLDUAL::IVOLDUAL_PROFILE::Add(const IVOLDUAL_PROFILE & profile)
+{
+  for (int i = 0; i < NUM_PROFILE_STAGES; i++) {
+    wall[i] += profile.wall[i];
+    cpu[i] += profile.cpu[i];
+    count[i] += profile.count[i];
+  }
 }
 
 // **************************************************
@@ -150,6 +1011,18 @@ void IVOLDUAL::IVOLDUAL_DATA::SetScalarGrid
   }
 }
 
+// Compute min/max block index of scalar_grid.
+void IVOLDUAL::IVOLDUAL_DATA::ComputeBlockIndex
+(const AXIS_SIZE_TYPE block_edge_length)
+{
+  if (block_edge_length <= 0) {
+    block_index.Clear();
+    return;
+  }
+
+  block_index.Set(scalar_grid, block_edge_length);
+}
+
 void IVOLDUAL::IVOLDUAL_DATA::SubdivideScalarGrid
 (const SCALAR_TYPE isovalue0, const SCALAR_TYPE isovalue1) 
 {
@@ -662,6 +1535,7 @@ void IVOLDUAL::IVOLDUAL_SCALAR_GRID::EliminateDiagonalMinus
 void IVOLDUAL::DUAL_IVOLVERT::Init()
 {
   // Data from interval volume lookup table.
+  connect_dir = 0;
   num_incident_hex = 0;
   num_incident_iso_quad = 0;
   flag_lower_isosurface = false;
@@ -669,11 +1543,153 @@ void IVOLDUAL::DUAL_IVOLVERT::Init()
 
   separation_vertex = 0;
   separation_edge_direction = 0;
+  doubly_connected_facet = 0;
   flag_missing_ivol_hexahedra = false;
   is_doubly_connected = false;
   in_loop = false;
   in_box = false;
   in_pseudobox = false;
+  in_thin_region = false;
   flag_adjacent_to_lower_isosurface = false;
   flag_adjacent_to_upper_isosurface = false;
+  map_to = 0;
+}
+
+
+// **************************************************
+// DUAL_IVOLVERT_SOA MEMBER FUNCTIONS
+// **************************************************
+
+void IVOLDUAL::DUAL_IVOLVERT_SOA::Set
+(const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+ const DUAL_IVOLVERT_ARRAY & ivolv_list)
+{
+  const ISO_VERTEX_INDEX numv = ivolv_list.size();
+
+  cube_index.resize(numv);
+  table_index.resize(numv);
+  patch_index.resize(numv);
+  flag_bits.resize(numv);
+
+  for (ISO_VERTEX_INDEX ivolv = 0; ivolv < numv; ivolv++) {
+    const DUAL_IVOLVERT & v = ivolv_list[ivolv];
+    FLAG_BITS_TYPE bits = 0;
+
+    cube_index[ivolv] = v.cube_index;
+    table_index[ivolv] = v.table_index;
+    patch_index[ivolv] = v.patch_index;
+
+    if (ivoldual_table.OnLowerIsosurface(v.table_index, v.patch_index))
+      { bits |= ON_LOWER_ISOSURFACE; }
+    if (ivoldual_table.OnUpperIsosurface(v.table_index, v.patch_index))
+      { bits |= ON_UPPER_ISOSURFACE; }
+    if (v.flag_missing_ivol_hexahedra) { bits |= MISSING_IVOL_HEXAHEDRA; }
+    if (v.is_doubly_connected) { bits |= DOUBLY_CONNECTED; }
+    if (v.in_loop) { bits |= IN_LOOP; }
+    if (v.in_box) { bits |= IN_BOX; }
+    if (v.in_pseudobox) { bits |= IN_PSEUDOBOX; }
+    if (v.in_thin_region) { bits |= IN_THIN_REGION; }
+    if (v.flag_adjacent_to_lower_isosurface)
+      { bits |= ADJACENT_TO_LOWER_ISOSURFACE; }
+    if (v.flag_adjacent_to_upper_isosurface)
+      { bits |= ADJACENT_TO_UPPER_ISOSURFACE; }
+
+    flag_bits[ivolv] = bits;
+  }
+}
+
+void IVOLDUAL::DUAL_IVOLVERT_SOA::Clear()
+{
+  cube_index.clear();
+  table_index.clear();
+  patch_index.clear();
+  flag_bits.clear();
+}
+
+
+// **************************************************
+// CLASS IVOLDUAL_HEX_JACOBIAN_CACHE
+// **************************************************
+
+void IVOLDUAL::IVOLDUAL_HEX_JACOBIAN_CACHE::ComputeHex
+(const std::vector<VERTEX_INDEX> & ivolpoly_vert,
+ const COORD_ARRAY & vertex_coord, const VERTEX_INDEX ihex)
+{
+  COORD_TYPE * hex_jacobian = &(jacobian[ihex*NUM_VERT_PER_HEX]);
+
+  compute_hexahedron_normalized_Jacobian_determinants
+    (ivolpoly_vert, ihex, vertex_coord, hex_jacobian);
+
+  // Skip NaN so that MinJacobian(ihex) < t iff some Jacobian(ihex,k) < t.
+  COORD_TYPE jmin = hex_jacobian[0];
+  for (int k = 1; k < NUM_VERT_PER_HEX; k++) {
+    if (hex_jacobian[k] < jmin || jmin != jmin) 
+      { jmin = hex_jacobian[k]; }
+  }
+  min_jacobian[ihex] = jmin;
+}
+
+
+void IVOLDUAL::IVOLDUAL_HEX_JACOBIAN_CACHE::Set
+(const std::vector<VERTEX_INDEX> & ivolpoly_vert,
+ const COORD_ARRAY & vertex_coord)
+{
+  const VERTEX_INDEX num_hex = ivolpoly_vert.size()/NUM_VERT_PER_HEX;
+
+  jacobian.resize(num_hex*NUM_VERT_PER_HEX);
+  min_jacobian.resize(num_hex);
+  flag_dirty.assign(num_hex, false);
+  dirty_hex.clear();
+
+  for (VERTEX_INDEX ihex = 0; ihex < num_hex; ihex++)
+    { ComputeHex(ivolpoly_vert, vertex_coord, ihex); }
+}
+
+
+void IVOLDUAL::IVOLDUAL_HEX_JACOBIAN_CACHE::MarkMovedVertex
+(const VERTEX_INDEX iv,
+ const IJK::VERTEX_POLY_INCIDENCE<int,int> & vertex_poly_incidence)
+{
+  if (iv >= vertex_poly_incidence.NumVertices()) { return; }
+
+  for (int j = 0; j < vertex_poly_incidence.NumIncidentPoly(iv); j++) {
+    const VERTEX_INDEX ihex = vertex_poly_incidence.IncidentPoly(iv, j);
+    if (ihex < NumHex() && !flag_dirty[ihex]) {
+      flag_dirty[ihex] = true;
+      dirty_hex.push_back(ihex);
+    }
+  }
+}
+
+
+void IVOLDUAL::IVOLDUAL_HEX_JACOBIAN_CACHE::Update
+(const std::vector<VERTEX_INDEX> & ivolpoly_vert,
+ const COORD_ARRAY & vertex_coord,
+ VERTEX_INDEX & num_recomputed)
+{
+  const VERTEX_INDEX num_hex = ivolpoly_vert.size()/NUM_VERT_PER_HEX;
+
+  if (num_hex != NumHex()) {
+    Set(ivolpoly_vert, vertex_coord);
+    num_recomputed = num_hex;
+    return;
+  }
+
+  for (VERTEX_INDEX i = 0; i < dirty_hex.size(); i++) {
+    const VERTEX_INDEX ihex = dirty_hex[i];
+    ComputeHex(ivolpoly_vert, vertex_coord, ihex);
+    flag_dirty[ihex] = false;
+  }
+
+  num_recomputed = dirty_hex.size();
+  dirty_hex.clear();
+}
+
+
+void IVOLDUAL::IVOLDUAL_HEX_JACOBIAN_CACHE::Clear()
+{
+  jacobian.clear();
+  min_jacobian.clear();
+  flag_dirty.clear();
+  dirty_hex.clear();
 }
@@ -24,6 +24,9 @@
 #ifndef _IVOLDUAL_DATASTRUCT_
 #define _IVOLDUAL_DATASTRUCT_
 
+#include <chrono>
+#include <ctime>
+
 #include "ijkcube.txx"
 #include "ijkmesh_datastruct.txx"
 #include "ijkdual_mesh.txx"
@@ -107,6 +110,10 @@ namespace IVOLDUAL {
 
     typedef IVOLDUAL_TABLE_VERTEX_INFO::DIR_BITS_TYPE DIR_BITS_TYPE;
 
+    // Fields are ordered from smallest to largest and boolean flags
+    //   are packed into single bits so that DUAL_IVOLVERT_ARRAY
+    //   stays compact for meshes with many vertices.
+
     /// Bit flag for connection direction.
     /// If bit i is 1, then vertex connects across facet i.
     DIR_BITS_TYPE connect_dir;
@@ -122,44 +129,45 @@ namespace IVOLDUAL {
     ///   equals the number of incident isosurface quadrilaterals in the mesh.
     DEGREE_TYPE num_incident_iso_quad;
 
+    /// If ivol vertex is doubly connected, then ivol vertex is
+    ///   doubly connected across facet doubly_connected_facet.
+    FACET_INDEX doubly_connected_facet;
+
+    /// Separation edge direction.
+    /// Separation edge has lower/left endpoint separation_vertex.
+    /// - Always 0, 1 or 2.
+    unsigned char separation_edge_direction;
+
     // *** CHANGE TO flag_on_lower_isosurface ***
     /// True if vertex is on the lower isosurface.
-    bool flag_lower_isosurface;
+    bool flag_lower_isosurface:1;
 
     // *** CHANGE TO flag_on_upper_isosurface ***
     /// True if vertex is on the upper isosurface.
     /// - A vertex cannot be in both the lower and upper isosurface.
     /// - A vertex could be in neither lower nor upper isosurface.
-    bool flag_upper_isosurface;
+    bool flag_upper_isosurface:1;
 
     /// If true, the mesh is missing some interval volume hexahedra
     ///   which would normally be incident on the vertex.
     /// The hexahedra are missing because they are dual to grid edges
     ///   or vertices which are on the grid boundary.
-    bool flag_missing_ivol_hexahedra;
+    bool flag_missing_ivol_hexahedra:1;
 
-    /// Separation vertex.
-    VERTEX_INDEX separation_vertex;
-
-    /// Separation edge direction.
-    /// Separation edge has lower/left endpoint separation_vertex.
-    VERTEX_INDEX separation_edge_direction;
-
-    /// If ivol vertex is doubly connected, then ivol vertex is
-    ///   doubly connected across facet doubly_connected_facet.
-    FACET_INDEX doubly_connected_facet;
-
-    bool is_doubly_connected;        ///< True, if vertex is doubly connected.
-    bool in_loop;                    ///< True, if vertex is in loop.
-    bool in_box;                     ///< True, if vertex is in box.
-    bool in_pseudobox;               ///< True, if vertex is in pseudobox.
-    bool in_thin_region;             ///< True, if vertex is in thin region.
+    bool is_doubly_connected:1;      ///< True, if vertex is doubly connected.
+    bool in_loop:1;                  ///< True, if vertex is in loop.
+    bool in_box:1;                   ///< True, if vertex is in box.
+    bool in_pseudobox:1;             ///< True, if vertex is in pseudobox.
+    bool in_thin_region:1;           ///< True, if vertex is in thin region.
 
     /// If true, adjacent to upper isosurface.
-    bool flag_adjacent_to_upper_isosurface;
+    bool flag_adjacent_to_upper_isosurface:1;
 
     /// If true, adjacent to lower isosurface.
-    bool flag_adjacent_to_lower_isosurface;
+    bool flag_adjacent_to_lower_isosurface:1;
+
+    /// Separation vertex.
+    VERTEX_INDEX separation_vertex;
 
     /// Map for degenerate mesh.
     ISO_VERTEX_INDEX map_to;
@@ -183,6 +191,97 @@ namespace IVOLDUAL {
     { return(separation_vertex); }
   };
   typedef std::vector<DUAL_IVOLVERT> DUAL_IVOLVERT_ARRAY;
+
+
+  // **************************************************
+  // DUAL INTERVAL VOLUME VERTEX STORE
+  // **************************************************
+
+  /// Structure-of-arrays copy of interval volume vertex information.
+  /// - Stores cube index, table index and patch index in separate
+  ///   contiguous arrays and packs vertex flags into one word per vertex,
+  ///   so passes over all vertices read only the fields they use.
+  /// - Flags ON_LOWER_ISOSURFACE and ON_UPPER_ISOSURFACE are computed
+  ///   from the interval volume lookup table.
+  /// - Snapshot of DUAL_IVOLVERT_ARRAY. Must be reset by Set()
+  ///   if the vertex array changes.
+  class DUAL_IVOLVERT_SOA {
+
+  public:
+
+    /// Type of flag word.
+    typedef unsigned short FLAG_BITS_TYPE;
+
+    /// Bits of flag word.
+    typedef enum {
+      ON_LOWER_ISOSURFACE = 0x0001,
+      ON_UPPER_ISOSURFACE = 0x0002,
+      MISSING_IVOL_HEXAHEDRA = 0x0004,
+      DOUBLY_CONNECTED = 0x0008,
+      IN_LOOP = 0x0010,
+      IN_BOX = 0x0020,
+      IN_PSEUDOBOX = 0x0040,
+      IN_THIN_REGION = 0x0080,
+      ADJACENT_TO_LOWER_ISOSURFACE = 0x0100,
+      ADJACENT_TO_UPPER_ISOSURFACE = 0x0200
+    } FLAG_BIT;
+
+  protected:
+    std::vector<VERTEX_INDEX> cube_index;
+    std::vector<TABLE_INDEX> table_index;
+    std::vector<FACET_VERTEX_INDEX> patch_index;
+    std::vector<FLAG_BITS_TYPE> flag_bits;
+
+  public:
+    DUAL_IVOLVERT_SOA() {};
+    DUAL_IVOLVERT_SOA
+    (const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+     const DUAL_IVOLVERT_ARRAY & ivolv_list)
+    { Set(ivoldual_table, ivolv_list); }
+
+    /// Copy vertex information from \a ivolv_list.
+    void Set(const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+             const DUAL_IVOLVERT_ARRAY & ivolv_list);
+
+    /// Remove all vertices.
+    void Clear();
+
+    /// Return number of vertices.
+    ISO_VERTEX_INDEX NumVertices() const
+    { return(cube_index.size()); }
+
+    /// Return index of cube containing vertex \a ivolv.
+    VERTEX_INDEX CubeIndex(const ISO_VERTEX_INDEX ivolv) const
+    { return(cube_index[ivolv]); }
+
+    /// Return lookup table index of cube containing vertex \a ivolv.
+    TABLE_INDEX TableIndex(const ISO_VERTEX_INDEX ivolv) const
+    { return(table_index[ivolv]); }
+
+    /// Return patch index of vertex \a ivolv.
+    FACET_VERTEX_INDEX PatchIndex(const ISO_VERTEX_INDEX ivolv) const
+    { return(patch_index[ivolv]); }
+
+    /// Return flag word of vertex \a ivolv.
+    FLAG_BITS_TYPE FlagBits(const ISO_VERTEX_INDEX ivolv) const
+    { return(flag_bits[ivolv]); }
+
+    /// Return true if any bit in \a mask is set for vertex \a ivolv.
+    bool IsFlagSet(const ISO_VERTEX_INDEX ivolv, const FLAG_BITS_TYPE mask) const
+    { return((flag_bits[ivolv] & mask) != 0); }
+
+    /// Return true if vertex \a ivolv is on the lower isosurface.
+    bool OnLowerIsosurface(const ISO_VERTEX_INDEX ivolv) const
+    { return(IsFlagSet(ivolv, ON_LOWER_ISOSURFACE)); }
+
+    /// Return true if vertex \a ivolv is on the upper isosurface.
+    bool OnUpperIsosurface(const ISO_VERTEX_INDEX ivolv) const
+    { return(IsFlagSet(ivolv, ON_UPPER_ISOSURFACE)); }
+
+    /// Return true if vertex \a ivolv is on the lower or upper isosurface.
+    bool OnIsosurface(const ISO_VERTEX_INDEX ivolv) const
+    { return(IsFlagSet(ivolv, ON_LOWER_ISOSURFACE|ON_UPPER_ISOSURFACE)); }
+  };
   
 
   // **************************************************
@@ -196,6 +295,377 @@ namespace IVOLDUAL {
    GRID_COORD_TYPE> GRID_CUBE_DATA;
 
 
+  // **************************************************
+  // ACTIVE GRID CUBE
+  // **************************************************
+
+  /// Active grid cube and its interval volume lookup table index.
+  /// - A grid cube is active if its vertices are not all
+  ///   below isovalue0 and not all above isovalue1.
+  class ACTIVE_CUBE {
+
+  public:
+    VERTEX_INDEX cube_index;
+    TABLE_INDEX table_index;
+
+    ACTIVE_CUBE() {};
+    ACTIVE_CUBE(const VERTEX_INDEX icube, const TABLE_INDEX it):
+      cube_index(icube), table_index(it) {};
+  };
+
+  /// Array of active grid cubes.
+  typedef std::vector<ACTIVE_CUBE> ACTIVE_CUBE_ARRAY;
+
+
+  /// Grid edge dual to an interval volume polytope.
+  class DUAL_GRID_EDGE {
+
+  public:
+    /// First vertex of the row of grid edges containing the edge.
+    VERTEX_INDEX row;
+
+    /// Lower endpoint of the edge.
+    VERTEX_INDEX iend0;
+
+    bool flag_reverse_orient;
+
+    /// Return true if edge precedes edgeB in the order visited
+    ///   by IJK_FOR_EACH_INTERIOR_GRID_EDGE_IN_DIRECTION.
+    bool operator < (const DUAL_GRID_EDGE & edgeB) const
+    {
+      if (row != edgeB.row) { return(row < edgeB.row); }
+      return(iend0 < edgeB.iend0);
+    }
+  };
+
+  /// Array of grid edges dual to interval volume polytopes.
+  typedef std::vector<DUAL_GRID_EDGE> DUAL_GRID_EDGE_ARRAY;
+
+
+  // **************************************************
+  // GRID BLOCK MIN/MAX INDEX
+  // **************************************************
+
+  /// Min and max scalar values of each block of the scalar grid.
+  /// - Block edges contain BlockEdgeLength() grid edges.
+  /// - Block j along an axis contains the grid vertices with
+  ///   coordinates [j*L,(j+1)*L] where L is BlockEdgeLength().
+  ///   Adjacent blocks share a layer of grid vertices.
+  /// - Depends only on the scalar grid, not on the isovalues,
+  ///   so it is computed once and reused for every pair of isovalues.
+  ///   Must be recomputed if the scalar grid changes.
+  class IVOLDUAL_BLOCK_INDEX:
+    public IJK::MINMAX_REGIONS<DUALISO_GRID,SCALAR_TYPE> {
+
+  protected:
+    /// flag_contains_nan[ib] is true if block ib contains
+    ///   a grid vertex with NaN scalar value.
+    std::vector<bool> flag_contains_nan;
+
+    /// Set flag_contains_nan[].
+    void SetContainsNaN(const DUALISO_SCALAR_GRID_BASE & scalar_grid);
+
+  public:
+    IVOLDUAL_BLOCK_INDEX() {};
+
+    /// Compute min and max scalar values of each block.
+    /// - Also flags blocks containing NaN scalar values.
+    /// @pre block_edge_length > 0.
+    void Set(const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+             const AXIS_SIZE_TYPE block_edge_length);
+
+    /// Clear block index.
+    void Clear();
+
+    /// Return true if block ib contains a grid vertex 
+    ///   with NaN scalar value.
+    /// - Min(ib) and Max(ib) do not reliably reflect NaN values.
+    bool ContainsNaN(const VERTEX_INDEX ib) const
+    { return(flag_contains_nan[ib]); }
+
+    /// Return true if block min and max have been computed.
+    bool IsSet() const
+    { return(RegionEdgeLength() > 0 && NumRegions() > 0); }
+
+    /// Return number of grid edges in each block edge.
+    AXIS_SIZE_TYPE BlockEdgeLength() const
+    { return(RegionEdgeLength()); }
+
+    /// Return true if block index was computed from a grid
+    ///   with the same dimension and axis sizes as grid.
+    bool IsIndexOf(const DUALISO_GRID & grid) const;
+  };
+
+
+  /// Encoding of grid blocks for one pair of isovalues.
+  /// - Scalar(ib) is 0 if all vertices in block ib have encoding 0,
+  ///   3 if all vertices in block ib have encoding 3,
+  ///   and ACTIVE_BLOCK otherwise.
+  /// - No grid edge or grid vertex in a block with encoding 0 or 3
+  ///   is dual to an interval volume polytope.
+  class IVOLDUAL_ENCODED_BLOCKS:public IVOLDUAL_ENCODED_GRID {
+
+  protected:
+    AXIS_SIZE_TYPE block_edge_length;
+
+  public:
+    const static GRID_VERTEX_ENCODING ACTIVE_BLOCK = 4;
+
+  public:
+    IVOLDUAL_ENCODED_BLOCKS() { block_edge_length = 0; };
+
+    /// Set block encoding from block_index and isovalues.
+    /// - If block_index is not set, sets a single active block
+    ///   containing all of grid.
+    /// - Blocks containing NaN scalar values are active.
+    /// - isovalue0 may be greater than isovalue1.  Blocks are then
+    ///   encoded as the grid vertices are by encode_scalar_values().
+    /// @pre If block_index is set, then block_index.IsIndexOf(grid).
+    /// @param isovalue0 Lower isovalue.
+    ///   - Note: SCALAR_TYPE in this class scope is the type of the
+    ///     block encoding, so the isovalue type is qualified.
+    void Set(const DUALISO_GRID & grid,
+             const IVOLDUAL_BLOCK_INDEX & block_index,
+             const IVOLDUAL::SCALAR_TYPE isovalue0, 
+             const IVOLDUAL::SCALAR_TYPE isovalue1);
+
+    /// Set a single active block containing all of grid.
+    void SetAllActive(const DUALISO_GRID & grid);
+
+    /// Return number of grid edges in each block edge.
+    AXIS_SIZE_TYPE BlockEdgeLength() const
+    { return(block_edge_length); }
+
+    /// Return true if block ib may contain grid edges or vertices
+    ///   dual to interval volume polytopes.
+    bool IsActive(const VERTEX_INDEX ib) const
+    { return(Scalar(ib) == ACTIVE_BLOCK); }
+
+    /// Return coordinate along axis d of block containing
+    ///   grid coordinate c.
+    /// - Grid coordinate c is in block c/BlockEdgeLength(),
+    ///   except for the last grid coordinate which may be
+    ///   in the last block.
+    VERTEX_INDEX BlockCoord(const VERTEX_INDEX c, const int d) const
+    {
+      const VERTEX_INDEX jb = c/block_edge_length;
+      if (jb < AxisSize(d)) { return(jb); }
+      else { return(AxisSize(d)-1); }
+    }
+
+    /// Return number of active blocks.
+    VERTEX_INDEX CountActive() const;
+  };
+
+
+  // **************************************************
+  // MULTI-INTERVAL BAND GRID
+  // **************************************************
+
+  /// Encoding of grid vertices into bands for a list of isovalues.
+  /// - Thresholds t[0] < t[1] < ... < t[m-1] are the isovalues and,
+  ///   if interior codes are set from scalar values, the averages
+  ///   of consecutive isovalues.
+  /// - Scalar(iv) is the band of grid vertex iv.
+  ///   - Band is 2k if t[k-1] < s < t[k] and 2k+1 if s equals t[k].
+  ///   - Band is NAN_BAND if s is NaN.
+  /// - The encoding (0,1,2 or 3) of a vertex for interval i
+  ///   is a lookup on its band, so the scalar grid is read only once
+  ///   for all the intervals.
+  class IVOLDUAL_BAND_GRID:public IVOLDUAL_ENCODED_GRID {
+
+  public:
+    const static GRID_VERTEX_ENCODING NAN_BAND = 255;
+    const static int NUM_BANDS = 256;
+    const static int MAX_NUM_THRESHOLDS = (NAN_BAND-1)/2;
+
+  protected:
+    IVOLDUAL::SCALAR_ARRAY isovalue;
+    IVOLDUAL::SCALAR_ARRAY threshold;
+
+    /// interval_code[i*NUM_BANDS+b] is the encoding of band b
+    ///   for interval i.
+    std::vector<GRID_VERTEX_ENCODING> interval_code;
+
+    /// Number of thresholds t with !(s < t) for scalars s in band b.
+    int num_not_below[NUM_BANDS];
+
+    /// Number of thresholds t with s > t for scalars s in band b.
+    int num_above[NUM_BANDS];
+
+    /// first_interval_from_above[k] is the first interval i
+    ///   whose upper isovalue is at least threshold k.
+    std::vector<int> first_interval_from_above;
+
+    /// end_interval_from_not_below[k] is the number of intervals
+    ///   whose lower isovalue is below threshold k.
+    std::vector<int> end_interval_from_not_below;
+
+  public:
+    IVOLDUAL_BAND_GRID() {};
+
+    /// Set thresholds and band encodings from list of isovalues.
+    /// - Interval i is [isovalue[i],isovalue[i+1]].
+    /// - Return false if the isovalues are not strictly increasing
+    ///   or if there are more than MAX_NUM_THRESHOLDS thresholds.
+    bool SetIsovalues
+    (const IVOLDUAL::SCALAR_ARRAY & isovalue,
+     const bool flag_set_interior_code_from_scalar,
+     const GRID_VERTEX_ENCODING default_interior_code);
+
+    /// Return number of thresholds.
+    int NumThresholds() const
+    { return(threshold.size()); }
+
+    /// Return pointer to array of thresholds.
+    const IVOLDUAL::SCALAR_TYPE * ThresholdPtrConst() const
+    { return(threshold.data()); }
+
+    /// Return number of intervals.
+    int NumIntervals() const
+    { return(isovalue.size() > 0 ? isovalue.size()-1 : 0); }
+
+    /// Return isovalue i.
+    IVOLDUAL::SCALAR_TYPE Isovalue(const int i) const
+    { return(isovalue[i]); }
+
+    /// Return array of encodings of each band for interval i.
+    const GRID_VERTEX_ENCODING * IntervalCodePtrConst(const int i) const
+    { return(interval_code.data()+i*NUM_BANDS); }
+
+    /// Compute range [ibegin,iend) of intervals where the cube
+    ///   with vertex bands band[] is active.
+    void ComputeActiveIntervals
+    (const GRID_VERTEX_ENCODING band[], const int num_cube_vertices,
+     int & ibegin, int & iend) const
+    {
+      int max_not_below = num_not_below[band[0]];
+      int min_above = num_above[band[0]];
+      for (int k = 1; k < num_cube_vertices; k++) {
+        max_not_below = std::max(max_not_below, num_not_below[band[k]]);
+        min_above = std::min(min_above, num_above[band[k]]);
+      }
+      ibegin = first_interval_from_above[min_above];
+      iend = end_interval_from_not_below[max_not_below];
+    }
+  };
+
+
+  // **************************************************
+  // INCREMENTAL ENCODED GRID
+  // **************************************************
+
+  /// Encoded grid which is updated incrementally when the isovalues change.
+  /// - Grid vertices are sorted by scalar value.  When the interval
+  ///   changes, only vertices whose scalar values lie between
+  ///   the old and new isovalues are reclassified.
+  /// - In 3D, also stores the active cubes sorted by cube index.
+  ///   Only cubes incident on reclassified vertices are updated.
+  /// - Vertices with scalar value NaN are not sorted.
+  ///   Their encoding does not depend on the isovalues.
+  class IVOLDUAL_INCREMENTAL_GRID:public IVOLDUAL_ENCODED_GRID {
+
+  protected:
+
+    /// Non-NaN grid vertices sorted by increasing scalar value.
+    std::vector<VERTEX_INDEX> sorted_vertex;
+
+    /// sorted_scalar[i] is the scalar value of sorted_vertex[i].
+    IVOLDUAL::SCALAR_ARRAY sorted_scalar;
+
+    /// Isovalues of the current encoding.
+    IVOLDUAL::SCALAR_TYPE isovalue[2];
+
+    /// If true, grid has been encoded for isovalue[0] and isovalue[1].
+    bool flag_encoded;
+
+    bool flag_set_interior_code_from_scalar;
+    GRID_VERTEX_ENCODING default_interior_code;
+
+    /// Number of vertices reclassified by the last update.
+    VERTEX_INDEX num_reclassified;
+
+    /// Number of cubes whose table indices were recomputed
+    ///   by the last update.
+    VERTEX_INDEX num_updated_cubes;
+
+  public:
+
+    /// Active cubes of the current encoding, sorted by cube index.
+    /// - Only set if the grid dimension is 3.
+    ACTIVE_CUBE_ARRAY active_cube_list;
+
+    /// dual_edge_list[d] is the list of grid edges in direction d
+    ///   which are dual to interval volume polytopes.
+    /// - Sorted in the order visited by IJK_FOR_EACH_INTERIOR_GRID_EDGE.
+    /// - Only set if the grid dimension is 3.
+    std::vector<DUAL_GRID_EDGE_ARRAY> dual_edge_list;
+
+    /// Grid vertices which are dual to interval volume polytopes,
+    ///   sorted by vertex index.
+    /// - Only set if the grid dimension is 3.
+    std::vector<VERTEX_INDEX> dual_vertex_list;
+
+  public:
+    IVOLDUAL_INCREMENTAL_GRID()
+    { flag_encoded = false; num_reclassified = 0; num_updated_cubes = 0; };
+
+    /// Set grid size and sort grid vertices by scalar value.
+    /// - Clears the encoding.  The next update encodes every vertex.
+    void SetScalarGrid
+    (const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+     const bool flag_set_interior_code_from_scalar,
+     const GRID_VERTEX_ENCODING default_interior_code);
+
+    /// Set isovalues of the current encoding.
+    void SetIsovalues
+    (const IVOLDUAL::SCALAR_TYPE isovalue0,
+     const IVOLDUAL::SCALAR_TYPE isovalue1)
+    {
+      isovalue[0] = isovalue0;
+      isovalue[1] = isovalue1;
+      flag_encoded = true;
+    }
+
+    /// Set counts of the last update.
+    void SetUpdateCounts
+    (const VERTEX_INDEX num_reclassified,
+     const VERTEX_INDEX num_updated_cubes)
+    {
+      this->num_reclassified = num_reclassified;
+      this->num_updated_cubes = num_updated_cubes;
+    }
+
+    bool IsEncoded() const
+    { return(flag_encoded); }
+    IVOLDUAL::SCALAR_TYPE Isovalue(const int i) const
+    { return(isovalue[i]); }
+    bool SetInteriorCodeFromScalarFlag() const
+    { return(flag_set_interior_code_from_scalar); }
+    GRID_VERTEX_ENCODING DefaultInteriorCode() const
+    { return(default_interior_code); }
+
+    /// Return number of sorted (non-NaN) vertices.
+    VERTEX_INDEX NumSorted() const
+    { return(sorted_vertex.size()); }
+    const VERTEX_INDEX * SortedVertexPtrConst() const
+    { return(sorted_vertex.data()); }
+    const IVOLDUAL::SCALAR_TYPE * SortedScalarPtrConst() const
+    { return(sorted_scalar.data()); }
+
+    /// Return range [ibegin,iend) of sorted vertices
+    ///   with scalar values in [s0,s1].
+    void SortedRange
+    (const IVOLDUAL::SCALAR_TYPE s0, const IVOLDUAL::SCALAR_TYPE s1,
+     VERTEX_INDEX & ibegin, VERTEX_INDEX & iend) const;
+
+    VERTEX_INDEX NumReclassified() const
+    { return(num_reclassified); }
+    VERTEX_INDEX NumUpdatedCubes() const
+    { return(num_updated_cubes); }
+  };
+
+
   // **************************************************
   // INTERVAL VOLUME POLY INFO
   // **************************************************
@@ -313,6 +783,36 @@ namespace IVOLDUAL {
     float elength_threshold;
     float jacobian_threshold;
 
+    /// If true, Laplacian edge length smoothing colors the vertex 
+    ///   adjacency graph and updates each color class on num_threads threads.
+    bool flag_lsmooth_elength_color;
+
+    /// Stop smoothing when no vertex moves more than smooth_move_epsilon
+    ///   in an iteration.
+    /// - If negative, run all iterations.
+    COORD_TYPE smooth_move_epsilon;
+
+    /// If true, stop Jacobian smoothing when the number of hexahedra
+    ///   with Jacobian below jacobian_threshold stops decreasing.
+    bool flag_smooth_stop_stalled;
+
+    /// Wall clock seconds allowed for each smoothing pass.
+    /// - If not positive, no time limit.
+    float smooth_time_limit;
+
+    /// If true, Jacobian smoothing moves interior vertices along
+    ///   the analytic gradient of the min Jacobian with a line search.
+    /// - Otherwise, Jacobian smoothing probes candidate positions.
+    bool flag_jacobian_gradient;
+
+    /// If true, repair hexahedra with Jacobian below jacobian_threshold
+    ///   worst first, after smoothing.
+    bool flag_repair_jacobian;
+
+    /// Wall clock milliseconds allowed for worst first Jacobian repair.
+    /// - If not positive, no time limit.
+    float repair_budget_ms;
+
     bool flag_split_hex;
     bool flag_collapse_hex;
 
@@ -338,6 +838,38 @@ namespace IVOLDUAL {
     /// - Used for case analysis.
     bool flag_set_interior_code_from_scalar;
 
+    /// Number of threads used in encoding the grid 
+    ///   and extracting the interval volume polytopes.
+    /// - If num_threads is 1, run in a single thread.
+    int num_threads;
+
+    /// Number of grid edges in each block edge of the min/max block index.
+    /// - Blocks with all scalar values below isovalue0 or all above
+    ///   isovalue1 are skipped in encoding and extraction.
+    /// - If block_edge_length is 0, do not use a block index.
+    AXIS_SIZE_TYPE block_edge_length;
+
+    /// File storing the interval volume lookup table.
+    /// - If the file contains the table, read the table from the file.
+    ///   Otherwise, create the table and write it to the file.
+    /// - If table_filename is empty, always create the table.
+    std::string table_filename;
+
+    /// If true, extract all intervals of a list of isovalues
+    ///   from a single classification of the grid vertices into bands.
+    /// - See IVOLDUAL_BAND_GRID.
+    bool flag_multi_interval;
+
+    /// If true, update the grid encoding and active cubes of the
+    ///   previous interval instead of encoding every grid vertex.
+    /// - See IVOLDUAL_INCREMENTAL_GRID.
+    bool flag_incremental;
+
+    /// Method for locating grid cubes in the list of active cubes.
+    /// - Sparse methods use memory proportional to the number
+    ///   of active cubes instead of the number of grid vertices.
+    CUBE_INDEX_METHOD cube_index_method;
+
   public:
 
     /// Constructor.
@@ -378,6 +910,10 @@ namespace IVOLDUAL {
   class IVOLDUAL_DATA:
     public IJKDUAL::DUALISO_DATA_BASE<IVOLDUAL_SCALAR_GRID,IVOLDUAL_DATA_FLAGS> 
   {
+  protected:
+    /// Min/max block index of scalar_grid.
+    IVOLDUAL_BLOCK_INDEX block_index;
+
   public:
     IVOLDUAL_DATA() {}; 
 
@@ -418,6 +954,15 @@ namespace IVOLDUAL {
     int symbol
       (const int cur, const SCALAR_TYPE v0, const SCALAR_TYPE v1);
 
+    /// Compute min/max block index of scalar_grid.
+    /// - Call after the scalar grid is set and modified.
+    /// - If block_edge_length is 0, clear the block index.
+    void ComputeBlockIndex(const AXIS_SIZE_TYPE block_edge_length);
+
+    /// Return min/max block index of scalar_grid.
+    const IVOLDUAL_BLOCK_INDEX & BlockIndex() const
+    { return(block_index); }
+
   };
 
   // **************************************************
@@ -427,6 +972,176 @@ namespace IVOLDUAL {
   typedef IJKDUAL::DUALISO_TIME DUALISO_TIME;
 
 
+  // **************************************************
+  // PROFILE
+  // **************************************************
+
+  /// Wall clock and cpu timer.
+  class PROFILE_TIMER {
+
+  protected:
+    std::chrono::steady_clock::time_point wall_start;
+    std::clock_t cpu_start;
+
+  public:
+    PROFILE_TIMER() { Restart(); };
+
+    /// Restart timer.
+    void Restart()
+    {
+      wall_start = std::chrono::steady_clock::now();
+      cpu_start = std::clock();
+    }
+
+    /// Wall clock seconds since timer was started.
+    double WallSeconds() const
+    {
+      const std::chrono::duration<double> t = 
+        std::chrono::steady_clock::now() - wall_start;
+      return(t.count());
+    }
+
+    /// Cpu seconds used by all threads since timer was started.
+    double CpuSeconds() const
+    { return(double(std::clock() - cpu_start)/CLOCKS_PER_SEC); }
+  };
+
+
+  /// Wall clock and cpu times of each stage of 
+  ///   interval volume construction.
+  class IVOLDUAL_PROFILE {
+
+  protected:
+    double wall[NUM_PROFILE_STAGES];
+    double cpu[NUM_PROFILE_STAGES];
+    int count[NUM_PROFILE_STAGES];
+
+  public:
+    IVOLDUAL_PROFILE() { Clear(); };
+
+    /// Name of stage, used as key in profile files.
+    static const char * StageName(const PROFILE_STAGE stage);
+
+    double Wall(const PROFILE_STAGE stage) const
+    { return(wall[stage]); }
+    double Cpu(const PROFILE_STAGE stage) const
+    { return(cpu[stage]); }
+
+    /// Number of times stage was run.
+    int Count(const PROFILE_STAGE stage) const
+    { return(count[stage]); }
+
+    /// Sum of wall clock times of all stages.
+    double TotalWall() const;
+
+    /// Sum of cpu times of all stages.
+    double TotalCpu() const;
+
+    /// Add times since timer was started to stage and restart timer.
+    void AddTime(const PROFILE_STAGE stage, PROFILE_TIMER & timer)
+    {
+      wall[stage] += timer.WallSeconds();
+      cpu[stage] += timer.CpuSeconds();
+      count[stage]++;
+      timer.Restart();
+    }
+
+    void Clear();
+    void Add(const IVOLDUAL_PROFILE & profile);
+  };
+
+
+  // **************************************************
+  // SMOOTHING CONTROL
+  // **************************************************
+
+  /// Number of iterations run by a smoothing pass 
+  ///   and the reason the pass stopped.
+  class IVOLDUAL_SMOOTH_INFO {
+
+  public:
+    IVOLDUAL_SMOOTH_INFO() { Clear(); };
+
+    /// Number of smoothing iterations completed.
+    int num_iterations;
+
+    SMOOTH_STOP_REASON stop_reason;
+
+    /// Description of stop reason, used in reports.
+    static const char * StopReasonName(const SMOOTH_STOP_REASON reason);
+
+    const char * StopReasonName() const
+    { return(StopReasonName(stop_reason)); }
+
+    void Clear()
+    {
+      num_iterations = 0;
+      stop_reason = SMOOTH_NOT_RUN;
+    }
+  };
+
+
+  /// Criteria for stopping a smoothing pass 
+  ///   before its maximum number of iterations,
+  ///   and method for moving vertices in Jacobian smoothing.
+  /// - Default constructor disables all criteria, 
+  ///   except stopping when no hexahedra have bad Jacobians,
+  ///   and selects probing candidate positions.
+  class IVOLDUAL_SMOOTH_CONTROL {
+
+  protected:
+    PROFILE_TIMER timer;
+
+  public:
+    IVOLDUAL_SMOOTH_CONTROL() { Init(); };
+    IVOLDUAL_SMOOTH_CONTROL(const IVOLDUAL_DATA_FLAGS & flags)
+    { Set(flags); };
+
+    /// Stop if no vertex moves more than move_epsilon.
+    /// - If negative, ignore vertex moves.
+    COORD_TYPE move_epsilon;
+
+    /// If true, stop if the number of hexahedra with bad Jacobian
+    ///   does not decrease.
+    bool flag_stop_stalled;
+
+    /// Wall clock seconds allowed for the smoothing pass.
+    /// - If not positive, no time limit.
+    float time_limit;
+
+    /// If true, move interior vertices along the analytic gradient
+    ///   of the min Jacobian instead of probing candidate positions.
+    bool flag_jacobian_gradient;
+
+    void Init();
+    void Set(const IVOLDUAL_DATA_FLAGS & flags);
+
+    /// Return true if vertex moves should be measured.
+    bool CheckMove() const
+    { return(move_epsilon >= 0); }
+
+    /// Restart timer and set smooth_info for a new smoothing pass.
+    void Start(IVOLDUAL_SMOOTH_INFO & smooth_info);
+
+    /// Return true if smoothing should stop before iteration it,
+    ///   given num_bad hexahedra with bad Jacobian.
+    /// - num_bad_prev is the number before iteration it-1.
+    /// - Sets smooth_info.stop_reason if returns true.
+    bool StopBeforeIteration
+      (const int it, const VERTEX_INDEX num_bad, 
+       const VERTEX_INDEX num_bad_prev, 
+       IVOLDUAL_SMOOTH_INFO & smooth_info) const;
+
+    /// Record a completed iteration in which no vertex moved 
+    ///   more than max_move.
+    /// - Return true if smoothing should stop.
+    /// - max_move is ignored unless CheckMove() is true.
+    /// - Sets smooth_info.stop_reason if returns true.
+    bool EndIteration
+      (const COORD_TYPE max_move, IVOLDUAL_SMOOTH_INFO & smooth_info) const;
+  };
+
+
   // **************************************************
   // DUALISO INFO
   // **************************************************
@@ -440,6 +1155,18 @@ namespace IVOLDUAL {
     int num_non_manifold_changes;
     int num_vertices_moved_in_expand_thin;
 
+    /// Iterations run by each smoothing pass and why each pass stopped.
+    IVOLDUAL_SMOOTH_INFO lsmooth_elength_info;
+    IVOLDUAL_SMOOTH_INFO lsmooth_jacobian_info;
+    IVOLDUAL_SMOOTH_INFO gsmooth_jacobian_info;
+
+    /// Number of hexahedra repairs by worst first Jacobian repair,
+    ///   stored in num_iterations, and why repair stopped.
+    IVOLDUAL_SMOOTH_INFO repair_jacobian_info;
+
+    /// Times of each stage of the last extraction.
+    IVOLDUAL_PROFILE profile;
+
     void Clear(); // clear all data
   };
 
@@ -463,6 +1190,495 @@ namespace IVOLDUAL {
   typedef IJKDUAL::MERGE_DATA MERGE_DATA;
 
 
+  // **************************************************
+  // SPARSE CUBE LIST
+  // **************************************************
+
+  /// List of grid cube indices with no duplicate entries.
+  /// - Locations of cubes in the list are stored in an open addressing
+  ///   hash table with linear probing.
+  /// - Memory is proportional to the number of cubes in the list,
+  ///   not to the number of grid vertices.
+  /// - Insert(), ClearList(), ListLength() and List() match 
+  ///   IJK::INTEGER_LIST, so SPARSE_CUBE_LIST can replace MERGE_DATA
+  ///   in IJK::merge_identical().
+  class SPARSE_CUBE_LIST {
+
+  protected:
+
+    /// Hash table entry.
+    typedef struct {
+      VERTEX_INDEX cube_index;
+      VERTEX_INDEX loc;
+    } ENTRY;
+
+    static const VERTEX_INDEX EMPTY = -1;
+
+    std::vector<VERTEX_INDEX> list;
+    std::vector<ENTRY> table;
+
+    /// table.size()-1.  table.size() is a power of 2.
+    VERTEX_INDEX mask;
+
+    VERTEX_INDEX Hash(const VERTEX_INDEX cube_index) const
+    { return(VERTEX_INDEX((unsigned int)(cube_index)*2654435769u) & mask); }
+
+    /// Resize table to hold at least n cubes and reinsert list.
+    void Rehash(const VERTEX_INDEX n);
+
+  public:
+    SPARSE_CUBE_LIST() { mask = 0; };
+
+    /// Insert cube_index and return its location in list.
+    /// - If cube_index is already in list, return its location.
+    VERTEX_INDEX Insert(const VERTEX_INDEX cube_index)
+    {
+      if (2*(list.size()+1) > table.size()) { Rehash(list.size()+1); }
+
+      VERTEX_INDEX k = Hash(cube_index);
+      while (table[k].cube_index != EMPTY) {
+        if (table[k].cube_index == cube_index) { return(table[k].loc); }
+        k = (k+1) & mask;
+      }
+
+      const VERTEX_INDEX loc = list.size();
+      table[k].cube_index = cube_index;
+      table[k].loc = loc;
+      list.push_back(cube_index);
+      return(loc);
+    }
+
+    /// Return location of cube_index in list.
+    /// - Return undefined_loc if cube_index is not in list.
+    VERTEX_INDEX Locate
+    (const VERTEX_INDEX cube_index, const VERTEX_INDEX undefined_loc) const
+    {
+      if (list.empty()) { return(undefined_loc); }
+
+      VERTEX_INDEX k = Hash(cube_index);
+      while (table[k].cube_index != EMPTY) {
+        if (table[k].cube_index == cube_index) { return(table[k].loc); }
+        k = (k+1) & mask;
+      }
+      return(undefined_loc);
+    }
+
+    /// Reserve space for n cubes.
+    void Reserve(const VERTEX_INDEX n);
+
+    /// Clear list.  Keep the table capacity.
+    void ClearList();
+
+    VERTEX_INDEX ListLength() const
+    { return(list.size()); }
+    VERTEX_INDEX List(const VERTEX_INDEX i) const
+    { return(list[i]); }
+  };
+
+
+  /// Index from grid cubes to locations in a list of cubes.
+  /// - Uses either an array with one entry per grid vertex
+  ///   or a SPARSE_CUBE_LIST.
+  /// - Does not own the array or the sparse list.
+  class INDEX_TO_CUBE_LIST {
+
+  protected:
+    const VERTEX_INDEX * index_to_cube_list;
+    const SPARSE_CUBE_LIST * sparse_cube_list;
+    VERTEX_INDEX num_grid_vertices;
+
+  public:
+    /// Constructor.  Empty index.  No cube is in the list.
+    INDEX_TO_CUBE_LIST()
+    {
+      this->index_to_cube_list = NULL;
+      this->sparse_cube_list = NULL;
+      this->num_grid_vertices = 0;
+    }
+
+    /// Constructor.
+    /// @param index_to_cube_list[icube] Location of icube in list,
+    ///   or num_grid_vertices if icube is not in list.
+    INDEX_TO_CUBE_LIST
+    (const VERTEX_INDEX index_to_cube_list[],
+     const VERTEX_INDEX num_grid_vertices)
+    {
+      this->index_to_cube_list = index_to_cube_list;
+      this->sparse_cube_list = NULL;
+      this->num_grid_vertices = num_grid_vertices;
+    }
+
+    /// Constructor.
+    INDEX_TO_CUBE_LIST
+    (const SPARSE_CUBE_LIST & sparse_cube_list,
+     const VERTEX_INDEX num_grid_vertices)
+    {
+      this->index_to_cube_list = NULL;
+      this->sparse_cube_list = &sparse_cube_list;
+      this->num_grid_vertices = num_grid_vertices;
+    }
+
+    VERTEX_INDEX NumGridVertices() const
+    { return(num_grid_vertices); }
+
+    /// Return location of cube_index in list.
+    /// - Return NumGridVertices() if cube_index is not in list.
+    VERTEX_INDEX Location(const VERTEX_INDEX cube_index) const
+    {
+      if (index_to_cube_list != NULL) 
+        { return(index_to_cube_list[cube_index]); }
+      else if (sparse_cube_list != NULL)
+        { return(sparse_cube_list->Locate(cube_index, num_grid_vertices)); }
+      else
+        { return(num_grid_vertices); }
+    }
+  };
+
+
+  // **************************************************
+  // GRID EDGE INTERSECTION CACHE
+  // **************************************************
+
+  /// Intersections of grid edges with the lower and upper isosurfaces.
+  /// - Grid edge (iv0,iv0+AxisIncrement(d)) is stored with the cube
+  ///   whose lowest/leftmost vertex is iv0, if that cube is in cube_list.
+  ///   Each stored edge is shared by up to four cubes.
+  /// - Stores only edges whose endpoint scalar values are not both
+  ///   below or both above the isovalue.
+  /// - Intersections not in the cache are computed on request
+  ///   with the same arithmetic, so results do not depend
+  ///   on whether the cache is set.
+  class IVOLDUAL_EDGE_ISECT_CACHE {
+
+  protected:
+    int dimension;
+    SCALAR_TYPE isovalue[2];
+    INDEX_TO_CUBE_LIST index_to_cube_list;
+
+    /// Bit 2*d+j of edge_bits[i] is set if the edge in direction d
+    ///   from the lowest vertex of cube i is stored for isovalue[j].
+    std::vector<unsigned char> edge_bits;
+
+    /// Coordinates of the first intersection stored for cube i.
+    std::vector<VERTEX_INDEX> first_point;
+
+    /// Intersection coordinates.
+    COORD_ARRAY point_coord;
+
+  public:
+    IVOLDUAL_EDGE_ISECT_CACHE() { Clear(); };
+
+    /// Compute and store intersections of the edges of cubes in cube_list
+    ///   with isovalue0 and isovalue1.
+    /// - Split cube_list among num_threads threads.
+    /// - Cache is left empty if dimension is greater than 4.
+    /// @param index_to_cube_list Location of cubes in cube_list.
+    ///   Must remain valid while the cache is used.
+    void Set(const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+             const std::vector<GRID_CUBE_DATA> & cube_list,
+             const INDEX_TO_CUBE_LIST & index_to_cube_list,
+             const SCALAR_TYPE isovalue0, const SCALAR_TYPE isovalue1,
+             const int num_threads);
+
+    /// Remove all intersections.  Keep capacity.
+    void Clear();
+
+    /// Return number of stored intersections.
+    VERTEX_INDEX NumPoints() const
+    { return((dimension > 0) ? point_coord.size()/dimension : 0); }
+
+    /// Return stored intersection of grid edge (iend0,edge_dir) 
+    ///   with isovalue, or NULL if not stored.
+    const COORD_TYPE * StoredIntersection
+    (const VERTEX_INDEX iend0, const int edge_dir, 
+     const SCALAR_TYPE isovalue) const;
+
+    /// Compute intersection of grid edge (iend0,edge_dir) with isovalue.
+    /// - Use stored intersection if available.
+    /// - Use edge midpoint if s0 and s1 are both below 
+    ///   or both above isovalue.
+    void ComputeIntersection
+    (const DUALISO_SCALAR_GRID_BASE & scalar_grid,
+     const VERTEX_INDEX iend0, const int edge_dir,
+     const SCALAR_TYPE s0, const SCALAR_TYPE s1,
+     const SCALAR_TYPE isovalue, 
+     COORD_TYPE * temp_coord0, COORD_TYPE * temp_coord1,
+     COORD_TYPE * coord) const;
+  };
+
+
+  // **************************************************
+  // HEXAHEDRON JACOBIAN CACHE
+  // **************************************************
+
+  /// Normalized Jacobian determinants at the corners of each hexahedron.
+  /// - Callers report moved vertices with MarkMovedVertex().
+  ///   Update() recomputes only hexahedra incident on those vertices.
+  /// - Cached values equal the values computed by
+  ///   compute_hexahedron_normalized_Jacobian_determinants().
+  class IVOLDUAL_HEX_JACOBIAN_CACHE {
+
+  protected:
+    static const int NUM_VERT_PER_HEX = 8;
+
+    /// Jacobian determinant at corner k of hex ihex is
+    ///   jacobian[ihex*NUM_VERT_PER_HEX+k].
+    std::vector<COORD_TYPE> jacobian;
+
+    /// Minimum Jacobian determinant of each hexahedron.
+    std::vector<COORD_TYPE> min_jacobian;
+
+    /// flag_dirty[ihex] is true if ihex is in dirty_hex.
+    std::vector<bool> flag_dirty;
+
+    /// Hexahedra to recompute.
+    std::vector<VERTEX_INDEX> dirty_hex;
+
+    /// Compute Jacobian determinants of hexahedron ihex.
+    void ComputeHex
+    (const std::vector<VERTEX_INDEX> & ivolpoly_vert,
+     const COORD_ARRAY & vertex_coord, const VERTEX_INDEX ihex);
+
+  public:
+    IVOLDUAL_HEX_JACOBIAN_CACHE() {};
+
+    /// Compute Jacobian determinants of all hexahedra.
+    void Set(const std::vector<VERTEX_INDEX> & ivolpoly_vert,
+             const COORD_ARRAY & vertex_coord);
+
+    /// Mark hexahedra incident on vertex iv for recomputation.
+    /// @param vertex_poly_incidence Hexahedra incident on each vertex.
+    void MarkMovedVertex(const VERTEX_INDEX iv,
+                         const IJK::VERTEX_POLY_INCIDENCE<int,int> & 
+                         vertex_poly_incidence);
+
+    /// Recompute Jacobian determinants of hexahedra marked
+    ///   by MarkMovedVertex() since the last Set() or Update().
+    /// - Calls Set() if the number of hexahedra changed.
+    /// @param[out] num_recomputed Number of hexahedra recomputed.
+    void Update(const std::vector<VERTEX_INDEX> & ivolpoly_vert,
+                const COORD_ARRAY & vertex_coord,
+                VERTEX_INDEX & num_recomputed);
+
+    /// Remove all determinants.
+    void Clear();
+
+    /// Return number of hexahedra.
+    VERTEX_INDEX NumHex() const
+    { return(min_jacobian.size()); }
+
+    /// Return Jacobian determinant of hexahedron ihex at corner k.
+    COORD_TYPE Jacobian(const VERTEX_INDEX ihex, const int k) const
+    { return(jacobian[ihex*NUM_VERT_PER_HEX+k]); }
+
+    /// Return pointer to the eight Jacobian determinants
+    ///   of hexahedron ihex.
+    const COORD_TYPE * HexJacobian(const VERTEX_INDEX ihex) const
+    { return(&(jacobian[ihex*NUM_VERT_PER_HEX])); }
+
+    /// Return minimum Jacobian determinant of hexahedron ihex.
+    COORD_TYPE MinJacobian(const VERTEX_INDEX ihex) const
+    { return(min_jacobian[ihex]); }
+  };
+
+
+  // **************************************************
+  // PER THREAD LISTS
+  // **************************************************
+
+  /// Lists constructed by each thread range.
+  /// - Stored in IVOLDUAL_CONTEXT so that the lists keep 
+  ///   their capacity between extractions.
+  class IVOLDUAL_THREAD_LISTS {
+
+  public:
+
+    /// slab_cube[k] is the list of active cubes in grid vertex slab k.
+    /// - Active cubes in slab 0 are stored directly in the output,
+    ///   so slab_cube[0] is not used.
+    std::vector<ACTIVE_CUBE_ARRAY> slab_cube;
+
+    /// seam_cube[k] is the list of active cubes in the cube layer
+    ///   between grid vertex slabs k and k+1.
+    std::vector<ACTIVE_CUBE_ARRAY> seam_cube;
+
+    /// slab_end[k] is one more than the last vertex layer in slab k.
+    std::vector<VERTEX_INDEX> slab_end;
+
+    /// edge_list[k] is the list of dual grid edges found by range k.
+    std::vector<DUAL_GRID_EDGE_ARRAY> edge_list;
+
+    /// vertex_list[k] is the list of dual grid vertices found by range k.
+    std::vector< std::vector<VERTEX_INDEX> > vertex_list;
+  };
+
+
+  // **************************************************
+  // EXTRACTION CONTEXT
+  // **************************************************
+
+  /// Buffers used in constructing an interval volume.
+  /// - Buffers keep their capacity between extractions,
+  ///   so repeated extractions on the same grid reuse them
+  ///   instead of reallocating them.
+  /// - A context may be used by only one extraction at a time.
+  class IVOLDUAL_CONTEXT {
+
+  protected:
+
+    /// Merge data for the grid.  Allocated by MergeData().
+    IJKDUAL::ISO_MERGE_DATA * merge_data;
+
+    /// Axis sizes of the grid of merge_data.
+    std::vector<AXIS_SIZE_TYPE> merge_data_axis_size;
+
+    // Copying would share merge_data.  Not implemented.
+    IVOLDUAL_CONTEXT(const IVOLDUAL_CONTEXT &);
+    const IVOLDUAL_CONTEXT & operator = (const IVOLDUAL_CONTEXT &);
+
+  public:
+    IVOLDUAL_ENCODED_GRID encoded_grid;
+    IVOLDUAL_ENCODED_BLOCKS encoded_blocks;
+    ACTIVE_CUBE_ARRAY active_cube_list;
+
+    std::vector<ISO_VERTEX_INDEX> ivolpoly;
+    std::vector<POLY_VERTEX_INDEX> poly_vertex;
+    std::vector<ISO_VERTEX_INDEX> cube_list;
+    std::vector<ISO_VERTEX_INDEX> ivolpoly_cube;
+    std::vector<GRID_CUBE_DATA> cube_ivolv_list;
+
+    /// index_to_cube_list[icube] is the location of cube icube
+    ///   in cube_ivolv_list, or the number of grid vertices
+    ///   if icube is not in cube_ivolv_list.
+    /// - Only entries of cubes in cube_list are reset by SetGrid().
+    /// - Allocated by AllocateIndexToCubeList().
+    ///   Not used if cubes are located with sparse_cube_list.
+    std::vector<VERTEX_INDEX> index_to_cube_list;
+
+    /// Cubes in cube_list and their locations.
+    /// - Replaces merge data and index_to_cube_list
+    ///   if few grid cubes are active.
+    SPARSE_CUBE_LIST sparse_cube_list;
+
+    IVOL_VERTEX_ADJACENCY_LIST vertex_adjacency_list;
+    IJK::VERTEX_POLY_INCIDENCE<int,int> vertex_poly_incidence;
+
+    /// Intersections of grid edges with lower and upper isosurfaces.
+    IVOLDUAL_EDGE_ISECT_CACHE edge_isect_cache;
+
+    /// Grid edges and grid vertices dual to interval volume polytopes.
+    /// - Only set if the grid dimension is 3.
+    std::vector<DUAL_GRID_EDGE_ARRAY> dual_edge_list;
+    std::vector<VERTEX_INDEX> dual_vertex_list;
+
+    IVOLDUAL_THREAD_LISTS thread_lists;
+
+    /// Number of interval volume hexahedra incident on each ivol vertex.
+    /// - Set by set_ivol_vertex_info().
+    std::vector<ISO_VERTEX_INDEX> num_hex_incident_on_ivolv;
+
+  public:
+    IVOLDUAL_CONTEXT() { merge_data = NULL; };
+    ~IVOLDUAL_CONTEXT();
+
+    /// Prepare buffers for an extraction from grid.
+    /// - Resets index_to_cube_list.
+    void SetGrid(const DUALISO_GRID & grid);
+
+    /// Allocate index_to_cube_list with one entry per grid vertex.
+    /// - Does nothing if index_to_cube_list is already allocated for grid.
+    void AllocateIndexToCubeList(const DUALISO_GRID & grid);
+
+    /// Return merge data for grid.
+    /// - Merge data is reallocated only if the grid size changes.
+    MERGE_DATA & MergeData(const DUALISO_GRID & grid);
+  };
+
+
+  // **************************************************
+  // EXTRACTION OPTIONS
+  // **************************************************
+
+  /// Optional data used in constructing an interval volume.
+  /// - Each member is NULL if not used.
+  /// - Data is not owned by the options.
+  class IVOLDUAL_EXTRACT_OPTIONS {
+
+  protected:
+    void Init();
+
+  public:
+
+    /// Min/max block index of the scalar grid.
+    /// - Blocks outside the interval volume are skipped.
+    /// - If NULL or not set, no blocks are skipped.
+    const IVOLDUAL_BLOCK_INDEX * block_index;
+
+    /// Grid vertex bands computed by
+    ///   encode_grid_vertex_bands_and_active_cubes().
+    /// - If not NULL, grid vertices are encoded from band_grid.
+    const IVOLDUAL_BAND_GRID * band_grid;
+
+    /// Interval of band_grid.
+    int interval;
+
+    /// Active cubes of interval computed by
+    ///   encode_grid_vertex_bands_and_active_cubes().
+    const ACTIVE_CUBE_ARRAY * band_active_cube_list;
+
+    /// Encoding of the previous interval.
+    /// - If not NULL, the encoding is updated from the previous interval.
+    IVOLDUAL_INCREMENTAL_GRID * incremental_grid;
+
+    /// Buffers for intermediate results.
+    /// - If NULL, buffers are allocated on each extraction.
+    IVOLDUAL_CONTEXT * context;
+
+    /// Merge data for the scalar grid.
+    /// - If NULL, merge data is allocated in context if it is needed.
+    MERGE_DATA * merge_data;
+
+  public:
+    IVOLDUAL_EXTRACT_OPTIONS() { Init(); };
+
+    /// Set block_index.
+    void SetBlockIndex(const IVOLDUAL_BLOCK_INDEX & block_index)
+    { this->block_index = &block_index; }
+
+    /// Encode grid vertices from interval of band_grid.
+    /// @pre 0 <= interval < band_grid.NumIntervals().
+    void SetBandGrid
+    (const IVOLDUAL_BAND_GRID & band_grid, const int interval,
+     const ACTIVE_CUBE_ARRAY & active_cube_list);
+
+    /// Update encoding in incremental_grid.
+    /// @pre incremental_grid.SetScalarGrid() has been called
+    ///   with the scalar grid.
+    void SetIncrementalGrid(IVOLDUAL_INCREMENTAL_GRID & incremental_grid)
+    { this->incremental_grid = &incremental_grid; }
+
+    /// Store intermediate results in context.
+    void SetContext(IVOLDUAL_CONTEXT & context)
+    { this->context = &context; }
+
+    /// Set merge_data.
+    void SetMergeData(MERGE_DATA & merge_data)
+    { this->merge_data = &merge_data; }
+
+    /// Return true if grid vertices are encoded from band_grid.
+    bool UseBandGrid() const
+    { return(band_grid != NULL); }
+
+    /// Return true if encoding is updated in incremental_grid.
+    bool UseIncrementalGrid() const
+    { return(incremental_grid != NULL); }
+
+    /// Check options.
+    /// - Return false if both band_grid and incremental_grid are set.
+    bool Check(IJK::ERROR & error) const;
+  };
+
+
   // **************************************************
   // INTERVAL VOLUME MESH VERT INFO
   // **************************************************
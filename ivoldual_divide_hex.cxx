@@ -43,13 +43,15 @@ void IVOLDUAL::collapse_hex
 
   // Loop over polytopeS to find vertex with negative Jacobian and indentation.
   for (int ihex = 0; ihex < ivolpoly_vert.size() / NUM_VERT_PER_HEX; ihex++) {
+    // Compute Jacobian at all hex vertices
+    COORD_TYPE hex_jacob[NUM_VERT_PER_HEX];
+    compute_hexahedron_normalized_Jacobian_determinants
+      (ivolpoly_vert, ihex, vertex_coord, hex_jacob);
+
     for (int icorner = 0; icorner < NUM_VERT_PER_HEX; icorner++) {
     	
     	int cur = ivolpoly_vert[ihex*8+icorner];
-      // Compute Jacobian at current vertex
-      COORD_TYPE jacob;        
-      compute_hexahedron_normalized_Jacobian_determinant
-        (ivolpoly_vert, ihex, vertex_coord, icorner, jacob);
+      const COORD_TYPE jacob = hex_jacob[icorner];
       if (jacob < jacobian_limit && ivolv_list[cur].num_incident_hex == 4 && 
       	  ivolv_list[cur].num_incident_iso_quad == 0)
       {
@@ -67,16 +69,20 @@ void IVOLDUAL::collapse_hex
   }
 
   // Remove deleted hexahedra.
+  // Keep ivolpoly_info aligned with ivolpoly_vert.
   std::vector<VERTEX_INDEX> ivolpoly_vert_new;
+  IVOLDUAL_POLY_INFO_ARRAY ivolpoly_info_new;
   for (int i = 0; i < ivolpoly_info.size(); i++) {
   	if (!ivolpoly_info[i].flag_subdivide_hex) {
 			for (int j = 0; j < 8; j++) {
 				int cur = ivolpoly_vert[i*8 + j];
 				ivolpoly_vert_new.push_back(ivolv_list[cur].map_to);
 			} 		
+			ivolpoly_info_new.push_back(ivolpoly_info[i]);
   	}
   }
   ivolpoly_vert = move(ivolpoly_vert_new);
+  ivolpoly_info = move(ivolpoly_info_new);
 }
 
 void IVOLDUAL::split_hex
@@ -93,13 +99,14 @@ void IVOLDUAL::split_hex
 
   // Loop over every polytope to find vertex with negative Jacobian and indentation feature.
   for (int ihex = 0; ihex < ivolpoly_vert.size() / NUM_VERT_PER_HEX; ihex++) {
+    // Compute Jacobian at all hex vertices
+    COORD_TYPE hex_jacob[NUM_VERT_PER_HEX];
+    compute_hexahedron_normalized_Jacobian_determinants
+      (ivolpoly_vert, ihex, vertex_coord, hex_jacob);
+
     for (int icorner = 0; icorner < NUM_VERT_PER_HEX; icorner++) {
     	int cur = ivolpoly_vert[ihex*8+icorner];
-
-      // Compute Jacobian at current vertex
-      COORD_TYPE jacob;        
-      compute_hexahedron_normalized_Jacobian_determinant
-        (ivolpoly_vert, ihex, vertex_coord, icorner, jacob);
+      const COORD_TYPE jacob = hex_jacob[icorner];
 
       if (jacob < jacobian_limit)
       {
@@ -116,15 +123,19 @@ void IVOLDUAL::split_hex
      ivolpoly_info, vertex_subdivide_list, vertex_coord);
 
   // Remove deleted hexahedra.
+  // Keep ivolpoly_info aligned with ivolpoly_vert.
   std::vector<VERTEX_INDEX> ivolpoly_vert_new;
+  IVOLDUAL_POLY_INFO_ARRAY ivolpoly_info_new;
   for (int i = 0; i < ivolpoly_info.size(); i++) {
   	if (!ivolpoly_info[i].flag_subdivide_hex) {
   		for (int j = 0; j < 8; j++) {
   			ivolpoly_vert_new.push_back(ivolpoly_vert[i*8 + j]);
   		} 		
+  		ivolpoly_info_new.push_back(ivolpoly_info[i]);
   	}
   }
   ivolpoly_vert = move(ivolpoly_vert_new);
+  ivolpoly_info = move(ivolpoly_info_new);
 }
 
 void IVOLDUAL::subdivide_hex_to_four
@@ -161,8 +172,11 @@ void IVOLDUAL::subdivide_hex_to_four
   	for (int ipoly = 0; ipoly < vertex_poly_incidence.NumIncidentPoly(ivertex); ipoly++) {
 			const int ihex = vertex_poly_incidence.IncidentPoly(ivertex, ipoly);
 			// Flag subdivided hex.
+			// Its four children inherit its polytope information.
+			IVOLDUAL_POLY_INFO child_info = ivolpoly_info[ihex];
+			child_info.flag_subdivide_hex = false;
 			ivolpoly_info[ihex].flag_subdivide_hex = true;
-			ivolpoly_info.resize(ivolpoly_info.size() + 4);
+			ivolpoly_info.insert(ivolpoly_info.end(), 4, child_info);
 
 			// Forbid subdividing other polytopes around this vertex
 			for (int i = 0; i < 8; i++) {
@@ -198,6 +212,7 @@ void IVOLDUAL::subdivide_hex_to_four
 					}
 					new_vertex[iv[i]] = iw[i];
 					ivolv_list.push_back(ivolv_list.back());
+					ivolv_list.back().map_to = ivolv_list.size()-1;
 				}
 				// Get a existing vertex.
 				else {
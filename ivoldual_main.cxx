@@ -30,6 +30,7 @@
 
 #include "ivoldual_triangulate.h"
 #include "ivoldual_reposition.h"
+#include "ivoldual_stream.h"
 
 using namespace IJK;
 using namespace IJKDUAL;
@@ -45,7 +46,12 @@ void eliminate_non_manifold
  IVOLDUAL_INFO & dualiso_info);
 void construct_interval_volume
 (const IO_INFO & io_info, const IVOLDUAL_DATA & ivoldual_data,
- DUALISO_TIME & dualiso_time, IO_TIME & io_time, IVOLDUAL_INFO & dualiso_info);
+ DUALISO_TIME & dualiso_time, IO_TIME & io_time, IVOLDUAL_PROFILE & profile,
+ IVOLDUAL_INFO & dualiso_info);
+void report_time_and_profile
+(const IO_INFO & io_info, const IO_TIME & io_time, 
+ const DUALISO_TIME & dualiso_time, const IVOLDUAL_PROFILE & profile,
+ ELAPSED_TIME & elapsed_time);
 
 
 // **************************************************
@@ -54,11 +60,11 @@ void construct_interval_volume
 
 int main(int argc, char **argv)
 {
-  time_t start_time;
-  time(&start_time);
+  ELAPSED_TIME elapsed_time;
 
   DUALISO_TIME dualiso_time;
   IO_TIME io_time = {0.0, 0.0};
+  IVOLDUAL_PROFILE profile;
   IO_INFO io_info;
   IJK::ERROR error;
 
@@ -71,10 +77,22 @@ int main(int argc, char **argv)
 
     parse_command_line(argc, argv, io_info);
 
+    if (io_info.stream_slab_thickness > 0) {
+      // Read and process the grid one slab at a time.
+      stream_interval_volume(io_info, dualiso_time, io_time, profile);
+
+      report_time_and_profile
+        (io_info, io_time, dualiso_time, profile, elapsed_time);
+
+      return(0);
+    }
+
     DUALISO_SCALAR_GRID full_scalar_grid, scalar_grid_4D;
     NRRD_HEADER nrrd_header;
+    PROFILE_TIMER timer;
     read_nrrd_file
       (io_info.input_filename, full_scalar_grid,  nrrd_header, io_time);
+    profile.AddTime(PROFILE_READ, timer);
 
     if (!check_input(io_info, full_scalar_grid, error)) 
       { throw(error); };
@@ -105,6 +123,7 @@ int main(int argc, char **argv)
     }
 
     ivoldual_data.Set(io_info);
+    ivoldual_data.ComputeBlockIndex(io_info.block_edge_length);
     warn_non_manifold(io_info);
     report_num_cubes(full_scalar_grid, io_info, ivoldual_data);
 
@@ -114,7 +133,7 @@ int main(int argc, char **argv)
     }
 
     construct_interval_volume
-      (io_info, ivoldual_data, dualiso_time, io_time, dualiso_info);
+      (io_info, ivoldual_data, dualiso_time, io_time, profile, dualiso_info);
 
     /* OBSOLETE.  MOVED TO report_ivol_info.
     // print out total number of changes for eliminating non-manifold
@@ -123,15 +142,8 @@ int main(int argc, char **argv)
     }
     */
     
-    if (io_info.flag_report_time) {
-
-      time_t end_time;
-      time(&end_time);
-      double total_elapsed_time = difftime(end_time, start_time);
-
-      cout << endl;
-      report_time(io_info, io_time, dualiso_time, total_elapsed_time);
-    };
+    report_time_and_profile
+      (io_info, io_time, dualiso_time, profile, elapsed_time);
 
   } 
   catch (ERROR & error) {
@@ -159,7 +171,8 @@ void eliminate_non_manifold
 
 void construct_interval_volume
 (const IO_INFO & io_info, const IVOLDUAL_DATA & ivoldual_data,
- DUALISO_TIME & dualiso_time, IO_TIME & io_time, IVOLDUAL_INFO & dualiso_info)
+ DUALISO_TIME & dualiso_time, IO_TIME & io_time, IVOLDUAL_PROFILE & profile,
+ IVOLDUAL_INFO & dualiso_info)
 {
   int dimension = ivoldual_data.ScalarGrid().Dimension();
   const int num_cube_vertices = IJK::compute_num_cube_vertices(dimension);
@@ -167,6 +180,49 @@ void construct_interval_volume
 
   io_time.write_time = 0;
 
+  // Classify grid vertices once for all intervals.
+  IVOLDUAL_BAND_GRID band_grid;
+  std::vector<ACTIVE_CUBE_ARRAY> active_cube_list;
+  bool flag_multi_interval = false;
+  if (io_info.flag_multi_interval && io_info.isovalue.size() > 2) {
+    flag_multi_interval = band_grid.SetIsovalues
+      (io_info.isovalue, io_info.flag_set_interior_code_from_scalar,
+       io_info.default_interior_code);
+
+    if (flag_multi_interval) {
+      encode_grid_vertex_bands_and_active_cubes
+        (ivoldual_data, band_grid, active_cube_list, dualiso_info);
+      dualiso_time.Add(dualiso_info.time);
+      profile.Add(dualiso_info.profile);
+    }
+    else {
+      cerr << "Warning: Isovalues are not strictly increasing" << endl
+           << "  or there are too many isovalues for -multi_interval." 
+           << endl
+           << "  Extracting each interval separately." << endl;
+    }
+  }
+
+  // Update the classification of the previous interval.
+  IVOLDUAL_INCREMENTAL_GRID incremental_grid;
+  const bool flag_incremental = 
+    (io_info.flag_incremental && !flag_multi_interval);
+  if (flag_incremental) {
+    incremental_grid.SetScalarGrid
+      (ivoldual_data.ScalarGrid(), 
+       ivoldual_data.flag_set_interior_code_from_scalar,
+       ivoldual_data.default_interior_code);
+  }
+
+  // Reuse buffers between intervals.
+  IVOLDUAL_CONTEXT context;
+  IVOLDUAL_EXTRACT_OPTIONS options;
+  DUAL_INTERVAL_VOLUME interval_volume(dimension, num_cube_vertices);
+
+  options.SetContext(context);
+  if (flag_incremental) 
+    { options.SetIncrementalGrid(incremental_grid); }
+
   for (unsigned int i = 0; i+1 < io_info.isovalue.size(); i++) {
 
     const SCALAR_TYPE isovalue0 = io_info.isovalue[i];
@@ -175,14 +231,22 @@ void construct_interval_volume
     dualiso_info.grid.num_cubes = num_cubes;
 
     // Dual contouring.  
-    DUAL_INTERVAL_VOLUME interval_volume(dimension, num_cube_vertices);
+    if (flag_multi_interval) 
+      { options.SetBandGrid(band_grid, i, active_cube_list[i]); }
 
     dual_contouring_interval_volume
-      (ivoldual_data, isovalue0, isovalue1, interval_volume,
+      (ivoldual_data, isovalue0, isovalue1, options, interval_volume,
        dualiso_info);
 
+    if (flag_multi_interval) {
+      // Free active cubes of interval i.
+      ACTIVE_CUBE_ARRAY().swap(active_cube_list[i]);
+    }
+
     // Time info
     dualiso_time.Add(dualiso_info.time);
+    profile.Add(dualiso_info.profile);
+    PROFILE_TIMER timer;
 
     // Rescale vertex coordinates. 
     rescale_vertex_coord
@@ -191,6 +255,7 @@ void construct_interval_volume
 
     if (ivoldual_data.UseTriangleMesh()) {
       triangulate_interval_volume(ivoldual_data, interval_volume);
+      profile.AddTime(PROFILE_TRIANGULATE, timer);
     }
 
 
@@ -198,8 +263,10 @@ void construct_interval_volume
     output_info.SetDimension(dimension, num_cube_vertices);
     set_output_info(io_info, i, output_info);
 
+    timer.Restart();
     output_dual_interval_volume
       (output_info, ivoldual_data, interval_volume, dualiso_info, io_time);
+    profile.AddTime(PROFILE_WRITE, timer);
 
     if (output_info.flag_report_all_isov) {
       report_all_ivol_vert
@@ -214,6 +281,23 @@ void construct_interval_volume
 }
 
 
+void report_time_and_profile
+(const IO_INFO & io_info, const IO_TIME & io_time, 
+ const DUALISO_TIME & dualiso_time, const IVOLDUAL_PROFILE & profile,
+ ELAPSED_TIME & elapsed_time)
+{
+  const double total_elapsed_time = elapsed_time.getElapsed();
+
+  if (io_info.flag_report_time) {
+    cout << endl;
+    report_time(io_info, io_time, dualiso_time, total_elapsed_time);
+  }
+
+  if (io_info.flag_write_profile) 
+    { write_profile(io_info, profile, total_elapsed_time); }
+}
+
+
 void memory_exhaustion()
 {
   cerr << "Error: Out of memory.  Terminating program." << endl;
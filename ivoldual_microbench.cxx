@@ -0,0 +1,610 @@
+/// \file ivoldual_microbench.cxx
+/// Microbenchmarks for the inner kernels of interval volume construction.
+
+/*
+  IJK: Isosurface Jeneration Kode
+  Copyright (C) 2018 Rephael Wenger
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public License
+  (LGPL) as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "ijkcoord.txx"
+#include "ijkIO.txx"
+#include "ijkmerge.txx"
+
+#include "ivoldual.h"
+#include "ivoldual_compute.h"
+#include "ivoldualtable.h"
+
+using namespace IJK;
+using namespace IVOLDUAL;
+
+using namespace std;
+
+
+// **************************************************
+// HEAP ALLOCATION COUNTER
+// **************************************************
+
+// Bytes allocated by operator new.
+// - Used to report heap bytes allocated per kernel operation.
+std::atomic<long long> num_bytes_allocated(0);
+
+// Replacement operator new allocates with malloc() and replacement
+//   operator delete releases with free().  Neither is inlined,
+//   so the compiler does not pair the free() with the library
+//   operator new at call sites.
+#if defined(__GNUC__)
+#define MICROBENCH_NOINLINE __attribute__((noinline))
+#else
+#define MICROBENCH_NOINLINE
+#endif
+
+MICROBENCH_NOINLINE void * operator new(std::size_t n)
+{
+  num_bytes_allocated += n;
+  void * p = std::malloc(n == 0 ? 1 : n);
+  if (p == NULL) { throw std::bad_alloc(); }
+  return(p);
+}
+
+MICROBENCH_NOINLINE void operator delete(void * p) noexcept
+{ std::free(p); }
+
+
+// **************************************************
+// TYPES
+// **************************************************
+
+typedef enum { JACOBIAN_KERNEL, JACOBIAN_HEX_KERNEL, TABLE_INDEX_KERNEL,
+               MERGE_DENSE_KERNEL, MERGE_SPARSE_KERNEL,
+               ADJACENCY_SET_KERNEL, IS_ADJACENT_KERNEL, VTK_WRITE_KERNEL,
+               NUM_KERNELS } KERNEL_TYPE;
+
+// Benchmark parameters.
+class MICROBENCH_INFO {
+
+public:
+  std::vector<KERNEL_TYPE> kernel;
+  std::vector<AXIS_SIZE_TYPE> size;
+  double min_seconds;
+  bool flag_csv;
+
+  MICROBENCH_INFO()
+  {
+    min_seconds = 0.2;
+    flag_csv = false;
+  }
+};
+
+// Input to the kernels.
+// - Interval volume of a gyroid field on a size^3 grid.
+class MICROBENCH_INPUT {
+
+public:
+  AXIS_SIZE_TYPE size;
+  DUALISO_SCALAR_GRID scalar_grid;
+  IVOLDUAL_CONTEXT context;
+  std::vector<ISO_VERTEX_INDEX> ivolpoly_vert;
+  IVOLDUAL_POLY_INFO_ARRAY ivolpoly_info;
+  DUAL_IVOLVERT_ARRAY ivolv_list;
+  COORD_ARRAY vertex_coord;
+
+  /// Copy of context.cube_ivolv_list.
+  std::vector<GRID_CUBE_DATA> cube_ivolv_list;
+
+  /// Cube containing each interval volume polytope vertex.
+  /// - Input to merge_identical.
+  std::vector<ISO_VERTEX_INDEX> ivolpoly_cube_list;
+
+  VERTEX_INDEX NumHex() const
+  { return(ivolpoly_vert.size()/8); }
+};
+
+
+// **************************************************
+// LOCAL SUBROUTINES
+// **************************************************
+
+void parse_command_line
+(int argc, char **argv, MICROBENCH_INFO & microbench_info);
+void set_input(const AXIS_SIZE_TYPE size, MICROBENCH_INPUT & input);
+void run_kernel
+(const MICROBENCH_INFO & microbench_info, const KERNEL_TYPE kernel,
+ MICROBENCH_INPUT & input);
+void usage_error(), help();
+
+
+// **************************************************
+// MAIN
+// **************************************************
+
+int main(int argc, char **argv)
+{
+  MICROBENCH_INFO microbench_info;
+
+  try {
+
+    parse_command_line(argc, argv, microbench_info);
+
+    if (microbench_info.flag_csv)
+      { cout << "kernel,size,ops,ns_per_op,bytes_per_op" << endl; }
+    else {
+      cout << left << setw(14) << "kernel" << right
+           << setw(6) << "size" << setw(12) << "ops"
+           << setw(12) << "ns/op" << setw(12) << "bytes/op" << endl;
+    }
+
+    for (int i = 0; i < microbench_info.size.size(); i++) {
+      MICROBENCH_INPUT input;
+      set_input(microbench_info.size[i], input);
+
+      for (int j = 0; j < microbench_info.kernel.size(); j++)
+        { run_kernel(microbench_info, microbench_info.kernel[j], input); }
+    }
+
+  }
+  catch (ERROR & error) {
+    if (error.NumMessages() == 0) {
+      cerr << "Unknown error." << endl;
+    }
+    else { error.Print(cerr); }
+    cerr << "Exiting." << endl;
+    exit(20);
+  }
+  catch (...) {
+    cerr << "Unknown error." << endl;
+    exit(50);
+  };
+
+}
+
+
+// **************************************************
+// SET INPUT
+// **************************************************
+
+void set_input(const AXIS_SIZE_TYPE size, MICROBENCH_INPUT & input)
+{
+  const int DIM3(3);
+  const AXIS_SIZE_TYPE axis_size[DIM3] = { size, size, size };
+  const double K = 2*3.14159265358979323846*4/(size-1);
+  const SCALAR_TYPE isovalue0 = -0.4;
+  const SCALAR_TYPE isovalue1 = 0.4;
+  IVOLDUAL_BLOCK_INDEX block_index;
+  IVOLDUAL_EXTRACT_OPTIONS options;
+  IVOLDUAL_DATA_FLAGS flags;
+  IVOLDUAL_INFO ivoldual_info(DIM3);
+
+  input.size = size;
+  input.scalar_grid.SetSize(DIM3, axis_size);
+  for (VERTEX_INDEX iv = 0; iv < input.scalar_grid.NumVertices(); iv++) {
+    GRID_COORD_TYPE c[DIM3];
+    input.scalar_grid.ComputeCoord(iv, c);
+    const double x = K*c[0], y = K*c[1], z = K*c[2];
+    input.scalar_grid.Set
+      (iv, std::sin(x)*std::cos(y) + std::sin(y)*std::cos(z) +
+       std::sin(z)*std::cos(x));
+  }
+
+  // Use the dense cube index so merge data is allocated in context.
+  flags.cube_index_method = DENSE_CUBE_INDEX;
+  block_index.Set(input.scalar_grid, flags.block_edge_length);
+
+  const IVOLDUAL_CUBE_TABLE & ivoldual_table =
+    get_ivoldual_cube_table(DIM3, flags.SeparateNegFlag(), "");
+
+  options.SetContext(input.context);
+  options.SetBlockIndex(block_index);
+  dual_contouring_interval_volume
+    (input.scalar_grid, isovalue0, isovalue1, ivoldual_table, flags, 
+     options, input.ivolpoly_vert, input.ivolv_list, input.ivolpoly_info, 
+     input.vertex_coord, ivoldual_info);
+
+  input.cube_ivolv_list = input.context.cube_ivolv_list;
+  input.ivolpoly_cube_list = input.context.ivolpoly;
+}
+
+
+// **************************************************
+// RUN KERNEL
+// **************************************************
+
+namespace {
+
+  const char * kernel_name[NUM_KERNELS] =
+    { "jacobian", "jacobian_hex", "table_index", "merge_dense", "merge_sparse",
+      "adjacency_set", "is_adjacent", "vtk_write" };
+
+  // Stream buffer which discards output.
+  class NULL_STREAMBUF:public std::streambuf {
+
+  protected:
+    virtual int overflow(int c)
+    { return(traits_type::not_eof(c)); }
+
+    virtual std::streamsize xsputn(const char * s, std::streamsize n)
+    { return(n); }
+  };
+
+  // Run f until at least min_seconds have elapsed.
+  // - Each call to f performs num_op_per_call kernel operations.
+  // - Report nanoseconds and heap bytes allocated per operation.
+  template <typename FTYPE>
+  void time_kernel
+  (const MICROBENCH_INFO & microbench_info, const KERNEL_TYPE kernel,
+   const AXIS_SIZE_TYPE size, const long long num_op_per_call, FTYPE f)
+  {
+    long long num_calls = 0;
+
+    // Warm up caches and buffers.
+    f();
+
+    const long long num_bytes0 = num_bytes_allocated;
+    PROFILE_TIMER timer;
+    double seconds = 0;
+    do {
+      f();
+      num_calls++;
+      seconds = timer.WallSeconds();
+    } while (seconds < microbench_info.min_seconds);
+    const long long num_bytes = num_bytes_allocated - num_bytes0;
+
+    const double num_op = double(num_op_per_call)*num_calls;
+    const double ns_per_op = (num_op > 0) ? 1.0e9*seconds/num_op : 0;
+    const double bytes_per_op = (num_op > 0) ? num_bytes/num_op : 0;
+
+    if (microbench_info.flag_csv) {
+      cout << kernel_name[kernel] << "," << size << ","
+           << num_op_per_call << "," << ns_per_op << ","
+           << bytes_per_op << endl;
+    }
+    else {
+      cout << left << setw(14) << kernel_name[kernel] << right
+           << setw(6) << size << setw(12) << num_op_per_call
+           << setw(12) << ns_per_op << setw(12) << bytes_per_op << endl;
+    }
+  }
+
+}
+
+
+void run_kernel
+(const MICROBENCH_INFO & microbench_info, const KERNEL_TYPE kernel,
+ MICROBENCH_INPUT & input)
+{
+  const int DIM3(3);
+  const int NUM_VERT_PER_HEXAHEDRON(8);
+  const AXIS_SIZE_TYPE size = input.size;
+  const VERTEX_INDEX num_hex = input.NumHex();
+  const VERTEX_INDEX numv = input.vertex_coord.size()/DIM3;
+  IJK::CUBE_FACE_INFO<int,int,int> cube(DIM3);
+
+  // Sum of kernel results.  Prevents the compiler from removing kernels.
+  static volatile double sink = 0;
+
+  switch(kernel) {
+
+  case JACOBIAN_KERNEL:
+    time_kernel
+      (microbench_info, kernel, size,
+       (long long)(num_hex)*NUM_VERT_PER_HEXAHEDRON,
+       [&]()
+       {
+         const int POSITIVE_ORIENTATION(1);
+         const COORD_TYPE max_small_magnitude(0.0);
+         const COORD_TYPE * vcoord = vector2pointer(input.vertex_coord);
+         double s = 0;
+         for (VERTEX_INDEX ihex = 0; ihex < num_hex; ihex++) {
+           const ISO_VERTEX_INDEX * hex_vert =
+             &(input.ivolpoly_vert[ihex*NUM_VERT_PER_HEXAHEDRON]);
+           for (int icorner = 0; icorner < NUM_VERT_PER_HEXAHEDRON;
+                icorner++) {
+             COORD_TYPE Jacobian_determinant;
+             bool flag_zero;
+             compute_normalized_Jacobian_determinant_at_hex_vertex_3D
+               (hex_vert, POSITIVE_ORIENTATION, vcoord, cube, icorner,
+                max_small_magnitude, Jacobian_determinant, flag_zero);
+             s += Jacobian_determinant;
+           }
+         }
+         sink = sink + s;
+       });
+    break;
+
+  case JACOBIAN_HEX_KERNEL:
+    time_kernel
+      (microbench_info, kernel, size,
+       (long long)(num_hex)*NUM_VERT_PER_HEXAHEDRON,
+       [&]()
+       {
+         double s = 0;
+         for (VERTEX_INDEX ihex = 0; ihex < num_hex; ihex++) {
+           COORD_TYPE Jacobian_determinant[NUM_VERT_PER_HEXAHEDRON];
+           compute_hexahedron_normalized_Jacobian_determinants
+             (input.ivolpoly_vert, ihex, input.vertex_coord,
+              Jacobian_determinant);
+           for (int icorner = 0; icorner < NUM_VERT_PER_HEXAHEDRON;
+                icorner++)
+             { s += Jacobian_determinant[icorner]; }
+         }
+         sink = sink + s;
+       });
+    break;
+
+  case TABLE_INDEX_KERNEL:
+    {
+      // compute_table_index_from_encoded_grid is local to ivoldual.cxx.
+      // Time set_cube_ivoltable_info which calls it once per cube.
+      const IVOLDUAL_CUBE_TABLE & ivoldual_table =
+        get_ivoldual_cube_table(DIM3, false, "");
+      time_kernel
+        (microbench_info, kernel, size, input.cube_ivolv_list.size(),
+         [&]()
+         {
+           set_cube_ivoltable_info
+             (input.context.encoded_grid, ivoldual_table,
+              input.cube_ivolv_list);
+         });
+    }
+    break;
+
+  case MERGE_DENSE_KERNEL:
+    {
+      std::vector<ISO_VERTEX_INDEX> cube_list;
+      std::vector<ISO_VERTEX_INDEX> ivolpoly_cube;
+      MERGE_DATA & merge_data = input.context.MergeData(input.scalar_grid);
+      time_kernel
+        (microbench_info, kernel, size, input.ivolpoly_cube_list.size(),
+         [&]()
+         {
+           merge_identical
+             (input.ivolpoly_cube_list, cube_list, ivolpoly_cube, merge_data);
+         });
+    }
+    break;
+
+  case MERGE_SPARSE_KERNEL:
+    {
+      std::vector<ISO_VERTEX_INDEX> cube_list;
+      std::vector<ISO_VERTEX_INDEX> ivolpoly_cube;
+      SPARSE_CUBE_LIST sparse_cube_list;
+      time_kernel
+        (microbench_info, kernel, size, input.ivolpoly_cube_list.size(),
+         [&]()
+         {
+           merge_identical
+             (input.ivolpoly_cube_list, cube_list, ivolpoly_cube,
+              sparse_cube_list);
+         });
+    }
+    break;
+
+  case ADJACENCY_SET_KERNEL:
+    {
+      IVOL_VERTEX_ADJACENCY_LIST vertex_adjacency_list;
+      time_kernel
+        (microbench_info, kernel, size, num_hex,
+         [&]()
+         { vertex_adjacency_list.SetFromMeshOfCubes
+             (input.ivolpoly_vert, cube, 1); });
+    }
+    break;
+
+  case IS_ADJACENT_KERNEL:
+    {
+      // Query one adjacent vertex and one pseudo-random vertex
+      //   of each vertex.
+      IVOL_VERTEX_ADJACENCY_LIST vertex_adjacency_list;
+      std::vector<VERTEX_INDEX> query;
+      vertex_adjacency_list.SetFromMeshOfCubes(input.ivolpoly_vert, cube, 1);
+      const VERTEX_INDEX num_adj_vert = vertex_adjacency_list.NumVertices();
+      for (VERTEX_INDEX iv = 0; iv < num_adj_vert; iv++) {
+        const int num_adjacent = vertex_adjacency_list.NumAdjacent(iv);
+        if (num_adjacent == 0) { continue; }
+        query.push_back(iv);
+        query.push_back
+          (vertex_adjacency_list.AdjacentVertex(iv, iv%num_adjacent));
+        query.push_back(iv);
+        query.push_back
+          (VERTEX_INDEX((unsigned int)(iv)*2654435761u % num_adj_vert));
+      }
+
+      time_kernel
+        (microbench_info, kernel, size, query.size()/2,
+         [&]()
+         {
+           long long num_adjacent = 0;
+           for (VERTEX_INDEX i = 0; i+1 < query.size(); i += 2) {
+             if (vertex_adjacency_list.IsAdjacent(query[i], query[i+1]))
+               { num_adjacent++; }
+           }
+           sink = sink + num_adjacent;
+         });
+    }
+    break;
+
+  case VTK_WRITE_KERNEL:
+  default:
+    {
+      NULL_STREAMBUF null_streambuf;
+      std::ostream out(&null_streambuf);
+      time_kernel
+        (microbench_info, kernel, size, num_hex,
+         [&]()
+         {
+           ijkoutHexahedraVTK
+             (out, "microbench", DIM3, vector2pointer(input.vertex_coord),
+              numv, vector2pointer(input.ivolpoly_vert), num_hex, true);
+         });
+    }
+    break;
+  }
+}
+
+
+// **************************************************
+// PARSE COMMAND LINE
+// **************************************************
+
+namespace {
+
+  KERNEL_TYPE get_kernel(const char * s)
+  {
+    for (int i = 0; i < NUM_KERNELS; i++) {
+      if (strcmp(s, kernel_name[i]) == 0)
+        { return(KERNEL_TYPE(i)); }
+    }
+
+    cerr << "Error.  Illegal kernel " << s << "." << endl;
+    usage_error();
+    return(JACOBIAN_KERNEL);
+  }
+
+}
+
+
+void parse_command_line
+(int argc, char **argv, MICROBENCH_INFO & microbench_info)
+{
+  int iarg = 1;
+  while (iarg < argc) {
+    const string s = argv[iarg];
+
+    if (s == "-kernel") {
+      iarg++;
+      if (iarg >= argc) { usage_error(); }
+      if (strcmp(argv[iarg], "all") == 0) {
+        for (int i = 0; i < NUM_KERNELS; i++)
+          { microbench_info.kernel.push_back(KERNEL_TYPE(i)); }
+      }
+      else
+        { microbench_info.kernel.push_back(get_kernel(argv[iarg])); }
+    }
+    else if (s == "-size") {
+      iarg++;
+      if (iarg >= argc) { usage_error(); }
+      const int size = atoi(argv[iarg]);
+      if (size < 4 || size > 512) {
+        cerr << "Error.  Size must be in range [4,512]." << endl;
+        usage_error();
+      }
+      microbench_info.size.push_back(size);
+    }
+    else if (s == "-min_time") {
+      iarg++;
+      if (iarg >= argc) { usage_error(); }
+      microbench_info.min_seconds = atof(argv[iarg]);
+    }
+    else if (s == "-csv")
+      { microbench_info.flag_csv = true; }
+    else if (s == "-help")
+      { help(); }
+    else {
+      cerr << "Error.  Illegal option " << s << "." << endl;
+      usage_error();
+    }
+
+    iarg++;
+  }
+
+  // Defaults.
+  if (microbench_info.kernel.size() == 0) {
+    for (int i = 0; i < NUM_KERNELS; i++)
+      { microbench_info.kernel.push_back(KERNEL_TYPE(i)); }
+  }
+  if (microbench_info.size.size() == 0) {
+    microbench_info.size.push_back(16);
+    microbench_info.size.push_back(32);
+    microbench_info.size.push_back(64);
+  }
+}
+
+
+// **************************************************
+// USAGE/HELP MESSAGES
+// **************************************************
+
+void usage_msg(std::ostream & out)
+{
+  out << "Usage: ivoldual_microbench [OPTIONS]" << endl;
+  out << "OPTIONS:" << endl;
+  out << "  [-kernel {jacobian|jacobian_hex|table_index|merge_dense|" << endl
+      << "           merge_sparse|adjacency_set|is_adjacent|vtk_write|all}]..."
+      << endl;
+  out << "  [-size {N}]... [-min_time {S}] [-csv] [-help]" << endl;
+}
+
+void usage_error()
+{
+  usage_msg(cerr);
+  exit(10);
+}
+
+void help()
+{
+  usage_msg(cout);
+  cout << endl;
+  cout << "ivoldual_microbench - Time inner kernels of interval volume"
+       << " construction." << endl;
+  cout << endl;
+  cout << "  Kernel input is the interval volume of a gyroid field"
+       << endl
+       << "  on an N x N x N grid.  Reports nanoseconds and heap bytes"
+       << endl
+       << "  allocated per operation." << endl;
+  cout << endl;
+  cout << "  -kernel {K}:  Kernel.  May be repeated.  Default all." << endl;
+  cout << "     jacobian:      compute_normalized_Jacobian_determinant_at"
+       << "_hex_vertex_3D." << endl
+       << "                    One op is one hexahedron corner." << endl;
+  cout << "     jacobian_hex:  compute_hexahedron_normalized_Jacobian"
+       << "_determinants." << endl
+       << "                    One op is one hexahedron corner." << endl;
+  cout << "     table_index:   set_cube_ivoltable_info"
+       << " from the encoded grid." << endl
+       << "                    One op is one active cube." << endl;
+  cout << "     merge_dense:   merge_identical with grid-sized merge data."
+       << endl
+       << "                    One op is one list element." << endl;
+  cout << "     merge_sparse:  merge_identical with SPARSE_CUBE_LIST." << endl
+       << "                    One op is one list element." << endl;
+  cout << "     adjacency_set: VERTEX_ADJACENCY_LIST_BASE::"
+       << "SetFromMeshOfCubes." << endl
+       << "                    One op is one hexahedron." << endl;
+  cout << "     is_adjacent:   VERTEX_ADJACENCY_LIST_BASE::IsAdjacent."
+       << endl
+       << "                    One op is one query." << endl;
+  cout << "     vtk_write:     ijkoutHexahedraVTK to a null stream." << endl
+       << "                    One op is one hexahedron." << endl;
+  cout << "  -size {N}:  Grid size, 4 <= N <= 512.  May be repeated." << endl
+       << "     Default 16, 32 and 64." << endl;
+  cout << "  -min_time {S}:  Run each kernel for at least S seconds."
+       << "  Default 0.2." << endl;
+  cout << "  -csv:  Write one CSV line per kernel and size." << endl;
+  cout << "  -help:  Print this help message." << endl;
+  exit(0);
+}
@@ -232,6 +232,10 @@ bool IVOLDUAL::get_adjacent_cube_in_oriented_direction
     const ISO_VERTEX_INDEX ivolvA = 
       cube_list[cubeA_list_index].first_isov + i;
 
+    // Vertices in no interval volume polytope are not
+    //   in vertex_adjacency_list.
+    if (ivolvA >= vertex_adjacency_list.NumVertices()) { continue; }
+
     if (vertex_adjacency_list.GetAdjacentVertexInOrientedDirection
         (ivolvA, direction, orientation, ivolvB)) {
 
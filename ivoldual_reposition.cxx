@@ -20,9 +20,13 @@
   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 */
 
+#include <functional>
+#include <queue>
+
 #include "ivoldual_compute.h"
 #include "ivoldual_reposition.h"
 #include "ivoldual_divide_hex.h"
+#include "ivoldual_thread.txx"
 #include "ijktriangulate.txx"
 
 using namespace IJK;
@@ -39,6 +43,317 @@ void IVOLDUAL::eliminate_non_manifold_grid
   dualiso_info.num_non_manifold_changes = num_changes;
 }
 
+namespace {
+
+  /// Move vertex cur to the centroid of its neighbors
+  ///   if some neighbor is closer than laplacian_smooth_limit.
+  /// - Neighbors not on the same isosurface as cur are ignored.
+  /// - Skip cur if its on-isosurface status equals skipSurfaceVert.
+  /// - Reads coordinates of cur and its neighbors; writes only cur.
+  void laplacian_smooth_elength_vertex
+  (const VERTEX_INDEX cur,
+   const IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
+   const DUAL_IVOLVERT_SOA & ivolv_soa,
+   const float laplacian_smooth_limit,
+   const bool skipSurfaceVert,
+   COORD_TYPE * vcoord)
+  {
+    const int d = 3;
+    float dist;
+
+    // Current node coordinates.
+    COORD_TYPE *cur_coord = vcoord + cur*d;
+
+    // Check if current node is on isosurface.
+    bool curOnLower = ivolv_soa.OnLowerIsosurface(cur);
+    bool curOnUpper = ivolv_soa.OnUpperIsosurface(cur);
+    bool isOnSurface = curOnLower || curOnUpper;
+
+    if (isOnSurface == skipSurfaceVert) return;
+
+    // Store sum of neighbor coordinates.
+    COORD_TYPE neigh_sum[d]; 
+    IJK::set_coord(d, 0.0, neigh_sum);
+    bool flag_moving = false;
+    int adj_count = 0;
+
+    // Loop over adjacent vertices of the current vertex
+    for (int  k = 0; k < vertex_adjacency_list.NumAdjacent(cur); k++) {
+
+      // Neighbor node coordinates
+      int adj = vertex_adjacency_list.AdjacentVertex(cur, k);
+      COORD_TYPE *neigh_coord = vcoord + adj*d;
+
+      // Check if neighbor node is on isosurface.
+      bool adjOnLower = ivolv_soa.OnLowerIsosurface(adj);
+      bool adjOnUpper = ivolv_soa.OnUpperIsosurface(adj);
+
+      // Skip if a vertex and its adjacent vertex are not on the same surface.
+      if ((curOnLower && !adjOnLower) || (curOnUpper && !adjOnUpper))
+        continue;
+
+      IJK::add_coord(d, neigh_sum, neigh_coord, neigh_sum);
+      IJK::compute_distance(d, cur_coord, neigh_coord, dist);
+
+      // Check if minimum distance is valid.
+      if (dist < laplacian_smooth_limit) {
+        flag_moving = true;
+      }
+
+      adj_count++;
+    }
+
+    // Update current node coordinate.
+    if (flag_moving) {
+      IJK::divide_coord(d, adj_count, neigh_sum, neigh_sum);
+      IJK::copy_coord(d, neigh_sum, cur_coord);
+    }
+  }
+
+
+  /// Return max distance between vertex coordinates 
+  ///   in coord0 and coord1.
+  COORD_TYPE compute_max_vertex_move
+  (const COORD_ARRAY & coord0, const COORD_ARRAY & coord1)
+  {
+    const int DIM3(3);
+    const VERTEX_INDEX num_vert = coord1.size()/DIM3;
+    COORD_TYPE max_move_squared = 0;
+
+    for (VERTEX_INDEX iv = 0; iv < num_vert; iv++) {
+      COORD_TYPE move_squared;
+      IJK::compute_distance_squared
+        (DIM3, &(coord0[iv*DIM3]), &(coord1[iv*DIM3]), move_squared);
+      if (move_squared > max_move_squared) 
+        { max_move_squared = move_squared; }
+    }
+
+    return(std::sqrt(max_move_squared));
+  }
+
+
+  /// Return number of hexahedra with min Jacobian below jacobian_limit.
+  VERTEX_INDEX count_hex_below_jacobian
+  (const IVOLDUAL_HEX_JACOBIAN_CACHE & jacobian_cache,
+   const float jacobian_limit)
+  {
+    VERTEX_INDEX num_below = 0;
+    for (VERTEX_INDEX ihex = 0; ihex < jacobian_cache.NumHex(); ihex++) {
+      if (jacobian_cache.MinJacobian(ihex) < jacobian_limit) 
+        { num_below++; }
+    }
+    return(num_below);
+  }
+
+
+  /// List of vertices and the min Jacobian at each vertex.
+  /// - Per vertex arrays are reused by each call to Clear(),
+  ///   so building the list allocates no memory once arrays
+  ///   reach their final size.
+  /// - Per vertex entries are valid only if stamped with
+  ///   the current generation.  Clear() increments the generation.
+  class VERTEX_MIN_JACOBIAN_LIST {
+
+  protected:
+    std::vector<int> generation;
+    std::vector<int> loc;
+    int current_generation;
+
+  public:
+    /// List of vertices in order of insertion.
+    std::vector<int> vlist;
+
+    /// min_jacobian[k] = Min Jacobian at vertex vlist[k].
+    std::vector<COORD_TYPE> min_jacobian;
+
+    VERTEX_MIN_JACOBIAN_LIST() { current_generation = 0; };
+
+    /// Clear list of vertices.
+    /// - Vertices are in range [0,num_vertices).
+    void Clear(const VERTEX_INDEX num_vertices)
+    {
+      if (generation.size() != num_vertices || 
+          current_generation == std::numeric_limits<int>::max()) {
+        generation.assign(num_vertices, 0);
+        loc.resize(num_vertices);
+        current_generation = 0;
+      }
+      current_generation++;
+      vlist.clear();
+      min_jacobian.clear();
+    }
+
+    /// Add vertex iv with Jacobian jacob.
+    /// - If iv is already in the list, keep the min Jacobian.
+    void Insert(const int iv, const COORD_TYPE jacob)
+    {
+      if (generation[iv] != current_generation) {
+        generation[iv] = current_generation;
+        loc[iv] = vlist.size();
+        vlist.push_back(iv);
+        min_jacobian.push_back(jacob);
+      }
+      else if (jacob < min_jacobian[loc[iv]]) {
+        min_jacobian[loc[iv]] = jacob;
+      }
+    }
+  };
+
+
+  /// Compute min normalized Jacobian over hexahedra corners
+  ///   whose Jacobian depends on vertex ivert, and the gradient
+  ///   of that Jacobian with respect to the coordinates of ivert.
+  /// - Corner Jacobians depending on ivert are at ivert
+  ///   and at hex neighbors of ivert.
+  /// - If no Jacobian is below 1, min_jacob is 1 and gradient is zero.
+  void compute_min_jacobian_and_gradient_at_vertex
+  (const std::vector<VERTEX_INDEX> & ivolpoly_vert,
+   IJK::VERTEX_POLY_INCIDENCE<int,int> & vertex_poly_incidence,
+   const COORD_ARRAY & vertex_coord,
+   const int ivert,
+   COORD_TYPE & min_jacob,
+   COORD_TYPE gradient[3])
+  {
+    const int NUM_VERT_PER_HEX(8); 
+
+    min_jacob = 1.0;
+    IJK::set_coord_3D(0, gradient);
+
+    for (int ipoly = 0; ipoly < vertex_poly_incidence.NumIncidentPoly(ivert); 
+         ipoly++) {
+      const int ihex = vertex_poly_incidence.IncidentPoly(ivert, ipoly);
+      const VERTEX_INDEX * hex_vert = &(ivolpoly_vert[ihex*NUM_VERT_PER_HEX]);
+      COORD_TYPE jacob[NUM_VERT_PER_HEX];
+      COORD_TYPE jacob_gradient[NUM_VERT_PER_HEX][3];
+
+      compute_hexahedron_normalized_Jacobian_gradients
+        (ivolpoly_vert, ihex, vertex_coord, ivert, jacob, jacob_gradient);
+
+      for (int k = 0; k < NUM_VERT_PER_HEX; k++) {
+        if (hex_vert[k] != ivert && hex_vert[k^1] != ivert &&
+            hex_vert[k^2] != ivert && hex_vert[k^4] != ivert)
+          { continue; }
+
+        if (jacob[k] < min_jacob) {
+          min_jacob = jacob[k];
+          IJK::copy_coord_3D(jacob_gradient[k], gradient);
+        }
+      }
+    }
+  }
+
+
+  /// Hexahedron ihex keyed by its min normalized Jacobian.
+  typedef std::pair<COORD_TYPE,VERTEX_INDEX> HEX_JACOBIAN_KEY;
+
+  /// Min-heap of hexahedra keyed by min normalized Jacobian.
+  /// - Ties are broken by smaller hexahedron index.
+  typedef std::priority_queue
+  <HEX_JACOBIAN_KEY, std::vector<HEX_JACOBIAN_KEY>,
+   std::greater<HEX_JACOBIAN_KEY> > HEX_JACOBIAN_HEAP;
+
+
+  /// Move vertex ivert to increase the min Jacobian
+  ///   at hexahedra corners around ivert.
+  /// - Vertices on isosurfaces move towards neighbors on the isosurface.
+  /// - Interior vertices move with move_vertex_jacobian_gradient()
+  ///   if flag_jacobian_gradient is true,
+  ///   and with move_vertex_all_direction() otherwise.
+  /// - Restore ivert and return false if the min Jacobian
+  ///   around ivert does not increase.
+  bool repair_vertex_jacobian
+  (const std::vector<VERTEX_INDEX> & ivolpoly_vert,
+   const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+   IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
+   IJK::VERTEX_POLY_INCIDENCE<int,int> & vertex_poly_incidence,
+   const DUAL_IVOLVERT_ARRAY & ivolv_list,
+   const DUAL_IVOLVERT_SOA & ivolv_soa,
+   COORD_ARRAY & vertex_coord,
+   const bool flag_jacobian_gradient,
+   int ivert)
+  {
+    const int DIM3(3);
+    COORD_TYPE * cur_coord = &(vertex_coord.front()) + ivert*DIM3;
+    COORD_TYPE start_coord[DIM3];
+    COORD_TYPE min_jacob_at_cur, min_jacob_around_cur;
+    COORD_TYPE new_min_jacob_at_cur, new_min_jacob_around_cur;
+
+    IJK::copy_coord_3D(cur_coord, start_coord);
+    min_jacob_around_vertex
+      (ivolpoly_vert, vertex_poly_incidence, vertex_coord,
+       ivert, min_jacob_at_cur, min_jacob_around_cur);
+
+    const bool onLower = ivolv_soa.OnLowerIsosurface(ivert);
+    const bool onUpper = ivolv_soa.OnUpperIsosurface(ivert);
+    if (onLower || onUpper) {
+      gradient_move_vertex
+        (ivolpoly_vert, ivoldual_table, vertex_adjacency_list,
+         vertex_poly_incidence, ivolv_list, vertex_coord,
+         cur_coord, ivert, onLower, onUpper);
+    }
+    else if (flag_jacobian_gradient) {
+      move_vertex_jacobian_gradient
+        (ivolpoly_vert, vertex_poly_incidence, vertex_coord, ivert);
+    }
+    else {
+      move_vertex_all_direction
+        (ivolpoly_vert, vertex_adjacency_list, vertex_poly_incidence,
+         vertex_coord, min_jacob_at_cur, ivert, 0);
+    }
+
+    min_jacob_around_vertex
+      (ivolpoly_vert, vertex_poly_incidence, vertex_coord,
+       ivert, new_min_jacob_at_cur, new_min_jacob_around_cur);
+
+    if (new_min_jacob_around_cur > min_jacob_around_cur) { return(true); }
+
+    IJK::copy_coord_3D(start_coord, cur_coord);
+    return(false);
+  }
+
+
+  /// Greedy coloring of the vertex adjacency graph.
+  /// - Vertices are colored in increasing order.  Each vertex receives
+  ///   the smallest color not used by any previously colored neighbor.
+  /// - color_list[c] is the list of vertices with color c,
+  ///   in increasing order.
+  /// - Adjacent vertices never share a color.
+  void color_vertex_adjacency_graph
+  (const IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
+   std::vector< std::vector<VERTEX_INDEX> > & color_list)
+  {
+    const VERTEX_INDEX num_vertices = vertex_adjacency_list.NumVertices();
+    const int UNCOLORED = -1;
+    std::vector<int> vertex_color(num_vertices, UNCOLORED);
+
+    // used_by[c] == iv if color c is used by some neighbor of iv.
+    std::vector<VERTEX_INDEX> used_by;
+
+    color_list.clear();
+    for (VERTEX_INDEX iv = 0; iv < num_vertices; iv++) {
+
+      for (int k = 0; k < vertex_adjacency_list.NumAdjacent(iv); k++) {
+        const VERTEX_INDEX adj = vertex_adjacency_list.AdjacentVertex(iv, k);
+        const int c = vertex_color[adj];
+        if (c != UNCOLORED) { used_by[c] = iv; }
+      }
+
+      int c = 0;
+      while (c < used_by.size() && used_by[c] == iv) { c++; }
+
+      if (c == used_by.size()) {
+        used_by.push_back(num_vertices);
+        color_list.push_back(std::vector<VERTEX_INDEX>());
+      }
+
+      vertex_color[iv] = c;
+      color_list[c].push_back(iv);
+    }
+  }
+
+}
+
+
 void IVOLDUAL::laplacian_smooth_elength
 (const IVOLDUAL_CUBE_TABLE & ivoldual_table,
  IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
@@ -47,69 +362,100 @@ void IVOLDUAL::laplacian_smooth_elength
  float laplacian_smooth_limit, 
  int iteration)
 {
-  const int d = 3;
-  float dist;
-  COORD_TYPE * vcoord = &(vertex_coord.front());
-
-  for (int it = 0; it < 2*iteration+1; it++) {
-
-    bool skipSurfaceVert = (it % 2 == 0);
-
-    // Loop over all vertices
-    for (int cur = 0; cur < vertex_adjacency_list.NumVertices(); cur++) {
-      
-      // Current node coordinates.
-      COORD_TYPE *cur_coord = vcoord + cur*d;
+  laplacian_smooth_elength
+    (ivoldual_table, vertex_adjacency_list, ivolv_list, vertex_coord,
+     laplacian_smooth_limit, iteration, false, 1);
+}
 
-      // Check if current node is on isosurface.
-      const int ivolv_cur = ivolv_list[cur].patch_index;
-      const TABLE_INDEX table_cur = ivolv_list[cur].table_index;
-      bool curOnLower = ivoldual_table.OnLowerIsosurface(table_cur, ivolv_cur);
-      bool curOnUpper = ivoldual_table.OnUpperIsosurface(table_cur, ivolv_cur);
-      bool isOnSurface = curOnLower || curOnUpper;
 
-      if (isOnSurface == skipSurfaceVert) continue;
+// Laplacian Smoothing for small edge length.
+// - Version which colors the vertex adjacency graph and updates
+//   each color class on num_threads threads.
+void IVOLDUAL::laplacian_smooth_elength
+(const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+ IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
+ const DUAL_IVOLVERT_ARRAY & ivolv_list,
+ COORD_ARRAY & vertex_coord,
+ float laplacian_smooth_limit, 
+ int iteration,
+ const bool flag_color,
+ const int num_threads)
+{
+  const IVOLDUAL_SMOOTH_CONTROL smooth_control;
+  IVOLDUAL_SMOOTH_INFO smooth_info;
 
-      // Store sum of neighbor coordinates.
-      COORD_TYPE neigh_sum[d]; 
-      IJK::set_coord(d, 0.0, neigh_sum);
-      bool flag_moving = false;
-      int adj_count = 0;
+  laplacian_smooth_elength
+    (ivoldual_table, vertex_adjacency_list, ivolv_list, vertex_coord,
+     laplacian_smooth_limit, iteration, flag_color, num_threads,
+     smooth_control, smooth_info);
+}
 
-      // Loop over adjacent vertices of the current vertex
-      for (int  k = 0; k < vertex_adjacency_list.NumAdjacent(cur); k++) {
 
-        // Neighbor node coordinates
-        int adj = vertex_adjacency_list.AdjacentVertex(cur, k);
-        COORD_TYPE *neigh_coord = vcoord + adj*d;
+// Laplacian Smoothing for small edge length.
+// - Version which stops when smooth_control criteria are met.
+void IVOLDUAL::laplacian_smooth_elength
+(const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+ IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
+ const DUAL_IVOLVERT_ARRAY & ivolv_list,
+ COORD_ARRAY & vertex_coord,
+ float laplacian_smooth_limit, 
+ int iteration,
+ const bool flag_color,
+ const int num_threads,
+ IVOLDUAL_SMOOTH_CONTROL smooth_control,
+ IVOLDUAL_SMOOTH_INFO & smooth_info)
+{
+  COORD_TYPE * vcoord = &(vertex_coord.front());
+  const DUAL_IVOLVERT_SOA ivolv_soa(ivoldual_table, ivolv_list);
+  std::vector< std::vector<VERTEX_INDEX> > color_list;
+  COORD_ARRAY prev_coord;
 
-        // Check if neighbor node is on isosurface.
-        const int ivolv_adj = ivolv_list[adj].patch_index;
-        const TABLE_INDEX table_adj = ivolv_list[adj].table_index;
-        bool adjOnLower = ivoldual_table.OnLowerIsosurface(table_adj, ivolv_adj);
-        bool adjOnUpper = ivoldual_table.OnUpperIsosurface(table_adj, ivolv_adj);
+  if (flag_color) 
+    { color_vertex_adjacency_graph(vertex_adjacency_list, color_list); }
 
-        // Skip if a vertex and its adjacent vertex are not on the same surface.
-        if ((curOnLower && !adjOnLower) || (curOnUpper && !adjOnUpper))
-            continue;
+  smooth_control.Start(smooth_info);
 
-        IJK::add_coord(d, neigh_sum, neigh_coord, neigh_sum);
-        IJK::compute_distance(d, cur_coord, neigh_coord, dist);
+  for (int it = 0; it < 2*iteration+1; it++) {
 
-        // Check if minimum distance is valid.
-        if (dist < laplacian_smooth_limit) {
-          flag_moving = true;
-        }
+    bool skipSurfaceVert = (it % 2 == 0);
 
-        adj_count++;
+    // Iteration k is sweeps 2k-1 (surface) and 2k (interior).
+    if (!skipSurfaceVert && smooth_control.CheckMove()) 
+      { prev_coord = vertex_coord; }
+
+    if (flag_color) {
+      // Vertices with the same color are not adjacent,
+      //   so each color class may be updated in any order.
+      for (int c = 0; c < color_list.size(); c++) {
+        const VERTEX_INDEX * vlist = color_list[c].data();
+
+        run_on_thread_ranges
+          (num_threads, VERTEX_INDEX(color_list[c].size()),
+           [&](const int, const VERTEX_INDEX ibegin, const VERTEX_INDEX iend)
+           {
+             for (VERTEX_INDEX i = ibegin; i < iend; i++) {
+               laplacian_smooth_elength_vertex
+                 (vlist[i], vertex_adjacency_list, ivolv_soa, 
+                  laplacian_smooth_limit, skipSurfaceVert, vcoord);
+             }
+           });
       }
-
-      // Update current node coordinate.
-      if (flag_moving) {
-        IJK::divide_coord(d, adj_count, neigh_sum, neigh_sum);
-        IJK::copy_coord(d, neigh_sum, cur_coord);
+    }
+    else {
+      // Loop over all vertices
+      for (int cur = 0; cur < vertex_adjacency_list.NumVertices(); cur++) {
+        laplacian_smooth_elength_vertex
+          (cur, vertex_adjacency_list, ivolv_soa, laplacian_smooth_limit,
+           skipSurfaceVert, vcoord);
       }
     }
+
+    if (skipSurfaceVert && it > 0) {
+      COORD_TYPE max_move = 0;
+      if (smooth_control.CheckMove()) 
+        { max_move = compute_max_vertex_move(prev_coord, vertex_coord); }
+      if (smooth_control.EndIteration(max_move, smooth_info)) { break; }
+    }
   }
 }
 
@@ -122,25 +468,84 @@ void IVOLDUAL::laplacian_smooth_jacobian
  COORD_ARRAY & vertex_coord, 
  float jacobian_limit, 
  int iteration)
+{
+  const IVOLDUAL_SMOOTH_CONTROL smooth_control;
+  IVOLDUAL_SMOOTH_INFO smooth_info;
+
+  laplacian_smooth_jacobian
+    (ivolpoly_vert, ivoldual_table, vertex_adjacency_list, 
+     vertex_poly_incidence, ivolv_list, vertex_coord, jacobian_limit,
+     iteration, smooth_control, smooth_info);
+}
+
+
+// Laplacian Smoothing for bad Jacobian.
+// - Version which stops when smooth_control criteria are met.
+void IVOLDUAL::laplacian_smooth_jacobian
+(const std::vector<VERTEX_INDEX> & ivolpoly_vert,
+ const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+ IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
+ IJK::VERTEX_POLY_INCIDENCE<int,int> & vertex_poly_incidence,
+ const DUAL_IVOLVERT_ARRAY & ivolv_list,
+ COORD_ARRAY & vertex_coord, 
+ float jacobian_limit, 
+ int iteration,
+ IVOLDUAL_SMOOTH_CONTROL smooth_control,
+ IVOLDUAL_SMOOTH_INFO & smooth_info)
  {
+  IVOLDUAL_HEX_JACOBIAN_CACHE jacobian_cache;
+  VERTEX_INDEX num_bad_prev = 0;
+  COORD_ARRAY prev_coord;
+
+  smooth_control.Start(smooth_info);
+
   for (int it = 0; it < iteration; it++) {
     std::vector<int> neg_jacob_list;
+
+    // Recompute Jacobians only of hexes incident on moved vertices.
+    if (it == 0) { jacobian_cache.Set(ivolpoly_vert, vertex_coord); }
+    else {
+      VERTEX_INDEX num_recomputed;
+      jacobian_cache.Update(ivolpoly_vert, vertex_coord, num_recomputed);
+    }
+
+    const VERTEX_INDEX num_bad = 
+      count_hex_below_jacobian(jacobian_cache, jacobian_limit);
+    if (smooth_control.StopBeforeIteration
+        (it, num_bad, num_bad_prev, smooth_info)) { break; }
+    num_bad_prev = num_bad;
+
     // Find all vertices with negative Jacobian.
     for (int ihex = 0; ihex < ivolpoly_vert.size()/8; ihex++) {
-      for (int i = 0; i < 8; i++) {
-        // Compute Jacobian at current vertex
-        COORD_TYPE jacob;        
-        compute_hexahedron_normalized_Jacobian_determinant
-          (ivolpoly_vert, ihex, vertex_coord, i, jacob);
+      if (!(jacobian_cache.MinJacobian(ihex) < jacobian_limit)) continue;
 
-        if (jacob < jacobian_limit) {
+      for (int i = 0; i < 8; i++) {
+        if (jacobian_cache.Jacobian(ihex, i) < jacobian_limit) {
           neg_jacob_list.push_back(ivolpoly_vert[ihex * 8 + i]);
         }
       }
     }
+
+    if (smooth_control.CheckMove()) { prev_coord = vertex_coord; }
+
     laplacian_smooth_jacobian
       (ivolpoly_vert, ivoldual_table, vertex_adjacency_list,  
-       vertex_poly_incidence, ivolv_list, vertex_coord, neg_jacob_list);
+       vertex_poly_incidence, ivolv_list, vertex_coord, neg_jacob_list,
+       smooth_control.flag_jacobian_gradient);
+
+    // Smoothing moves only vertices in neg_jacob_list and their neighbors.
+    for (int cur : neg_jacob_list) {
+      jacobian_cache.MarkMovedVertex(cur, vertex_poly_incidence);
+      for (int j = 0; j < vertex_adjacency_list.NumAdjacent(cur); j++) {
+        jacobian_cache.MarkMovedVertex
+          (vertex_adjacency_list.AdjacentVertex(cur, j), vertex_poly_incidence);
+      }
+    }
+
+    COORD_TYPE max_move = 0;
+    if (smooth_control.CheckMove()) 
+      { max_move = compute_max_vertex_move(prev_coord, vertex_coord); }
+    if (smooth_control.EndIteration(max_move, smooth_info)) { break; }
   }
 }
 
@@ -153,6 +558,26 @@ void IVOLDUAL::laplacian_smooth_jacobian
  const DUAL_IVOLVERT_ARRAY & ivolv_list,
  COORD_ARRAY & vertex_coord, 
  const std::vector<int> & neg_jacobian_list)
+{
+  laplacian_smooth_jacobian
+    (ivolpoly_vert, ivoldual_table, vertex_adjacency_list, 
+     vertex_poly_incidence, ivolv_list, vertex_coord, neg_jacobian_list,
+     false);
+}
+
+
+// Laplacian Smoothing for bad Jacobian.
+// - Version which moves interior vertices along the analytic
+//   Jacobian gradient if flag_jacobian_gradient is true.
+void IVOLDUAL::laplacian_smooth_jacobian
+(const std::vector<VERTEX_INDEX> & ivolpoly_vert,
+ const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+ IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
+ IJK::VERTEX_POLY_INCIDENCE<int,int> & vertex_poly_incidence,
+ const DUAL_IVOLVERT_ARRAY & ivolv_list,
+ COORD_ARRAY & vertex_coord, 
+ const std::vector<int> & neg_jacobian_list,
+ const bool flag_jacobian_gradient)
 {
 	const int DIM3(3);
   COORD_TYPE * vcoord = &(vertex_coord.front());
@@ -183,7 +608,28 @@ void IVOLDUAL::laplacian_smooth_jacobian
       bool adjOnLower = ivoldual_table.OnLowerIsosurface(table_adj, ivolv_adj);
       bool adjOnUpper = ivoldual_table.OnUpperIsosurface(table_adj, ivolv_adj);
 
-      if (cube_cur == cube_adj) {
+      if (cube_cur == cube_adj && flag_jacobian_gradient) {
+        // Vertices on isosurfaces move towards neighbors on the isosurface.
+        if (adjOnLower || adjOnUpper) {
+          gradient_move_vertex
+          (ivolpoly_vert, ivoldual_table, vertex_adjacency_list, vertex_poly_incidence, 
+           ivolv_list, vertex_coord,neigh_coord, adj, adjOnLower, adjOnUpper);
+        }
+        else {
+          move_vertex_jacobian_gradient
+            (ivolpoly_vert, vertex_poly_incidence, vertex_coord, adj);
+        }
+        if (curOnLower || curOnUpper) {
+          gradient_move_vertex
+          (ivolpoly_vert, ivoldual_table, vertex_adjacency_list, vertex_poly_incidence, 
+           ivolv_list, vertex_coord,cur_coord, cur, curOnLower, curOnUpper);
+        }
+        else {
+          move_vertex_jacobian_gradient
+            (ivolpoly_vert, vertex_poly_incidence, vertex_coord, cur);
+        }
+      }
+      else if (cube_cur == cube_adj) {
       	gradient_move_vertex
       	(ivolpoly_vert, ivoldual_table, vertex_adjacency_list, vertex_poly_incidence, 
          ivolv_list, vertex_coord,neigh_coord, adj, adjOnLower, adjOnUpper);
@@ -206,82 +652,136 @@ void IVOLDUAL::gradient_smooth_jacobian
  float jacobian_limit, 
  int iteration)
 {
+  const IVOLDUAL_SMOOTH_CONTROL smooth_control;
+  IVOLDUAL_SMOOTH_INFO smooth_info;
+
+  gradient_smooth_jacobian
+    (ivolpoly_vert, ivoldual_table, vertex_adjacency_list, 
+     vertex_poly_incidence, ivolv_list, ivolpoly_info, vertex_coord, 
+     jacobian_limit, iteration, smooth_control, smooth_info);
+}
+
+
+// Gradient Smoothing for bad Jacobian.
+// - Version which stops when smooth_control criteria are met.
+// - Flat hexahedra facets and edges found in the last iteration
+//   are expanded after smoothing stops.
+void IVOLDUAL::gradient_smooth_jacobian
+(std::vector<VERTEX_INDEX> & ivolpoly_vert,
+ const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+ IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
+ IJK::VERTEX_POLY_INCIDENCE<int,int> & vertex_poly_incidence,
+ DUAL_IVOLVERT_ARRAY & ivolv_list,
+ IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
+ COORD_ARRAY & vertex_coord, 
+ float jacobian_limit, 
+ int iteration,
+ IVOLDUAL_SMOOTH_CONTROL smooth_control,
+ IVOLDUAL_SMOOTH_INFO & smooth_info)
+{
+  const int DIM3(3);
   const int NUM_VERT_PER_HEX(8); 
-  COORD_TYPE * vcoord = &(vertex_coord.front());
+  const DUAL_IVOLVERT_SOA ivolv_soa(ivoldual_table, ivolv_list);
+  IVOLDUAL_HEX_JACOBIAN_CACHE jacobian_cache;
+  VERTEX_INDEX num_bad_prev = 0;
+  COORD_ARRAY prev_coord;
+
+  // Lists are reused by every iteration.
+  VERTEX_MIN_JACOBIAN_LIST neg_jacobian;
+  IJK::LIST_OF_LISTS<int,int> facet_list, edge_list;
+
+  smooth_control.Start(smooth_info);
 
   for (int it = 0; it < iteration; it++) {
-    std::vector<int> neg_jacobian_list;
-    std::vector<std::vector<int>> facet_list, edge_list;
-    std::unordered_map<int, COORD_TYPE> neg_jacob_value;
+    neg_jacobian.Clear(vertex_coord.size()/DIM3);
+    facet_list.Clear();
+    edge_list.Clear();
+
+    // Recompute Jacobians only of hexes incident on moved vertices.
+    if (it == 0) { jacobian_cache.Set(ivolpoly_vert, vertex_coord); }
+    else {
+      VERTEX_INDEX num_recomputed;
+      jacobian_cache.Update(ivolpoly_vert, vertex_coord, num_recomputed);
+    }
 
-    for (int ihex = 0; ihex < ivolpoly_vert.size()/8; ihex++) {
+    const VERTEX_INDEX num_bad = 
+      count_hex_below_jacobian(jacobian_cache, jacobian_limit);
+    const bool flag_stop_before = smooth_control.StopBeforeIteration
+      (it, num_bad, num_bad_prev, smooth_info);
+    num_bad_prev = num_bad;
 
-      std::vector<int> internal_vert;
+    for (int ihex = 0; ihex < ivolpoly_vert.size()/8; ihex++) {
 
-      bool small_jacob_hex = false;
+      int internal_vert[NUM_VERT_PER_HEX];
+      int num_internal = 0;
 
       // Check is current hex has Jacobian below threshold
-      for (int i = 0; i < NUM_VERT_PER_HEX; i++) {
-        // Compute Jacobian at current vertex
-        COORD_TYPE jacob;        
-        compute_hexahedron_normalized_Jacobian_determinant
-          (ivolpoly_vert, ihex, vertex_coord, i, jacob);
-
-        if (jacob < jacobian_limit) {
-          small_jacob_hex = true;
-          break;
-        }
-      }
+      const bool small_jacob_hex = 
+        (jacobian_cache.MinJacobian(ihex) < jacobian_limit);
 
       if (small_jacob_hex == true) {
+        const COORD_TYPE * jacob = jacobian_cache.HexJacobian(ihex);
+
         for (int i = 0; i < NUM_VERT_PER_HEX; i++) {
 
           int ivert = ivolpoly_vert[ihex * 8 + i];
           
           // Check if current node is on isosurface.
-          const int ivolv_cur = ivolv_list[ivert].patch_index;
-          const TABLE_INDEX table_cur = ivolv_list[ivert].table_index;
-          bool curOnLower = ivoldual_table.OnLowerIsosurface(table_cur, ivolv_cur);
-          bool curOnUpper = ivoldual_table.OnUpperIsosurface(table_cur, ivolv_cur);
-          if (curOnLower || curOnUpper) continue;
+          if (ivolv_soa.OnIsosurface(ivert)) continue;
           
-          internal_vert.push_back(ivert);
+          internal_vert[num_internal] = ivert;
+          num_internal++;
 
-          COORD_TYPE jacob;        
-          compute_hexahedron_normalized_Jacobian_determinant
-            (ivolpoly_vert, ihex, vertex_coord, i, jacob);
-
-          if (jacob < jacobian_limit) {
-            // A vertex is not in the negative jacobian list
-            if (neg_jacob_value.count(ivert) == 0) {
-              neg_jacobian_list.push_back(ivert);
-              neg_jacob_value[ivert] = jacob;
-            }
-            else if (jacob < neg_jacob_value[ivert]) {
-              neg_jacob_value[ivert] = jacob;
-            } 
-          }   
+          if (jacob[i] < jacobian_limit) 
+            { neg_jacobian.Insert(ivert, jacob[i]); }
         }
 
-        facet_list.push_back(internal_vert);
+        facet_list.AddList(internal_vert, num_internal);
 
-        for (int i = 0; i < internal_vert.size() - 1; i++) {
-          for (int j = i + 1; j < internal_vert.size(); j++) {
-            int iv0 = internal_vert[i], iv1 = internal_vert[j];
-            if (vertex_adjacency_list.IsAdjacent(iv0, iv1)) {
-              edge_list.push_back({iv0, iv1});
+        for (int i = 0; i + 1 < num_internal; i++) {
+          for (int j = i + 1; j < num_internal; j++) {
+            const int iv_pair[2] = { internal_vert[i], internal_vert[j] };
+            if (vertex_adjacency_list.IsAdjacent(iv_pair[0], iv_pair[1])) {
+              edge_list.AddList(iv_pair, 2);
             }
           }
         }
       }
     }
 
-    // Smoothing vertices.
-    gradient_smooth_jacobian
-    (ivolpoly_vert, ivoldual_table, vertex_adjacency_list, vertex_poly_incidence, 
-     ivolv_list, vertex_coord, neg_jacobian_list, neg_jacob_value, it);
+    bool flag_stop = flag_stop_before;
+    if (!flag_stop) {
+      if (smooth_control.CheckMove()) { prev_coord = vertex_coord; }
+
+      // Smoothing vertices.
+      if (smooth_control.flag_jacobian_gradient) {
+        // Vertices in neg_jacobian.vlist are not on isosurfaces.
+        for (int i = 0; i < neg_jacobian.vlist.size(); i++) {
+          move_vertex_jacobian_gradient
+            (ivolpoly_vert, vertex_poly_incidence, vertex_coord, 
+             neg_jacobian.vlist[i]);
+        }
+      }
+      else {
+        gradient_smooth_jacobian
+        (ivolpoly_vert, ivoldual_table, vertex_adjacency_list, vertex_poly_incidence, 
+         ivolv_list, vertex_coord, neg_jacobian.vlist, neg_jacobian.min_jacobian,
+         it);
+      }
+
+      // Smoothing moves only vertices in neg_jacobian.vlist.
+      for (int i = 0; i < neg_jacobian.vlist.size(); i++) {
+        jacobian_cache.MarkMovedVertex
+          (neg_jacobian.vlist[i], vertex_poly_incidence);
+      }
+
+      COORD_TYPE max_move = 0;
+      if (smooth_control.CheckMove()) 
+        { max_move = compute_max_vertex_move(prev_coord, vertex_coord); }
+      flag_stop = smooth_control.EndIteration(max_move, smooth_info);
+    }
     
-    if (it == iteration - 1) {
+    if (it == iteration - 1 || flag_stop) {
       // Smoothing flat hex facet
       expand_flat_hex
       (ivolpoly_vert, ivoldual_table, vertex_adjacency_list,  
@@ -291,6 +791,8 @@ void IVOLDUAL::gradient_smooth_jacobian
       (ivolpoly_vert, ivoldual_table, vertex_adjacency_list, 
        vertex_poly_incidence, ivolv_list, vertex_coord, edge_list); 
     }
+
+    if (flag_stop) { break; }
   }
 
   // Split hex to fix indented small Jacobian. Only works for indented vertex.
@@ -299,6 +801,109 @@ void IVOLDUAL::gradient_smooth_jacobian
   //  ivolpoly_info, vertex_coord, 0.1);
 }
 
+
+// Repair hexahedra with Jacobian below jacobian_limit, worst first.
+// - Heap entries whose key differs from hex_min_jacobian[ihex]
+//   are out of date and are skipped.
+// - Each hexahedron is repaired at most MAX_NUM_REPAIRS times,
+//   so the pass terminates even if some hexahedra cannot be fixed.
+void IVOLDUAL::repair_jacobian_worst_first
+(const std::vector<VERTEX_INDEX> & ivolpoly_vert,
+ const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+ IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
+ IJK::VERTEX_POLY_INCIDENCE<int,int> & vertex_poly_incidence,
+ const DUAL_IVOLVERT_ARRAY & ivolv_list,
+ COORD_ARRAY & vertex_coord,
+ const float jacobian_limit,
+ const float budget_ms,
+ const bool flag_jacobian_gradient,
+ IVOLDUAL_SMOOTH_INFO & repair_info)
+{
+  const int NUM_VERT_PER_HEX(8);
+  const int MAX_NUM_REPAIRS(3);
+  const VERTEX_INDEX num_hex = ivolpoly_vert.size()/NUM_VERT_PER_HEX;
+  const DUAL_IVOLVERT_SOA ivolv_soa(ivoldual_table, ivolv_list);
+  PROFILE_TIMER timer;
+  HEX_JACOBIAN_HEAP heap;
+  std::vector<COORD_TYPE> hex_min_jacobian(num_hex);
+  std::vector<int> num_repairs(num_hex, 0);
+
+  repair_info.num_iterations = 0;
+  repair_info.stop_reason = SMOOTH_STOP_NO_BAD_ELEMENTS;
+
+  for (VERTEX_INDEX ihex = 0; ihex < num_hex; ihex++) {
+    int icorner;
+    compute_min_hexahedron_normalized_Jacobian_determinant
+      (ivolpoly_vert, ihex, vertex_coord, hex_min_jacobian[ihex], icorner);
+    if (hex_min_jacobian[ihex] < jacobian_limit)
+      { heap.push(HEX_JACOBIAN_KEY(hex_min_jacobian[ihex], ihex)); }
+  }
+
+  while (!heap.empty()) {
+
+    if (budget_ms > 0 && 1000*timer.WallSeconds() >= budget_ms) {
+      repair_info.stop_reason = SMOOTH_STOP_TIME_LIMIT;
+      break;
+    }
+
+    const HEX_JACOBIAN_KEY key = heap.top();
+    const VERTEX_INDEX ihex = key.second;
+    heap.pop();
+
+    if (key.first != hex_min_jacobian[ihex]) { continue; }
+
+    num_repairs[ihex]++;
+    repair_info.num_iterations++;
+
+    // Move vertices which some bad corner Jacobian of ihex depends on.
+    const VERTEX_INDEX * hex_vert = &(ivolpoly_vert[ihex*NUM_VERT_PER_HEX]);
+    COORD_TYPE jacob[NUM_VERT_PER_HEX];
+    bool flag_move[NUM_VERT_PER_HEX] = { false };
+    compute_hexahedron_normalized_Jacobian_determinants
+      (ivolpoly_vert, ihex, vertex_coord, jacob);
+    for (int k = 0; k < NUM_VERT_PER_HEX; k++) {
+      if (jacob[k] < jacobian_limit) {
+        flag_move[k] = flag_move[k^1] = flag_move[k^2] = flag_move[k^4] = true;
+      }
+    }
+
+    for (int k = 0; k < NUM_VERT_PER_HEX; k++) {
+      if (!flag_move[k]) { continue; }
+
+      const int ivert = hex_vert[k];
+      if (!repair_vertex_jacobian
+          (ivolpoly_vert, ivoldual_table, vertex_adjacency_list,
+           vertex_poly_incidence, ivolv_list, ivolv_soa, vertex_coord,
+           flag_jacobian_gradient, ivert))
+        { continue; }
+
+      // Update keys of hexahedra incident on ivert.
+      for (int j = 0; j < vertex_poly_incidence.NumIncidentPoly(ivert); j++) {
+        const VERTEX_INDEX jhex = vertex_poly_incidence.IncidentPoly(ivert, j);
+        COORD_TYPE jmin;
+        int icorner;
+        compute_min_hexahedron_normalized_Jacobian_determinant
+          (ivolpoly_vert, jhex, vertex_coord, jmin, icorner);
+
+        if (jmin == hex_min_jacobian[jhex]) { continue; }
+        hex_min_jacobian[jhex] = jmin;
+
+        if (jmin < jacobian_limit && num_repairs[jhex] < MAX_NUM_REPAIRS)
+          { heap.push(HEX_JACOBIAN_KEY(jmin, jhex)); }
+      }
+    }
+  }
+
+  if (repair_info.stop_reason == SMOOTH_STOP_NO_BAD_ELEMENTS) {
+    for (VERTEX_INDEX ihex = 0; ihex < num_hex; ihex++) {
+      if (hex_min_jacobian[ihex] < jacobian_limit) {
+        repair_info.stop_reason = SMOOTH_STOP_NO_IMPROVEMENT;
+        break;
+      }
+    }
+  }
+}
+
 void IVOLDUAL::gradient_smooth_jacobian
 (const std::vector<VERTEX_INDEX> & ivolpoly_vert,
  const IVOLDUAL_CUBE_TABLE & ivoldual_table,
@@ -309,10 +914,36 @@ void IVOLDUAL::gradient_smooth_jacobian
  const std::vector<int> & neg_jacobian_list,
  std::unordered_map<int, COORD_TYPE> & neg_jacob_value,
  int iter)
+{
+  std::vector<COORD_TYPE> neg_jacobian_min(neg_jacobian_list.size());
+
+  for (int i = 0; i < neg_jacobian_list.size(); i++) 
+    { neg_jacobian_min[i] = neg_jacob_value[neg_jacobian_list[i]]; }
+
+  gradient_smooth_jacobian
+    (ivolpoly_vert, ivoldual_table, vertex_adjacency_list, 
+     vertex_poly_incidence, ivolv_list, vertex_coord, 
+     neg_jacobian_list, neg_jacobian_min, iter);
+}
+
+
+// Move vertices in neg_jacobian_list to improve Jacobian.
+// - Version where neg_jacobian_min[i] is the min Jacobian 
+//   at vertex neg_jacobian_list[i].
+void IVOLDUAL::gradient_smooth_jacobian
+(const std::vector<VERTEX_INDEX> & ivolpoly_vert,
+ const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+ IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
+ IJK::VERTEX_POLY_INCIDENCE<int,int> & vertex_poly_incidence,
+ const DUAL_IVOLVERT_ARRAY & ivolv_list,
+ COORD_ARRAY & vertex_coord, 
+ const std::vector<int> & neg_jacobian_list,
+ const std::vector<COORD_TYPE> & neg_jacobian_min,
+ int iter)
 {
   for (int i = 0; i < neg_jacobian_list.size(); i++) {
     int ivert = neg_jacobian_list[i];
-    COORD_TYPE cur_min_jacob = neg_jacob_value[ivert];
+    COORD_TYPE cur_min_jacob = neg_jacobian_min[i];
 
     move_vertex_all_direction
     (ivolpoly_vert, vertex_adjacency_list, vertex_poly_incidence, 
@@ -328,20 +959,47 @@ void IVOLDUAL::expand_flat_hex
  const DUAL_IVOLVERT_ARRAY & ivolv_list,
  COORD_ARRAY & vertex_coord, 
  const std::vector<std::vector<int>> & flat_hex)
+{
+  IJK::LIST_OF_LISTS<int,int> flat_hex_lists;
+
+  for (int ifacet = 0; ifacet < flat_hex.size(); ifacet++) {
+    flat_hex_lists.AddList
+      (flat_hex[ifacet].data(), int(flat_hex[ifacet].size()));
+  }
+
+  expand_flat_hex
+    (ivolpoly_vert, ivoldual_table, vertex_adjacency_list, 
+     vertex_poly_incidence, ivolv_list, vertex_coord, flat_hex_lists);
+}
+
+
+// Expand flat hexahedra facets or edges.
+// - Version using LIST_OF_LISTS for flat_hex.
+void IVOLDUAL::expand_flat_hex
+(const std::vector<VERTEX_INDEX> & ivolpoly_vert,
+ const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+ IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
+ IJK::VERTEX_POLY_INCIDENCE<int,int> & vertex_poly_incidence,
+ const DUAL_IVOLVERT_ARRAY & ivolv_list,
+ COORD_ARRAY & vertex_coord, 
+ const IJK::LIST_OF_LISTS<int,int> & flat_hex)
 {
   const int DIM3(3);
   COORD_TYPE * vcoord = &(vertex_coord.front());
 
   // Loop over hexahedra facets with small Jacobian.
-  for (int ifacet = 0; ifacet < flat_hex.size(); ifacet++) {
+  for (int ifacet = 0; ifacet < flat_hex.NumLists(); ifacet++) {
 
+    const int * flat_vert = 
+      flat_hex.element.data() + flat_hex.FirstElement(ifacet);
+    const int num_flat_vert = flat_hex.ListLength(ifacet);
     float move_dist = 0.0;
-    std::vector<int> dir(3);
+    int dir[DIM3] = { 0, 0, 0 };
     float pre_min_at_facet = 1.0, pre_min_around_facet = 1.0;
 
     // Find min Jacobian at/around a facet/edge
-    for (int j = 0; j < flat_hex[ifacet].size(); j++) {
-      int ivert = flat_hex[ifacet][j];
+    for (int j = 0; j < num_flat_vert; j++) {
+      int ivert = flat_vert[j];
       float min_jacob_at_cur, min_jacob_around_cur;
 
       min_jacob_around_vertex
@@ -353,12 +1011,13 @@ void IVOLDUAL::expand_flat_hex
     } 
 
     find_optimal_jacobian_point
-    (ivolpoly_vert, vertex_poly_incidence, vertex_coord, flat_hex, 
-     pre_min_at_facet, pre_min_around_facet, ifacet, move_dist, dir);
+    (ivolpoly_vert, vertex_poly_incidence, vertex_coord, 
+     flat_vert, num_flat_vert, pre_min_at_facet, pre_min_around_facet, 
+     move_dist, dir);
 
     // Move to optiminal position.
-    for (int j = 0; j < flat_hex[ifacet].size(); j++) {
-      int ivert = flat_hex[ifacet][j];
+    for (int j = 0; j < num_flat_vert; j++) {
+      int ivert = flat_vert[j];
       COORD_TYPE *cur_coord = vcoord + ivert * DIM3;
       for (int d = 0; d < DIM3; d++) {
         cur_coord[d] += move_dist * dir[d];
@@ -375,6 +1034,32 @@ void IVOLDUAL::find_optimal_jacobian_point
  float pre_min_at_facet, float pre_min_around_facet, 
  int ifacet, 
  float & move_dist, std::vector<int> & dir)
+{
+  const int DIM3(3);
+  int dir3[DIM3];
+
+  dir.resize(DIM3);
+  std::copy(dir.begin(), dir.end(), dir3);
+
+  find_optimal_jacobian_point
+    (ivolpoly_vert, vertex_poly_incidence, vertex_coord,
+     flat_hex[ifacet].data(), int(flat_hex[ifacet].size()),
+     pre_min_at_facet, pre_min_around_facet, move_dist, dir3);
+
+  std::copy(dir3, dir3+DIM3, dir.begin());
+}
+
+
+// Find optimal direction and distance to move flat facet or edge.
+// - Version with array flat_vert[] of num_flat_vert facet 
+//   or edge vertices.
+void IVOLDUAL::find_optimal_jacobian_point
+(const std::vector<VERTEX_INDEX> & ivolpoly_vert,
+ IJK::VERTEX_POLY_INCIDENCE<int,int> & vertex_poly_incidence,
+ COORD_ARRAY & vertex_coord, 
+ const int flat_vert[], const int num_flat_vert,
+ float pre_min_at_facet, float pre_min_around_facet, 
+ float & move_dist, int dir[])
 {
   const int DIM3(3);
   const float step_base(0.05);
@@ -388,14 +1073,11 @@ void IVOLDUAL::find_optimal_jacobian_point
 
           if (ix == 0 && iy == 0 && iz == 0) continue;
 
-          std::vector<int> dir_temp(3);
-          dir_temp[0] = ix;
-          dir_temp[1] = iy;
-          dir_temp[2] = iz;
+          const int dir_temp[DIM3] = { ix, iy, iz };
 
           // Move in dir_temp
-          for (int j = 0; j < flat_hex[ifacet].size(); j++) {
-            int ivert = flat_hex[ifacet][j];
+          for (int j = 0; j < num_flat_vert; j++) {
+            int ivert = flat_vert[j];
             COORD_TYPE *cur_coord = vcoord + ivert * DIM3;
 
             for (int d = 0; d < DIM3; d++) {
@@ -405,8 +1087,8 @@ void IVOLDUAL::find_optimal_jacobian_point
 
           // Check Jacobian.
           float min_at_facet = 1.0, min_around_facet = 1.0;
-          for (int j = 0; j < flat_hex[ifacet].size(); j++) {
-            int ivert = flat_hex[ifacet][j];
+          for (int j = 0; j < num_flat_vert; j++) {
+            int ivert = flat_vert[j];
             float min_jacob_at_cur, min_jacob_around_cur;
 
             min_jacob_around_vertex
@@ -423,12 +1105,12 @@ void IVOLDUAL::find_optimal_jacobian_point
             pre_min_at_facet = min_at_facet;
             pre_min_around_facet = min_around_facet;
             move_dist = k * step_base;
-            dir = dir_temp;
+            std::copy(dir_temp, dir_temp+DIM3, dir);
           }
 
           // Move back to original positions
-          for (int j = 0; j < flat_hex[ifacet].size(); j++) {
-            int ivert = flat_hex[ifacet][j];
+          for (int j = 0; j < num_flat_vert; j++) {
+            int ivert = flat_vert[j];
             COORD_TYPE *cur_coord = vcoord + ivert * DIM3;
 
             for (int d = 0; d < DIM3; d++) {
@@ -551,14 +1233,13 @@ void IVOLDUAL::move_vertex_along_edge
       for (int ipoly = 0; ipoly < vertex_poly_incidence.NumIncidentPoly(ivert); ipoly++) {
         const int jhex = vertex_poly_incidence.IncidentPoly(ivert, ipoly);
 
-        for (int i = 0; i < 8; i++) {
-          // Compute Jacobian at current vertex
-          COORD_TYPE jacob;        
-          compute_hexahedron_normalized_Jacobian_determinant
-            (ivolpoly_vert, jhex, vertex_coord, i, jacob);
+        // Compute min Jacobian of hex jhex
+        COORD_TYPE jacob;
+        int icorner;
+        compute_min_hexahedron_normalized_Jacobian_determinant
+          (ivolpoly_vert, jhex, vertex_coord, jacob, icorner);
 
-          min_jacobian = std::min(jacob, min_jacobian);
-        }
+        min_jacobian = std::min(jacob, min_jacobian);
       }
 
       if (min_jacobian > pre_jacobian) {
@@ -708,14 +1389,13 @@ void IVOLDUAL::gradient_move_vertex
     for (int ipoly = 0; ipoly < vertex_poly_incidence.NumIncidentPoly(ver_index); ipoly++) {
       const int ihex = vertex_poly_incidence.IncidentPoly(ver_index, ipoly);
 
-      for (int i = 0; i < 8; i++) {
-        // Compute Jacobian at current vertex
-        COORD_TYPE jacob;        
-        compute_hexahedron_normalized_Jacobian_determinant
-          (ivolpoly_vert, ihex, vertex_coord, i, jacob);
+      // Compute min Jacobian of hex ihex
+      COORD_TYPE jacob;
+      int icorner;
+      compute_min_hexahedron_normalized_Jacobian_determinant
+        (ivolpoly_vert, ihex, vertex_coord, jacob, icorner);
 
-        min_jacobian = std::min(jacob, min_jacobian);
-      }
+      min_jacobian = std::min(jacob, min_jacobian);
     }
 
     if (min_jacobian > pre_jacobian) {
@@ -745,13 +1425,13 @@ void IVOLDUAL::gradient_move_vertex
     for (int ipoly = 0; ipoly < vertex_poly_incidence.NumIncidentPoly(ver_index); ipoly++) {
       const int ihex = vertex_poly_incidence.IncidentPoly(ver_index, ipoly);
 
-      for (int i = 0; i < 8; i++) {
-        // Compute Jacobian at current vertex
-        COORD_TYPE jacob;        
-        compute_hexahedron_normalized_Jacobian_determinant
-          (ivolpoly_vert, ihex, vertex_coord, i, jacob);
-        min_jacobian = std::min(jacob, min_jacobian);
-      }
+      // Compute min Jacobian of hex ihex
+      COORD_TYPE jacob;
+      int icorner;
+      compute_min_hexahedron_normalized_Jacobian_determinant
+        (ivolpoly_vert, ihex, vertex_coord, jacob, icorner);
+
+      min_jacobian = std::min(jacob, min_jacobian);
     }
     if (min_jacobian > pre_jacobian) {
       pre_jacobian = min_jacobian;
@@ -896,6 +1576,64 @@ void IVOLDUAL::move_vertex_normal_direction
 }
 
 
+// Move vertex ivert along the gradient of the min normalized Jacobian.
+void IVOLDUAL::move_vertex_jacobian_gradient
+(const std::vector<VERTEX_INDEX> & ivolpoly_vert,
+ IJK::VERTEX_POLY_INCIDENCE<int,int> & vertex_poly_incidence,
+ COORD_ARRAY & vertex_coord,
+ const int ivert)
+{
+  const int DIM3(3);
+  const int MAX_NUM_STEPS(3);
+  const int MAX_NUM_HALVINGS(6);
+  const COORD_TYPE max_step_length(0.5);
+  COORD_TYPE * cur_coord = &(vertex_coord.front()) + ivert*DIM3;
+  COORD_TYPE min_jacob, gradient[DIM3];
+
+  compute_min_jacobian_and_gradient_at_vertex
+    (ivolpoly_vert, vertex_poly_incidence, vertex_coord, ivert, 
+     min_jacob, gradient);
+
+  for (int istep = 0; istep < MAX_NUM_STEPS; istep++) {
+    COORD_TYPE magnitude, dir[DIM3], start_coord[DIM3];
+    bool flag_zero;
+
+    IJK::normalize_vector
+      (DIM3, gradient, COORD_TYPE(0), dir, magnitude, flag_zero);
+    if (flag_zero) { return; }
+
+    IJK::copy_coord_3D(cur_coord, start_coord);
+
+    // Backtracking line search.  Accept first step increasing min_jacob.
+    bool flag_improved = false;
+    COORD_TYPE step_length = max_step_length;
+    for (int i = 0; i < MAX_NUM_HALVINGS; i++) {
+      COORD_TYPE new_min_jacob, new_gradient[DIM3];
+
+      for (int d = 0; d < DIM3; d++) 
+        { cur_coord[d] = start_coord[d] + step_length*dir[d]; }
+
+      compute_min_jacobian_and_gradient_at_vertex
+        (ivolpoly_vert, vertex_poly_incidence, vertex_coord, ivert, 
+         new_min_jacob, new_gradient);
+
+      if (new_min_jacob > min_jacob) {
+        min_jacob = new_min_jacob;
+        IJK::copy_coord_3D(new_gradient, gradient);
+        flag_improved = true;
+        break;
+      }
+
+      step_length = step_length/2;
+    }
+
+    if (!flag_improved) {
+      IJK::copy_coord_3D(start_coord, cur_coord);
+      return;
+    }
+  }
+}
+
 void IVOLDUAL::min_jacob_around_vertex
 (const std::vector<VERTEX_INDEX> & ivolpoly_vert,
  IJK::VERTEX_POLY_INCIDENCE<int,int> & vertex_poly_incidence,
@@ -911,15 +1649,15 @@ void IVOLDUAL::min_jacob_around_vertex
   for (int ipoly = 0; ipoly < vertex_poly_incidence.NumIncidentPoly(ivert); ipoly++) {
     const int ihex = vertex_poly_incidence.IncidentPoly(ivert, ipoly);
 
-    for (int j = 0; j < 8; j++) {
-      // Compute Jacobian at current vertex
-      COORD_TYPE jacob;        
-      compute_hexahedron_normalized_Jacobian_determinant
-        (ivolpoly_vert, ihex, vertex_coord, j, jacob);
+    // Compute Jacobian at all hex vertices
+    COORD_TYPE jacob[8];
+    compute_hexahedron_normalized_Jacobian_determinants
+      (ivolpoly_vert, ihex, vertex_coord, jacob);
 
-      min_jacob_around_cur = std::min(jacob, min_jacob_around_cur);
+    for (int j = 0; j < 8; j++) {
+      min_jacob_around_cur = std::min(jacob[j], min_jacob_around_cur);
       if (ivert == ivolpoly_vert[ihex * 8 + j]) {
-        min_jacob_at_cur = std::min(jacob, min_jacob_at_cur);
+        min_jacob_at_cur = std::min(jacob[j], min_jacob_at_cur);
       }
     }
   }
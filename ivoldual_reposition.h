@@ -24,6 +24,7 @@
 #define _IVOLDUAL_REPOSITION_
 
 #include "ijk.txx"
+#include "ijklist.txx"
 
 #include "ivoldual_types.h"
 #include "ivoldual_datastruct.h"
@@ -53,6 +54,41 @@ namespace IVOLDUAL {
    float laplacian_smooth_limit, 
    int iteration);
 
+  /// Laplacian Smoothing for small edge length.
+  /// - Version which optionally colors the vertex adjacency graph
+  ///   and updates each color class on num_threads threads.
+  /// - If flag_color is false, run the serial version.
+  /// - If flag_color is true, output is independent of num_threads
+  ///   but may differ from the serial version, since vertices
+  ///   are updated color class by color class.
+  void laplacian_smooth_elength
+  (const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+   IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
+   const DUAL_IVOLVERT_ARRAY & ivolv_list,
+   COORD_ARRAY & vertex_coord,
+   float laplacian_smooth_limit, 
+   int iteration,
+   const bool flag_color,
+   const int num_threads);
+
+  /// Laplacian Smoothing for small edge length.
+  /// - Version which stops when smooth_control criteria are met.
+  /// - Each iteration is one sweep over surface vertices 
+  ///   followed by one sweep over interior vertices.
+  /// - smooth_info is set to the number of iterations 
+  ///   and the reason smoothing stopped.
+  void laplacian_smooth_elength
+  (const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+   IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
+   const DUAL_IVOLVERT_ARRAY & ivolv_list,
+   COORD_ARRAY & vertex_coord,
+   float laplacian_smooth_limit, 
+   int iteration,
+   const bool flag_color,
+   const int num_threads,
+   IVOLDUAL_SMOOTH_CONTROL smooth_control,
+   IVOLDUAL_SMOOTH_INFO & smooth_info);
+
   /// Laplacian Smoothing for bad Jacobian.
   void laplacian_smooth_jacobian
   (const std::vector<VERTEX_INDEX> & ivolpoly_cube,
@@ -64,6 +100,22 @@ namespace IVOLDUAL {
    float jacobian_limit, 
    int iteration);
 
+  /// Laplacian Smoothing for bad Jacobian.
+  /// - Version which stops when smooth_control criteria are met.
+  /// - smooth_info is set to the number of iterations 
+  ///   and the reason smoothing stopped.
+  void laplacian_smooth_jacobian
+  (const std::vector<VERTEX_INDEX> & ivolpoly_cube,
+   const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+   IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
+   IJK::VERTEX_POLY_INCIDENCE<int,int> & vertex_poly_incidence,
+   const DUAL_IVOLVERT_ARRAY & ivolv_list,
+   COORD_ARRAY & vertex_coord, 
+   float jacobian_limit, 
+   int iteration,
+   IVOLDUAL_SMOOTH_CONTROL smooth_control,
+   IVOLDUAL_SMOOTH_INFO & smooth_info);
+
   void laplacian_smooth_jacobian
   (const std::vector<VERTEX_INDEX> & ivolpoly_cube,
    const IVOLDUAL_CUBE_TABLE & ivoldual_table,
@@ -73,6 +125,19 @@ namespace IVOLDUAL {
    COORD_ARRAY & vertex_coord, 
    const std::vector<int> & negative_jabocian_list);
 
+  /// Laplacian Smoothing for bad Jacobian.
+  /// - Version which moves interior vertices with 
+  ///   move_vertex_jacobian_gradient() if flag_jacobian_gradient is true.
+  void laplacian_smooth_jacobian
+  (const std::vector<VERTEX_INDEX> & ivolpoly_cube,
+   const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+   IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
+   IJK::VERTEX_POLY_INCIDENCE<int,int> & vertex_poly_incidence,
+   const DUAL_IVOLVERT_ARRAY & ivolv_list,
+   COORD_ARRAY & vertex_coord, 
+   const std::vector<int> & negative_jabocian_list,
+   const bool flag_jacobian_gradient);
+
   /// Gradient Smoothing for bad Jacobian.
   void gradient_smooth_jacobian
   (std::vector<VERTEX_INDEX> & ivolpoly_cube,
@@ -85,6 +150,51 @@ namespace IVOLDUAL {
    float jacobian_limit, 
    int iteration);
 
+  /// Gradient Smoothing for bad Jacobian.
+  /// - Version which stops when smooth_control criteria are met.
+  /// - smooth_info is set to the number of iterations 
+  ///   and the reason smoothing stopped.
+  void gradient_smooth_jacobian
+  (std::vector<VERTEX_INDEX> & ivolpoly_cube,
+   const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+   IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
+   IJK::VERTEX_POLY_INCIDENCE<int,int> & vertex_poly_incidence,
+   DUAL_IVOLVERT_ARRAY & ivolv_list,
+   IVOLDUAL_POLY_INFO_ARRAY & ivolpoly_info,
+   COORD_ARRAY & vertex_coord, 
+   float jacobian_limit, 
+   int iteration,
+   IVOLDUAL_SMOOTH_CONTROL smooth_control,
+   IVOLDUAL_SMOOTH_INFO & smooth_info);
+
+  /// Repair hexahedra with Jacobian below jacobian_limit, worst first.
+  /// - Keeps a min-heap of hexahedra keyed by min normalized Jacobian.
+  ///   Repeatedly moves the vertices of the worst hexahedron
+  ///   which its bad corner Jacobians depend on, and updates
+  ///   the keys of hexahedra incident on moved vertices.
+  /// - A vertex move is kept only if it increases the min Jacobian
+  ///   at hexahedra corners around the vertex.
+  /// - Stops when no hexahedron has Jacobian below jacobian_limit,
+  ///   when no bad hexahedron can be improved,
+  ///   or after budget_ms milliseconds.
+  /// @param budget_ms Wall clock milliseconds allowed for repair.
+  ///   If not positive, no time limit.
+  /// @param flag_jacobian_gradient If true, move interior vertices
+  ///   with move_vertex_jacobian_gradient().
+  /// @param[out] repair_info Number of hexahedra repairs
+  ///   and the reason repair stopped.
+  void repair_jacobian_worst_first
+  (const std::vector<VERTEX_INDEX> & ivolpoly_vert,
+   const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+   IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
+   IJK::VERTEX_POLY_INCIDENCE<int,int> & vertex_poly_incidence,
+   const DUAL_IVOLVERT_ARRAY & ivolv_list,
+   COORD_ARRAY & vertex_coord,
+   const float jacobian_limit,
+   const float budget_ms,
+   const bool flag_jacobian_gradient,
+   IVOLDUAL_SMOOTH_INFO & repair_info);
+
   void expand_flat_hex
   (const std::vector<VERTEX_INDEX> & ivolpoly_cube,
    const IVOLDUAL_CUBE_TABLE & ivoldual_table,
@@ -94,6 +204,18 @@ namespace IVOLDUAL {
    COORD_ARRAY & vertex_coord, 
    const std::vector<std::vector<int>> & flag_hex);
 
+  /// Expand flat hexahedra facets or edges.
+  /// - Version using LIST_OF_LISTS for flat_hex.
+  ///   List i contains the vertices of flat facet or edge i.
+  void expand_flat_hex
+  (const std::vector<VERTEX_INDEX> & ivolpoly_cube,
+   const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+   IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
+   IJK::VERTEX_POLY_INCIDENCE<int,int> & vertex_poly_incidence,
+   const DUAL_IVOLVERT_ARRAY & ivolv_list,
+   COORD_ARRAY & vertex_coord, 
+   const IJK::LIST_OF_LISTS<int,int> & flat_hex);
+
   void expand_flat_hex_normal_direction
   (const std::vector<VERTEX_INDEX> & ivolpoly_cube,
    const IVOLDUAL_CUBE_TABLE & ivoldual_table,
@@ -114,6 +236,20 @@ namespace IVOLDUAL {
    std::unordered_map<int, COORD_TYPE> & negative_jacobian_value,
    int iter);
 
+  /// Move vertices in negative_jacobian_list to improve Jacobian.
+  /// - Version where negative_jacobian_min[i] is the min Jacobian
+  ///   at vertex negative_jacobian_list[i].
+  void gradient_smooth_jacobian
+  (const std::vector<VERTEX_INDEX> & ivolpoly_cube,
+   const IVOLDUAL_CUBE_TABLE & ivoldual_table,
+   IVOL_VERTEX_ADJACENCY_LIST & vertex_adjacency_list,
+   IJK::VERTEX_POLY_INCIDENCE<int,int> & vertex_poly_incidence,
+   const DUAL_IVOLVERT_ARRAY & ivolv_list,
+   COORD_ARRAY & vertex_coord, 
+   const std::vector<int> & negative_jabocian_list,
+   const std::vector<COORD_TYPE> & negative_jacobian_min,
+   int iter);
+
   void gradient_move_vertex
 	(const std::vector<VERTEX_INDEX> & ivolpoly_cube,
 	 const IVOLDUAL_CUBE_TABLE & ivoldual_table,
@@ -140,6 +276,18 @@ namespace IVOLDUAL {
    COORD_TYPE cur_min_jacob,
    int ivert, int iter);
 
+  /// Move vertex ivert along the gradient of the min normalized
+  ///   Jacobian at hexahedra corners depending on ivert.
+  /// - Gradient is computed analytically, not by probing positions.
+  /// - Backtracking line search halves the step, starting at 0.5,
+  ///   until the min Jacobian increases.  Stops after three steps,
+  ///   or when no step increases the min Jacobian.
+  void move_vertex_jacobian_gradient
+  (const std::vector<VERTEX_INDEX> & ivolpoly_vert,
+   IJK::VERTEX_POLY_INCIDENCE<int,int> & vertex_poly_incidence,
+   COORD_ARRAY & vertex_coord,
+   const int ivert);
+
   void min_jacob_around_vertex
   (const std::vector<VERTEX_INDEX> & ivolpoly_vert,
    IJK::VERTEX_POLY_INCIDENCE<int,int> & vertex_poly_incidence,
@@ -163,6 +311,17 @@ namespace IVOLDUAL {
    float pre_min_at_facet, float pre_min_around_facet, 
    int ifacet, 
    float & move_dist, std::vector<int> & dir);
+
+  /// Find optimal direction and distance to move flat facet or edge.
+  /// - Version with array flat_vert[] of num_flat_vert facet 
+  ///   or edge vertices and array dir[3].
+  void find_optimal_jacobian_point
+  (const std::vector<VERTEX_INDEX> & ivolpoly_vert,
+   IJK::VERTEX_POLY_INCIDENCE<int,int> & vertex_poly_incidence,
+   COORD_ARRAY & vertex_coord, 
+   const int flat_vert[], const int num_flat_vert,
+   float pre_min_at_facet, float pre_min_around_facet, 
+   float & move_dist, int dir[]);
    
   void surface_normal_direction
    (COORD_ARRAY & vertex_coord,
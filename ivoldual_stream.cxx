@@ -0,0 +1,727 @@
+/// \file ivoldual_stream.cxx
+/// Construct interval volumes from z-slabs of a nrrd file (out-of-core).
+
+/*
+  IJK: Isosurface Jeneration Kode
+  Copyright (C) 2018 Rephael Wenger
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public License
+  (LGPL) as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "ivoldual_stream.h"
+#include "ivoldual.h"
+
+using namespace IJK;
+using namespace IVOLDUAL;
+
+using namespace std;
+
+
+// **************************************************
+// CLASS NRRD_SLAB_READER
+// **************************************************
+
+// local namespace
+namespace {
+
+  bool is_little_endian()
+  {
+    const unsigned short one = 1;
+    return(*(reinterpret_cast<const unsigned char *>(&one)) == 1);
+  }
+
+  /// Copy raw values of type T into scalar array.
+  template <typename T>
+  void copy_raw_values
+  (const char * raw, const STREAM_INDEX numv, SCALAR_TYPE * scalar)
+  {
+    for (STREAM_INDEX iv = 0; iv < numv; iv++) {
+      T x;
+      std::memcpy(&x, raw+iv*sizeof(T), sizeof(T));
+      scalar[iv] = SCALAR_TYPE(x);
+    }
+  }
+
+  /// Reverse bytes of each value in raw.
+  void swap_raw_bytes
+  (char * raw, const STREAM_INDEX numv, const int value_size)
+  {
+    for (STREAM_INDEX iv = 0; iv < numv; iv++) {
+      char * value = raw + iv*value_size;
+      std::reverse(value, value+value_size);
+    }
+  }
+
+  /// Return directory of filename including the trailing '/'.
+  std::string get_directory(const std::string & filename)
+  {
+    const size_t islash = filename.rfind('/');
+    if (islash == std::string::npos) { return(""); }
+    return(filename.substr(0, islash+1));
+  }
+}
+
+
+void NRRD_SLAB_READER::Init()
+{
+  data_offset = 0;
+  value_type = FLOAT32;
+  value_size = 4;
+  flag_swap_bytes = false;
+  for (int d = 0; d < DIMENSION; d++) {
+    axis_size[d] = 0;
+    spacing[d] = 1;
+  }
+}
+
+
+// Parse nrrd header.
+// - Sets data_filename and data_offset.
+void NRRD_SLAB_READER::ParseHeader
+(std::istream & header, const std::string & header_filename,
+ IJK::ERROR & error)
+{
+  std::string line;
+  std::string type_string, encoding, endian, detached_filename;
+  std::vector<STREAM_INDEX> sizes;
+  int dimension = 0;
+  long line_skip = 0;
+  long byte_skip = 0;
+
+  if (!std::getline(header, line) || line.compare(0, 4, "NRRD") != 0) {
+    error.AddMessage("File ", header_filename, " is not a nrrd file.");
+    throw error;
+  }
+
+  while (std::getline(header, line)) {
+    if (!line.empty() && line[line.size()-1] == '\r')
+      { line.erase(line.size()-1); }
+
+    // Blank line ends the header.
+    if (line.empty()) { break; }
+
+    // Skip comments and key/value pairs.
+    if (line[0] == '#') { continue; }
+    if (line.find(":=") != std::string::npos) { continue; }
+
+    const size_t icolon = line.find(": ");
+    if (icolon == std::string::npos) { continue; }
+
+    const std::string field = line.substr(0, icolon);
+    std::istringstream value(line.substr(icolon+2));
+
+    if (field == "type") { type_string = value.str(); }
+    else if (field == "dimension") { value >> dimension; }
+    else if (field == "sizes") {
+      STREAM_INDEX s;
+      while (value >> s) { sizes.push_back(s); }
+    }
+    else if (field == "spacings") {
+      std::string s;
+      for (int d = 0; d < DIMENSION && (value >> s); d++) {
+        const double x = std::atof(s.c_str());
+        if (s != "nan" && s != "NaN" && std::isfinite(x) && x > 0)
+          { spacing[d] = x; }
+      }
+    }
+    else if (field == "encoding") { value >> encoding; }
+    else if (field == "endian") { value >> endian; }
+    else if (field == "data file" || field == "datafile")
+      { detached_filename = value.str(); }
+    else if (field == "line skip" || field == "lineskip")
+      { value >> line_skip; }
+    else if (field == "byte skip" || field == "byteskip")
+      { value >> byte_skip; }
+  }
+
+  if (dimension != DIMENSION || sizes.size() != DIMENSION) {
+    error.AddMessage
+      ("Streaming requires a 3D scalar grid.  File ", header_filename,
+       " has dimension ", dimension, ".");
+    throw error;
+  }
+
+  for (int d = 0; d < DIMENSION; d++) {
+    if (sizes[d] < 1 || sizes[d] > INT_MAX) {
+      error.AddMessage("Illegal axis size ", sizes[d], " in nrrd header.");
+      throw error;
+    }
+    axis_size[d] = sizes[d];
+  }
+
+  if (type_string == "signed char" || type_string == "int8" ||
+      type_string == "int8_t")
+    { value_type = INT8; value_size = 1; }
+  else if (type_string == "uchar" || type_string == "unsigned char" ||
+           type_string == "uint8" || type_string == "uint8_t")
+    { value_type = UINT8; value_size = 1; }
+  else if (type_string == "short" || type_string == "short int" ||
+           type_string == "signed short" ||
+           type_string == "signed short int" ||
+           type_string == "int16" || type_string == "int16_t")
+    { value_type = INT16; value_size = 2; }
+  else if (type_string == "ushort" || type_string == "unsigned short" ||
+           type_string == "unsigned short int" ||
+           type_string == "uint16" || type_string == "uint16_t")
+    { value_type = UINT16; value_size = 2; }
+  else if (type_string == "int" || type_string == "signed int" ||
+           type_string == "int32" || type_string == "int32_t")
+    { value_type = INT32; value_size = 4; }
+  else if (type_string == "uint" || type_string == "unsigned int" ||
+           type_string == "uint32" || type_string == "uint32_t")
+    { value_type = UINT32; value_size = 4; }
+  else if (type_string == "float")
+    { value_type = FLOAT32; value_size = 4; }
+  else if (type_string == "double")
+    { value_type = FLOAT64; value_size = 8; }
+  else {
+    error.AddMessage
+      ("Nrrd type \"", type_string, "\" is not supported in streaming mode.");
+    throw error;
+  }
+
+  if (encoding != "raw") {
+    error.AddMessage
+      ("Streaming requires raw nrrd encoding.  File ", header_filename,
+       " has encoding \"", encoding, "\".");
+    error.AddMessage("  Convert with: unu save -e raw -f nrrd.");
+    throw error;
+  }
+
+  flag_swap_bytes = false;
+  if (value_size > 1) {
+    if (endian == "little") { flag_swap_bytes = !is_little_endian(); }
+    else if (endian == "big") { flag_swap_bytes = is_little_endian(); }
+    else {
+      error.AddMessage("Missing or illegal endian field in nrrd header.");
+      throw error;
+    }
+  }
+
+  if (detached_filename == "") {
+    // Data attached to header.
+    data_filename = header_filename;
+    data_offset = header.tellg();
+    if (data_offset < 0) {
+      error.AddMessage("Missing data in nrrd file ", header_filename, ".");
+      throw error;
+    }
+  }
+  else {
+    if (detached_filename.find(' ') != std::string::npos ||
+        detached_filename == "LIST") {
+      error.AddMessage
+        ("Streaming requires a single detached data file.");
+      throw error;
+    }
+
+    if (detached_filename[0] == '/')
+      { data_filename = detached_filename; }
+    else
+      { data_filename = get_directory(header_filename) + detached_filename; }
+    data_offset = 0;
+  }
+
+  SetDataOffset(line_skip, byte_skip, error);
+}
+
+
+// Open data file and skip lines and bytes before data.
+// @pre data_offset is the location of the first line to skip.
+void NRRD_SLAB_READER::SetDataOffset
+(const long line_skip, const long byte_skip, IJK::ERROR & error)
+{
+  data_file.open(data_filename.c_str(), ios::in | ios::binary);
+  if (!data_file) {
+    error.AddMessage("Unable to open nrrd data file ", data_filename, ".");
+    throw error;
+  }
+
+  data_file.seekg(data_offset);
+  std::string line;
+  for (long i = 0; i < line_skip; i++)
+    { std::getline(data_file, line); }
+
+  const STREAM_INDEX num_bytes =
+    NumVerticesInLayer()*STREAM_INDEX(axis_size[2])*value_size;
+
+  if (byte_skip == -1) {
+    // Data is at the end of the file.
+    data_file.seekg(0, ios::end);
+    data_offset = std::streamoff(data_file.tellg()) - num_bytes;
+  }
+  else {
+    data_offset = std::streamoff(data_file.tellg()) + byte_skip;
+  }
+
+  data_file.seekg(0, ios::end);
+  if (!data_file || data_offset < 0 ||
+      data_offset + num_bytes > std::streamoff(data_file.tellg())) {
+    error.AddMessage
+      ("Nrrd data file ", data_filename, " is too short for grid sizes.");
+    throw error;
+  }
+}
+
+
+void NRRD_SLAB_READER::Open(const std::string & input_filename)
+{
+  IJK::PROCEDURE_ERROR error("NRRD_SLAB_READER::Open");
+
+  std::ifstream header(input_filename.c_str(), ios::in | ios::binary);
+  if (!header) {
+    error.AddMessage("Unable to open nrrd file ", input_filename, ".");
+    throw error;
+  }
+
+  ParseHeader(header, input_filename, error);
+}
+
+
+void NRRD_SLAB_READER::ReadSlab
+(const AXIS_SIZE_TYPE z0, const AXIS_SIZE_TYPE z1,
+ DUALISO_SCALAR_GRID & slab_grid)
+{
+  const STREAM_INDEX numv_in_layer = NumVerticesInLayer();
+  const STREAM_INDEX numv = numv_in_layer*(z1-z0+1);
+  AXIS_SIZE_TYPE slab_axis_size[DIMENSION] =
+    { axis_size[0], axis_size[1], z1-z0+1 };
+  IJK::PROCEDURE_ERROR error("NRRD_SLAB_READER::ReadSlab");
+
+  if (z0 < 0 || z1 < z0 || z1 >= axis_size[2]) {
+    error.AddMessage
+      ("Programming error.  Illegal slab [", z0, ",", z1, "].");
+    throw error;
+  }
+
+  if (numv > INT_MAX) {
+    error.AddMessage
+      ("Slab [", z0, ",", z1, "] has too many grid vertices.");
+    error.AddMessage("  Reduce slab thickness.");
+    throw error;
+  }
+
+  slab_grid.SetSize(DIMENSION, slab_axis_size);
+
+  buffer.resize(numv*value_size);
+  data_file.clear();
+  data_file.seekg(data_offset + z0*numv_in_layer*value_size);
+  data_file.read(&(buffer[0]), buffer.size());
+  if (!data_file) {
+    error.AddMessage
+      ("Error reading slab [", z0, ",", z1, "] from ", data_filename, ".");
+    throw error;
+  }
+
+  if (flag_swap_bytes)
+    { swap_raw_bytes(&(buffer[0]), numv, value_size); }
+
+  const char * raw = &(buffer[0]);
+  SCALAR_TYPE * scalar = slab_grid.ScalarPtr();
+  switch(value_type) {
+  case INT8:    copy_raw_values<signed char>(raw, numv, scalar); break;
+  case UINT8:   copy_raw_values<unsigned char>(raw, numv, scalar); break;
+  case INT16:   copy_raw_values<short>(raw, numv, scalar); break;
+  case UINT16:  copy_raw_values<unsigned short>(raw, numv, scalar); break;
+  case INT32:   copy_raw_values<int>(raw, numv, scalar); break;
+  case UINT32:  copy_raw_values<unsigned int>(raw, numv, scalar); break;
+  case FLOAT32: copy_raw_values<float>(raw, numv, scalar); break;
+  case FLOAT64: copy_raw_values<double>(raw, numv, scalar); break;
+  }
+}
+
+
+// **************************************************
+// CLASS OFF_STREAM_WRITER
+// **************************************************
+
+// local namespace
+namespace {
+
+  /// Width of line containing vertex and polytope counts.
+  const int OFF_COUNT_LINE_WIDTH = 48;
+}
+
+
+OFF_STREAM_WRITER::OFF_STREAM_WRITER()
+{
+  count_position = 0;
+  num_vertices = 0;
+  num_poly = 0;
+}
+
+
+OFF_STREAM_WRITER::~OFF_STREAM_WRITER()
+{
+  if (poly_file.is_open()) {
+    poly_file.close();
+    std::remove(poly_filename.c_str());
+  }
+}
+
+
+void OFF_STREAM_WRITER::Open(const std::string & output_filename)
+{
+  IJK::PROCEDURE_ERROR error("OFF_STREAM_WRITER::Open");
+
+  this->output_filename = output_filename;
+  poly_filename = output_filename + ".poly.tmp";
+  num_vertices = 0;
+  num_poly = 0;
+
+  output_file.open(output_filename.c_str(), ios::out);
+  poly_file.open(poly_filename.c_str(), ios::out);
+  if (!output_file || !poly_file) {
+    error.AddMessage("Unable to open output file ", output_filename, ".");
+    throw error;
+  }
+
+  output_file << "OFF" << endl;
+  count_position = output_file.tellp();
+  WriteCounts();
+}
+
+
+// Write vertex and polytope counts padded to OFF_COUNT_LINE_WIDTH.
+void OFF_STREAM_WRITER::WriteCounts()
+{
+  std::ostringstream counts;
+  counts << num_vertices << " " << num_poly << " " << 0;
+
+  output_file.seekp(count_position);
+  output_file << std::left << std::setw(OFF_COUNT_LINE_WIDTH)
+              << counts.str() << endl;
+}
+
+
+void OFF_STREAM_WRITER::WriteVertex
+(const int dimension, const COORD_TYPE coord[])
+{
+  for (int d = 0; d < dimension; d++) {
+    output_file << coord[d];
+    if (d+1 < dimension) { output_file << " "; }
+    else { output_file << "\n"; }
+  }
+  num_vertices++;
+}
+
+
+void OFF_STREAM_WRITER::WritePoly
+(const int numv_per_poly, const STREAM_INDEX poly_vert[])
+{
+  poly_file << numv_per_poly;
+  for (int k = 0; k < numv_per_poly; k++)
+    { poly_file << " " << poly_vert[k]; }
+  poly_file << "\n";
+  num_poly++;
+}
+
+
+void OFF_STREAM_WRITER::Close()
+{
+  IJK::PROCEDURE_ERROR error("OFF_STREAM_WRITER::Close");
+
+  poly_file.close();
+
+  output_file << endl;
+  std::ifstream poly_in(poly_filename.c_str(), ios::in);
+  if (num_poly > 0) { output_file << poly_in.rdbuf(); }
+  poly_in.close();
+  std::remove(poly_filename.c_str());
+
+  WriteCounts();
+  output_file.close();
+
+  if (!output_file) {
+    error.AddMessage("Error writing output file ", output_filename, ".");
+    throw error;
+  }
+}
+
+
+// **************************************************
+// STREAM INTERVAL VOLUME
+// **************************************************
+
+// local namespace
+namespace {
+
+  /// Number of keys per grid cube in the map of slab boundary vertices.
+  /// - Patch indices are FACET_VERTEX_INDEX (unsigned char).
+  const STREAM_INDEX NUM_PATCH_KEYS = 256;
+
+  typedef std::unordered_map<STREAM_INDEX,STREAM_INDEX> STREAM_VERTEX_MAP;
+
+  /// Construct interval volume [isovalue0,isovalue1] slab by slab.
+  void stream_interval_volume_slabs
+  (NRRD_SLAB_READER & reader, const OUTPUT_INFO & output_info,
+   const SCALAR_TYPE isovalue0, const SCALAR_TYPE isovalue1,
+   DUALISO_TIME & dualiso_time, IO_TIME & io_time, IVOLDUAL_PROFILE & profile,
+   STREAM_INDEX & num_ivolv, STREAM_INDEX & num_ivolpoly, int & num_slabs)
+  {
+    const int DIM3(3);
+    const int NUM_VERT_PER_HEXAHEDRON(8);
+    const AXIS_SIZE_TYPE nz = reader.AxisSize(2);
+    const AXIS_SIZE_TYPE slab_thickness = output_info.stream_slab_thickness;
+    const STREAM_INDEX numv_in_layer = reader.NumVerticesInLayer();
+    DUALISO_SCALAR_GRID slab_grid;
+    IVOLDUAL_BLOCK_INDEX block_index;
+    IVOLDUAL_INFO ivoldual_info(DIM3);
+    std::vector<ISO_VERTEX_INDEX> ivolpoly_vert;
+    IVOLDUAL_POLY_INFO_ARRAY ivolpoly_info;
+    DUAL_IVOLVERT_ARRAY ivolv_list;
+    COORD_ARRAY vertex_coord;
+    std::vector<STREAM_INDEX> global_index;
+    STREAM_INDEX hex_vert[NUM_VERT_PER_HEXAHEDRON];
+    COORD_TYPE coord[DIM3];
+    OFF_STREAM_WRITER writer;
+
+    // Reuse buffers between slabs.
+    IVOLDUAL_CONTEXT context;
+    IVOLDUAL_EXTRACT_OPTIONS options;
+    options.SetContext(context);
+    options.SetBlockIndex(block_index);
+
+    const IVOLDUAL_CUBE_TABLE & ivoldual_table =
+      get_ivoldual_cube_table
+      (DIM3, output_info.SeparateNegFlag(), output_info.table_filename);
+
+    // Vertices in the lowest layer of cubes of the current slab
+    //   which were numbered by the previous slab.
+    STREAM_VERTEX_MAP lower_layer_vertex;
+
+    // Vertices in the highest layer of cubes of the current slab.
+    STREAM_VERTEX_MAP upper_layer_vertex;
+
+    num_ivolv = 0;
+    num_ivolpoly = 0;
+    num_slabs = 0;
+
+    if (!output_info.flag_nowrite)
+      { writer.Open(output_info.output_off_filename); }
+
+    // Grid vertices in layer nz-1 are not dual to any polytope.
+    for (AXIS_SIZE_TYPE z0 = 0; z0+1 < nz; z0 += slab_thickness) {
+      const AXIS_SIZE_TYPE z1 = std::min(z0+slab_thickness, nz-1);
+      const AXIS_SIZE_TYPE zlow = std::max(z0-1, 0);
+      const STREAM_INDEX first_slab_vertex = zlow*numv_in_layer;
+
+      PROFILE_TIMER timer;
+      ELAPSED_TIME read_time;
+      reader.ReadSlab(zlow, z1, slab_grid);
+      io_time.read_nrrd_time += read_time.getElapsed();
+      profile.AddTime(PROFILE_READ, timer);
+
+      if (output_info.block_edge_length > 0)
+        { block_index.Set(slab_grid, output_info.block_edge_length); }
+      else
+        { block_index.Clear(); }
+
+      ivolpoly_vert.clear();
+      ivolpoly_info.clear();
+      ivolv_list.clear();
+      vertex_coord.clear();
+      ivoldual_info.time.Clear();
+      dual_contouring_interval_volume
+        (slab_grid, isovalue0, isovalue1, ivoldual_table, output_info, 
+         options, ivolpoly_vert, ivolv_list, ivolpoly_info, vertex_coord, 
+         ivoldual_info);
+      dualiso_time.Add(ivoldual_info.time);
+      profile.Add(ivoldual_info.profile);
+
+      timer.Restart();
+      ELAPSED_TIME write_time;
+      global_index.assign(ivolv_list.size(), -1);
+      upper_layer_vertex.clear();
+
+      for (VERTEX_INDEX ipoly = 0; ipoly < ivolpoly_info.size(); ipoly++) {
+
+        // Keep only polytopes owned by the slab.
+        const STREAM_INDEX zpoly =
+          zlow + ivolpoly_info[ipoly].v0/numv_in_layer;
+        if (zpoly < z0 || zpoly >= z1) { continue; }
+
+        for (int k = 0; k < NUM_VERT_PER_HEXAHEDRON; k++) {
+          const ISO_VERTEX_INDEX ivolv =
+            ivolpoly_vert[ipoly*NUM_VERT_PER_HEXAHEDRON+k];
+
+          if (global_index[ivolv] < 0) {
+            const STREAM_INDEX icube =
+              first_slab_vertex + ivolv_list[ivolv].cube_index;
+            const STREAM_INDEX key =
+              icube*NUM_PATCH_KEYS + ivolv_list[ivolv].patch_index;
+            const STREAM_INDEX zcube = icube/numv_in_layer;
+
+            if (zcube < z0) {
+              STREAM_VERTEX_MAP::const_iterator pos =
+                lower_layer_vertex.find(key);
+              if (pos != lower_layer_vertex.end())
+                { global_index[ivolv] = pos->second; }
+            }
+
+            if (global_index[ivolv] < 0) {
+              global_index[ivolv] = num_ivolv;
+              num_ivolv++;
+
+              if (!output_info.flag_nowrite) {
+                for (int d = 0; d < DIM3; d++)
+                  { coord[d] = vertex_coord[ivolv*DIM3+d]; }
+                coord[2] += zlow;
+                for (int d = 0; d < DIM3; d++)
+                  { coord[d] *= reader.Spacing(d); }
+                writer.WriteVertex(DIM3, coord);
+              }
+            }
+
+            if (zcube+1 == z1)
+              { upper_layer_vertex[key] = global_index[ivolv]; }
+          }
+
+          hex_vert[k] = global_index[ivolv];
+        }
+
+        num_ivolpoly++;
+        if (!output_info.flag_nowrite)
+          { writer.WritePoly(NUM_VERT_PER_HEXAHEDRON, hex_vert); }
+      }
+
+      lower_layer_vertex.swap(upper_layer_vertex);
+      io_time.write_time += write_time.getElapsed();
+      profile.AddTime(PROFILE_WRITE, timer);
+      num_slabs++;
+    }
+
+    if (!output_info.flag_nowrite) {
+      PROFILE_TIMER timer;
+      ELAPSED_TIME write_time;
+      writer.Close();
+      io_time.write_time += write_time.getElapsed();
+      profile.AddTime(PROFILE_WRITE, timer);
+
+      if (!output_info.flag_silent) {
+        cout << "Wrote output to file: "
+             << output_info.output_off_filename << endl;
+      }
+    }
+  }
+
+}
+
+
+// Construct interval volume slab by slab and write it to OFF files.
+void IVOLDUAL::stream_interval_volume
+(const IO_INFO & io_info, DUALISO_TIME & dualiso_time, IO_TIME & io_time,
+ IVOLDUAL_PROFILE & profile)
+{
+  const int DIM3(3);
+  const int NUM_VERT_PER_HEXAHEDRON(8);
+  IJK::PROCEDURE_ERROR error("stream_interval_volume");
+
+  if (!check_stream_options(io_info, error)) { throw error; }
+
+  NRRD_SLAB_READER reader;
+  ELAPSED_TIME read_time;
+  reader.Open(io_info.input_filename);
+  io_time.read_nrrd_time = read_time.getElapsed();
+  io_time.write_time = 0;
+
+  if (reader.AxisSize(2) < 2) {
+    error.AddMessage("Streaming requires at least two layers of grid vertices.");
+    throw error;
+  }
+
+  IO_INFO stream_io_info(io_info);
+  stream_io_info.grid_spacing.resize(DIM3);
+  for (int d = 0; d < DIM3; d++)
+    { stream_io_info.grid_spacing[d] = reader.Spacing(d); }
+
+  for (unsigned int i = 0; i+1 < io_info.isovalue.size(); i++) {
+
+    OUTPUT_INFO output_info;
+    output_info.SetDimension(DIM3, NUM_VERT_PER_HEXAHEDRON);
+    set_output_info(stream_io_info, i, output_info);
+
+    STREAM_INDEX num_ivolv, num_ivolpoly;
+    int num_slabs;
+    stream_interval_volume_slabs
+      (reader, output_info, io_info.isovalue[i], io_info.isovalue[i+1],
+       dualiso_time, io_time, profile, num_ivolv, num_ivolpoly, num_slabs);
+
+    if (!output_info.flag_use_stdout && !output_info.flag_silent) {
+      cout << "  Interval volume ["
+           << output_info.isovalue[0] << ":"
+           << output_info.isovalue[1] << "].  "
+           << num_ivolv << " ivol vertices.  "
+           << num_ivolpoly << " ivol polytopes.  "
+           << num_slabs << " slabs." << endl;
+    }
+  }
+}
+
+
+// Return false and set error if io_info has an option
+//   which is not supported in streaming mode.
+bool IVOLDUAL::check_stream_options
+(const IO_INFO & io_info, IJK::ERROR & error)
+{
+  std::vector<std::string> option;
+
+  if (io_info.flag_subsample) { option.push_back("-subsample"); }
+  if (io_info.flag_supersample) { option.push_back("-supersample"); }
+  if (io_info.flag_subdivide) { option.push_back("-subdivide"); }
+  if (io_info.flag_rm_diag_ambig) { option.push_back("-rm_diag_ambig"); }
+  if (io_info.flag_add_outer_layer) { option.push_back("-add_outer_layer"); }
+  if (io_info.flag_rm_non_manifold) { option.push_back("-rm_non_manifold"); }
+  if (io_info.flag_split_ambig_pairs || io_info.flag_split_ambig_pairsB ||
+      io_info.flag_split_ambig_pairsC || io_info.flag_split_ambig_pairsD)
+    { option.push_back("-split_ambig_pairs"); }
+  if (io_info.flag_expand_thin_regions) { option.push_back("-expand_thin"); }
+  if (io_info.flag_split_hex) { option.push_back("-split_hex"); }
+  if (io_info.flag_collapse_hex) { option.push_back("-collapse_hex"); }
+  if (io_info.flag_lsmooth_elength) { option.push_back("-lsmooth_elength"); }
+  if (io_info.flag_lsmooth_elength_color) 
+    { option.push_back("-lsmooth_elength_color"); }
+  if (io_info.flag_lsmooth_jacobian) { option.push_back("-lsmooth_jacobian"); }
+  if (io_info.flag_gsmooth_jacobian) { option.push_back("-gsmooth_jacobian"); }
+  if (io_info.flag_repair_jacobian) { option.push_back("-repair_jacobian"); }
+  if (io_info.flag_multi_interval) { option.push_back("-multi_interval"); }
+  if (io_info.flag_incremental) { option.push_back("-incremental"); }
+  if (io_info.cube_index_method != AUTO_CUBE_INDEX)
+    { option.push_back("-cube_index"); }
+  if (io_info.use_triangle_mesh) { option.push_back("-trimesh"); }
+  if (io_info.flag_output_ply) { option.push_back("-ply"); }
+  if (io_info.flag_output_vtk) { option.push_back("-vtk"); }
+  if (io_info.flag_use_stdout) { option.push_back("-stdout"); }
+  if (io_info.flag_write_scalar) { option.push_back("-write_scalar"); }
+  if (io_info.flag_report_all_isov) { option.push_back("-out_ivolv"); }
+  if (io_info.flag_report_all_ivol_poly) { option.push_back("-out_ivolp"); }
+
+  if (option.size() == 0) { return(true); }
+
+  error.AddMessage("Option ", option[0], " is not supported with -stream_slab.");
+  error.AddMessage
+    ("  Streaming supports only Geomview OFF output without",
+     " mesh improvement.");
+  return(false);
+}
@@ -0,0 +1,188 @@
+/// \file ivoldual_stream.h
+/// Construct interval volumes from z-slabs of a nrrd file (out-of-core).
+
+/*
+  IJK: Isosurface Jeneration Kode
+  Copyright (C) 2018 Rephael Wenger
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public License
+  (LGPL) as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+
+#ifndef _IVOLDUAL_STREAM_
+#define _IVOLDUAL_STREAM_
+
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ivoldual_datastruct.h"
+#include "ivoldualIO.h"
+
+namespace IVOLDUAL {
+
+  /// Index of grid cubes and interval volume vertices in the full volume.
+  /// - Streamed volumes may have more than 2^31 grid vertices,
+  ///   so global indices do not use VERTEX_INDEX.
+  /// - Indices local to a slab still use VERTEX_INDEX.
+  typedef long long STREAM_INDEX;
+
+
+  // **************************************************
+  // CLASS NRRD_SLAB_READER
+  // **************************************************
+
+  /// Read z-slabs of a 3D scalar grid from a nrrd file.
+  /// - Parses the nrrd header and reads only the requested layers
+  ///   of grid vertices.  The full volume is never in memory.
+  /// - Data must have raw encoding, either attached to the header
+  ///   or in a single detached data file.
+  class NRRD_SLAB_READER {
+
+  protected:
+
+    /// Scalar value types supported in the nrrd file.
+    typedef enum
+      { INT8, UINT8, INT16, UINT16, INT32, UINT32, FLOAT32, FLOAT64 }
+    VALUE_TYPE;
+
+    static const int DIMENSION = 3;
+
+    std::string data_filename;
+    std::ifstream data_file;
+    std::streamoff data_offset;
+    VALUE_TYPE value_type;
+    int value_size;
+    bool flag_swap_bytes;
+    AXIS_SIZE_TYPE axis_size[DIMENSION];
+    COORD_TYPE spacing[DIMENSION];
+
+    /// Buffer for raw slab data.
+    std::vector<char> buffer;
+
+    void Init();
+    void ParseHeader
+    (std::istream & header, const std::string & header_filename,
+     IJK::ERROR & error);
+    void SetDataOffset
+    (const long line_skip, const long byte_skip, IJK::ERROR & error);
+
+  public:
+    NRRD_SLAB_READER() { Init(); };
+
+    /// Open nrrd file and read header.
+    void Open(const std::string & input_filename);
+
+    int Dimension() const
+    { return(DIMENSION); }
+    AXIS_SIZE_TYPE AxisSize(const int d) const
+    { return(axis_size[d]); }
+    const AXIS_SIZE_TYPE * AxisSize() const
+    { return(axis_size); }
+    COORD_TYPE Spacing(const int d) const
+    { return(spacing[d]); }
+
+    /// Number of grid vertices in one z-layer.
+    STREAM_INDEX NumVerticesInLayer() const
+    { return(STREAM_INDEX(axis_size[0])*STREAM_INDEX(axis_size[1])); }
+
+    /// Read grid vertex layers z0,...,z1 into slab_grid.
+    /// - slab_grid has axis sizes (AxisSize(0), AxisSize(1), z1-z0+1).
+    /// @pre z0 <= z1 < AxisSize(2).
+    void ReadSlab
+    (const AXIS_SIZE_TYPE z0, const AXIS_SIZE_TYPE z1,
+     DUALISO_SCALAR_GRID & slab_grid);
+  };
+
+
+  // **************************************************
+  // CLASS OFF_STREAM_WRITER
+  // **************************************************
+
+  /// Write a Geomview OFF file incrementally.
+  /// - Vertices are written directly to the output file.
+  ///   Polytopes are written to a temporary file which is appended
+  ///   to the output file by Close().
+  /// - The OFF header is written with a fixed width and overwritten
+  ///   with the vertex and polytope counts by Close().
+  class OFF_STREAM_WRITER {
+
+  protected:
+    std::string output_filename;
+    std::string poly_filename;
+    std::ofstream output_file;
+    std::ofstream poly_file;
+    std::streamoff count_position;
+    STREAM_INDEX num_vertices;
+    STREAM_INDEX num_poly;
+
+    void WriteCounts();
+
+  public:
+    OFF_STREAM_WRITER();
+    ~OFF_STREAM_WRITER();
+
+    /// Open output file and temporary polytope file.
+    void Open(const std::string & output_filename);
+
+    /// Write vertex.
+    void WriteVertex(const int dimension, const COORD_TYPE coord[]);
+
+    /// Write polytope.
+    void WritePoly(const int numv_per_poly, const STREAM_INDEX poly_vert[]);
+
+    /// Append polytopes to output file and set counts in header.
+    void Close();
+
+    STREAM_INDEX NumVertices() const
+    { return(num_vertices); }
+    STREAM_INDEX NumPoly() const
+    { return(num_poly); }
+  };
+
+
+  // **************************************************
+  // STREAM INTERVAL VOLUME
+  // **************************************************
+
+  /// Construct interval volume slab by slab and write it to OFF files.
+  /// - Each slab owns the interval volume polytopes dual to grid
+  ///   vertices and edges whose lower endpoint has z-coordinate
+  ///   in [z0,z1), z1-z0 = io_info.stream_slab_thickness.
+  /// - Reads grid vertex layers [z0-1,z1] of each slab.
+  ///   The extra layers ensure that every polytope owned by the slab
+  ///   is dual to a grid vertex or edge in the interior of the slab.
+  /// - Interval volume vertices are numbered in the order they are
+  ///   first used.  Vertices in the top layer of cubes of a slab
+  ///   keep their numbers in the next slab.
+  /// - Positions of interval volume vertices depend only on
+  ///   the containing grid cube, so the output has the same hexahedra
+  ///   as the output of the in-core algorithm.  Vertex numbering differs
+  ///   and vertices which are in no hexahedra are not output.
+  /// - Mesh improvements which move vertices based on their neighbors
+  ///   are not supported.  See check_stream_options().
+  /// - Adds read, encode, extract and write times of each slab to profile.
+  void stream_interval_volume
+  (const IO_INFO & io_info, DUALISO_TIME & dualiso_time, IO_TIME & io_time,
+   IVOLDUAL_PROFILE & profile);
+
+  /// Return false and set error if io_info has an option
+  ///   which is not supported in streaming mode.
+  bool check_stream_options(const IO_INFO & io_info, IJK::ERROR & error);
+
+}
+
+#endif
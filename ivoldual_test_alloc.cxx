@@ -0,0 +1,276 @@
+/// \file ivoldual_test_alloc.cxx
+/// Check that repeated extractions with an IVOLDUAL_CONTEXT
+///   do not allocate memory.
+/// - The second extraction from the same grid with the same context
+///   and the same output arrays must not call operator new.
+/// - Only single thread extractions are checked.
+///   Each std::thread allocates its own state when it starts.
+
+/*
+  IJK: Isosurface Jeneration Kode
+  Copyright (C) 2018 Rephael Wenger
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public License
+  (LGPL) as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <vector>
+
+#include "ivoldual.h"
+#include "ivoldualtable.h"
+
+using namespace IJK;
+using namespace IVOLDUAL;
+
+using namespace std;
+
+
+// **************************************************
+// HEAP ALLOCATION COUNTER
+// **************************************************
+
+// Number of calls to operator new while flag_count_allocations is true.
+std::atomic<bool> flag_count_allocations(false);
+std::atomic<long long> num_allocations(0);
+std::atomic<long long> num_bytes_allocated(0);
+
+// Replacement operator new allocates with malloc() and replacement
+//   operator delete releases with free().  Neither is inlined,
+//   so the compiler does not pair the free() with the library
+//   operator new at call sites.
+#if defined(__GNUC__)
+#define TEST_ALLOC_NOINLINE __attribute__((noinline))
+#else
+#define TEST_ALLOC_NOINLINE
+#endif
+
+TEST_ALLOC_NOINLINE void * operator new(std::size_t n)
+{
+  if (flag_count_allocations) {
+    num_allocations++;
+    num_bytes_allocated += n;
+  }
+  void * p = std::malloc(n == 0 ? 1 : n);
+  if (p == NULL) { throw std::bad_alloc(); }
+  return(p);
+}
+
+TEST_ALLOC_NOINLINE void operator delete(void * p) noexcept
+{ std::free(p); }
+
+
+// **************************************************
+// TYPES
+// **************************************************
+
+typedef enum { GYROID_FIELD, AMBIG_FIELD, NUM_FIELDS } FIELD_TYPE;
+
+typedef enum { EXTRACT_FLAGS, SPLIT_FLAGS, NUM_FLAG_SETS } FLAG_SET;
+
+
+// **************************************************
+// LOCAL SUBROUTINES
+// **************************************************
+
+void set_field
+(const FIELD_TYPE field, const AXIS_SIZE_TYPE size,
+ DUALISO_SCALAR_GRID & scalar_grid);
+void set_flags(const FLAG_SET flag_set, IVOLDUAL_DATA_FLAGS & param);
+bool check_second_extraction
+(const DUALISO_SCALAR_GRID & scalar_grid, const FLAG_SET flag_set,
+ const CUBE_INDEX_METHOD cube_index_method,
+ long long & num_alloc, long long & num_bytes);
+
+
+// **************************************************
+// MAIN
+// **************************************************
+
+namespace {
+
+  const char * field_name[NUM_FIELDS] = { "gyroid", "ambig" };
+
+  const char * flag_set_name[NUM_FLAG_SETS] = { "extract", "split" };
+
+  const int NUM_CUBE_INDEX_METHODS = 2;
+  const CUBE_INDEX_METHOD cube_index_method[NUM_CUBE_INDEX_METHODS] =
+    { DENSE_CUBE_INDEX, SPARSE_CUBE_INDEX };
+  const char * cube_index_method_name[NUM_CUBE_INDEX_METHODS] =
+    { "dense", "sparse" };
+
+  const AXIS_SIZE_TYPE GRID_SIZE = 20;
+  const SCALAR_TYPE ISOVALUE0 = -0.2;
+  const SCALAR_TYPE ISOVALUE1 = 0.3;
+}
+
+int main()
+{
+  int num_failed = 0;
+  int num_checked = 0;
+
+  try {
+
+    for (int ifield = 0; ifield < NUM_FIELDS; ifield++) {
+
+      DUALISO_SCALAR_GRID scalar_grid;
+      set_field(FIELD_TYPE(ifield), GRID_SIZE, scalar_grid);
+
+      for (int iflag = 0; iflag < NUM_FLAG_SETS; iflag++) {
+        for (int j = 0; j < NUM_CUBE_INDEX_METHODS; j++) {
+          long long num_alloc, num_bytes;
+
+          num_checked++;
+          if (!check_second_extraction
+              (scalar_grid, FLAG_SET(iflag), cube_index_method[j],
+               num_alloc, num_bytes)) {
+            cerr << "FAILED: field " << field_name[ifield]
+                 << ", flags " << flag_set_name[iflag]
+                 << ", cube index " << cube_index_method_name[j]
+                 << ".  Second extraction made " << num_alloc
+                 << " allocations of " << num_bytes << " bytes." << endl;
+            num_failed++;
+          }
+        }
+      }
+    }
+  }
+  catch (ERROR & error) {
+    if (error.NumMessages() == 0) {
+      cerr << "Unknown error." << endl;
+    }
+    else { error.Print(cerr); }
+    cerr << "Exiting." << endl;
+    exit(20);
+  }
+  catch (...) {
+    cerr << "Unknown error." << endl;
+    exit(50);
+  };
+
+  if (num_failed > 0) {
+    cerr << num_failed << " of " << num_checked
+         << " allocation checks failed." << endl;
+    return(1);
+  }
+
+  cout << "All " << num_checked << " allocation checks passed." << endl;
+  return(0);
+}
+
+
+// **************************************************
+// SYNTHETIC SCALAR FIELDS
+// **************************************************
+
+// Set scalar_grid to a size x size x size sample of field.
+void set_field
+(const FIELD_TYPE field, const AXIS_SIZE_TYPE size,
+ DUALISO_SCALAR_GRID & scalar_grid)
+{
+  const int DIM3(3);
+  const double PI = 3.14159265358979323846;
+  const double scale = 4*PI/(size-1);
+  const AXIS_SIZE_TYPE axis_size[DIM3] = { size, size, size };
+
+  scalar_grid.SetSize(DIM3, axis_size);
+
+  VERTEX_INDEX iv = 0;
+  for (AXIS_SIZE_TYPE z = 0; z < size; z++) {
+    for (AXIS_SIZE_TYPE y = 0; y < size; y++) {
+      for (AXIS_SIZE_TYPE x = 0; x < size; x++) {
+        SCALAR_TYPE s;
+
+        if (field == GYROID_FIELD) {
+          const double X = x*scale;
+          const double Y = y*scale;
+          const double Z = z*scale;
+          s = sin(X)*cos(Y) + sin(Y)*cos(Z) + sin(Z)*cos(X);
+        }
+        else {
+          // Checkerboard with small perturbations.
+          // Many cubes are ambiguous.
+          s = ((x+y+z)%2 == 0) ?
+            1.0 : -1.0 + 0.001*((7*x+13*y+31*z)%17);
+        }
+
+        scalar_grid.Set(iv, s);
+        iv++;
+      }
+    }
+  }
+}
+
+
+// **************************************************
+// CHECK ALLOCATIONS
+// **************************************************
+
+// Set flags for flag_set.
+void set_flags(const FLAG_SET flag_set, IVOLDUAL_DATA_FLAGS & param)
+{
+  if (flag_set == SPLIT_FLAGS) {
+    param.flag_split_ambig_pairs = true;
+    param.flag_expand_thin_regions = true;
+  }
+}
+
+
+// Extract the interval volume twice with the same context.
+// - Return true if the second extraction does not allocate memory.
+bool check_second_extraction
+(const DUALISO_SCALAR_GRID & scalar_grid, const FLAG_SET flag_set,
+ const CUBE_INDEX_METHOD cube_index_method,
+ long long & num_alloc, long long & num_bytes)
+{
+  const int dimension = scalar_grid.Dimension();
+  IVOLDUAL_DATA_FLAGS param;
+  IVOLDUAL_CONTEXT context;
+  IVOLDUAL_EXTRACT_OPTIONS options;
+  IVOLDUAL_INFO ivoldual_info(dimension);
+  std::vector<ISO_VERTEX_INDEX> ivolpoly_vert;
+  IVOLDUAL_POLY_INFO_ARRAY ivolpoly_info;
+  DUAL_IVOLVERT_ARRAY ivolv_list;
+  COORD_ARRAY vertex_coord;
+
+  set_flags(flag_set, param);
+  param.num_threads = 1;
+  param.cube_index_method = cube_index_method;
+  options.SetContext(context);
+
+  const IVOLDUAL_CUBE_TABLE & ivoldual_table =
+    get_ivoldual_cube_table(dimension, param.SeparateNegFlag(), "");
+
+  dual_contouring_interval_volume
+    (scalar_grid, ISOVALUE0, ISOVALUE1, ivoldual_table, param, options,
+     ivolpoly_vert, ivolv_list, ivolpoly_info, vertex_coord, ivoldual_info);
+
+  num_allocations = 0;
+  num_bytes_allocated = 0;
+  flag_count_allocations = true;
+
+  dual_contouring_interval_volume
+    (scalar_grid, ISOVALUE0, ISOVALUE1, ivoldual_table, param, options,
+     ivolpoly_vert, ivolv_list, ivolpoly_info, vertex_coord, ivoldual_info);
+
+  flag_count_allocations = false;
+  num_alloc = num_allocations;
+  num_bytes = num_bytes_allocated;
+
+  return(num_alloc == 0);
+}
@@ -0,0 +1,518 @@
+/// \file ivoldual_test_determinism.cxx
+/// Check that interval volume construction is deterministic.
+/// - Output with num_threads > 1 must equal output with one thread.
+/// - Output with a sparse cube index must equal output
+///   with a dense cube index.
+/// - Output with a block index, from a multi-interval band grid
+///   or from an incrementally updated encoding must equal 
+///   the plain output, including for reversed and equal isovalues.
+
+/*
+  IJK: Isosurface Jeneration Kode
+  Copyright (C) 2018 Rephael Wenger
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public License
+  (LGPL) as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ivoldual.h"
+#include "ivoldualtable.h"
+
+using namespace IJK;
+using namespace IVOLDUAL;
+
+using namespace std;
+
+
+// **************************************************
+// TYPES
+// **************************************************
+
+typedef enum { GYROID_FIELD, AMBIG_FIELD, SPHERE_FIELD, NUM_FIELDS } 
+  FIELD_TYPE;
+
+typedef enum { EXTRACT_FLAGS, SPLIT_FLAGS, HEX_FLAGS,
+               LSMOOTH_FLAGS, GSMOOTH_FLAGS, NUM_FLAG_SETS } FLAG_SET;
+
+/// Extraction method compared with the plain extraction.
+typedef enum { PLAIN_MODE, BLOCK_MODE, BAND_MODE, INCREMENTAL_MODE, 
+               NUM_MODES } EXTRACT_MODE;
+
+// Interval volume computed by one run.
+class TEST_OUTPUT {
+
+public:
+  std::vector<ISO_VERTEX_INDEX> ivolpoly_vert;
+  IVOLDUAL_POLY_INFO_ARRAY ivolpoly_info;
+  DUAL_IVOLVERT_ARRAY ivolv_list;
+  COORD_ARRAY vertex_coord;
+};
+
+
+// **************************************************
+// LOCAL SUBROUTINES
+// **************************************************
+
+void set_field
+(const FIELD_TYPE field, const AXIS_SIZE_TYPE size,
+ DUALISO_SCALAR_GRID & scalar_grid);
+void set_flags(const FLAG_SET flag_set, IVOLDUAL_DATA_FLAGS & param);
+void construct_interval_volume
+(const DUALISO_SCALAR_GRID & scalar_grid, const FLAG_SET flag_set,
+ const int num_threads, const CUBE_INDEX_METHOD cube_index_method,
+ TEST_OUTPUT & output);
+bool construct_interval_volume
+(const DUALISO_SCALAR_GRID & scalar_grid, 
+ const SCALAR_TYPE isovalue0, const SCALAR_TYPE isovalue1,
+ const FLAG_SET flag_set, const EXTRACT_MODE mode, TEST_OUTPUT & output);
+int check_modes
+(const DUALISO_SCALAR_GRID & scalar_grid, const FIELD_TYPE field,
+ int & num_checked);
+bool is_equal(const TEST_OUTPUT & output0, const TEST_OUTPUT & output1,
+              std::string & mismatch);
+
+
+// **************************************************
+// MAIN
+// **************************************************
+
+namespace {
+
+  const char * field_name[NUM_FIELDS] = { "gyroid", "ambig", "sphere" };
+
+  const char * flag_set_name[NUM_FLAG_SETS] =
+    { "extract", "split", "hex", "lsmooth", "gsmooth" };
+
+  const AXIS_SIZE_TYPE GRID_SIZE = 20;
+  const SCALAR_TYPE ISOVALUE0 = -0.2;
+  const SCALAR_TYPE ISOVALUE1 = 0.3;
+
+  const int NUM_THREAD_COUNTS = 3;
+  const int thread_count[NUM_THREAD_COUNTS] = { 1, 2, 4 };
+
+  const char * mode_name[NUM_MODES] = 
+    { "plain", "block", "band", "incremental" };
+
+  // Blocks are small so that the grid has many uniform blocks.
+  const AXIS_SIZE_TYPE BLOCK_EDGE_LENGTH = 4;
+
+  // Increasing, reversed and equal isovalues.
+  const int NUM_ISOVALUE_PAIRS = 3;
+  const SCALAR_TYPE isovalue_pair[NUM_ISOVALUE_PAIRS][2] = 
+    { { ISOVALUE0, ISOVALUE1 }, { ISOVALUE1, ISOVALUE0 }, { 0.1, 0.1 } };
+}
+
+int main()
+{
+  int num_failed = 0;
+  int num_checked = 0;
+
+  try {
+
+    for (int ifield = 0; ifield < NUM_FIELDS; ifield++) {
+
+      DUALISO_SCALAR_GRID scalar_grid;
+      set_field(FIELD_TYPE(ifield), GRID_SIZE, scalar_grid);
+
+      for (int iflag = 0; iflag < NUM_FLAG_SETS; iflag++) {
+        const FLAG_SET flag_set = FLAG_SET(iflag);
+        TEST_OUTPUT reference;
+
+        // Reference: one thread, dense cube index.
+        construct_interval_volume
+          (scalar_grid, flag_set, 1, DENSE_CUBE_INDEX, reference);
+
+        for (int i = 0; i < NUM_THREAD_COUNTS; i++) {
+          for (int j = 0; j < 2; j++) {
+            const int num_threads = thread_count[i];
+            const CUBE_INDEX_METHOD cube_index_method =
+              (j == 0) ? DENSE_CUBE_INDEX : SPARSE_CUBE_INDEX;
+            TEST_OUTPUT output;
+            std::string mismatch;
+
+            if (num_threads == 1 && cube_index_method == DENSE_CUBE_INDEX)
+              { continue; }
+
+            construct_interval_volume
+              (scalar_grid, flag_set, num_threads, cube_index_method,
+               output);
+            num_checked++;
+
+            if (!is_equal(reference, output, mismatch)) {
+              cerr << "FAILED: field " << field_name[ifield]
+                   << ", flags " << flag_set_name[iflag]
+                   << ", threads " << num_threads
+                   << ", cube index "
+                   << ((j == 0) ? "dense" : "sparse")
+                   << ": " << mismatch << " differs." << endl;
+              num_failed++;
+            }
+          }
+        }
+
+        if (reference.ivolpoly_info.size() == 0) {
+          cerr << "FAILED: field " << field_name[ifield]
+               << ", flags " << flag_set_name[iflag]
+               << ": empty interval volume." << endl;
+          num_failed++;
+        }
+      }
+
+      num_failed += check_modes(scalar_grid, FIELD_TYPE(ifield), num_checked);
+    }
+
+  }
+  catch (ERROR & error) {
+    if (error.NumMessages() == 0) {
+      cerr << "Unknown error." << endl;
+    }
+    else { error.Print(cerr); }
+    cerr << "Exiting." << endl;
+    exit(20);
+  }
+  catch (...) {
+    cerr << "Unknown error." << endl;
+    exit(50);
+  };
+
+  if (num_failed > 0) {
+    cerr << num_failed << " of " << num_checked
+         << " determinism checks failed." << endl;
+    return(1);
+  }
+
+  cout << "All " << num_checked << " determinism checks passed." << endl;
+  return(0);
+}
+
+
+// Compare each extraction mode with the plain extraction
+//   for each pair in isovalue_pair[].
+// - Return number of failed checks.
+int check_modes
+(const DUALISO_SCALAR_GRID & scalar_grid, const FIELD_TYPE field,
+ int & num_checked)
+{
+  const FLAG_SET flag_set[2] = { EXTRACT_FLAGS, SPLIT_FLAGS };
+  int num_failed = 0;
+
+  for (int ipair = 0; ipair < NUM_ISOVALUE_PAIRS; ipair++) {
+    const SCALAR_TYPE isovalue0 = isovalue_pair[ipair][0];
+    const SCALAR_TYPE isovalue1 = isovalue_pair[ipair][1];
+
+    for (int iflag = 0; iflag < 2; iflag++) {
+      TEST_OUTPUT reference;
+
+      construct_interval_volume
+        (scalar_grid, isovalue0, isovalue1, flag_set[iflag], PLAIN_MODE,
+         reference);
+
+      for (int imode = PLAIN_MODE+1; imode < NUM_MODES; imode++) {
+        TEST_OUTPUT output;
+        std::string mismatch;
+
+        if (!construct_interval_volume
+            (scalar_grid, isovalue0, isovalue1, flag_set[iflag], 
+             EXTRACT_MODE(imode), output))
+          { continue; }
+        num_checked++;
+
+        if (!is_equal(reference, output, mismatch)) {
+          cerr << "FAILED: field " << field_name[field]
+               << ", flags " << flag_set_name[flag_set[iflag]]
+               << ", isovalues " << isovalue0 << " " << isovalue1
+               << ", mode " << mode_name[imode]
+               << ": " << mismatch << " differs." << endl;
+          num_failed++;
+        }
+      }
+    }
+  }
+
+  return(num_failed);
+}
+
+
+// **************************************************
+// SYNTHETIC SCALAR FIELDS
+// **************************************************
+
+// Set scalar_grid to a size x size x size sample of field.
+void set_field
+(const FIELD_TYPE field, const AXIS_SIZE_TYPE size,
+ DUALISO_SCALAR_GRID & scalar_grid)
+{
+  const int DIM3(3);
+  const double PI = 3.14159265358979323846;
+  const double scale = 4*PI/(size-1);
+  const AXIS_SIZE_TYPE axis_size[DIM3] = { size, size, size };
+
+  scalar_grid.SetSize(DIM3, axis_size);
+
+  VERTEX_INDEX iv = 0;
+  for (AXIS_SIZE_TYPE z = 0; z < size; z++) {
+    for (AXIS_SIZE_TYPE y = 0; y < size; y++) {
+      for (AXIS_SIZE_TYPE x = 0; x < size; x++) {
+        SCALAR_TYPE s;
+
+        if (field == GYROID_FIELD) {
+          const double X = x*scale;
+          const double Y = y*scale;
+          const double Z = z*scale;
+          s = sin(X)*cos(Y) + sin(Y)*cos(Z) + sin(Z)*cos(X);
+        }
+        else if (field == SPHERE_FIELD) {
+          // Distance to grid center, scaled to [-0.5,0.37].
+          const double c = (size-1)/2.0;
+          const double dx = x-c;
+          const double dy = y-c;
+          const double dz = z-c;
+          s = sqrt(dx*dx+dy*dy+dz*dz)/(size-1) - 0.5;
+        }
+        else {
+          // Checkerboard with small perturbations.
+          // Many cubes are ambiguous.
+          s = ((x+y+z)%2 == 0) ?
+            1.0 : -1.0 + 0.001*((7*x+13*y+31*z)%17);
+        }
+
+        scalar_grid.Set(iv, s);
+        iv++;
+      }
+    }
+  }
+}
+
+
+// **************************************************
+// CONSTRUCT INTERVAL VOLUME
+// **************************************************
+
+// Set flags for flag_set.
+void set_flags(const FLAG_SET flag_set, IVOLDUAL_DATA_FLAGS & param)
+{
+  if (flag_set != EXTRACT_FLAGS) {
+    param.flag_split_ambig_pairs = true;
+    param.flag_expand_thin_regions = true;
+  }
+
+  switch(flag_set) {
+
+  case HEX_FLAGS:
+    param.flag_split_hex = true;
+    param.flag_collapse_hex = true;
+    break;
+
+  case LSMOOTH_FLAGS:
+    param.flag_lsmooth_elength = true;
+    param.lsmooth_elength_iter = 2;
+    param.flag_lsmooth_jacobian = true;
+    param.lsmooth_jacobian_iter = 2;
+    break;
+
+  case GSMOOTH_FLAGS:
+    param.flag_gsmooth_jacobian = true;
+    param.gsmooth_jacobian_iter = 3;
+    break;
+
+  default:
+    break;
+  }
+}
+
+
+void construct_interval_volume
+(const DUALISO_SCALAR_GRID & scalar_grid, const FLAG_SET flag_set,
+ const int num_threads, const CUBE_INDEX_METHOD cube_index_method,
+ TEST_OUTPUT & output)
+{
+  const int dimension = scalar_grid.Dimension();
+  IVOLDUAL_DATA_FLAGS param;
+  IJKDUAL::ISO_MERGE_DATA merge_data(dimension, scalar_grid.AxisSize());
+  IVOLDUAL_INFO ivoldual_info(dimension);
+
+  set_flags(flag_set, param);
+  param.num_threads = num_threads;
+  param.cube_index_method = cube_index_method;
+
+  dual_contouring_interval_volume
+    (scalar_grid, ISOVALUE0, ISOVALUE1, param,
+     output.ivolpoly_vert, output.ivolpoly_info, output.ivolv_list,
+     output.vertex_coord, merge_data, ivoldual_info);
+}
+
+
+// Construct interval volume using extraction mode.
+// - PLAIN_MODE encodes every grid vertex and scans every grid cube.
+// - BAND_MODE extracts the first interval of a band grid
+//   with isovalues isovalue0, isovalue1 and a third larger isovalue.
+// - INCREMENTAL_MODE first extracts a wider interval and then
+//   updates the encoding to [isovalue0,isovalue1].
+// - Modes other than PLAIN_MODE use a block index.
+// - Return false if mode does not apply to the isovalues.
+bool construct_interval_volume
+(const DUALISO_SCALAR_GRID & scalar_grid, 
+ const SCALAR_TYPE isovalue0, const SCALAR_TYPE isovalue1,
+ const FLAG_SET flag_set, const EXTRACT_MODE mode, TEST_OUTPUT & output)
+{
+  const int dimension = scalar_grid.Dimension();
+  IVOLDUAL_DATA_FLAGS param;
+  IJKDUAL::ISO_MERGE_DATA merge_data(dimension, scalar_grid.AxisSize());
+  IVOLDUAL_BLOCK_INDEX block_index;
+  IVOLDUAL_INFO ivoldual_info(dimension);
+  IVOLDUAL_EXTRACT_OPTIONS options;
+
+  set_flags(flag_set, param);
+
+  const IVOLDUAL_CUBE_TABLE & ivoldual_table =
+    get_ivoldual_cube_table
+    (dimension, param.SeparateNegFlag(), param.table_filename);
+
+  if (mode != PLAIN_MODE) 
+    { block_index.Set(scalar_grid, BLOCK_EDGE_LENGTH); }
+  options.SetBlockIndex(block_index);
+  options.SetMergeData(merge_data);
+
+  if (mode == BAND_MODE) {
+    IVOLDUAL_BAND_GRID band_grid;
+    std::vector<ACTIVE_CUBE_ARRAY> active_cube_list;
+    SCALAR_ARRAY isovalue;
+
+    isovalue.push_back(isovalue0);
+    isovalue.push_back(isovalue1);
+    isovalue.push_back(isovalue1+0.4);
+
+    // Band grid requires strictly increasing isovalues.
+    if (!band_grid.SetIsovalues
+        (isovalue, param.flag_set_interior_code_from_scalar,
+         param.default_interior_code))
+      { return(false); }
+
+    encode_grid_vertex_bands_and_active_cubes
+      (scalar_grid, ivoldual_table.NumVertexTypes(), param.num_threads,
+       band_grid, active_cube_list, ivoldual_info);
+    options.SetBandGrid(band_grid, 0, active_cube_list[0]);
+    dual_contouring_interval_volume
+      (scalar_grid, isovalue0, isovalue1, ivoldual_table, param, options,
+       output.ivolpoly_vert, output.ivolv_list, output.ivolpoly_info, 
+       output.vertex_coord, ivoldual_info);
+  }
+  else if (mode == INCREMENTAL_MODE) {
+    IVOLDUAL_INCREMENTAL_GRID incremental_grid;
+    IVOLDUAL_CONTEXT context;
+    const SCALAR_TYPE s0 = std::min(isovalue0, isovalue1) - 0.05;
+    const SCALAR_TYPE s1 = std::max(isovalue0, isovalue1) + 0.05;
+
+    incremental_grid.SetScalarGrid
+      (scalar_grid, param.flag_set_interior_code_from_scalar,
+       param.default_interior_code);
+    options.SetIncrementalGrid(incremental_grid);
+    options.SetContext(context);
+    dual_contouring_interval_volume
+      (scalar_grid, s0, s1, ivoldual_table, param, options,
+       output.ivolpoly_vert, output.ivolv_list, output.ivolpoly_info, 
+       output.vertex_coord, ivoldual_info);
+    dual_contouring_interval_volume
+      (scalar_grid, isovalue0, isovalue1, ivoldual_table, param, options,
+       output.ivolpoly_vert, output.ivolv_list, output.ivolpoly_info, 
+       output.vertex_coord, ivoldual_info);
+  }
+  else {
+    dual_contouring_interval_volume
+      (scalar_grid, isovalue0, isovalue1, ivoldual_table, param, options,
+       output.ivolpoly_vert, output.ivolv_list, output.ivolpoly_info, 
+       output.vertex_coord, ivoldual_info);
+  }
+
+  return(true);
+}
+
+
+// **************************************************
+// COMPARE OUTPUT
+// **************************************************
+
+// Return true if output0 and output1 are identical.
+// - Vertex coordinates must be bitwise equal.
+// @param[out] mismatch Name of the first array which differs.
+bool is_equal(const TEST_OUTPUT & output0, const TEST_OUTPUT & output1,
+              std::string & mismatch)
+{
+  if (output0.ivolpoly_vert != output1.ivolpoly_vert) {
+    mismatch = "ivolpoly_vert";
+    return(false);
+  }
+
+  if (output0.ivolpoly_info.size() != output1.ivolpoly_info.size()) {
+    mismatch = "ivolpoly_info";
+    return(false);
+  }
+
+  for (int i = 0; i < output0.ivolpoly_info.size(); i++) {
+    const IVOLDUAL_POLY_INFO & info0 = output0.ivolpoly_info[i];
+    const IVOLDUAL_POLY_INFO & info1 = output1.ivolpoly_info[i];
+
+    if (info0.flag_dual_to_edge != info1.flag_dual_to_edge ||
+        info0.flag_reverse_orient != info1.flag_reverse_orient ||
+        info0.flag_subdivide_hex != info1.flag_subdivide_hex ||
+        info0.v0 != info1.v0 ||
+        info0.edge_direction != info1.edge_direction) {
+      mismatch = "ivolpoly_info";
+      return(false);
+    }
+  }
+
+  if (output0.ivolv_list.size() != output1.ivolv_list.size()) {
+    mismatch = "ivolv_list";
+    return(false);
+  }
+
+  for (int i = 0; i < output0.ivolv_list.size(); i++) {
+    const DUAL_IVOLVERT & ivolv0 = output0.ivolv_list[i];
+    const DUAL_IVOLVERT & ivolv1 = output1.ivolv_list[i];
+
+    if (ivolv0.cube_index != ivolv1.cube_index ||
+        ivolv0.table_index != ivolv1.table_index ||
+        ivolv0.patch_index != ivolv1.patch_index ||
+        ivolv0.num_incident_hex != ivolv1.num_incident_hex ||
+        ivolv0.map_to != ivolv1.map_to) {
+      mismatch = "ivolv_list";
+      return(false);
+    }
+  }
+
+  if (output0.vertex_coord.size() != output1.vertex_coord.size()) {
+    mismatch = "vertex_coord";
+    return(false);
+  }
+
+  for (int i = 0; i < output0.vertex_coord.size(); i++) {
+    // Compare NaN coordinates as equal.
+    const COORD_TYPE c0 = output0.vertex_coord[i];
+    const COORD_TYPE c1 = output1.vertex_coord[i];
+    if (c0 != c1 && (c0 == c0 || c1 == c1)) {
+      mismatch = "vertex_coord";
+      return(false);
+    }
+  }
+
+  return(true);
+}
@@ -0,0 +1,437 @@
+/// \file ivoldual_test_hex.cxx
+/// Regression tests for splitting, collapsing and smoothing hexahedra.
+/// - split_hex and collapse_hex must keep ivolpoly_info aligned
+///   with ivolpoly_vert.
+/// - Vertices added by split_hex must map to themselves,
+///   so that collapse_hex does not replace them.
+/// - gradient_smooth_jacobian must terminate on hexahedra
+///   whose vertices all lie on isosurfaces.
+/// - Children of subdivided hexahedra must have the polytope
+///   information of their parent.
+
+/*
+  IJK: Isosurface Jeneration Kode
+  Copyright (C) 2018 Rephael Wenger
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public License
+  (LGPL) as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ivoldual.h"
+#include "ivoldualtable.h"
+#include "ivoldual_compute.h"
+
+using namespace IJK;
+using namespace IVOLDUAL;
+
+using namespace std;
+
+
+// **************************************************
+// TYPES
+// **************************************************
+
+typedef enum { GYROID_FIELD, SPHERE_FIELD, NUM_FIELDS } FIELD_TYPE;
+
+// Interval volume computed by one run.
+class TEST_OUTPUT {
+
+public:
+  std::vector<ISO_VERTEX_INDEX> ivolpoly_vert;
+  IVOLDUAL_POLY_INFO_ARRAY ivolpoly_info;
+  DUAL_IVOLVERT_ARRAY ivolv_list;
+  COORD_ARRAY vertex_coord;
+};
+
+
+// **************************************************
+// LOCAL SUBROUTINES
+// **************************************************
+
+void set_field(const FIELD_TYPE field, DUALISO_SCALAR_GRID & scalar_grid);
+void construct_interval_volume
+(const DUALISO_SCALAR_GRID & scalar_grid, const IVOLDUAL_DATA_FLAGS & param,
+ TEST_OUTPUT & output);
+void construct_interval_volume
+(const DUALISO_SCALAR_GRID & scalar_grid, 
+ const SCALAR_TYPE isovalue0, const SCALAR_TYPE isovalue1,
+ const IVOLDUAL_DATA_FLAGS & param, TEST_OUTPUT & output);
+int check_poly_info_size
+(const DUALISO_SCALAR_GRID & scalar_grid, const FIELD_TYPE field,
+ int & num_checked);
+int check_split_vertex_map
+(const DUALISO_SCALAR_GRID & scalar_grid, const FIELD_TYPE field,
+ int & num_checked);
+int check_gsmooth_isosurface_hex
+(const DUALISO_SCALAR_GRID & scalar_grid, const FIELD_TYPE field,
+ int & num_checked);
+int check_split_poly_info
+(const DUALISO_SCALAR_GRID & scalar_grid, const FIELD_TYPE field,
+ int & num_checked);
+
+
+// **************************************************
+// MAIN
+// **************************************************
+
+namespace {
+
+  const char * field_name[NUM_FIELDS] = { "gyroid", "sphere" };
+
+  const AXIS_SIZE_TYPE GRID_SIZE = 20;
+  const SCALAR_TYPE ISOVALUE0 = -0.2;
+  const SCALAR_TYPE ISOVALUE1 = 0.3;
+
+  // Jacobian threshold large enough that many hexahedra are split.
+  const float SPLIT_HEX_THRESHOLD = 0.3;
+
+  // No normalized Jacobian determinant is below this threshold,
+  //   so collapse_hex removes no hexahedra.
+  const float NO_COLLAPSE_THRESHOLD = -2;
+
+  // Thin interval volume.  Many hexahedra have every vertex
+  //   on an isosurface.
+  const SCALAR_TYPE THIN_ISOVALUE0 = -0.02;
+  const SCALAR_TYPE THIN_ISOVALUE1 = 0.02;
+
+  // Jacobian threshold large enough that some hexahedra
+  //   with every vertex on an isosurface are smoothed.
+  const float GSMOOTH_THRESHOLD = 0.9;
+}
+
+int main()
+{
+  int num_failed = 0;
+  int num_checked = 0;
+
+  try {
+
+    for (int ifield = 0; ifield < NUM_FIELDS; ifield++) {
+      const FIELD_TYPE field = FIELD_TYPE(ifield);
+      DUALISO_SCALAR_GRID scalar_grid;
+      set_field(field, scalar_grid);
+
+      num_failed += check_poly_info_size(scalar_grid, field, num_checked);
+      num_failed += check_split_vertex_map(scalar_grid, field, num_checked);
+      num_failed +=
+        check_gsmooth_isosurface_hex(scalar_grid, field, num_checked);
+      num_failed += check_split_poly_info(scalar_grid, field, num_checked);
+    }
+  }
+  catch (ERROR & error) {
+    if (error.NumMessages() == 0) {
+      cerr << "Unknown error." << endl;
+    }
+    else { error.Print(cerr); }
+    cerr << "Exiting." << endl;
+    exit(20);
+  }
+  catch (...) {
+    cerr << "Unknown error." << endl;
+    exit(50);
+  };
+
+  if (num_failed > 0) {
+    cerr << num_failed << " of " << num_checked
+         << " hexahedra checks failed." << endl;
+    return(1);
+  }
+
+  cout << "All " << num_checked << " hexahedra checks passed." << endl;
+  return(0);
+}
+
+
+// **************************************************
+// CHECK SPLIT AND COLLAPSE
+// **************************************************
+
+// Check that split_hex and collapse_hex keep one polytope info
+//   for each hexahedron.
+// - Return number of failed checks.
+int check_poly_info_size
+(const DUALISO_SCALAR_GRID & scalar_grid, const FIELD_TYPE field,
+ int & num_checked)
+{
+  const int NUM_VERT_PER_HEXAHEDRON(8);
+  const int NUM_RUNS = 3;
+  const char * run_name[NUM_RUNS] =
+    { "split_hex", "collapse_hex", "split_hex and collapse_hex" };
+  int num_failed = 0;
+
+  for (int irun = 0; irun < NUM_RUNS; irun++) {
+    IVOLDUAL_DATA_FLAGS param;
+    TEST_OUTPUT output;
+
+    param.flag_split_hex = (irun != 1);
+    param.split_hex_threshold = SPLIT_HEX_THRESHOLD;
+    param.flag_collapse_hex = (irun != 0);
+    construct_interval_volume(scalar_grid, param, output);
+
+    num_checked++;
+    if (output.ivolpoly_info.size()*NUM_VERT_PER_HEXAHEDRON !=
+        output.ivolpoly_vert.size()) {
+      cerr << "FAILED: " << field_name[field] << ", " << run_name[irun]
+           << ": " << output.ivolpoly_info.size() << " polytope infos for "
+           << output.ivolpoly_vert.size()/NUM_VERT_PER_HEXAHEDRON
+           << " hexahedra." << endl;
+      num_failed++;
+    }
+  }
+
+  return(num_failed);
+}
+
+
+// Check that collapse_hex without collapsed hexahedra
+//   does not change the output of split_hex.
+// - collapse_hex replaces each vertex by ivolv_list[iv].map_to.
+// - Return number of failed checks.
+int check_split_vertex_map
+(const DUALISO_SCALAR_GRID & scalar_grid, const FIELD_TYPE field,
+ int & num_checked)
+{
+  IVOLDUAL_DATA_FLAGS param;
+  TEST_OUTPUT output, output_split;
+
+  param.flag_split_hex = true;
+  param.split_hex_threshold = SPLIT_HEX_THRESHOLD;
+  construct_interval_volume(scalar_grid, param, output_split);
+
+  param.flag_collapse_hex = true;
+  param.collapse_hex_threshold = NO_COLLAPSE_THRESHOLD;
+  construct_interval_volume(scalar_grid, param, output);
+
+  num_checked++;
+  if (output.ivolpoly_vert != output_split.ivolpoly_vert) {
+    cerr << "FAILED: " << field_name[field]
+         << ": collapse_hex changed vertices added by split_hex." << endl;
+    return(1);
+  }
+
+  return(0);
+}
+
+
+// Check that children of subdivided hexahedra have the polytope
+//   information of their parent.
+// - Every hexahedron contains some vertex of the original interval
+//   volume.  That vertex is in a grid cube containing grid vertex v0.
+// - Return number of failed checks.
+int check_split_poly_info
+(const DUALISO_SCALAR_GRID & scalar_grid, const FIELD_TYPE field,
+ int & num_checked)
+{
+  const int DIM3(3);
+  const int NUM_VERT_PER_HEXAHEDRON(8);
+  IVOLDUAL_DATA_FLAGS param;
+  TEST_OUTPUT output, output_plain;
+  GRID_COORD_TYPE v0_coord[DIM3], cube_coord[DIM3];
+  int num_failed = 0;
+
+  construct_interval_volume(scalar_grid, param, output_plain);
+  const ISO_VERTEX_INDEX num_original_vert = output_plain.ivolv_list.size();
+
+  param.flag_split_hex = true;
+  param.split_hex_threshold = SPLIT_HEX_THRESHOLD;
+  construct_interval_volume(scalar_grid, param, output);
+
+  num_checked++;
+  if (output.ivolv_list.size() == num_original_vert) {
+    cerr << "FAILED: " << field_name[field]
+         << ": split_hex did not split any hexahedra." << endl;
+    return(1);
+  }
+
+  num_checked++;
+  for (int ihex = 0; ihex < output.ivolpoly_info.size(); ihex++) {
+    const IVOLDUAL_POLY_INFO & poly_info = output.ivolpoly_info[ihex];
+    bool flag_contains_v0 = false;
+
+    scalar_grid.ComputeCoord(poly_info.v0, v0_coord);
+    for (int k = 0; k < NUM_VERT_PER_HEXAHEDRON; k++) {
+      const ISO_VERTEX_INDEX ivolv =
+        output.ivolpoly_vert[ihex*NUM_VERT_PER_HEXAHEDRON+k];
+      if (ivolv >= num_original_vert) { continue; }
+
+      scalar_grid.ComputeCoord
+        (output.ivolv_list[ivolv].cube_index, cube_coord);
+      bool flag_contains = true;
+      for (int d = 0; d < DIM3; d++) {
+        if (v0_coord[d] < cube_coord[d] || v0_coord[d] > cube_coord[d]+1)
+          { flag_contains = false; }
+      }
+      if (flag_contains) { flag_contains_v0 = true; }
+    }
+
+    if (poly_info.flag_subdivide_hex || !flag_contains_v0) {
+      cerr << "FAILED: " << field_name[field]
+           << ": hexahedron " << ihex
+           << " has polytope information of a different hexahedron."
+           << endl;
+      num_failed++;
+      break;
+    }
+  }
+
+  return(num_failed);
+}
+
+
+// **************************************************
+// CHECK SMOOTHING
+// **************************************************
+
+// Check that gradient_smooth_jacobian terminates if some hexahedra
+//   with Jacobian below the threshold have every vertex on an isosurface.
+// - Return number of failed checks.
+int check_gsmooth_isosurface_hex
+(const DUALISO_SCALAR_GRID & scalar_grid, const FIELD_TYPE field,
+ int & num_checked)
+{
+  const int NUM_VERT_PER_HEXAHEDRON(8);
+  const int dimension = scalar_grid.Dimension();
+  IVOLDUAL_DATA_FLAGS param;
+  TEST_OUTPUT output_plain, output;
+  int num_failed = 0;
+
+  construct_interval_volume
+    (scalar_grid, THIN_ISOVALUE0, THIN_ISOVALUE1, param, output_plain);
+
+  // Count hexahedra which have every vertex on an isosurface
+  //   and Jacobian below GSMOOTH_THRESHOLD.
+  const IVOLDUAL_CUBE_TABLE & ivoldual_table =
+    get_ivoldual_cube_table(dimension, param.SeparateNegFlag());
+  const DUAL_IVOLVERT_SOA ivolv_soa(ivoldual_table, output_plain.ivolv_list);
+  int num_isosurface_hex = 0;
+  for (int ihex = 0;
+       ihex*NUM_VERT_PER_HEXAHEDRON < output_plain.ivolpoly_vert.size();
+       ihex++) {
+    COORD_TYPE min_jacobian;
+    int icorner;
+    compute_min_hexahedron_normalized_Jacobian_determinant
+      (output_plain.ivolpoly_vert, ihex, output_plain.vertex_coord,
+       min_jacobian, icorner);
+    if (min_jacobian >= GSMOOTH_THRESHOLD) { continue; }
+
+    int k = 0;
+    while (k < NUM_VERT_PER_HEXAHEDRON && ivolv_soa.OnIsosurface
+           (output_plain.ivolpoly_vert[ihex*NUM_VERT_PER_HEXAHEDRON+k]))
+      { k++; }
+    if (k == NUM_VERT_PER_HEXAHEDRON) { num_isosurface_hex++; }
+  }
+
+  num_checked++;
+  if (num_isosurface_hex == 0) {
+    cerr << "FAILED: " << field_name[field]
+         << ": no hexahedra with every vertex on an isosurface"
+         << " and Jacobian below " << GSMOOTH_THRESHOLD << "." << endl;
+    num_failed++;
+  }
+
+  param.flag_gsmooth_jacobian = true;
+  param.gsmooth_jacobian_iter = 3;
+  param.jacobian_threshold = GSMOOTH_THRESHOLD;
+  construct_interval_volume
+    (scalar_grid, THIN_ISOVALUE0, THIN_ISOVALUE1, param, output);
+
+  num_checked++;
+  if (output.ivolpoly_vert != output_plain.ivolpoly_vert) {
+    cerr << "FAILED: " << field_name[field]
+         << ": gradient_smooth_jacobian changed the hexahedra." << endl;
+    num_failed++;
+  }
+
+  return(num_failed);
+}
+
+
+// **************************************************
+// CONSTRUCT INTERVAL VOLUME
+// **************************************************
+
+// Construct interval volume [ISOVALUE0,ISOVALUE1].
+void construct_interval_volume
+(const DUALISO_SCALAR_GRID & scalar_grid, const IVOLDUAL_DATA_FLAGS & param,
+ TEST_OUTPUT & output)
+{
+  construct_interval_volume
+    (scalar_grid, ISOVALUE0, ISOVALUE1, param, output);
+}
+
+
+// Construct interval volume [isovalue0,isovalue1].
+void construct_interval_volume
+(const DUALISO_SCALAR_GRID & scalar_grid, 
+ const SCALAR_TYPE isovalue0, const SCALAR_TYPE isovalue1,
+ const IVOLDUAL_DATA_FLAGS & param, TEST_OUTPUT & output)
+{
+  const int dimension = scalar_grid.Dimension();
+  IJKDUAL::ISO_MERGE_DATA merge_data(dimension, scalar_grid.AxisSize());
+  IVOLDUAL_INFO ivoldual_info(dimension);
+
+  dual_contouring_interval_volume
+    (scalar_grid, isovalue0, isovalue1, param,
+     output.ivolpoly_vert, output.ivolpoly_info, output.ivolv_list,
+     output.vertex_coord, merge_data, ivoldual_info);
+}
+
+
+// **************************************************
+// SCALAR FIELDS
+// **************************************************
+
+void set_field(const FIELD_TYPE field, DUALISO_SCALAR_GRID & scalar_grid)
+{
+  const int DIM3(3);
+  const double PI = 3.14159265358979323846;
+  const double scale = 4*PI/(GRID_SIZE-1);
+  const AXIS_SIZE_TYPE axis_size[DIM3] =
+    { GRID_SIZE, GRID_SIZE, GRID_SIZE };
+
+  scalar_grid.SetSize(DIM3, axis_size);
+
+  VERTEX_INDEX iv = 0;
+  for (AXIS_SIZE_TYPE z = 0; z < GRID_SIZE; z++) {
+    for (AXIS_SIZE_TYPE y = 0; y < GRID_SIZE; y++) {
+      for (AXIS_SIZE_TYPE x = 0; x < GRID_SIZE; x++) {
+        SCALAR_TYPE s;
+
+        if (field == GYROID_FIELD) {
+          const double X = x*scale;
+          const double Y = y*scale;
+          const double Z = z*scale;
+          s = sin(X)*cos(Y) + sin(Y)*cos(Z) + sin(Z)*cos(X);
+        }
+        else {
+          // Distance to grid center, scaled to [-0.5,0.37].
+          const double c = (GRID_SIZE-1)/2.0;
+          const double dx = x-c;
+          const double dy = y-c;
+          const double dz = z-c;
+          s = sqrt(dx*dx+dy*dy+dz*dz)/(GRID_SIZE-1) - 0.5;
+        }
+
+        scalar_grid.Set(iv, s);
+        iv++;
+      }
+    }
+  }
+}
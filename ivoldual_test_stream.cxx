@@ -0,0 +1,539 @@
+/// \file ivoldual_test_stream.cxx
+/// Check slab streaming of the interval volume.
+/// - NRRD_SLAB_READER must read the scalar values written
+///   to the nrrd file.
+/// - Hexahedra written by stream_interval_volume() must equal
+///   the hexahedra of the in-core interval volume up to vertex
+///   renumbering, for any slab thickness.
+
+/*
+  IJK: Isosurface Jeneration Kode
+  Copyright (C) 2018 Rephael Wenger
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public License
+  (LGPL) as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "ivoldual.h"
+#include "ivoldualtable.h"
+#include "ivoldual_stream.h"
+
+using namespace IJK;
+using namespace IVOLDUAL;
+
+using namespace std;
+
+
+// **************************************************
+// TYPES
+// **************************************************
+
+typedef enum { GYROID_FIELD, SPHERE_FIELD, NUM_FIELDS } FIELD_TYPE;
+
+/// Hexahedron as the list of its vertex classes.
+/// - Vertices with identical coordinates are in the same class.
+typedef std::array<int,8> HEX_KEY;
+
+/// Hexahedral mesh read from an OFF file.
+class OFF_MESH {
+
+public:
+  std::vector<COORD_TYPE> vertex_coord;
+  std::vector<STREAM_INDEX> hex_vert;
+};
+
+
+// **************************************************
+// LOCAL SUBROUTINES
+// **************************************************
+
+void set_field(const FIELD_TYPE field, DUALISO_SCALAR_GRID & scalar_grid);
+void write_nrrd_file
+(const std::string & filename, const DUALISO_SCALAR_GRID & scalar_grid);
+void read_off_file(const std::string & filename, OFF_MESH & mesh);
+int check_reader
+(const std::string & nrrd_filename, const DUALISO_SCALAR_GRID & scalar_grid,
+ int & num_checked);
+int check_stream
+(const std::string & nrrd_filename, const DUALISO_SCALAR_GRID & scalar_grid,
+ const FIELD_TYPE field, const int slab_thickness, int & num_checked);
+bool is_equal_mesh
+(const std::vector<ISO_VERTEX_INDEX> & ivolpoly_vert,
+ const COORD_ARRAY & vertex_coord, const OFF_MESH & mesh,
+ std::string & mismatch);
+
+
+// **************************************************
+// MAIN
+// **************************************************
+
+namespace {
+
+  const char * field_name[NUM_FIELDS] = { "gyroid", "sphere" };
+
+  // Axis sizes differ so that x, y and z are not interchangeable.
+  const int DIM3 = 3;
+  const AXIS_SIZE_TYPE AXIS_SIZE[DIM3] = { 13, 11, 15 };
+  const COORD_TYPE SPACING[DIM3] = { 1, 1, 1.5 };
+
+  const SCALAR_TYPE ISOVALUE0 = -0.2;
+  const SCALAR_TYPE ISOVALUE1 = 0.3;
+
+  // Slabs of thickness one, thickness not dividing the number
+  //   of cube layers, one slab and a slab thicker than the grid.
+  const int NUM_SLAB_THICKNESS = 5;
+  const int slab_thickness[NUM_SLAB_THICKNESS] =
+    { 1, 2, 3, 14, 20 };
+
+  // Maximum difference between streamed and in-core coordinates.
+  // - Coordinates in the OFF file are rounded to 6 significant digits.
+  const COORD_TYPE COORD_TOLERANCE = 1.0e-3;
+
+  const char * NRRD_FILENAME = "ivoldual_test_stream.nrrd";
+  const char * OFF_FILENAME = "ivoldual_test_stream.off";
+}
+
+int main()
+{
+  int num_failed = 0;
+  int num_checked = 0;
+
+  try {
+
+    for (int ifield = 0; ifield < NUM_FIELDS; ifield++) {
+
+      DUALISO_SCALAR_GRID scalar_grid;
+      set_field(FIELD_TYPE(ifield), scalar_grid);
+      write_nrrd_file(NRRD_FILENAME, scalar_grid);
+
+      num_failed += check_reader(NRRD_FILENAME, scalar_grid, num_checked);
+
+      for (int i = 0; i < NUM_SLAB_THICKNESS; i++) {
+        num_failed += check_stream
+          (NRRD_FILENAME, scalar_grid, FIELD_TYPE(ifield),
+           slab_thickness[i], num_checked);
+      }
+    }
+  }
+  catch (ERROR & error) {
+    if (error.NumMessages() == 0) {
+      cerr << "Unknown error." << endl;
+    }
+    else { error.Print(cerr); }
+    cerr << "Exiting." << endl;
+    exit(20);
+  }
+  catch (...) {
+    cerr << "Unknown error." << endl;
+    exit(50);
+  };
+
+  std::remove(NRRD_FILENAME);
+  std::remove(OFF_FILENAME);
+
+  if (num_failed > 0) {
+    cerr << num_failed << " of " << num_checked
+         << " stream checks failed." << endl;
+    return(1);
+  }
+
+  cout << "All " << num_checked << " stream checks passed." << endl;
+  return(0);
+}
+
+
+// **************************************************
+// CHECK READER AND STREAM
+// **************************************************
+
+// Check that every slab read by NRRD_SLAB_READER
+//   equals the corresponding layers of scalar_grid.
+// - Return number of failed checks.
+int check_reader
+(const std::string & nrrd_filename, const DUALISO_SCALAR_GRID & scalar_grid,
+ int & num_checked)
+{
+  const AXIS_SIZE_TYPE nz = scalar_grid.AxisSize(2);
+  const VERTEX_INDEX numv_in_layer =
+    scalar_grid.AxisSize(0)*scalar_grid.AxisSize(1);
+  NRRD_SLAB_READER reader;
+  DUALISO_SCALAR_GRID slab_grid;
+  int num_failed = 0;
+
+  reader.Open(nrrd_filename);
+
+  num_checked++;
+  for (int d = 0; d < DIM3; d++) {
+    if (reader.AxisSize(d) != scalar_grid.AxisSize(d) ||
+        reader.Spacing(d) != SPACING[d]) {
+      cerr << "FAILED: NRRD_SLAB_READER read wrong axis size or spacing."
+           << endl;
+      num_failed++;
+      return(num_failed);
+    }
+  }
+
+  // Read slabs [z0,z1] in decreasing order of z0
+  //   so that reads are not sequential.
+  for (AXIS_SIZE_TYPE z0 = nz-1; z0 >= 0; z0 -= 4) {
+    const AXIS_SIZE_TYPE z1 = std::min(z0+2, nz-1);
+    reader.ReadSlab(z0, z1, slab_grid);
+
+    num_checked++;
+    if (slab_grid.AxisSize(2) != z1-z0+1 ||
+        !std::equal(slab_grid.ScalarPtrConst(),
+                    slab_grid.ScalarPtrConst()+slab_grid.NumVertices(),
+                    scalar_grid.ScalarPtrConst()+z0*numv_in_layer)) {
+      cerr << "FAILED: NRRD_SLAB_READER slab [" << z0 << "," << z1
+           << "] differs from nrrd data." << endl;
+      num_failed++;
+    }
+  }
+
+  return(num_failed);
+}
+
+
+// Stream interval volume and compare with the in-core interval volume.
+// - Return number of failed checks.
+int check_stream
+(const std::string & nrrd_filename, const DUALISO_SCALAR_GRID & scalar_grid,
+ const FIELD_TYPE field, const int slab_thickness, int & num_checked)
+{
+  const int NUM_VERT_PER_HEXAHEDRON(8);
+  IO_INFO io_info;
+  DUALISO_TIME dualiso_time;
+  IO_TIME io_time = {0.0, 0.0};
+  IVOLDUAL_PROFILE profile;
+  OFF_MESH mesh;
+  std::string mismatch;
+
+  io_info.flag_interval_volume = true;
+  io_info.isovalue.push_back(ISOVALUE0);
+  io_info.isovalue.push_back(ISOVALUE1);
+  io_info.input_filename = nrrd_filename;
+  io_info.flag_output_off = true;
+  io_info.SetOutputFilename(OFF_FILENAME);
+  io_info.flag_silent = true;
+  io_info.stream_slab_thickness = slab_thickness;
+
+  stream_interval_volume(io_info, dualiso_time, io_time, profile);
+  read_off_file(OFF_FILENAME, mesh);
+
+  // In-core interval volume with the same parameters.
+  OUTPUT_INFO output_info;
+  io_info.grid_spacing.assign(SPACING, SPACING+DIM3);
+  output_info.SetDimension(DIM3, NUM_VERT_PER_HEXAHEDRON);
+  set_output_info(io_info, 0, output_info);
+
+  IJKDUAL::ISO_MERGE_DATA merge_data(DIM3, scalar_grid.AxisSize());
+  IVOLDUAL_INFO ivoldual_info(DIM3);
+  std::vector<ISO_VERTEX_INDEX> ivolpoly_vert;
+  IVOLDUAL_POLY_INFO_ARRAY ivolpoly_info;
+  DUAL_IVOLVERT_ARRAY ivolv_list;
+  COORD_ARRAY vertex_coord;
+
+  dual_contouring_interval_volume
+    (scalar_grid, ISOVALUE0, ISOVALUE1, output_info,
+     ivolpoly_vert, ivolpoly_info, ivolv_list, vertex_coord,
+     merge_data, ivoldual_info);
+
+  for (VERTEX_INDEX iv = 0; iv*DIM3 < vertex_coord.size(); iv++) {
+    for (int d = 0; d < DIM3; d++)
+      { vertex_coord[iv*DIM3+d] *= SPACING[d]; }
+  }
+
+  num_checked++;
+  if (ivolpoly_info.empty()) {
+    cerr << "FAILED: " << field_name[field]
+         << ": in-core interval volume is empty." << endl;
+    return(1);
+  }
+
+  num_checked++;
+  if (!is_equal_mesh(ivolpoly_vert, vertex_coord, mesh, mismatch)) {
+    cerr << "FAILED: " << field_name[field]
+         << ", slab thickness " << slab_thickness << ": "
+         << mismatch << " differs from in-core interval volume." << endl;
+    return(1);
+  }
+
+  return(0);
+}
+
+
+// **************************************************
+// COMPARE MESHES
+// **************************************************
+
+// local namespace
+namespace {
+
+  typedef std::tuple<long,long,long> CELL_KEY;
+
+  /// Cell of the hash grid containing coord.
+  CELL_KEY cell_key(const COORD_TYPE coord[], const int offset[])
+  {
+    return(CELL_KEY
+           (long(std::floor(coord[0]/COORD_TOLERANCE)) + offset[0],
+            long(std::floor(coord[1]/COORD_TOLERANCE)) + offset[1],
+            long(std::floor(coord[2]/COORD_TOLERANCE)) + offset[2]));
+  }
+}
+
+
+// Return true if mesh has the same hexahedra as ivolpoly_vert
+//   up to vertex renumbering.
+// - Each mesh vertex is matched with an in-core vertex
+//   within distance COORD_TOLERANCE in each coordinate.
+// - In-core vertices with identical coordinates are interchangeable.
+// - Mesh must have exactly one vertex for each in-core vertex
+//   which is in some hexahedron.
+// @param[out] mismatch Name of the first part which differs.
+bool is_equal_mesh
+(const std::vector<ISO_VERTEX_INDEX> & ivolpoly_vert,
+ const COORD_ARRAY & vertex_coord, const OFF_MESH & mesh,
+ std::string & mismatch)
+{
+  const int NUM_VERT_PER_HEXAHEDRON(8);
+  const int zero_offset[DIM3] = { 0, 0, 0 };
+  std::map<std::vector<COORD_TYPE>,int> coord_class;
+  std::vector<int> vertex_class(vertex_coord.size()/DIM3);
+  std::vector<bool> is_used(vertex_class.size(), false);
+  std::map<CELL_KEY,std::vector<VERTEX_INDEX> > cell_vertex;
+  std::vector<HEX_KEY> hex0, hex1;
+
+  for (VERTEX_INDEX iv = 0; iv < vertex_class.size(); iv++) {
+    const std::vector<COORD_TYPE> coord
+      (vertex_coord.begin()+iv*DIM3, vertex_coord.begin()+(iv+1)*DIM3);
+    const int num_classes = coord_class.size();
+    vertex_class[iv] =
+      coord_class.insert(std::make_pair(coord, num_classes)).first->second;
+    cell_vertex[cell_key(&(coord[0]), zero_offset)].push_back(iv);
+  }
+
+  for (size_t i = 0; i < ivolpoly_vert.size(); i++)
+    { is_used[ivolpoly_vert[i]] = true; }
+
+  const size_t num_used = std::count(is_used.begin(), is_used.end(), true);
+  if (mesh.vertex_coord.size() != num_used*DIM3) {
+    mismatch = "number of vertices";
+    return(false);
+  }
+
+  // Match each mesh vertex with the closest in-core vertex.
+  std::vector<int> mesh_vertex_class(mesh.vertex_coord.size()/DIM3, -1);
+  for (size_t jv = 0; jv < mesh_vertex_class.size(); jv++) {
+    const COORD_TYPE * coord = &(mesh.vertex_coord[jv*DIM3]);
+    COORD_TYPE min_dist = COORD_TOLERANCE;
+    int offset[DIM3];
+
+    for (offset[0] = -1; offset[0] <= 1; offset[0]++) {
+      for (offset[1] = -1; offset[1] <= 1; offset[1]++) {
+        for (offset[2] = -1; offset[2] <= 1; offset[2]++) {
+          auto pos = cell_vertex.find(cell_key(coord, offset));
+          if (pos == cell_vertex.end()) { continue; }
+
+          for (VERTEX_INDEX iv : pos->second) {
+            COORD_TYPE dist = 0;
+            for (int d = 0; d < DIM3; d++) {
+              dist = std::max
+                (dist, COORD_TYPE(std::abs(coord[d]-vertex_coord[iv*DIM3+d])));
+            }
+            if (dist <= min_dist && is_used[iv]) {
+              min_dist = dist;
+              mesh_vertex_class[jv] = vertex_class[iv];
+            }
+          }
+        }
+      }
+    }
+
+    if (mesh_vertex_class[jv] < 0) {
+      mismatch = "vertex " + std::to_string(jv);
+      return(false);
+    }
+  }
+
+  for (size_t i = 0; i < ivolpoly_vert.size(); i += NUM_VERT_PER_HEXAHEDRON) {
+    HEX_KEY key;
+    for (int k = 0; k < NUM_VERT_PER_HEXAHEDRON; k++)
+      { key[k] = vertex_class[ivolpoly_vert[i+k]]; }
+    hex0.push_back(key);
+  }
+
+  for (size_t i = 0; i < mesh.hex_vert.size(); i += NUM_VERT_PER_HEXAHEDRON) {
+    HEX_KEY key;
+    for (int k = 0; k < NUM_VERT_PER_HEXAHEDRON; k++)
+      { key[k] = mesh_vertex_class[mesh.hex_vert[i+k]]; }
+    hex1.push_back(key);
+  }
+
+  std::sort(hex0.begin(), hex0.end());
+  std::sort(hex1.begin(), hex1.end());
+  if (hex0 != hex1) {
+    mismatch = "list of hexahedra";
+    return(false);
+  }
+
+  return(true);
+}
+
+
+// **************************************************
+// SCALAR FIELDS
+// **************************************************
+
+// Set scalar_grid to a synthetic scalar field.
+// - Scalar values are stored as float in the nrrd file,
+//   so values are rounded to float.
+void set_field(const FIELD_TYPE field, DUALISO_SCALAR_GRID & scalar_grid)
+{
+  const double PI = 3.14159265358979323846;
+  const double scale = 3*PI/(AXIS_SIZE[0]-1);
+  double center[DIM3];
+
+  for (int d = 0; d < DIM3; d++)
+    { center[d] = (AXIS_SIZE[d]-1)/2.0; }
+
+  scalar_grid.SetSize(DIM3, AXIS_SIZE);
+
+  VERTEX_INDEX iv = 0;
+  for (AXIS_SIZE_TYPE z = 0; z < AXIS_SIZE[2]; z++) {
+    for (AXIS_SIZE_TYPE y = 0; y < AXIS_SIZE[1]; y++) {
+      for (AXIS_SIZE_TYPE x = 0; x < AXIS_SIZE[0]; x++) {
+        double s;
+        if (field == GYROID_FIELD) {
+          s = std::sin(x*scale)*std::cos(y*scale) +
+            std::sin(y*scale)*std::cos(z*scale) +
+            std::sin(z*scale)*std::cos(x*scale);
+        }
+        else {
+          const double dx = x-center[0];
+          const double dy = y-center[1];
+          const double dz = z-center[2];
+          s = std::sqrt(dx*dx+dy*dy+dz*dz)/(AXIS_SIZE[0]-1) - 0.3;
+        }
+        scalar_grid.Set(iv, float(s));
+        iv++;
+      }
+    }
+  }
+}
+
+
+// **************************************************
+// READ AND WRITE FILES
+// **************************************************
+
+// Write scalar_grid as a raw little endian float nrrd file
+//   with data attached to the header.
+void write_nrrd_file
+(const std::string & filename, const DUALISO_SCALAR_GRID & scalar_grid)
+{
+  IJK::PROCEDURE_ERROR error("write_nrrd_file");
+  std::ofstream out(filename.c_str(), ios::out | ios::binary);
+
+  out << "NRRD0004" << "\n"
+      << "# Synthetic scalar field." << "\n"
+      << "type: float" << "\n"
+      << "dimension: 3" << "\n"
+      << "sizes: " << AXIS_SIZE[0] << " " << AXIS_SIZE[1]
+      << " " << AXIS_SIZE[2] << "\n"
+      << "spacings: " << SPACING[0] << " " << SPACING[1]
+      << " " << SPACING[2] << "\n"
+      << "encoding: raw" << "\n"
+      << "endian: little" << "\n"
+      << "\n";
+
+  for (VERTEX_INDEX iv = 0; iv < scalar_grid.NumVertices(); iv++) {
+    const float s = scalar_grid.Scalar(iv);
+    const unsigned char * byte =
+      reinterpret_cast<const unsigned char *>(&s);
+    unsigned char little[sizeof(float)];
+
+    // Store bytes in little endian order on any host.
+    const unsigned int one = 1;
+    const bool is_little =
+      (*reinterpret_cast<const unsigned char *>(&one) == 1);
+    for (size_t k = 0; k < sizeof(float); k++)
+      { little[k] = (is_little ? byte[k] : byte[sizeof(float)-1-k]); }
+    out.write(reinterpret_cast<const char *>(little), sizeof(float));
+  }
+
+  if (!out) {
+    error.AddMessage("Error writing nrrd file ", filename, ".");
+    throw error;
+  }
+}
+
+
+// Read hexahedral mesh from OFF file.
+void read_off_file(const std::string & filename, OFF_MESH & mesh)
+{
+  const int NUM_VERT_PER_HEXAHEDRON(8);
+  IJK::PROCEDURE_ERROR error("read_off_file");
+  std::ifstream in(filename.c_str(), ios::in);
+  std::string header;
+  STREAM_INDEX numv, num_poly, num_edges;
+
+  in >> header >> numv >> num_poly >> num_edges;
+  if (!in || header != "OFF") {
+    error.AddMessage("Illegal OFF header in file ", filename, ".");
+    throw error;
+  }
+
+  mesh.vertex_coord.resize(numv*DIM3);
+  for (STREAM_INDEX i = 0; i < numv*DIM3; i++)
+    { in >> mesh.vertex_coord[i]; }
+
+  mesh.hex_vert.resize(num_poly*NUM_VERT_PER_HEXAHEDRON);
+  for (STREAM_INDEX ipoly = 0; ipoly < num_poly; ipoly++) {
+    int numv_in_poly;
+    in >> numv_in_poly;
+    if (numv_in_poly != NUM_VERT_PER_HEXAHEDRON) {
+      error.AddMessage("Polytope ", ipoly, " in file ", filename,
+                       " is not a hexahedron.");
+      throw error;
+    }
+
+    for (int k = 0; k < NUM_VERT_PER_HEXAHEDRON; k++) {
+      STREAM_INDEX jv;
+      in >> jv;
+      if (jv < 0 || jv >= numv) {
+        error.AddMessage("Illegal vertex index ", jv, " in file ",
+                         filename, ".");
+        throw error;
+      }
+      mesh.hex_vert[ipoly*NUM_VERT_PER_HEXAHEDRON+k] = jv;
+    }
+  }
+
+  if (!in) {
+    error.AddMessage("Error reading OFF file ", filename, ".");
+    throw error;
+  }
+}
@@ -0,0 +1,271 @@
+/// \file ivoldual_test_table.cxx
+/// Check binary storage of the interval volume lookup table.
+/// - Table read by ReadBinary() must equal the table written
+///   by WriteBinary().
+/// - ReadBinary() must reject truncated files, files with
+///   a wrong magic number and files containing a different table.
+
+/*
+  IJK: Isosurface Jeneration Kode
+  Copyright (C) 2018 Rephael Wenger
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public License
+  (LGPL) as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "ivoldualtable.h"
+
+using namespace IJK;
+using namespace IVOLDUAL;
+
+using namespace std;
+
+
+// **************************************************
+// LOCAL SUBROUTINES
+// **************************************************
+
+bool is_equal(const IVOLDUAL_CUBE_TABLE & table0,
+              const IVOLDUAL_CUBE_TABLE & table1,
+              std::string & mismatch);
+bool read_table(const std::string & buffer, const int dimension,
+                const bool flag_separate_neg);
+int check_table(const int dimension, const bool flag_separate_neg,
+                int & num_checked);
+
+
+// **************************************************
+// MAIN
+// **************************************************
+
+int main()
+{
+  const int DIM3(3);
+  int num_failed = 0;
+  int num_checked = 0;
+
+  try {
+    num_failed += check_table(DIM3, true, num_checked);
+    num_failed += check_table(DIM3, false, num_checked);
+  }
+  catch (ERROR & error) {
+    if (error.NumMessages() == 0) {
+      cerr << "Unknown error." << endl;
+    }
+    else { error.Print(cerr); }
+    cerr << "Exiting." << endl;
+    exit(20);
+  }
+  catch (...) {
+    cerr << "Unknown error." << endl;
+    exit(50);
+  };
+
+  if (num_failed > 0) {
+    cerr << num_failed << " of " << num_checked
+         << " table checks failed." << endl;
+    return(1);
+  }
+
+  cout << "All " << num_checked << " table checks passed." << endl;
+  return(0);
+}
+
+
+// **************************************************
+// CHECK TABLE
+// **************************************************
+
+// Write table, read it back and compare.
+// Check that damaged copies are rejected.
+// - Return number of failed checks.
+int check_table(const int dimension, const bool flag_separate_neg,
+                int & num_checked)
+{
+  const IVOLDUAL_CUBE_TABLE & table =
+    get_ivoldual_cube_table(dimension, flag_separate_neg);
+  const std::string table_name =
+    std::string("table (dimension ") + std::to_string(dimension) +
+    (flag_separate_neg ? ", separate neg)" : ", separate pos)");
+  std::ostringstream out;
+  int num_failed = 0;
+
+  table.WriteBinary(out);
+  const std::string buffer = out.str();
+
+  // Round trip.
+  {
+    std::istringstream in(buffer);
+    IVOLDUAL_CUBE_TABLE table_read;
+    std::string mismatch;
+
+    num_checked++;
+    if (!table_read.ReadBinary(in, dimension, flag_separate_neg)) {
+      cerr << "FAILED: " << table_name
+           << ": ReadBinary rejected table written by WriteBinary." << endl;
+      num_failed++;
+    }
+    else if (!is_equal(table, table_read, mismatch)) {
+      cerr << "FAILED: " << table_name
+           << ": " << mismatch << " differs after round trip." << endl;
+      num_failed++;
+    }
+  }
+
+  // Truncated file.
+  // - Truncate in the magic number, the header, the first entry,
+  //   the middle of the entries and the vertex info.
+  const std::string::size_type truncated_length[] =
+    { 0, 4, 12, 100, buffer.size()/2, buffer.size()-1 };
+  for (std::string::size_type length : truncated_length) {
+    num_checked++;
+    if (read_table(buffer.substr(0, length), dimension, flag_separate_neg)) {
+      cerr << "FAILED: " << table_name
+           << ": ReadBinary accepted file truncated to " << length
+           << " of " << buffer.size() << " bytes." << endl;
+      num_failed++;
+    }
+  }
+
+  // Wrong magic number.
+  {
+    std::string wrong_magic = buffer;
+    wrong_magic[7] = '0';
+    num_checked++;
+    if (read_table(wrong_magic, dimension, flag_separate_neg)) {
+      cerr << "FAILED: " << table_name
+           << ": ReadBinary accepted wrong magic number." << endl;
+      num_failed++;
+    }
+  }
+
+  // Different table.
+  num_checked++;
+  if (read_table(buffer, dimension, !flag_separate_neg) ||
+      read_table(buffer, dimension+1, flag_separate_neg)) {
+    cerr << "FAILED: " << table_name
+         << ": ReadBinary accepted table with different dimension"
+         << " or separation flag." << endl;
+    num_failed++;
+  }
+
+  return(num_failed);
+}
+
+
+// Return true if ReadBinary() accepts buffer.
+bool read_table(const std::string & buffer, const int dimension,
+                const bool flag_separate_neg)
+{
+  std::istringstream in(buffer);
+  IVOLDUAL_CUBE_TABLE table;
+
+  return(table.ReadBinary(in, dimension, flag_separate_neg));
+}
+
+
+// **************************************************
+// COMPARE TABLES
+// **************************************************
+
+// Return true if table0 and table1 are identical.
+// - Arrays of table entries are compared bytewise
+//   since WriteBinary() stores them bytewise.
+// @param[out] mismatch Name of the first field which differs.
+bool is_equal(const IVOLDUAL_CUBE_TABLE & table0,
+              const IVOLDUAL_CUBE_TABLE & table1,
+              std::string & mismatch)
+{
+  if (table0.Dimension() != table1.Dimension() ||
+      table0.FlagSeparateNeg() != table1.FlagSeparateNeg() ||
+      table0.NumVertexTypes() != table1.NumVertexTypes() ||
+      table0.NumPolyVertices() != table1.NumPolyVertices() ||
+      table0.NumPolyEdges() != table1.NumPolyEdges() ||
+      table0.NumTableEntries() != table1.NumTableEntries()) {
+    mismatch = "table size";
+    return(false);
+  }
+
+  for (TABLE_INDEX it = 0; it < table0.NumTableEntries(); it++) {
+    const IVOLDUAL_TABLE_ENTRY & entry0 = table0.Entry(it);
+    const IVOLDUAL_TABLE_ENTRY & entry1 = table1.Entry(it);
+
+    if (entry0.NumVerticesInLowerLifted() !=
+        entry1.NumVerticesInLowerLifted() ||
+        entry0.NumVerticesInUpperLifted() !=
+        entry1.NumVerticesInUpperLifted() ||
+        entry0.lower_isosurface_table_index !=
+        entry1.lower_isosurface_table_index ||
+        entry0.upper_isosurface_table_index !=
+        entry1.upper_isosurface_table_index ||
+        entry0.is_non_manifold != entry1.is_non_manifold ||
+        entry0.is_ambiguous != entry1.is_ambiguous ||
+        entry0.num_ambiguous_facets != entry1.num_ambiguous_facets ||
+        entry0.num_active_facets != entry1.num_active_facets ||
+        entry0.ambiguous_facet_bits != entry1.ambiguous_facet_bits ||
+        entry0.ambiguous_facet_bits_in_lower_lifted !=
+        entry1.ambiguous_facet_bits_in_lower_lifted ||
+        entry0.ambiguous_facet_bits_in_upper_lifted !=
+        entry1.ambiguous_facet_bits_in_upper_lifted) {
+      mismatch = "table entry " + std::to_string(it);
+      return(false);
+    }
+
+    if (memcmp(entry0.poly_vertex_info, entry1.poly_vertex_info,
+               sizeof(entry0.poly_vertex_info[0])*table0.NumPolyVertices())
+        != 0 ||
+        memcmp(entry0.poly_edge_info, entry1.poly_edge_info,
+               sizeof(entry0.poly_edge_info[0])*table0.NumPolyEdges())
+        != 0 ||
+        memcmp(entry0.ivolv_info, entry1.ivolv_info,
+               sizeof(entry0.ivolv_info[0])*entry0.NumVertices()) != 0) {
+      mismatch = "table entry " + std::to_string(it);
+      return(false);
+    }
+  }
+
+  for (TABLE_INDEX it = 0; it < table0.NumTableEntries(); it++) {
+    if (table0.vertex_info.NumVertices(it) !=
+        table1.vertex_info.NumVertices(it)) {
+      mismatch = "vertex info";
+      return(false);
+    }
+
+    for (int j = 0; j < table0.vertex_info.NumVertices(it); j++) {
+      const IVOLDUAL_TABLE_VERTEX_INFO & vinfo0 = table0.VertexInfo(it, j);
+      const IVOLDUAL_TABLE_VERTEX_INFO & vinfo1 = table1.VertexInfo(it, j);
+
+      if (vinfo0.num_incident_poly != vinfo1.num_incident_poly ||
+          vinfo0.num_incident_isopoly != vinfo1.num_incident_isopoly ||
+          vinfo0.separation_vertex != vinfo1.separation_vertex ||
+          vinfo0.separation_edge != vinfo1.separation_edge ||
+          vinfo0.doubly_connected_facet !=
+          vinfo1.doubly_connected_facet ||
+          vinfo0.is_doubly_connected != vinfo1.is_doubly_connected ||
+          vinfo0.connect_dir != vinfo1.connect_dir ||
+          vinfo0.iso_connect_dir != vinfo1.iso_connect_dir) {
+        mismatch = "vertex info";
+        return(false);
+      }
+    }
+  }
+
+  return(true);
+}
@@ -0,0 +1,55 @@
+/// \file ivoldual_thread.txx
+/// templates for running ivoldual loops on multiple threads.
+/// - Templates are defined in ijkthread.txx in namespace IJK.
+/// Version 0.1.0
+
+/*
+  IJK: Isosurface Jeneration Kode
+  Copyright (C) 2017-2018 Rephael Wenger
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public License
+  (LGPL) as published by the Free Software Foundation; either
+  version 2.1 of the License, or any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef _IVOLDUAL_THREAD_
+#define _IVOLDUAL_THREAD_
+
+#include "ijkthread.txx"
+
+namespace IVOLDUAL {
+
+  // **************************************************
+  // SPLIT INTO RANGES
+  // **************************************************
+
+  using IJK::compute_num_thread_ranges;
+  using IJK::get_thread_range;
+
+
+  // **************************************************
+  // RUN ON MULTIPLE THREADS
+  // **************************************************
+
+  using IJK::run_on_thread_ranges;
+
+
+  // **************************************************
+  // CONCATENATE PER THREAD LISTS
+  // **************************************************
+
+  using IJK::append_thread_lists;
+
+}
+
+#endif
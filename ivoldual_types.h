@@ -73,6 +73,46 @@ namespace IVOLDUAL {
 
   typedef IJKDUAL::VERTEX_POSITION_METHOD VERTEX_POSITION_METHOD;
 
+  /// Stages of interval volume construction recorded 
+  ///   in IVOLDUAL_PROFILE.
+  typedef enum
+    { PROFILE_READ, PROFILE_ENCODE, PROFILE_EXTRACT, PROFILE_MERGE, 
+      PROFILE_TABLE_INFO, PROFILE_AMBIG_SPLIT, PROFILE_VERTEX_SPLIT, 
+      PROFILE_POSITION, PROFILE_ADJACENCY, PROFILE_IVOL_VERTEX_INFO,
+      PROFILE_EXPAND_THIN, PROFILE_INCIDENCE, 
+      PROFILE_SPLIT_HEX, PROFILE_COLLAPSE_HEX, 
+      PROFILE_LSMOOTH_ELENGTH, PROFILE_LSMOOTH_JACOBIAN, 
+      PROFILE_GSMOOTH_JACOBIAN, PROFILE_REPAIR_JACOBIAN, 
+      PROFILE_TRIANGULATE, PROFILE_WRITE,
+      NUM_PROFILE_STAGES }
+    PROFILE_STAGE;
+
+  /// Method for locating grid cubes in the list of active cubes.
+  /// - DENSE_CUBE_INDEX: Arrays with one entry per grid vertex.
+  /// - SPARSE_CUBE_INDEX: Hash table with size proportional
+  ///   to the number of active cubes.
+  /// - AUTO_CUBE_INDEX: Sparse if few cubes are active, else dense.
+  typedef enum
+    { AUTO_CUBE_INDEX, DENSE_CUBE_INDEX, SPARSE_CUBE_INDEX }
+    CUBE_INDEX_METHOD;
+
+  /// Reason mesh smoothing stopped.
+  /// - SMOOTH_NOT_RUN: Smoothing was not run.
+  /// - SMOOTH_STOP_MAX_ITERATIONS: Ran the given number of iterations.
+  /// - SMOOTH_STOP_NO_BAD_ELEMENTS: No hexahedra with Jacobian 
+  ///   below the Jacobian threshold.
+  /// - SMOOTH_STOP_MOVE_EPSILON: No vertex moved more than epsilon.
+  /// - SMOOTH_STOP_STALLED: Number of hexahedra with Jacobian
+  ///   below the Jacobian threshold stopped decreasing.
+  /// - SMOOTH_STOP_TIME_LIMIT: Wall clock time limit reached.
+  /// - SMOOTH_STOP_NO_IMPROVEMENT: Some hexahedra have Jacobian
+  ///   below the Jacobian threshold, but none can be improved.
+  typedef enum
+    { SMOOTH_NOT_RUN, SMOOTH_STOP_MAX_ITERATIONS, SMOOTH_STOP_NO_BAD_ELEMENTS,
+      SMOOTH_STOP_MOVE_EPSILON, SMOOTH_STOP_STALLED, SMOOTH_STOP_TIME_LIMIT,
+      SMOOTH_STOP_NO_IMPROVEMENT }
+    SMOOTH_STOP_REASON;
+
 }
 
 #endif
@@ -20,9 +20,77 @@
   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 */
 
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <mutex>
 #include <vector>
+
 #include "ivoldualtable.h"
 
+
+// **************************************************
+// BINARY TABLE FORMAT
+// **************************************************
+
+namespace {
+
+  const char IVOLDUAL_TABLE_MAGIC[8] = 
+    { 'I', 'V', 'O', 'L', 'T', 'B', 'L', '1' };
+
+  const int IVOLDUAL_TABLE_HEADER_LENGTH = 9;
+
+  template <typename T>
+  void write_binary(std::ostream & out, const T & x)
+  { out.write(reinterpret_cast<const char *>(&x), sizeof(T)); }
+
+  template <typename T, typename NTYPE>
+  void write_binary(std::ostream & out, const T * x, const NTYPE n)
+  {
+    if (n > 0) 
+      { out.write(reinterpret_cast<const char *>(x), sizeof(T)*n); }
+  }
+
+  template <typename T>
+  bool read_binary(std::istream & in, T & x)
+  { 
+    in.read(reinterpret_cast<char *>(&x), sizeof(T)); 
+    return(bool(in));
+  }
+
+  template <typename T, typename NTYPE>
+  bool read_binary(std::istream & in, T * x, const NTYPE n)
+  {
+    if (n > 0) 
+      { in.read(reinterpret_cast<char *>(x), sizeof(T)*n); }
+    return(bool(in));
+  }
+
+  // Set header of binary table.
+  // - Header includes the sizes of the table entry records,
+  //   so that tables written with a different entry layout are rejected.
+  void set_binary_table_header
+  (const IVOLDUAL::IVOLDUAL_CUBE_TABLE & table,
+   const int dimension, const bool flag_separate_neg,
+   const long num_table_entries,
+   long header[IVOLDUAL_TABLE_HEADER_LENGTH])
+  {
+    const IVOLDUAL::IVOLDUAL_TABLE_ENTRY * entry = NULL;
+
+    header[0] = dimension;
+    header[1] = flag_separate_neg;
+    header[2] = table.NumVertexTypes();
+    header[3] = num_table_entries;
+    header[4] = sizeof(entry->poly_vertex_info[0]);
+    header[5] = sizeof(entry->poly_edge_info[0]);
+    header[6] = sizeof(entry->ivolv_info[0]);
+    header[7] = sizeof(IVOLDUAL::IVOLDUAL_TABLE_VERTEX_INFO);
+    header[8] = sizeof(IVOLDUAL::TABLE_INDEX);
+  }
+
+}
+
+
 // **************************************************
 // CLASS IVOLDUAL_CUBE_TABLE MEMBER FUNCTIONS
 // **************************************************
@@ -38,3 +106,256 @@ void IVOLDUAL::IVOLDUAL_CUBE_TABLE::Init()
   determine_separation_edges(*this, vertex_info);
   determine_doubly_connected_ivol3D_vertices(*this, vertex_info);
 }
+
+
+// Write table entries and vertex_info to out in binary format.
+void IVOLDUAL::IVOLDUAL_CUBE_TABLE::WriteBinary(std::ostream & out) const
+{
+  long header[IVOLDUAL_TABLE_HEADER_LENGTH];
+
+  set_binary_table_header
+    (*this, Dimension(), FlagSeparateNeg(), NumTableEntries(), header);
+
+  write_binary(out, IVOLDUAL_TABLE_MAGIC, sizeof(IVOLDUAL_TABLE_MAGIC));
+  write_binary(out, header, IVOLDUAL_TABLE_HEADER_LENGTH);
+
+  for (TABLE_INDEX it = 0; it < NumTableEntries(); it++) {
+    const IVOLDUAL_TABLE_ENTRY & table_entry = entry[it];
+
+    write_binary(out, table_entry.NumVerticesInLowerLifted());
+    write_binary(out, table_entry.NumVerticesInUpperLifted());
+    write_binary(out, table_entry.lower_isosurface_table_index);
+    write_binary(out, table_entry.upper_isosurface_table_index);
+    write_binary(out, table_entry.is_non_manifold);
+    write_binary(out, table_entry.is_ambiguous);
+    write_binary(out, table_entry.num_ambiguous_facets);
+    write_binary(out, table_entry.num_active_facets);
+    write_binary(out, table_entry.ambiguous_facet_bits);
+    write_binary(out, table_entry.ambiguous_facet_bits_in_lower_lifted);
+    write_binary(out, table_entry.ambiguous_facet_bits_in_upper_lifted);
+    write_binary
+      (out, table_entry.poly_vertex_info, NumPolyVertices());
+    write_binary
+      (out, table_entry.poly_edge_info, NumPolyEdges());
+    write_binary
+      (out, table_entry.ivolv_info, table_entry.NumVertices());
+  }
+
+  write_binary(out, vertex_info.element.data(), vertex_info.element.size());
+}
+
+
+// Read table entries and vertex_info written by WriteBinary().
+bool IVOLDUAL::IVOLDUAL_CUBE_TABLE::ReadBinary
+(std::istream & in, const int dimension, const bool flag_separate_neg)
+{
+  char magic[sizeof(IVOLDUAL_TABLE_MAGIC)];
+  long header[IVOLDUAL_TABLE_HEADER_LENGTH];
+  long expected_header[IVOLDUAL_TABLE_HEADER_LENGTH];
+
+  if (!read_binary(in, magic, sizeof(magic))) { return(false); }
+  if (!std::equal(magic, magic+sizeof(magic), IVOLDUAL_TABLE_MAGIC))
+    { return(false); }
+  if (!read_binary(in, header, IVOLDUAL_TABLE_HEADER_LENGTH)) 
+    { return(false); }
+
+  // Compute number of table entries as in IVOLDUAL_CUBE_DOUBLE_TABLE::Create.
+  SetToCube(dimension);
+  cube.SetDimension(dimension);
+  this->flag_separate_neg = flag_separate_neg;
+  const TABLE_INDEX num_table_entries = 2*IJKDUALTABLE::calculate_num_entries
+    <TABLE_INDEX>(NumPolyVertices(), NumVertexTypes());
+
+  set_binary_table_header
+    (*this, dimension, flag_separate_neg, num_table_entries, 
+     expected_header);
+  if (!std::equal(header, header+IVOLDUAL_TABLE_HEADER_LENGTH,
+                  expected_header))
+    { return(false); }
+
+  SetNumTableEntries(num_table_entries);
+
+  for (TABLE_INDEX it = 0; it < NumTableEntries(); it++) {
+    IVOLDUAL_TABLE_ENTRY & table_entry = entry[it];
+    int numv_in_lower_lifted, numv_in_upper_lifted;
+
+    read_binary(in, numv_in_lower_lifted);
+    if (!read_binary(in, numv_in_upper_lifted)) { return(false); }
+    if (numv_in_lower_lifted < 0 || numv_in_upper_lifted < 0 ||
+        numv_in_lower_lifted+numv_in_upper_lifted > NumPolyVertices())
+      { return(false); }
+
+    table_entry.CreateIntervalVolumeVertices
+      (numv_in_lower_lifted, numv_in_upper_lifted);
+
+    read_binary(in, table_entry.lower_isosurface_table_index);
+    read_binary(in, table_entry.upper_isosurface_table_index);
+    read_binary(in, table_entry.is_non_manifold);
+    read_binary(in, table_entry.is_ambiguous);
+    read_binary(in, table_entry.num_ambiguous_facets);
+    read_binary(in, table_entry.num_active_facets);
+    read_binary(in, table_entry.ambiguous_facet_bits);
+    read_binary(in, table_entry.ambiguous_facet_bits_in_lower_lifted);
+    read_binary(in, table_entry.ambiguous_facet_bits_in_upper_lifted);
+    read_binary
+      (in, table_entry.poly_vertex_info, NumPolyVertices());
+    read_binary
+      (in, table_entry.poly_edge_info, NumPolyEdges());
+    if (!read_binary
+        (in, table_entry.ivolv_info, table_entry.NumVertices()))
+      { return(false); }
+  }
+
+  vertex_info.Set(*this);
+  if (!read_binary
+      (in, vertex_info.element.data(), vertex_info.element.size()))
+    { return(false); }
+
+  return(true);
+}
+
+
+// **************************************************
+// TABLE CACHE
+// **************************************************
+
+namespace {
+
+  typedef std::unique_ptr<IVOLDUAL::IVOLDUAL_CUBE_TABLE> 
+  IVOLDUAL_CUBE_TABLE_PTR;
+  typedef std::unique_ptr<IJKDUAL::ISODUAL_CUBE_TABLE_AMBIG> 
+  ISODUAL_CUBE_TABLE_AMBIG_PTR;
+
+  // Cached tables.
+  // - Tables are never removed from the cache, so references
+  //   returned by the get functions remain valid.
+  class TABLE_CACHE {
+
+  public:
+    std::mutex mutex;
+    std::vector<IVOLDUAL_CUBE_TABLE_PTR> ivoldual_table;
+    std::vector<ISODUAL_CUBE_TABLE_AMBIG_PTR> isodual_table;
+
+    // ivoldual_table_filename[i] is the list of files 
+    //   from which ivoldual_table[i] was read or to which it was written.
+    std::vector< std::vector<std::string> > ivoldual_table_filename;
+
+    // isodual_table[i] was created with flag_separate_neg 
+    //   isodual_separate_neg[i] and flag_separate_opposite
+    //   isodual_separate_opposite[i].
+    std::vector<bool> isodual_separate_neg;
+    std::vector<bool> isodual_separate_opposite;
+  };
+
+  TABLE_CACHE table_cache;
+
+  // Write table to table_filename.
+  void write_ivoldual_cube_table
+  (const IVOLDUAL::IVOLDUAL_CUBE_TABLE & table, 
+   const std::string & table_filename)
+  {
+    std::ofstream out(table_filename.c_str(), std::ios::binary);
+    if (out) { table.WriteBinary(out); }
+  }
+
+  // Create table and write it to table_filename.
+  // - If table_filename is not empty, first try to read table 
+  //   from table_filename.
+  IVOLDUAL_CUBE_TABLE_PTR create_ivoldual_cube_table
+  (const int dimension, const bool flag_separate_neg,
+   const std::string & table_filename)
+  {
+    using namespace IVOLDUAL;
+
+    if (table_filename != "") {
+      std::ifstream in(table_filename.c_str(), std::ios::binary);
+
+      if (in) {
+        IVOLDUAL_CUBE_TABLE_PTR table(new IVOLDUAL_CUBE_TABLE);
+        if (table->ReadBinary(in, dimension, flag_separate_neg))
+          { return(table); }
+      }
+    }
+
+    IVOLDUAL_CUBE_TABLE_PTR table
+      (new IVOLDUAL_CUBE_TABLE(dimension, flag_separate_neg));
+
+    if (table_filename != "") 
+      { write_ivoldual_cube_table(*table, table_filename); }
+
+    return(table);
+  }
+
+}
+
+
+const IVOLDUAL::IVOLDUAL_CUBE_TABLE & IVOLDUAL::get_ivoldual_cube_table
+(const int dimension, const bool flag_separate_neg)
+{
+  return(get_ivoldual_cube_table(dimension, flag_separate_neg, ""));
+}
+
+
+// Return interval volume lookup table.
+// - If the table is already cached, write it to table_filename
+//   unless it was already read from or written to table_filename.
+const IVOLDUAL::IVOLDUAL_CUBE_TABLE & IVOLDUAL::get_ivoldual_cube_table
+(const int dimension, const bool flag_separate_neg,
+ const std::string & table_filename)
+{
+  std::lock_guard<std::mutex> lock(table_cache.mutex);
+
+  for (std::size_t i = 0; i < table_cache.ivoldual_table.size(); i++) {
+    const IVOLDUAL_CUBE_TABLE & table = *table_cache.ivoldual_table[i];
+    if (table.Dimension() == dimension &&
+        table.FlagSeparateNeg() == flag_separate_neg) {
+
+      std::vector<std::string> & filename = 
+        table_cache.ivoldual_table_filename[i];
+      if (table_filename != "" &&
+          std::find(filename.begin(), filename.end(), table_filename) ==
+          filename.end()) {
+        write_ivoldual_cube_table(table, table_filename);
+        filename.push_back(table_filename);
+      }
+
+      return(table);
+    }
+  }
+
+  table_cache.ivoldual_table.push_back
+    (create_ivoldual_cube_table
+     (dimension, flag_separate_neg, table_filename));
+  table_cache.ivoldual_table_filename.push_back(std::vector<std::string>());
+  if (table_filename != "") 
+    { table_cache.ivoldual_table_filename.back().push_back(table_filename); }
+
+  return(*table_cache.ivoldual_table.back());
+}
+
+
+const IJKDUAL::ISODUAL_CUBE_TABLE_AMBIG & 
+IVOLDUAL::get_isodual_cube_table_ambig
+(const int dimension, const bool flag_separate_neg,
+ const bool flag_separate_opposite)
+{
+  std::lock_guard<std::mutex> lock(table_cache.mutex);
+
+  for (std::size_t i = 0; i < table_cache.isodual_table.size(); i++) {
+    const IJKDUAL::ISODUAL_CUBE_TABLE_AMBIG * table = 
+      table_cache.isodual_table[i].get();
+    if (table->Dimension() == dimension &&
+        table_cache.isodual_separate_neg[i] == flag_separate_neg &&
+        table_cache.isodual_separate_opposite[i] == flag_separate_opposite)
+      { return(*table); }
+  }
+
+  table_cache.isodual_table.push_back
+    (ISODUAL_CUBE_TABLE_AMBIG_PTR
+     (new IJKDUAL::ISODUAL_CUBE_TABLE_AMBIG
+      (dimension, flag_separate_neg, flag_separate_opposite)));
+  table_cache.isodual_separate_neg.push_back(flag_separate_neg);
+  table_cache.isodual_separate_opposite.push_back(flag_separate_opposite);
+
+  return(*table_cache.isodual_table.back());
+}
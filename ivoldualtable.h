@@ -23,9 +23,13 @@
 #ifndef _IVOLDUALTABLE_
 #define _IVOLDUALTABLE_
 
+#include <iostream>
+#include <string>
+
 #include "ijkcube.txx"
 #include "ijkdualtableX.txx"
 
+#include "ijkdual_datastruct.h"
 #include "ivoldual_types.h"
 
 
@@ -109,6 +113,10 @@ namespace IVOLDUAL {
     vertex_info;
 
   public:
+    /// Constructor.
+    /// - Creates an empty table.  Use ReadBinary() to fill the table.
+    IVOLDUAL_CUBE_TABLE() {};
+
     IVOLDUAL_CUBE_TABLE(const int dimension, const bool flag_separate_neg):
       IVOLDUAL_CUBE_DOUBLE_TABLE(dimension, flag_separate_neg)
     { Init(); }; 
@@ -116,8 +124,55 @@ namespace IVOLDUAL {
     const IVOLDUAL_TABLE_VERTEX_INFO & VertexInfo
     (const TABLE_INDEX ientry, const int ivolv) const
     { return(vertex_info.VertexInfo(ientry, ivolv)); }
+
+    /// Write table entries and vertex_info to out in binary format.
+    void WriteBinary(std::ostream & out) const;
+
+    /// Read table entries and vertex_info written by WriteBinary().
+    /// - Return false if in does not contain a table 
+    ///   with the given dimension and flag_separate_neg
+    ///   written with the same table entry layout.
+    /// @pre Table is empty, i.e., created with the default constructor.
+    bool ReadBinary(std::istream & in, const int dimension, 
+                    const bool flag_separate_neg);
   };
 
+
+  // **************************************************
+  // TABLE CACHE
+  // **************************************************
+
+  /// Return interval volume lookup table for dimension 
+  ///   and flag_separate_neg.
+  /// - The table is created on the first call with a given
+  ///   (dimension, flag_separate_neg) and reused by later calls.
+  /// - Thread safe.
+  const IVOLDUAL_CUBE_TABLE & get_ivoldual_cube_table
+  (const int dimension, const bool flag_separate_neg);
+
+  /// Return interval volume lookup table for dimension 
+  ///   and flag_separate_neg.
+  /// - Version which reads the table from table_filename, if possible,
+  ///   instead of creating it.
+  /// - If table_filename cannot be read or contains a different table, 
+  ///   create the table and write it to table_filename.
+  /// - If table_filename is empty, do not read or write any file.
+  /// - If the table is already cached, it is not read from table_filename.
+  ///   Instead, the cached table is written to table_filename,
+  ///   unless it was already read from or written to table_filename.
+  const IVOLDUAL_CUBE_TABLE & get_ivoldual_cube_table
+  (const int dimension, const bool flag_separate_neg,
+   const std::string & table_filename);
+
+  /// Return isosurface lookup table for dimension, flag_separate_neg
+  ///   and flag_separate_opposite.
+  /// - The table is created on the first call with the given parameters
+  ///   and reused by later calls.
+  /// - Thread safe.
+  const IJKDUAL::ISODUAL_CUBE_TABLE_AMBIG & get_isodual_cube_table_ambig
+  (const int dimension, const bool flag_separate_neg,
+   const bool flag_separate_opposite);
+
 }
 
 #endif